@@ -3,31 +3,180 @@
 /* Author: Christopher Moretti                                        */
 /*--------------------------------------------------------------------*/
 
+/* pthread_rwlock_t is an XSI extension beyond ISO C */
+#define _XOPEN_SOURCE 600
+
 #include <stdlib.h>
 #include <assert.h>
 #include <string.h>
-#include "dynarray.h"
+#include <pthread.h>
+#include "arena.h"
+#include "btarray.h"
+#include "epoch.h"
+#include "hashtable.h"
+#include "pool.h"
 #include "NodeFT.h"
 
+/* The number of children beyond which a directory also files its
+   children by name in a hash table */
+static const size_t HASH_THRESHOLD = 32;
+
 /* A NodeFT in a FT */
 struct NodeFT {
-   /* the object corresponding to the NodeFT's absolute path */
-   Path_T oPPath;
-   /* this NodeFT's parent */
+   /* the final component of this NodeFT's absolute path; the rest of
+      the path is recovered on demand by following oNParent */
+   const char *pcName;
+   /* the string length of pcName */
+   size_t ulNameLength;
+   /* this NodeFT's parent in the live FT; a snapshot never follows
+      it, since a NodeFT it shares may point to the live FT's copy of
+      the parent it lists */
    Node_T oNParent;
    /* the object containing links to this NodeFT's file children */
-   DynArray_T oDFiles;
+   BTArray_T oDFiles;
    /* the object containing links to this NodeFT's directory children*/
-   DynArray_T oDDirectories;
+   BTArray_T oDDirectories;
+   /* all children of both kinds, filed by name, or NULL while this
+      NodeFT has no more than HASH_THRESHOLD children */
+   HashTable_T oHChildren;
    /* the boolean representing if the NodeFT is a file */
    boolean isFile;
    /* pointer to the object itself of the file */
    void* pvFile;
    /*Size of file*/
    size_t fileSize;
+   /* the number of NodeFTs beneath this one, of both kinds, kept so
+      that a subtree can be counted out without walking it */
+   size_t ulDescendants;
+   /* the number of directories that list this NodeFT, or of FTs that
+      hold it as their root; above one, a snapshot shares it, and
+      nothing a snapshot reads may change until NodeFT_unshare has
+      given the live FT a copy of its own */
+   size_t ulRefs;
+   /* held by a synchronized FT's calls as they pass through or change
+      this NodeFT (see ft.c) */
+   pthread_rwlock_t sLock;
+   /* the arena that this NodeFT and everything allocated for it come
+      from, or NULL if they come from the heap; a NodeFT's children and
+      copies use the same one */
+   Arena_T oArena;
 };
 
 
+/*
+  Returns a block of ulSize bytes from oArena, or if oArena is NULL
+  from the pool, or from malloc if it is too large for the pool, or
+  NULL if memory could not be allocated.
+*/
+static void *NodeFT_alloc(Arena_T oArena, size_t ulSize) {
+   if(oArena != NULL)
+      return Arena_alloc(oArena, ulSize);
+   if(ulSize <= POOL_MAX_SIZE)
+      return Pool_alloc(ulSize);
+   return malloc(ulSize);
+}
+
+/*
+  Frees pv, a block of ulSize bytes that NodeFT_alloc took from
+  oArena, through Epoch_releaseWith. A block from an arena is left for
+  the arena to release.
+*/
+static void NodeFT_discard(Arena_T oArena, void *pv, size_t ulSize) {
+   if(oArena != NULL)
+      return;
+   if(ulSize <= POOL_MAX_SIZE)
+      Epoch_releaseWith(pv, Pool_free);
+   else
+      Epoch_releaseWith(pv, free);
+}
+
+/* A path component that is not necessarily '\0'-terminated */
+struct NodeFT_name {
+   /* the first character of the component */
+   const char *pcName;
+   /* the number of characters in the component */
+   size_t ulLength;
+};
+
+/*
+  Compares the name of oNFirst with the component described by
+  psSecond. Returns <0, 0, or >0 if oNFirst is "less than", "equal to",
+  or "greater than" psSecond, respectively. Since all children of a
+  NodeFT share the same parent path, this is also the order of their
+  absolute paths within one children array.
+*/
+static int NodeFT_compareName(const Node_T oNFirst,
+                              const struct NodeFT_name *psSecond) {
+   int iCompare;
+
+   assert(oNFirst != NULL);
+   assert(psSecond != NULL);
+
+   /* a lookup may race with NodeFT_relink renaming oNFirst; either
+      name is '\0'-terminated, so a mismatched pair is still safe */
+   iCompare = strncmp(__atomic_load_n(&oNFirst->pcName,
+                                      __ATOMIC_ACQUIRE),
+                      psSecond->pcName, psSecond->ulLength);
+   if(iCompare != 0)
+      return iCompare;
+   /* equal up to ulLength: the longer component is the greater */
+   return (__atomic_load_n(&oNFirst->ulNameLength, __ATOMIC_RELAXED) >
+           psSecond->ulLength);
+}
+
+
+/*
+  Returns nonzero if the name of pvNode, a Node_T, is the component
+  described by pvName, a struct NodeFT_name. Used to confirm hits in
+  oHChildren.
+*/
+static int NodeFT_matchName(const void *pvNode, const void *pvName) {
+   return NodeFT_compareName((Node_T) pvNode,
+                             (const struct NodeFT_name *) pvName) == 0;
+}
+
+/* Returns the hash under which oNChild is filed in oHChildren. */
+static size_t NodeFT_hashName(Node_T oNChild) {
+   assert(oNChild != NULL);
+
+   return HashTable_hash(HASHTABLE_SEED, oNChild->pcName,
+                         oNChild->ulNameLength);
+}
+
+/*
+  Builds oNParent->oHChildren from its children arrays, once it has
+  outgrown HASH_THRESHOLD. The table only speeds up lookups, so if
+  memory runs out oNParent is simply left without one.
+*/
+static void NodeFT_buildChildTable(Node_T oNParent) {
+   HashTable_T oHChildren;
+   BTArray_T aoDArrays[2];
+   Node_T oNChild;
+   size_t a, c;
+
+   assert(oNParent != NULL);
+   assert(oNParent->oHChildren == NULL);
+
+   oHChildren = HashTable_newIn(oNParent->oArena);
+   if(oHChildren == NULL)
+      return;
+
+   aoDArrays[0] = oNParent->oDFiles;
+   aoDArrays[1] = oNParent->oDDirectories;
+   for(a = 0; a < 2; a++) {
+      for(c = 0; c < BTArray_getLength(aoDArrays[a]); c++) {
+         oNChild = BTArray_get(aoDArrays[a], c);
+         if(!HashTable_add(oHChildren, NodeFT_hashName(oNChild),
+                           oNChild)) {
+            HashTable_free(oHChildren);
+            return;
+         }
+      }
+   }
+   __atomic_store_n(&oNParent->oHChildren, oHChildren,
+                    __ATOMIC_RELEASE);
+}
+
 /*
   Links new child oNChild into oNParent's children array at index
   ulIndex. Returns SUCCESS if the new child was added successfully,
@@ -37,137 +186,133 @@ static int NodeFT_addChild(Node_T oNParent, Node_T oNChild,
                          size_t ulIndex) {
    assert(oNParent != NULL);
    assert(oNChild != NULL);
-   
+
    /* If we get a directionry child */
    if(!oNChild->isFile) {
-      if(DynArray_addAt(oNParent->oDDirectories, ulIndex, oNChild))
-         return SUCCESS; /* insert into Directory*/
-      else 
+      if(!BTArray_addAt(oNParent->oDDirectories, ulIndex, oNChild))
          return MEMORY_ERROR;
    }
-   else { 
-      if(DynArray_addAt(oNParent->oDFiles, ulIndex, oNChild))
-         return SUCCESS; /* insert into Directory*/
-      else 
+   else {
+      if(!BTArray_addAt(oNParent->oDFiles, ulIndex, oNChild))
          return MEMORY_ERROR;
    }
+
+   /* keep the name table in step with the arrays */
+   if(oNParent->oHChildren != NULL) {
+      if(!HashTable_add(oNParent->oHChildren, NodeFT_hashName(oNChild),
+                        oNChild)) {
+         if(!oNChild->isFile)
+            (void) BTArray_removeAt(oNParent->oDDirectories, ulIndex);
+         else
+            (void) BTArray_removeAt(oNParent->oDFiles, ulIndex);
+         return MEMORY_ERROR;
+      }
+   }
+   else if(NodeFT_getNumChildren(oNParent) > HASH_THRESHOLD)
+      NodeFT_buildChildTable(oNParent);
+
+   return SUCCESS;
 }
 
 /*
-  Compares the string representation of oNfirst with a string
-  pcSecond representing a NodeFT's path.
-  Returns <0, 0, or >0 if oNFirst is "less than", "equal to", or
-  "greater than" pcSecond, respectively.
+  Adds ulValue to the descendant counts of oNNodeFT and each of its
+  ancestors. Inserts along different paths may update a shared
+  ancestor at once.
 */
-   static int NodeFT_compareString(const Node_T oNFirst,
-                                 const char *pcSecond) {
-   assert(oNFirst != NULL);
-   assert(pcSecond != NULL);
-
-   return Path_compareString(oNFirst->oPPath, pcSecond); 
-} 
+static void NodeFT_addDescendants(Node_T oNNodeFT, size_t ulValue) {
+   for(; oNNodeFT != NULL; oNNodeFT = oNNodeFT->oNParent)
+      (void) __atomic_add_fetch(&oNNodeFT->ulDescendants, ulValue,
+                                __ATOMIC_RELAXED);
+}
 
+/* Subtracts ulValue from the descendant counts of oNNodeFT and each
+   of its ancestors */
+static void NodeFT_subtractDescendants(Node_T oNNodeFT,
+                                       size_t ulValue) {
+   for(; oNNodeFT != NULL; oNNodeFT = oNNodeFT->oNParent)
+      (void) __atomic_sub_fetch(&oNNodeFT->ulDescendants, ulValue,
+                                __ATOMIC_RELAXED);
+}
 
 /*
-  Creates a new NodeFT with path oPPath and parent oNParent. Returns an
-  int SUCCESS status and sets *poNResult to be the new NodeFT if
-  successful. Otherwise, sets *poNResult to NULL and returns status:
+  Creates a new NodeFT named by the ulNameLength characters at pcName
+  with parent oNParent. Returns an int SUCCESS status and sets
+  *poNResult to be the new NodeFT if successful. Otherwise, sets
+  *poNResult to NULL and returns status:
   * MEMORY_ERROR if memory could not be allocated to complete request
-  * CONFLICTING_PATH if oNParent's path is not an ancestor of oPPath
-  * NO_SUCH_PATH if oPPath is of depth 0
-                 or oNParent's path is not oPPath's direct parent
-                 or oNParent is NULL but oPPath is not of depth 1
-  * ALREADY_IN_TREE if oNParent already has a child with this path
+  * NOT_A_DIRECTORY if oNParent is a file
+  * ALREADY_IN_TREE if oNParent already has a child of that name
 */
-int NodeFT_new(Path_T oPPath, Node_T oNParent, boolean isFile,
- void* pvFile, size_t fileSize, Node_T *poNResult) {
+int NodeFT_new(const char *pcName, size_t ulNameLength,
+ Node_T oNParent, boolean isFile, void* pvFile, size_t fileSize,
+ Arena_T oArena, Node_T *poNResult) {
    struct NodeFT *psNew;
-   Path_T oPParentPath = NULL;
-   Path_T oPNewPath = NULL;
-   size_t ulParentDepth;
+   size_t ulSize;
    size_t ulIndex;
    int iStatus;
 
-   assert(oPPath != NULL);
-
-   /* allocate space for a new NodeFT */
-   psNew = malloc(sizeof(struct NodeFT));
-   if(psNew == NULL) {
-      *poNResult = NULL;
-      return MEMORY_ERROR;
-   }
-
-   /* set the new NodeFT's path */
-   iStatus = Path_dup(oPPath, &oPNewPath);
-   if(iStatus != SUCCESS) {
-      free(psNew);
-      *poNResult = NULL;
-      return iStatus;
-   }
-   psNew->oPPath = oPNewPath;
+   assert(pcName != NULL);
+   assert(poNResult != NULL);
+   assert(oNParent == NULL || oNParent->oArena == oArena);
 
-   /* validate and set the new NodeFT's parent */
    if(oNParent != NULL) {
-      size_t ulSharedDepth;
-
-      oPParentPath = oNParent->oPPath;
-      ulParentDepth = Path_getDepth(oPParentPath);
-      ulSharedDepth = Path_getSharedPrefixDepth(psNew->oPPath,
-                                                oPParentPath);
-      /* parent must be an ancestor of child */
-      if(ulSharedDepth < ulParentDepth) {
-         Path_free(psNew->oPPath);
-         free(psNew);
+      /* files cannot have children */
+      if(oNParent->isFile) {
          *poNResult = NULL;
-         return CONFLICTING_PATH;
+         return NOT_A_DIRECTORY;
       }
-
-      /* parent must be exactly one level up from child */
-      if(Path_getDepth(psNew->oPPath) != ulParentDepth + 1) {
-         Path_free(psNew->oPPath);
-         free(psNew);
-         *poNResult = NULL;
-         return NO_SUCH_PATH;
-      }
-
-      /* parent must not already have child with this path */
-      if(NodeFT_hasDirectoryChild(oNParent, oPPath, &ulIndex) || NodeFT_hasFileChild(oNParent, oPPath, &ulIndex)) {
-         Path_free(psNew->oPPath);
-         free(psNew);
+      /* parent must not already have child with this name */
+      if(NodeFT_findChild(oNParent, pcName, ulNameLength) != NULL) {
          *poNResult = NULL;
          return ALREADY_IN_TREE;
       }
    }
-   else {
-      /* new NodeFT must be root */
-      /* can only create one "level" at a time */
-      if(Path_getDepth(psNew->oPPath) != 1) {
-         Path_free(psNew->oPPath);
-         free(psNew);
-         *poNResult = NULL;
-         return NO_SUCH_PATH;
-      }
+
+   /* allocate space for a new NodeFT, with its name stored
+      immediately after the struct in the same block */
+   ulSize = sizeof(struct NodeFT) + ulNameLength + 1;
+   psNew = NodeFT_alloc(oArena, ulSize);
+   if(psNew == NULL) {
+      *poNResult = NULL;
+      return MEMORY_ERROR;
    }
+   if(pthread_rwlock_init(&psNew->sLock, NULL) != 0) {
+      NodeFT_discard(oArena, psNew, ulSize);
+      *poNResult = NULL;
+      return MEMORY_ERROR;
+   }
+   psNew->oArena = oArena;
+   memcpy((char *) (psNew + 1), pcName, ulNameLength);
+   ((char *) (psNew + 1))[ulNameLength] = '\0';
+   psNew->pcName = (const char *) (psNew + 1);
+   psNew->ulNameLength = ulNameLength;
    psNew->oNParent = oNParent;
+   psNew->oHChildren = NULL;
+   psNew->ulDescendants = 0;
+   psNew->ulRefs = 1;
 
    /* initialize the new NodeFT */
    psNew->isFile = isFile;
    if(isFile) {
       psNew->pvFile = pvFile;
+      psNew->fileSize = fileSize;
       psNew->oDFiles = NULL;
       psNew->oDDirectories = NULL;
    } else {
-      psNew->oDFiles = DynArray_new(0);
+      psNew->pvFile = NULL;
+      psNew->fileSize = 0;
+      psNew->oDFiles = BTArray_newIn(oArena);
       if(psNew->oDFiles == NULL) {
-         Path_free(psNew->oPPath);
-         free(psNew);
+         (void) pthread_rwlock_destroy(&psNew->sLock);
+         NodeFT_discard(oArena, psNew, ulSize);
          *poNResult = NULL;
          return MEMORY_ERROR;
       }
-      psNew->oDDirectories = DynArray_new(0);
+      psNew->oDDirectories = BTArray_newIn(oArena);
       if(psNew->oDDirectories == NULL) {
-         Path_free(psNew->oPPath);
-         free(psNew);
+         BTArray_free(psNew->oDFiles);
+         (void) pthread_rwlock_destroy(&psNew->sLock);
+         NodeFT_discard(oArena, psNew, ulSize);
          *poNResult = NULL;
          return MEMORY_ERROR;
       }
@@ -175,18 +320,25 @@ int NodeFT_new(Path_T oPPath, Node_T oNParent, boolean isFile,
    /* Link into parent's children list */
    if(oNParent != NULL) {
       if(isFile) {
-         (void) (NodeFT_hasFileChild(oNParent, psNew->oPPath, &ulIndex));
+         (void) NodeFT_hasFileChildName(oNParent, pcName, ulNameLength,
+                                        &ulIndex);
       }
        else {
-         (void) (NodeFT_hasDirectoryChild(oNParent, psNew->oPPath, &ulIndex));
+         (void) NodeFT_hasDirectoryChildName(oNParent, pcName,
+                                             ulNameLength, &ulIndex);
       }
       iStatus = NodeFT_addChild(oNParent, psNew, ulIndex);
       if(iStatus != SUCCESS) {
-         Path_free(psNew->oPPath);
-         free(psNew);
+         if(!isFile) {
+            BTArray_free(psNew->oDFiles);
+            BTArray_free(psNew->oDDirectories);
+         }
+         (void) pthread_rwlock_destroy(&psNew->sLock);
+         NodeFT_discard(oArena, psNew, ulSize);
          *poNResult = NULL;
          return iStatus;
       }
+      NodeFT_addDescendants(oNParent, 1);
    }
 
    *poNResult = psNew;
@@ -194,102 +346,621 @@ int NodeFT_new(Path_T oPPath, Node_T oNParent, boolean isFile,
    return SUCCESS;
 }
 
-size_t NodeFT_free(Node_T oNNodeFT) {
+int NodeFT_newUnlinked(const char *pcName, size_t ulNameLength,
+                       Node_T oNParent, boolean isFile, void *pvFile,
+                       size_t fileSize, Arena_T oArena,
+                       Node_T *poNResult) {
+   struct NodeFT *psNew;
+   size_t ulSize;
+
+   assert(pcName != NULL);
+   assert(poNResult != NULL);
+   assert(oNParent == NULL || oNParent->oArena == oArena);
+
+   /* the name is stored immediately after the struct, as in
+      NodeFT_new */
+   ulSize = sizeof(struct NodeFT) + ulNameLength + 1;
+   psNew = NodeFT_alloc(oArena, ulSize);
+   if(psNew == NULL) {
+      *poNResult = NULL;
+      return MEMORY_ERROR;
+   }
+   if(pthread_rwlock_init(&psNew->sLock, NULL) != 0) {
+      NodeFT_discard(oArena, psNew, ulSize);
+      *poNResult = NULL;
+      return MEMORY_ERROR;
+   }
+   psNew->oArena = oArena;
+   memcpy((char *) (psNew + 1), pcName, ulNameLength);
+   ((char *) (psNew + 1))[ulNameLength] = '\0';
+   psNew->pcName = (const char *) (psNew + 1);
+   psNew->ulNameLength = ulNameLength;
+   psNew->oNParent = oNParent;
+   psNew->oHChildren = NULL;
+   psNew->ulDescendants = 0;
+   psNew->ulRefs = 1;
+
+   /* a directory's arrays wait for NodeFT_setChildren */
+   psNew->isFile = isFile;
+   psNew->pvFile = isFile ? pvFile : NULL;
+   psNew->fileSize = isFile ? fileSize : 0;
+   psNew->oDFiles = NULL;
+   psNew->oDDirectories = NULL;
+
+   *poNResult = psNew;
+   return SUCCESS;
+}
+
+int NodeFT_setChildren(Node_T oNParent, Node_T *aoNFiles,
+                       size_t ulNumFiles, Node_T *aoNDirectories,
+                       size_t ulNumDirectories) {
+   size_t ulDescendants;
+   size_t ul;
+
+   assert(oNParent != NULL);
+   assert(!oNParent->isFile);
+   assert(oNParent->oDFiles == NULL);
+   assert(ulNumFiles == 0 || aoNFiles != NULL);
+   assert(ulNumDirectories == 0 || aoNDirectories != NULL);
+
+   oNParent->oDFiles = BTArray_newFromIn(oNParent->oArena,
+                                         (const void **) aoNFiles,
+                                         ulNumFiles);
+   if(oNParent->oDFiles == NULL)
+      return MEMORY_ERROR;
+   oNParent->oDDirectories =
+      BTArray_newFromIn(oNParent->oArena,
+                        (const void **) aoNDirectories,
+                        ulNumDirectories);
+   if(oNParent->oDDirectories == NULL) {
+      BTArray_free(oNParent->oDFiles);
+      oNParent->oDFiles = NULL;
+      return MEMORY_ERROR;
+   }
+
+   if(ulNumFiles + ulNumDirectories > HASH_THRESHOLD)
+      NodeFT_buildChildTable(oNParent);
+
+   /* the directories' own children were set before oNParent's */
+   ulDescendants = ulNumFiles + ulNumDirectories;
+   for(ul = 0; ul < ulNumDirectories; ul++)
+      ulDescendants += aoNDirectories[ul]->ulDescendants;
+   oNParent->ulDescendants = ulDescendants;
+   return SUCCESS;
+}
+
+size_t NodeFT_detach(Node_T oNNodeFT) {
+   Node_T oNParent;
    size_t ulIndex;
+   size_t ulNodes;
+
+   assert(oNNodeFT != NULL);
+
+   ulNodes = oNNodeFT->ulDescendants + 1;
+   oNParent = oNNodeFT->oNParent;
+   if(oNParent == NULL)
+      return ulNodes;
+   assert(oNParent->oDFiles != NULL);
+
+   /* remove from parent's name table and list */
+   if(oNParent->oHChildren != NULL)
+      (void) HashTable_remove(oNParent->oHChildren,
+                              NodeFT_hashName(oNNodeFT), oNNodeFT);
+   if(oNNodeFT->isFile) {
+      if(NodeFT_hasFileChildName(oNParent, oNNodeFT->pcName,
+                                 oNNodeFT->ulNameLength, &ulIndex))
+         (void) BTArray_removeAt(oNParent->oDFiles, ulIndex);
+   }
+   else {
+      if(NodeFT_hasDirectoryChildName(oNParent, oNNodeFT->pcName,
+                                      oNNodeFT->ulNameLength, &ulIndex))
+         (void) BTArray_removeAt(oNParent->oDDirectories, ulIndex);
+   }
+
+   NodeFT_subtractDescendants(oNParent, ulNodes);
+   __atomic_store_n(&oNNodeFT->oNParent, NULL, __ATOMIC_RELAXED);
+   return ulNodes;
+}
+
+/* Sets oNNodeFT's name to the ulLength characters at pcName */
+static void NodeFT_setName(Node_T oNNodeFT, const char *pcName,
+                           size_t ulLength) {
+   assert(oNNodeFT != NULL);
+   assert(pcName != NULL);
+
+   /* the name's characters must be visible before the pointer */
+   __atomic_store_n(&oNNodeFT->pcName, pcName, __ATOMIC_RELEASE);
+   __atomic_store_n(&oNNodeFT->ulNameLength, ulLength,
+                    __ATOMIC_RELAXED);
+}
+
+int NodeFT_relink(Node_T oNNodeFT, Node_T oNNewParent,
+                  const char *pcNewName, size_t ulNewLength) {
+   Node_T oNOldParent;
+   const char *pcOldName;
+   size_t ulOldLength;
+   char *pcName = NULL;
+   size_t ulOldHash = 0;
+   size_t ulOldIndex = 0;
+   size_t ulNewIndex = 0;
+   boolean bHadTable = FALSE;
+   HashTable_T oHChildren;
+   size_t ulNodes;
+   int iStatus;
+
+   assert(oNNodeFT != NULL);
+   assert(pcNewName != NULL);
+   assert(oNNewParent == NULL || !oNNewParent->isFile);
+   assert(oNNewParent != NULL || oNNodeFT->oNParent == NULL);
+
+   oNOldParent = oNNodeFT->oNParent;
+   pcOldName = oNNodeFT->pcName;
+   ulOldLength = oNNodeFT->ulNameLength;
+
+   /* find both places while every array is still sorted */
+   if(oNOldParent != NULL) {
+      ulOldHash = NodeFT_hashName(oNNodeFT);
+      bHadTable = (boolean) (oNOldParent->oHChildren != NULL);
+      if(oNNodeFT->isFile)
+         (void) NodeFT_hasFileChildName(oNOldParent, pcOldName,
+                                        ulOldLength, &ulOldIndex);
+      else
+         (void) NodeFT_hasDirectoryChildName(oNOldParent, pcOldName,
+                                             ulOldLength, &ulOldIndex);
+   }
+   if(oNNewParent != NULL) {
+      if(oNNodeFT->isFile)
+         (void) NodeFT_hasFileChildName(oNNewParent, pcNewName,
+                                        ulNewLength, &ulNewIndex);
+      else
+         (void) NodeFT_hasDirectoryChildName(oNNewParent, pcNewName,
+                                             ulNewLength, &ulNewIndex);
+   }
+
+   if(ulNewLength != ulOldLength ||
+      strncmp(pcOldName, pcNewName, ulNewLength) != 0) {
+      pcName = NodeFT_alloc(oNNodeFT->oArena, ulNewLength + 1);
+      if(pcName == NULL)
+         return MEMORY_ERROR;
+      memcpy(pcName, pcNewName, ulNewLength);
+      pcName[ulNewLength] = '\0';
+      NodeFT_setName(oNNodeFT, pcName, ulNewLength);
+   }
+
+   /* join the new parent before leaving the old, so that failing
+      leaves oNNodeFT where it was */
+   if(oNNewParent != NULL) {
+      iStatus = NodeFT_addChild(oNNewParent, oNNodeFT, ulNewIndex);
+      if(iStatus != SUCCESS) {
+         if(pcName != NULL) {
+            NodeFT_setName(oNNodeFT, pcOldName, ulOldLength);
+            NodeFT_discard(oNNodeFT->oArena, pcName, ulNewLength + 1);
+         }
+         return iStatus;
+      }
+   }
+   if(oNOldParent != NULL) {
+      if(oNOldParent == oNNewParent && ulNewIndex <= ulOldIndex)
+         ulOldIndex++;
+      if(oNNodeFT->isFile)
+         (void) BTArray_removeAt(oNOldParent->oDFiles, ulOldIndex);
+      else
+         (void) BTArray_removeAt(oNOldParent->oDDirectories,
+                                 ulOldIndex);
+      oHChildren = oNOldParent->oHChildren;
+      if(bHadTable)
+         (void) HashTable_remove(oHChildren, ulOldHash, oNNodeFT);
+      else if(oHChildren != NULL) {
+         /* built by NodeFT_addChild while oNNodeFT was listed twice */
+         __atomic_store_n(&oNOldParent->oHChildren, NULL,
+                          __ATOMIC_RELAXED);
+         HashTable_free(oHChildren);
+         NodeFT_buildChildTable(oNOldParent);
+      }
+   }
+
+   if(oNOldParent != oNNewParent) {
+      ulNodes = oNNodeFT->ulDescendants + 1;
+      NodeFT_subtractDescendants(oNOldParent, ulNodes);
+      NodeFT_addDescendants(oNNewParent, ulNodes);
+      __atomic_store_n(&oNNodeFT->oNParent, oNNewParent,
+                       __ATOMIC_RELEASE);
+   }
+   if(pcName != NULL && pcOldName != (const char *) (oNNodeFT + 1))
+      NodeFT_discard(oNNodeFT->oArena, (void *) pcOldName,
+                     ulOldLength + 1);
+   return SUCCESS;
+}
+
+/*
+  Drops one reference to pvNode, a NodeFT, and once none remain frees
+  it and drops its references to its children in turn, adding the
+  number of NodeFTs freed to *(size_t *) pvCount. Each NodeFT is
+  visited once and its children arrays are freed whole, rather than
+  emptied one child at a time; a subtree that a snapshot still shares
+  is left alone.
+*/
+static void NodeFT_release(void *pvNode, void *pvCount) {
+   Node_T oNNodeFT = (Node_T) pvNode;
+
+   assert(oNNodeFT != NULL);
+   assert(pvCount != NULL);
+
+   if(__atomic_sub_fetch(&oNNodeFT->ulRefs, 1, __ATOMIC_ACQ_REL) != 0)
+      return;
+
+   /* a directory made by NodeFT_newUnlinked may have no arrays yet */
+   if(oNNodeFT->oDFiles != NULL) {
+      BTArray_map(oNNodeFT->oDFiles, NodeFT_release, pvCount);
+      BTArray_free(oNNodeFT->oDFiles);
+   }
+   if(oNNodeFT->oDDirectories != NULL) {
+      BTArray_map(oNNodeFT->oDDirectories, NodeFT_release, pvCount);
+      BTArray_free(oNNodeFT->oDDirectories);
+   }
+   if(oNNodeFT->oHChildren != NULL)
+      HashTable_free(oNNodeFT->oHChildren);
+   /* a name given by NodeFT_relink has a block of its own */
+   if(oNNodeFT->pcName != (const char *) (oNNodeFT + 1))
+      NodeFT_discard(oNNodeFT->oArena, (void *) oNNodeFT->pcName,
+                     oNNodeFT->ulNameLength + 1);
+
+   /* finally, free the struct NodeFT (and its name, which NodeFT_relink
+      never changes in place, so its length gives the block's size) */
+   (void) pthread_rwlock_destroy(&oNNodeFT->sLock);
+   NodeFT_discard(oNNodeFT->oArena, oNNodeFT, sizeof(struct NodeFT) +
+                  strlen((const char *) (oNNodeFT + 1)) + 1);
+   (*(size_t *) pvCount)++;
+}
+
+size_t NodeFT_free(Node_T oNNodeFT) {
    size_t ulCount = 0;
 
    assert(oNNodeFT != NULL);
-   /* remove from parent's list */
-   if(oNNodeFT->oNParent != NULL && oNNodeFT->isFile) {
-      if(DynArray_bsearch(
-            oNNodeFT->oNParent->oDFiles,
-            oNNodeFT, &ulIndex,
-            (int (*)(const void *, const void *)) Path_comparePath)
-        )
-         (void) DynArray_removeAt(oNNodeFT->oNParent->oDFiles,
-                                  ulIndex);
-   
-
-
-   /* remove path */
-   Path_free(oNNodeFT->oPPath);
-   
-   /* finally, free the struct NodeFT */
-   free(oNNodeFT);
-   ulCount++;
+   /* a parent whose children are not yet set does not list it */
+   if(oNNodeFT->oNParent != NULL &&
+      oNNodeFT->oNParent->oDFiles != NULL)
+      (void) NodeFT_detach(oNNodeFT);
+
+   /* below the top, no NodeFT need leave its parent's arrays, since
+      they are freed too */
+   NodeFT_release(oNNodeFT, &ulCount);
    return ulCount;
+}
+
+void NodeFT_retain(Node_T oNNodeFT) {
+   assert(oNNodeFT != NULL);
+
+   (void) __atomic_add_fetch(&oNNodeFT->ulRefs, 1, __ATOMIC_RELAXED);
+}
+
+boolean NodeFT_isShared(Node_T oNNodeFT) {
+   assert(oNNodeFT != NULL);
+
+   return (boolean) (__atomic_load_n(&oNNodeFT->ulRefs,
+                                     __ATOMIC_ACQUIRE) > 1);
+}
+
+/*
+  Takes a reference to pvChild, a NodeFT that the copy pvParent now
+  lists too, and makes pvParent its parent in the live FT.
+*/
+static void NodeFT_adoptChild(void *pvChild, void *pvParent) {
+   Node_T oNChild = (Node_T) pvChild;
+
+   assert(oNChild != NULL);
+   assert(pvParent != NULL);
+
+   NodeFT_retain(oNChild);
+   /* the copy is new, so a lookup that follows this link must see
+      it whole */
+   __atomic_store_n(&oNChild->oNParent, (Node_T) pvParent,
+                    __ATOMIC_RELEASE);
+}
+
+/*
+  Appends pvChild, a NodeFT, to the array that *(Node_T **) pvCursor
+  points into, advancing the cursor. Used to list a children array.
+*/
+static void NodeFT_collectChild(void *pvChild, void *pvCursor) {
+   Node_T **paoNCursor = (Node_T **) pvCursor;
+
+   assert(pvChild != NULL);
+   assert(pvCursor != NULL);
+
+   **paoNCursor = (Node_T) pvChild;
+   (*paoNCursor)++;
+}
+
+/*
+  Returns a new BTArray_T from oArena listing the same elements as
+  oDArray, using the room for them at aoNBuffer, or NULL if memory
+  could not be allocated.
+*/
+static BTArray_T NodeFT_copyArray(BTArray_T oDArray, Node_T *aoNBuffer,
+                                  Arena_T oArena) {
+   Node_T *aoNCursor = aoNBuffer;
+
+   assert(oDArray != NULL);
+
+   BTArray_map(oDArray, NodeFT_collectChild, &aoNCursor);
+   return BTArray_newFromIn(oArena, (const void **) aoNBuffer,
+                            BTArray_getLength(oDArray));
+}
+
+int NodeFT_unshare(Node_T oNNodeFT, Node_T *poNResult) {
+   struct NodeFT *psNew;
+   size_t ulSize;
+   Node_T oNParent;
+   Node_T *aoNBuffer = NULL;
+   size_t ulBuffer;
+   size_t ulIndex = 0;
+   size_t ulCount = 0;
 
+   assert(oNNodeFT != NULL);
+   assert(poNResult != NULL);
+   assert(oNNodeFT->oNParent == NULL ||
+          !NodeFT_isShared(oNNodeFT->oNParent));
+
+   *poNResult = oNNodeFT;
+   if(!NodeFT_isShared(oNNodeFT))
+      return SUCCESS;
+
+   /* build the whole copy before the live FT sees any of it */
+   ulSize = sizeof(struct NodeFT) + oNNodeFT->ulNameLength + 1;
+   psNew = NodeFT_alloc(oNNodeFT->oArena, ulSize);
+   if(psNew == NULL)
+      return MEMORY_ERROR;
+   if(pthread_rwlock_init(&psNew->sLock, NULL) != 0) {
+      NodeFT_discard(oNNodeFT->oArena, psNew, ulSize);
+      return MEMORY_ERROR;
    }
+   psNew->oArena = oNNodeFT->oArena;
+   psNew->pcName = strcpy((char *) (psNew + 1), oNNodeFT->pcName);
+   psNew->ulNameLength = oNNodeFT->ulNameLength;
+   psNew->oNParent = oNNodeFT->oNParent;
+   psNew->oHChildren = NULL;
+   psNew->ulDescendants = oNNodeFT->ulDescendants;
+   psNew->ulRefs = 1;
+   psNew->isFile = oNNodeFT->isFile;
+   psNew->pvFile = oNNodeFT->pvFile;
+   psNew->fileSize = oNNodeFT->fileSize;
+   psNew->oDFiles = NULL;
+   psNew->oDDirectories = NULL;
+   if(!oNNodeFT->isFile) {
+      ulBuffer = BTArray_getLength(oNNodeFT->oDFiles);
+      if(BTArray_getLength(oNNodeFT->oDDirectories) > ulBuffer)
+         ulBuffer = BTArray_getLength(oNNodeFT->oDDirectories);
+      aoNBuffer = malloc((ulBuffer + 1) * sizeof(Node_T));
+      if(aoNBuffer != NULL) {
+         psNew->oDFiles = NodeFT_copyArray(oNNodeFT->oDFiles,
+                                           aoNBuffer, psNew->oArena);
+         if(psNew->oDFiles != NULL)
+            psNew->oDDirectories =
+               NodeFT_copyArray(oNNodeFT->oDDirectories, aoNBuffer,
+                                psNew->oArena);
+         free(aoNBuffer);
+      }
+      if(psNew->oDDirectories == NULL) {
+         if(psNew->oDFiles != NULL)
+            BTArray_free(psNew->oDFiles);
+         (void) pthread_rwlock_destroy(&psNew->sLock);
+         NodeFT_discard(psNew->oArena, psNew, ulSize);
+         return MEMORY_ERROR;
+      }
+      if(oNNodeFT->oHChildren != NULL)
+         NodeFT_buildChildTable(psNew);
 
-   else if (oNNodeFT->oNParent != NULL && !(oNNodeFT->isFile)){ 
-   if(DynArray_bsearch(
-               oNNodeFT->oNParent->oDDirectories,
-               oNNodeFT, &ulIndex,
-               (int (*)(const void *, const void *)) Path_comparePath)
-         )
-            (void) DynArray_removeAt(oNNodeFT->oNParent->oDDirectories,
-                                    ulIndex);
+      BTArray_map(psNew->oDFiles, NodeFT_adoptChild, psNew);
+      BTArray_map(psNew->oDDirectories, NodeFT_adoptChild, psNew);
    }
-      
 
-      /* recursively remove children */
-      while(DynArray_getLength(oNNodeFT->oDDirectories) != 0) {
-         ulCount += NodeFT_free(DynArray_get(oNNodeFT->oDDirectories, 0));
+   /* swap the copy in for oNNodeFT in its parent, which is unshared;
+      the name table has room again once oNNodeFT leaves it */
+   oNParent = oNNodeFT->oNParent;
+   if(oNParent != NULL) {
+      if(oNNodeFT->isFile) {
+         (void) NodeFT_hasFileChildName(oNParent, oNNodeFT->pcName,
+                                        oNNodeFT->ulNameLength,
+                                        &ulIndex);
+         (void) BTArray_set(oNParent->oDFiles, ulIndex, psNew);
       }
-      DynArray_free(oNNodeFT->oDDirectories);
-
-  /* remove path */
-   Path_free(oNNodeFT->oPPath);
-   
-   /* finally, free the struct NodeFT */
-   free(oNNodeFT);
-   ulCount++;
-   return ulCount;
+      else {
+         (void) NodeFT_hasDirectoryChildName(oNParent, oNNodeFT->pcName,
+                                             oNNodeFT->ulNameLength,
+                                             &ulIndex);
+         (void) BTArray_set(oNParent->oDDirectories, ulIndex, psNew);
+      }
+      if(oNParent->oHChildren != NULL) {
+         (void) HashTable_remove(oNParent->oHChildren,
+                                 NodeFT_hashName(oNNodeFT), oNNodeFT);
+         (void) HashTable_add(oNParent->oHChildren,
+                              NodeFT_hashName(psNew), psNew);
+      }
+   }
 
-   
+   /* the snapshots may have let go meanwhile */
+   NodeFT_release(oNNodeFT, &ulCount);
+   *poNResult = psNew;
+   return SUCCESS;
+}
+
+const char *NodeFT_getName(Node_T oNNodeFT) {
+   assert(oNNodeFT != NULL);
+
+   return __atomic_load_n(&oNNodeFT->pcName, __ATOMIC_ACQUIRE);
+}
+
+size_t NodeFT_getDepth(Node_T oNNodeFT) {
+   size_t ulDepth = 0;
+
+   assert(oNNodeFT != NULL);
+
+   for(; oNNodeFT != NULL; oNNodeFT = oNNodeFT->oNParent)
+      ulDepth++;
+   return ulDepth;
+}
+
+size_t NodeFT_getPathLength(Node_T oNNodeFT) {
+   size_t ulLength;
+
+   assert(oNNodeFT != NULL);
+
+   /* each ancestor contributes its name and one '/' delimiter */
+   ulLength = oNNodeFT->ulNameLength;
+   for(oNNodeFT = oNNodeFT->oNParent; oNNodeFT != NULL;
+       oNNodeFT = oNNodeFT->oNParent)
+      ulLength += oNNodeFT->ulNameLength + 1;
+   return ulLength;
+}
+
+size_t NodeFT_writePath(Node_T oNNodeFT, char *pcBuf) {
+   size_t ulLength;
+   char *pcInsert;
+
+   assert(oNNodeFT != NULL);
+   assert(pcBuf != NULL);
+
+   /* fill from the end, since ancestors are reached last */
+   ulLength = NodeFT_getPathLength(oNNodeFT);
+   pcInsert = pcBuf + ulLength;
+   *pcInsert = '\0';
+   for(;;) {
+      pcInsert -= oNNodeFT->ulNameLength;
+      memcpy(pcInsert, oNNodeFT->pcName, oNNodeFT->ulNameLength);
+      oNNodeFT = oNNodeFT->oNParent;
+      if(oNNodeFT == NULL)
+         break;
+      pcInsert--;
+      *pcInsert = '/';
+   }
+   assert(pcInsert == pcBuf);
+   return ulLength;
 }
 
- Path_T NodeFT_getPath(Node_T oNNodeFT) {
+boolean NodeFT_hasPath(Node_T oNNodeFT, const char *pcPath,
+                       size_t ulLength) {
+   size_t ulNameLength;
+
    assert(oNNodeFT != NULL);
+   assert(pcPath != NULL);
 
-   return oNNodeFT->oPPath; 
-} 
+   /* match names against pcPath from its end, one ancestor at a
+      time, checking for a delimiter between each pair */
+   for(;;) {
+      ulNameLength = __atomic_load_n(&oNNodeFT->ulNameLength,
+                                     __ATOMIC_RELAXED);
+      if(ulLength < ulNameLength)
+         return FALSE;
+      ulLength -= ulNameLength;
+      if(strncmp(pcPath + ulLength,
+                 __atomic_load_n(&oNNodeFT->pcName, __ATOMIC_ACQUIRE),
+                 ulNameLength))
+         return FALSE;
+      /* a lookup may race with NodeFT_detach cutting this link, or
+         with NodeFT_unshare pointing it at a new copy */
+      oNNodeFT = __atomic_load_n(&oNNodeFT->oNParent, __ATOMIC_ACQUIRE);
+      if(oNNodeFT == NULL)
+         return (boolean) (ulLength == 0);
+      if(ulLength == 0 || pcPath[ulLength - 1] != '/')
+         return FALSE;
+      ulLength--;
+   }
+}
+
+int NodeFT_getPath(Node_T oNNodeFT, Path_T *poPResult) {
+   char *pcPath;
+   int iStatus;
+
+   assert(oNNodeFT != NULL);
+   assert(poPResult != NULL);
+
+   pcPath = Node_ToString(oNNodeFT);
+   if(pcPath == NULL) {
+      *poPResult = NULL;
+      return MEMORY_ERROR;
+   }
+   iStatus = Path_new(pcPath, poPResult);
+   free(pcPath);
+   return iStatus;
+}
+
+boolean NodeFT_hasFileChildName(Node_T oNParent, const char *pcName,
+                                size_t ulLength, size_t *pulChildID) {
+   struct NodeFT_name sName;
 
-boolean NodeFT_hasFileChild(Node_T oNParent, Path_T oPPath,
-                         size_t *pulChildID) {
    assert(oNParent != NULL);
-   assert(oPPath != NULL);
+   assert(pcName != NULL);
    assert(pulChildID != NULL);
-  /* assert(oNParent->isFile == FALSE); */
-   /* *pulChildID is the index into oNParent->oDChildren */
-   return DynArray_bsearch(oNParent->oDFiles,
-            (char*) Path_getPathname(oPPath), pulChildID,
-            (int (*)(const void*,const void*)) NodeFT_compareString);
+
+   sName.pcName = pcName;
+   sName.ulLength = ulLength;
+   return BTArray_bsearch(oNParent->oDFiles, &sName, pulChildID,
+            (int (*)(const void*,const void*)) NodeFT_compareName);
 }
 
-boolean NodeFT_hasDirectoryChild(Node_T oNParent, Path_T oPPath,
-                         size_t *pulChildID) {
+boolean NodeFT_hasDirectoryChildName(Node_T oNParent,
+                                     const char *pcName,
+                                     size_t ulLength,
+                                     size_t *pulChildID) {
+   struct NodeFT_name sName;
+
    assert(oNParent != NULL);
-   assert(oPPath != NULL);
+   assert(pcName != NULL);
    assert(pulChildID != NULL);
-   /* assert(oNParent->isFile == FALSE); */
-   /* *pulChildID is the index into oNParent->oDChildren */
-   return DynArray_bsearch(oNParent->oDDirectories,
-            (char*) Path_getPathname(oPPath), pulChildID,
-            (int (*)(const void*,const void*)) NodeFT_compareString);
+
+   sName.pcName = pcName;
+   sName.ulLength = ulLength;
+   return BTArray_bsearch(oNParent->oDDirectories, &sName, pulChildID,
+            (int (*)(const void*,const void*)) NodeFT_compareName);
 }
+
+Node_T NodeFT_findChild(Node_T oNParent, const char *pcName,
+                        size_t ulLength) {
+   struct NodeFT_name sName;
+   HashTable_T oHChildren;
+   Node_T oNChild;
+
+   assert(oNParent != NULL);
+   assert(pcName != NULL);
+
+   if(oNParent->isFile)
+      return NULL;
+
+   sName.pcName = pcName;
+   sName.ulLength = ulLength;
+
+   /* large directories: one probe of the name table */
+   oHChildren = __atomic_load_n(&oNParent->oHChildren,
+                                __ATOMIC_ACQUIRE);
+   if(oHChildren != NULL)
+      return HashTable_find(oHChildren,
+                            HashTable_hash(HASHTABLE_SEED, pcName,
+                                           ulLength),
+                            &sName, NodeFT_matchName);
+
+   /* small directories: search each sorted array */
+   oNChild = BTArray_find(oNParent->oDFiles, &sName,
+            (int (*)(const void*,const void*)) NodeFT_compareName);
+   if(oNChild == NULL)
+      oNChild = BTArray_find(oNParent->oDDirectories, &sName,
+            (int (*)(const void*,const void*)) NodeFT_compareName);
+   return oNChild;
+}
+
  size_t NodeFT_getNumChildren(Node_T oNParent) {
    assert(oNParent != NULL);
 
-   return DynArray_getLength(oNParent->oDFiles) + DynArray_getLength(oNParent->oDDirectories); 
+   return BTArray_getLength(oNParent->oDFiles) +
+      BTArray_getLength(oNParent->oDDirectories);
 }
 
 size_t NodeFT_getNumDirectoryChildren(Node_T oNParent) {
-   return DynArray_getLength(oNParent->oDDirectories);
+   return BTArray_getLength(oNParent->oDDirectories);
 }
 
 size_t NodeFT_getNumFileChildren(Node_T oNParent) {
-   return DynArray_getLength(oNParent->oDFiles);
+   return BTArray_getLength(oNParent->oDFiles);
 }
 
 int  NodeFT_getFileChild(Node_T oNParent, size_t ulChildID,
@@ -301,9 +972,9 @@ int  NodeFT_getFileChild(Node_T oNParent, size_t ulChildID,
    /* ulChildID is the index into oNParent->oDChildren */
    if(oNParent->isFile) {
       return NO_SUCH_PATH; /*Files cannot have children*/
-   }              
+   }
    else {
-      *poNResult = DynArray_get(oNParent->oDFiles, ulChildID);
+      *poNResult = BTArray_get(oNParent->oDFiles, ulChildID);
       return SUCCESS;
    }
 }
@@ -316,9 +987,9 @@ int  NodeFT_getDirectoryChild(Node_T oNParent, size_t ulChildID,
    /* ulChildID is the index into oNParent->oDChildren */
    if(oNParent->isFile) {
       return NO_SUCH_PATH; /*Files cannot have children*/
-   }              
+   }
    else {
-      *poNResult = DynArray_get(oNParent->oDDirectories, ulChildID);
+      *poNResult = BTArray_get(oNParent->oDDirectories, ulChildID);
       return SUCCESS;
    }
 }
@@ -326,26 +997,43 @@ int  NodeFT_getDirectoryChild(Node_T oNParent, size_t ulChildID,
 Node_T NodeFT_getParent(Node_T oNNodeFT) {
    assert(oNNodeFT != NULL);
 
-   return oNNodeFT->oNParent; 
-} 
+   return oNNodeFT->oNParent;
+}
 
 int NodeFT_compare(Node_T oNFirst, Node_T oNSecond) {
+   char *pcFirst;
+   char *pcSecond;
+   int iCompare;
+
    assert(oNFirst != NULL);
    assert(oNSecond != NULL);
 
-   return Path_comparePath(oNFirst->oPPath, oNSecond->oPPath);
-} 
+   /* siblings are ordered by name alone */
+   if(oNFirst->oNParent == oNSecond->oNParent)
+      return strcmp(oNFirst->pcName, oNSecond->pcName);
 
-char *NodeFT_ToString(Node_T oNNodeFT) {
+   pcFirst = Node_ToString(oNFirst);
+   pcSecond = Node_ToString(oNSecond);
+   if(pcFirst == NULL || pcSecond == NULL)
+      iCompare = strcmp(oNFirst->pcName, oNSecond->pcName);
+   else
+      iCompare = strcmp(pcFirst, pcSecond);
+   free(pcFirst);
+   free(pcSecond);
+   return iCompare;
+}
+
+char *Node_ToString(Node_T oNNodeFT) {
    char *copyPath;
 
    assert(oNNodeFT != NULL);
 
-   copyPath = malloc(Path_getStrLength((oNNodeFT->oPPath))+1); /* plus one indicates nullbyte */
+   /* plus one indicates nullbyte */
+   copyPath = malloc(NodeFT_getPathLength(oNNodeFT)+1);
    if(copyPath == NULL)
       return NULL;
-   else
-      return strcpy(copyPath, Path_getPathname(oNNodeFT->oPPath));
+   (void) NodeFT_writePath(oNNodeFT, copyPath);
+   return copyPath;
 }
 
 boolean NodeFT_isFile(Node_T oNNodeFT) {
@@ -354,14 +1042,39 @@ boolean NodeFT_isFile(Node_T oNNodeFT) {
 }
 
 void* NodeFT_getFileContents(Node_T oNNodeFT) {
-
+   assert(oNNodeFT != NULL);
+   return __atomic_load_n(&oNNodeFT->pvFile, __ATOMIC_RELAXED);
 }
 
 size_t NodeFT_getFileLength(Node_T oNNodeFT) {
+   assert(oNNodeFT != NULL);
+   return __atomic_load_n(&oNNodeFT->fileSize, __ATOMIC_RELAXED);
+}
+
+void* NodeFT_setFile(Node_T oNNodeFT, void* pvContents,
+                     size_t ulLength) {
+   void* pvOldContents;
 
+   assert(oNNodeFT != NULL);
+   assert(oNNodeFT->isFile);
+
+   pvOldContents = oNNodeFT->pvFile;
+   __atomic_store_n(&oNNodeFT->pvFile, pvContents, __ATOMIC_RELAXED);
+   __atomic_store_n(&oNNodeFT->fileSize, ulLength, __ATOMIC_RELAXED);
+   return pvOldContents;
+}
+
+void NodeFT_lockShared(Node_T oNNodeFT) {
+   assert(oNNodeFT != NULL);
+   (void) pthread_rwlock_rdlock(&oNNodeFT->sLock);
 }
 
-int NodeFT_setFile(void* pvContents, size_t ulLength) {
-   
+void NodeFT_lockExclusive(Node_T oNNodeFT) {
+   assert(oNNodeFT != NULL);
+   (void) pthread_rwlock_wrlock(&oNNodeFT->sLock);
 }
 
+void NodeFT_unlock(Node_T oNNodeFT) {
+   assert(oNNodeFT != NULL);
+   (void) pthread_rwlock_unlock(&oNNodeFT->sLock);
+}
@@ -8,6 +8,7 @@
 
 #include <stddef.h>
 #include "a4def.h"
+#include "arena.h"
 #include "path.h"
 
 
@@ -15,61 +16,199 @@
 typedef struct NodeFT *Node_T;
 
 /*
-  Creates a new NodeFT in the Directory Tree, with path oPPath and
-  parent oNParent. Returns an int SUCCESS status and sets *poNResult
-  to be the new NodeFT if successful. Otherwise, sets *poNResult to NULL
-  and returns status:
+  Creates a new NodeFT named by the ulNameLength characters at pcName,
+  which need not be '\0'-terminated, the final component of its
+  absolute path, as a child of oNParent (or as a root if oNParent is
+  NULL). The NodeFT, and everything later allocated for it, comes
+  from oArena, or from the heap if oArena is NULL; a child must use the
+  same arena as its parent, and a NodeFT from an arena is never
+  released before the arena is. Returns an int SUCCESS status and
+  sets *poNResult to be the new NodeFT if successful. Otherwise, sets
+  *poNResult to NULL and returns status:
   * MEMORY_ERROR if memory could not be allocated to complete request
-  * CONFLICTING_PATH if oNParent's path is not an ancestor of oPPath
-  * NO_SUCH_PATH if oPPath is of depth 0
-                 or oNParent's path is not oPPath's direct parent
-                 or oNParent is NULL but oPPath is not of depth 1
-  * ALREADY_IN_TREE if oNParent already has a child with this path
+  * NOT_A_DIRECTORY if oNParent is a file
+  * ALREADY_IN_TREE if oNParent already has a child of that name
 */
-int NodeFT_new(Path_T oPPath, Node_T oNParent, boolean isFile,
- void* pvFile, size_t fileSize, Node_T *poNResult);
+int NodeFT_new(const char *pcName, size_t ulNameLength,
+ Node_T oNParent, boolean isFile, void* pvFile, size_t fileSize,
+ Arena_T oArena, Node_T *poNResult);
+/*
+  Creates a new NodeFT named by the ulNameLength characters at pcName,
+  which need not be '\0'-terminated, whose parent is oNParent (or
+  that is a root if oNParent is NULL), but without adding it to
+  oNParent's children; NodeFT_setChildren does that for all of
+  oNParent's children at once. A new directory has no children until
+  NodeFT_setChildren is called on it, and must not be passed to any
+  other function but NodeFT_free before then. Memory comes from
+  oArena as for NodeFT_new. Returns an int SUCCESS status and sets
+  *poNResult to be the new NodeFT if successful. Otherwise, sets
+  *poNResult to NULL and returns MEMORY_ERROR.
+*/
+int NodeFT_newUnlinked(const char *pcName, size_t ulNameLength,
+                       Node_T oNParent, boolean isFile, void *pvFile,
+                       size_t fileSize, Arena_T oArena,
+                       Node_T *poNResult);
+
+/*
+  Sets the children of oNParent, a directory made by
+  NodeFT_newUnlinked whose children are not yet set, to the ulNumFiles
+  files at aoNFiles and the ulNumDirectories directories at
+  aoNDirectories, each made by NodeFT_newUnlinked with oNParent as
+  parent, and each array sorted by name with no name repeated within
+  or across them. Every array is allocated at its final size. Returns
+  SUCCESS, or MEMORY_ERROR if memory could not be allocated, in which
+  case oNParent's children are still not set.
+*/
+int NodeFT_setChildren(Node_T oNParent, Node_T *aoNFiles,
+                       size_t ulNumFiles, Node_T *aoNDirectories,
+                       size_t ulNumDirectories);
+
+/*
+  Removes oNNodeFT, and with it the subtree rooted there, from its
+  parent's children, leaving it a root, and takes the subtree's nodes
+  out of the descendant counts of its former ancestors. Returns the
+  number of NodeFTs in the subtree, oNNodeFT included, in O(log n)
+  time without visiting them. Does nothing else if oNNodeFT is
+  already a root.
+*/
+size_t NodeFT_detach(Node_T oNNodeFT);
+
+/*
+  Moves oNNodeFT, and with it the subtree rooted there, to be the
+  child of oNNewParent named by the ulNewLength characters at
+  pcNewName, which need not be '\0'-terminated. oNNewParent must be a
+  directory with no child of that name and must not lie in the
+  subtree; it may be oNNodeFT's current parent, to rename it, or NULL
+  if oNNodeFT is a root, to rename the root. The descendant counts of
+  the old and new ancestors are adjusted, but no other NodeFT of the
+  subtree is visited, since none stores its path. Returns SUCCESS, or
+  MEMORY_ERROR if memory could not be allocated, in which case
+  oNNodeFT is unchanged.
+*/
+int NodeFT_relink(Node_T oNNodeFT, Node_T oNNewParent,
+                  const char *pcNewName, size_t ulNewLength);
+
 /*
   Destroys and frees all memory allocated for the subtree rooted at
-  oNNodeFT, i.e., deletes this NodeFT and all its descendents. Returns the
-  number of NodeFTs deleted.
+  oNNodeFT, i.e., deletes this NodeFT and all its descendents, files
+  included. Only oNNodeFT itself leaves its parent's children; the
+  rest are visited once each, in O(n) time. A NodeFT that a snapshot
+  still shares is only let go of, and freed along with whatever it
+  alone holds once the last snapshot releases it. Returns the number
+  of NodeFTs deleted now.
 */
 size_t NodeFT_free(Node_T oNNodeFT);
 
-/* Returns the path object representing oNNodeFT's absolute path. */
-Path_T NodeFT_getPath(Node_T oNNodeFT);
+/*
+  Takes another reference to oNNodeFT, and so to the subtree rooted
+  there, for a snapshot that holds it as its root. NodeFT_free drops
+  the reference again.
+*/
+void NodeFT_retain(Node_T oNNodeFT);
+
+/*
+  Returns TRUE if oNNodeFT is shared with a snapshot, so that it must
+  not be changed in place, and FALSE otherwise.
+*/
+boolean NodeFT_isShared(Node_T oNNodeFT);
+
+/*
+  Gives the live FT a copy of oNNodeFT of its own, if oNNodeFT is
+  shared with a snapshot, putting the copy in its place among its
+  parent's children; the parent must not be shared. The copy lists
+  the same children, which are then shared in turn, so only
+  oNNodeFT's own fields and children arrays are copied. Returns
+  SUCCESS and sets *poNResult to the copy, or to oNNodeFT if it was
+  not shared. Otherwise, sets *poNResult to oNNodeFT and returns
+  MEMORY_ERROR, leaving it unchanged.
+*/
+int NodeFT_unshare(Node_T oNNodeFT, Node_T *poNResult);
+
+/* Returns oNNodeFT's name, the final component of its path. */
+const char *NodeFT_getName(Node_T oNNodeFT);
+
+/* Returns the number of components in oNNodeFT's absolute path. */
+size_t NodeFT_getDepth(Node_T oNNodeFT);
 
 /*
-  Returns TRUE if oNParent has a child with path oPPath. Returns
-  FALSE if it does not.
+  Returns the length (not including trailing '\0') of the string
+  representation of oNNodeFT's absolute path.
+*/
+size_t NodeFT_getPathLength(Node_T oNNodeFT);
+
+/*
+  Writes the string representation of oNNodeFT's absolute path,
+  including its trailing '\0', into pcBuf, which must have room for
+  NodeFT_getPathLength(oNNodeFT) + 1 characters. Returns the length
+  of the path written.
+*/
+size_t NodeFT_writePath(Node_T oNNodeFT, char *pcBuf);
+
+/*
+  Returns TRUE if oNNodeFT's absolute path is exactly the ulLength
+  characters starting at pcPath, and FALSE otherwise. Compares names
+  up the chain of ancestors, so no path is built.
+*/
+boolean NodeFT_hasPath(Node_T oNNodeFT, const char *pcPath,
+                       size_t ulLength);
+
+/*
+  Rebuilds the path object representing oNNodeFT's absolute path from
+  its ancestors' names. Returns an int SUCCESS status and sets
+  *poPResult to the new path, which is then owned by the caller, if
+  successful. Otherwise, sets *poPResult to NULL and returns status:
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int NodeFT_getPath(Node_T oNNodeFT, Path_T *poPResult);
+
+/*
+  Returns TRUE if oNParent has a file child whose final path component
+  is the ulLength characters starting at pcName, which need not be
+  '\0'-terminated. Returns FALSE if it does not. Allocates no memory.
 
   If oNParent has such a child, stores in *pulChildID the child's
-  identifier (as used in NodeFT_getChild). If oNParent does not have
-  such a child, stores in *pulChildID the identifier that such a
+  identifier (as used in NodeFT_getFileChild). If oNParent does not
+  have such a child, stores in *pulChildID the identifier that such a
   child _would_ have if inserted.
 */
-boolean NodeFT_hasFileChild(Node_T oNParent, Path_T oPPath,
-                         size_t *pulChildID);
+boolean NodeFT_hasFileChildName(Node_T oNParent, const char *pcName,
+                                size_t ulLength, size_t *pulChildID);
 
 /*
-  Returns TRUE if oNParent has a child with path oPPath. Returns
-  FALSE if it does not.
+  Returns TRUE if oNParent has a directory child whose final path
+  component is the ulLength characters starting at pcName, which need
+  not be '\0'-terminated. Returns FALSE if it does not. Allocates no
+  memory.
 
   If oNParent has such a child, stores in *pulChildID the child's
-  identifier (as used in NodeFT_getChild). If oNParent does not have
-  such a child, stores in *pulChildID the identifier that such a
-  child _would_ have if inserted.
+  identifier (as used in NodeFT_getDirectoryChild). If oNParent does
+  not have such a child, stores in *pulChildID the identifier that
+  such a child _would_ have if inserted.
 */
+boolean NodeFT_hasDirectoryChildName(Node_T oNParent,
+                                     const char *pcName,
+                                     size_t ulLength,
+                                     size_t *pulChildID);
 
-boolean NodeFT_hasDirectoryChild(Node_T oNParent, Path_T oPPath,
-                         size_t *pulChildID);
+/*
+  Returns the child of oNParent, file or directory, whose name is the
+  ulLength characters starting at pcName, which need not be
+  '\0'-terminated. Returns NULL if there is no such child or if
+  oNParent is a file. Directories with many children answer from a
+  hash table on names rather than by searching their sorted arrays.
+  Like NodeFT_getFileContents and NodeFT_getFileLength, this may run
+  while another thread changes oNParent, as BTArray_find describes.
+*/
+Node_T NodeFT_findChild(Node_T oNParent, const char *pcName,
+                        size_t ulLength);
 
 /* Returns the number of children that oNParent has. */
 size_t NodeFT_getNumChildren(Node_T oNParent);
 
-/* Returns the number of children in the directory dynarray */
+/* Returns the number of directory children that oNParent has */
 size_t NodeFT_getNumDirectoryChildren(Node_T oNParent);
 
-/* Returns the number of children in the file dynArray */
+/* Returns the number of file children that oNParent has */
 size_t NodeFT_getNumFileChildren(Node_T oNParent);
 /*
   Returns an int SUCCESS status and sets *poNResult to be the child
@@ -104,8 +243,9 @@ Node_T NodeFT_getParent(Node_T oNNodeFT);
 int NodeFT_compare(Node_T oNFirst, Node_T oNSecond);
 
 /*
-  Returns a string representation for oNNodeFT, or NULL if
-  there is an allocation error.
+  Returns a string representation for oNNodeFT, its absolute path
+  rebuilt from its ancestors' names, or NULL if there is an
+  allocation error.
 
   Allocates memory for the returned string, which is then owned by
   the caller!
@@ -129,9 +269,31 @@ void* NodeFT_getFileContents(Node_T oNNodeFT);
 size_t NodeFT_getFileLength(Node_T oNNodeFT);
 
 /*
---------
+  Replaces the contents of file NodeFT oNNodeFT with pvContents of
+  size ulLength bytes, and returns the old contents.
+*/
+void* NodeFT_setFile(Node_T oNNodeFT, void* pvContents,
+                     size_t ulLength);
+
+/*
+  Takes oNNodeFT's lock shared, waiting while another thread holds it
+  exclusively. Each NodeFT has a reader-writer lock of its own, which
+  the NodeFT functions never take themselves: a caller that shares
+  NodeFTs between threads takes it around its own calls.
+*/
+void NodeFT_lockShared(Node_T oNNodeFT);
+
+/*
+  Takes oNNodeFT's lock exclusively, waiting while any other thread
+  holds it.
+*/
+void NodeFT_lockExclusive(Node_T oNNodeFT);
+
+/*
+  Releases oNNodeFT's lock, taken either way. oNNodeFT must not be
+  freed while its lock is held.
 */
-int NodeFT_setFile(void* pvContents, size_t ulLength);
+void NodeFT_unlock(Node_T oNNodeFT);
 
 
 
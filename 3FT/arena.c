@@ -0,0 +1,209 @@
+/*--------------------------------------------------------------------*/
+/* arena.c                                                            */
+/* Author: Matthew Okechukwu, Pinrui Huang                            */
+/*--------------------------------------------------------------------*/
+
+/* pthread_mutex_t is a POSIX extension beyond ISO C */
+#define _XOPEN_SOURCE 600
+
+#include "arena.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+/*--------------------------------------------------------------------*/
+
+/* The size of the first chunk of an Arena.  Each later chunk is
+   twice the size of the one before, up to MAX_CHUNK_SIZE, so that a
+   small arena stays small and a large one needs few chunks. */
+
+static const size_t MIN_CHUNK_SIZE = 16384;
+
+/* The size beyond which chunks stop growing. */
+
+static const size_t MAX_CHUNK_SIZE = 4194304;
+
+/*--------------------------------------------------------------------*/
+
+/* The types whose alignment a block must satisfy.  Its size is a
+   multiple of the strictest of them. */
+
+union ArenaAlign
+{
+   long l;
+   double d;
+   long double ld;
+   void *pv;
+   void (*pf)(void);
+};
+
+/* A chunk, with its blocks following it. */
+
+struct ArenaChunk
+{
+   /* The chunk allocated before this one, or NULL. */
+   struct ArenaChunk *psPrev;
+
+   /* Pads the header to a multiple of the alignment of a block. */
+   union ArenaAlign uAlign;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* An Arena consists of its chunks, newest first, and the unused
+   room at the end of the newest chunk that blocks are carved from. */
+
+struct Arena
+{
+   /* The newest chunk, or NULL if there is none. */
+   struct ArenaChunk *psChunks;
+
+   /* The first unused byte of the newest chunk. */
+   char *pcNext;
+
+   /* The end of the newest chunk. */
+   char *pcLimit;
+
+   /* The size of the next chunk to allocate. */
+   size_t uChunkSize;
+
+   /* Held by Arena_alloc. */
+   pthread_mutex_t sMutex;
+};
+
+/*--------------------------------------------------------------------*/
+
+Arena_T Arena_new(void)
+{
+   Arena_T oArena;
+
+   oArena = (struct Arena*)malloc(sizeof(struct Arena));
+   if (oArena == NULL)
+      return NULL;
+   if (pthread_mutex_init(&oArena->sMutex, NULL) != 0)
+   {
+      free(oArena);
+      return NULL;
+   }
+   oArena->psChunks = NULL;
+   oArena->pcNext = NULL;
+   oArena->pcLimit = NULL;
+   oArena->uChunkSize = MIN_CHUNK_SIZE;
+   return oArena;
+}
+
+/*--------------------------------------------------------------------*/
+
+void Arena_clear(Arena_T oArena)
+{
+   struct ArenaChunk *psChunk;
+   struct ArenaChunk *psPrev;
+
+   assert(oArena != NULL);
+
+   for (psChunk = oArena->psChunks; psChunk != NULL; psChunk = psPrev)
+   {
+      psPrev = psChunk->psPrev;
+      free(psChunk);
+   }
+   oArena->psChunks = NULL;
+   oArena->pcNext = NULL;
+   oArena->pcLimit = NULL;
+   oArena->uChunkSize = MIN_CHUNK_SIZE;
+}
+
+/*--------------------------------------------------------------------*/
+
+void Arena_free(Arena_T oArena)
+{
+   if (oArena == NULL)
+      return;
+
+   Arena_clear(oArena);
+   (void)pthread_mutex_destroy(&oArena->sMutex);
+   free(oArena);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Allocate a chunk with room for at least uSize bytes of blocks and
+   link it into oArena.  A block too large for the next chunk gets a
+   chunk of its own behind the newest one, so that the room left in
+   the newest is not wasted.  Return the first byte of the room, or
+   NULL if insufficient memory is available. */
+
+static char *Arena_addChunk(Arena_T oArena, size_t uSize)
+{
+   struct ArenaChunk *psChunk;
+   size_t uRoom;
+
+   assert(oArena != NULL);
+
+   if (uSize > oArena->uChunkSize / 4)
+   {
+      psChunk = (struct ArenaChunk*)
+         malloc(sizeof(struct ArenaChunk) + uSize);
+      if (psChunk == NULL)
+         return NULL;
+      if (oArena->psChunks == NULL)
+      {
+         psChunk->psPrev = NULL;
+         oArena->psChunks = psChunk;
+      }
+      else
+      {
+         psChunk->psPrev = oArena->psChunks->psPrev;
+         oArena->psChunks->psPrev = psChunk;
+      }
+      return (char*)(psChunk + 1);
+   }
+
+   uRoom = oArena->uChunkSize;
+   psChunk = (struct ArenaChunk*)
+      malloc(sizeof(struct ArenaChunk) + uRoom);
+   if (psChunk == NULL)
+      return NULL;
+   psChunk->psPrev = oArena->psChunks;
+   oArena->psChunks = psChunk;
+   oArena->pcNext = (char*)(psChunk + 1);
+   oArena->pcLimit = oArena->pcNext + uRoom;
+   if (oArena->uChunkSize < MAX_CHUNK_SIZE)
+      oArena->uChunkSize *= 2;
+   return oArena->pcNext;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *Arena_alloc(Arena_T oArena, size_t uSize)
+{
+   const size_t ALIGNMENT = sizeof(union ArenaAlign);
+
+   char *pcBlock;
+
+   assert(oArena != NULL);
+
+   if (uSize == 0)
+      uSize = 1;
+   if (uSize > (size_t)-1 - sizeof(struct ArenaChunk) - ALIGNMENT)
+      return NULL;
+   uSize = (uSize + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+
+   (void)pthread_mutex_lock(&oArena->sMutex);
+   if (oArena->pcNext != NULL &&
+       uSize <= (size_t)(oArena->pcLimit - oArena->pcNext))
+      pcBlock = oArena->pcNext;
+   else
+   {
+      pcBlock = Arena_addChunk(oArena, uSize);
+      /* a chunk of its own is used up by its one block */
+      if (pcBlock != NULL && pcBlock != oArena->pcNext)
+      {
+         (void)pthread_mutex_unlock(&oArena->sMutex);
+         return pcBlock;
+      }
+   }
+   if (pcBlock != NULL)
+      oArena->pcNext = pcBlock + uSize;
+   (void)pthread_mutex_unlock(&oArena->sMutex);
+   return pcBlock;
+}
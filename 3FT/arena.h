@@ -0,0 +1,47 @@
+/*--------------------------------------------------------------------*/
+/* arena.h                                                            */
+/* Author: Matthew Okechukwu, Pinrui Huang                            */
+/*--------------------------------------------------------------------*/
+
+#ifndef ARENA_INCLUDED
+#define ARENA_INCLUDED
+
+#include <stddef.h>
+
+/* An Arena_T object is a region of memory from which blocks are
+   carved off in order from large chunks.  Blocks are never freed one
+   at a time: all of them are released together, a chunk at a time,
+   by Arena_clear or Arena_free, however many there are.  Arena_alloc
+   may be called by several threads at once. */
+
+typedef struct Arena *Arena_T;
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new, empty Arena_T object, or NULL if insufficient memory
+   is available.  No chunk is allocated until the first block is. */
+
+Arena_T Arena_new(void);
+
+/*--------------------------------------------------------------------*/
+
+/* Free oArena and every block allocated from it. */
+
+void Arena_free(Arena_T oArena);
+
+/*--------------------------------------------------------------------*/
+
+/* Release every block allocated from oArena, leaving it empty but
+   usable.  No block allocated from it may be used afterwards. */
+
+void Arena_clear(Arena_T oArena);
+
+/*--------------------------------------------------------------------*/
+
+/* Return a block of uSize bytes from oArena, aligned for any type, or
+   NULL if insufficient memory is available.  The block lasts until
+   oArena is cleared or freed. */
+
+void *Arena_alloc(Arena_T oArena, size_t uSize);
+
+#endif
@@ -0,0 +1,1163 @@
+/*--------------------------------------------------------------------*/
+/* btarray.c                                                          */
+/* Author: Matthew Okechukwu, Pinrui Huang                            */
+/*--------------------------------------------------------------------*/
+
+#include "btarray.h"
+#include "arena.h"
+#include "epoch.h"
+#include "pool.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*--------------------------------------------------------------------*/
+
+enum {
+   /* The most elements a leaf may hold. */
+   MAX_LEAF_LENGTH = 64,
+
+   /* The most children an interior node may have. */
+   MAX_FANOUT = 32
+};
+
+/* The physical length of the first leaf of a BTArray.  A leaf that is
+   the root grows from here by doubling; every other leaf is created
+   by a split at MAX_LEAF_LENGTH. */
+
+static const size_t MIN_PHYS_LENGTH = 2;
+
+/*--------------------------------------------------------------------*/
+
+/* A leaf holds a run of consecutive elements of the BTArray. */
+
+struct BTArrayLeaf
+{
+   /* 1 (TRUE), marking the node as a leaf. */
+   int bIsLeaf;
+
+   /* The number of elements in the leaf. */
+   size_t uLength;
+
+   /* The number of elements the underlying array can hold. */
+   size_t uPhysLength;
+
+   /* The array that holds the elements. */
+   const void **ppvArray;
+};
+
+/* An interior node holds its children, the number of elements beneath
+   each child, and the first element beneath each child.  The counts
+   locate an index; the first elements steer a binary search. */
+
+struct BTArrayInner
+{
+   /* 0 (FALSE), marking the node as an interior node. */
+   int bIsLeaf;
+
+   /* The number of children. */
+   size_t uLength;
+
+   /* The number of elements beneath each child. */
+   size_t auCounts[MAX_FANOUT];
+
+   /* The first element beneath each child. */
+   const void *apvFirsts[MAX_FANOUT];
+
+   /* The children: leaves if the node is at height 1, interior nodes
+      otherwise. */
+   void *apvChildren[MAX_FANOUT];
+};
+
+/*--------------------------------------------------------------------*/
+
+/* A BTArray consists of its root, the height of the tree below the
+   root, and the number of elements.  An empty BTArray has no root;
+   a root at height 0 is a leaf.
+
+   BTArray_find may run while the BTArray changes, so every change
+   stores the fields it reads (roots, lengths, children, first
+   elements, and leaf elements) one pointer-sized word at a time, and
+   fills in anything new before storing the length or pointer that
+   makes it reachable.  Discarded nodes and arrays go back to the pool
+   through Epoch_releaseWith rather than at once, or, in a BTArray
+   allocated from an arena, are simply left for the arena to
+   release. */
+
+struct BTArray
+{
+   /* The number of elements in the BTArray. */
+   size_t uLength;
+
+   /* The number of interior levels between the root and the leaves. */
+   size_t uHeight;
+
+   /* The root, or NULL if the BTArray is empty. */
+   void *pvRoot;
+
+   /* The arena that the BTArray and its nodes come from, or NULL if
+      they come from the pool. */
+   Arena_T oArena;
+};
+
+/*--------------------------------------------------------------------*/
+
+#ifndef NDEBUG
+
+/* Check the invariants of oBTArray.  Return 1 (TRUE) iff oBTArray
+   is in a valid state. */
+
+static int BTArray_isValid(BTArray_T oBTArray)
+{
+   struct BTArrayLeaf *psLeaf;
+   struct BTArrayInner *psInner;
+   size_t uTotal;
+   size_t u;
+
+   if (oBTArray->pvRoot == NULL)
+      return oBTArray->uLength == 0 && oBTArray->uHeight == 0;
+
+   if (oBTArray->uHeight == 0)
+   {
+      psLeaf = (struct BTArrayLeaf*)oBTArray->pvRoot;
+      if (psLeaf->ppvArray == NULL) return 0;
+      if (psLeaf->uLength > psLeaf->uPhysLength) return 0;
+      if (psLeaf->uLength != oBTArray->uLength) return 0;
+      return 1;
+   }
+
+   psInner = (struct BTArrayInner*)oBTArray->pvRoot;
+   if (psInner->uLength == 0 || psInner->uLength > MAX_FANOUT)
+      return 0;
+   uTotal = 0;
+   for (u = 0; u < psInner->uLength; u++)
+   {
+      if (psInner->auCounts[u] == 0) return 0;
+      uTotal += psInner->auCounts[u];
+   }
+   if (uTotal != oBTArray->uLength) return 0;
+   return 1;
+}
+
+#endif
+
+/*--------------------------------------------------------------------*/
+
+/* Return a block of uSize bytes for oBTArray, from its arena if it
+   has one and otherwise from the pool, or NULL if insufficient memory
+   is available.  No interior node, and no leaf array of at most
+   MAX_LEAF_LENGTH elements, is too large for the pool. */
+
+static void *BTArray_alloc(BTArray_T oBTArray, size_t uSize)
+{
+   assert(oBTArray != NULL);
+   assert(uSize <= POOL_MAX_SIZE);
+
+   if (oBTArray->oArena != NULL)
+      return Arena_alloc(oBTArray->oArena, uSize);
+   return Pool_alloc(uSize);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Release pv, a block of oBTArray that may still be read, to the pool
+   through Epoch_releaseWith.  A block from an arena stays until the
+   arena is released. */
+
+static void BTArray_release(BTArray_T oBTArray, void *pv)
+{
+   assert(oBTArray != NULL);
+
+   if (oBTArray->oArena == NULL)
+      Epoch_releaseWith(pv, Pool_free);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new leaf of oBTArray able to hold uPhysLength elements,
+   or NULL if insufficient memory is available. */
+
+static struct BTArrayLeaf *BTArray_newLeaf(BTArray_T oBTArray,
+                                           size_t uPhysLength)
+{
+   struct BTArrayLeaf *psLeaf;
+
+   psLeaf = (struct BTArrayLeaf*)
+      BTArray_alloc(oBTArray, sizeof(struct BTArrayLeaf));
+   if (psLeaf == NULL)
+      return NULL;
+
+   psLeaf->ppvArray = (const void**)
+      BTArray_alloc(oBTArray, sizeof(void*) * uPhysLength);
+   if (psLeaf->ppvArray == NULL)
+   {
+      BTArray_release(oBTArray, psLeaf);
+      return NULL;
+   }
+
+   psLeaf->bIsLeaf = 1;
+   psLeaf->uLength = 0;
+   psLeaf->uPhysLength = uPhysLength;
+   return psLeaf;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free pvNode, the root of a subtree of oBTArray of height uHeight,
+   and every node beneath it. */
+
+static void BTArray_freeNode(BTArray_T oBTArray, void *pvNode,
+                             size_t uHeight)
+{
+   struct BTArrayInner *psInner;
+   size_t u;
+
+   assert(pvNode != NULL);
+
+   if (uHeight == 0)
+   {
+      BTArray_release(oBTArray,
+                      (void*)((struct BTArrayLeaf*)pvNode)->ppvArray);
+      BTArray_release(oBTArray, pvNode);
+      return;
+   }
+
+   psInner = (struct BTArrayInner*)pvNode;
+   for (u = 0; u < psInner->uLength; u++)
+      BTArray_freeNode(oBTArray, psInner->apvChildren[u], uHeight - 1);
+   BTArray_release(oBTArray, psInner);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of entries (elements or children) in pvNode, a
+   node at height uHeight. */
+
+static size_t BTArray_nodeLength(void *pvNode, size_t uHeight)
+{
+   assert(pvNode != NULL);
+
+   if (uHeight == 0)
+      return ((struct BTArrayLeaf*)pvNode)->uLength;
+   return ((struct BTArrayInner*)pvNode)->uLength;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the first element beneath pvNode, a non-empty node at height
+   uHeight. */
+
+static const void *BTArray_nodeFirst(void *pvNode, size_t uHeight)
+{
+   assert(pvNode != NULL);
+   assert(BTArray_nodeLength(pvNode, uHeight) > 0);
+
+   if (uHeight == 0)
+      return ((struct BTArrayLeaf*)pvNode)->ppvArray[0];
+   return ((struct BTArrayInner*)pvNode)->apvFirsts[0];
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return 1 (TRUE) iff pvNode, a node at height uHeight, can take no
+   more entries without splitting. */
+
+static int BTArray_isFull(void *pvNode, size_t uHeight)
+{
+   if (uHeight == 0)
+      return BTArray_nodeLength(pvNode, uHeight) == MAX_LEAF_LENGTH;
+   return BTArray_nodeLength(pvNode, uHeight) == MAX_FANOUT;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Copy uCount elements from ppvFrom to ppvTo, which may overlap, one
+   pointer at a time, so that a concurrent BTArray_find never sees a
+   partly written pointer, nor an element it cannot yet read. */
+
+static void BTArray_move(const void **ppvTo, const void **ppvFrom,
+                         size_t uCount)
+{
+   size_t u;
+
+   assert(ppvTo != NULL);
+   assert(ppvFrom != NULL);
+
+   if (ppvTo < ppvFrom)
+      for (u = 0; u < uCount; u++)
+         __atomic_store_n(&ppvTo[u], ppvFrom[u], __ATOMIC_RELEASE);
+   else
+      for (u = uCount; u > 0; u--)
+         __atomic_store_n(&ppvTo[u-1], ppvFrom[u-1], __ATOMIC_RELEASE);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Store entry uTo of psInner, a child pvChild with uCount elements
+   beneath it, of which the first is pvFirst.  A concurrent
+   BTArray_find reads the first element and the child, so each is
+   stored in one piece, and only once what it points to is complete. */
+
+static void BTArray_setEntry(struct BTArrayInner *psInner, size_t uTo,
+                             size_t uCount, const void *pvFirst,
+                             void *pvChild)
+{
+   assert(psInner != NULL);
+   assert(uTo < MAX_FANOUT);
+
+   psInner->auCounts[uTo] = uCount;
+   __atomic_store_n(&psInner->apvFirsts[uTo], pvFirst,
+                    __ATOMIC_RELEASE);
+   __atomic_store_n(&psInner->apvChildren[uTo], pvChild,
+                    __ATOMIC_RELEASE);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Split the full uChild'th child of psParent, which is at height
+   uHeight, moving the upper half of its entries into a new sibling
+   just after it.  psParent must not be full.  Return 1 (TRUE) if
+   successful and 0 (FALSE) if insufficient memory is available. */
+
+static int BTArray_splitChild(BTArray_T oBTArray,
+                              struct BTArrayInner *psParent,
+                              size_t uChild, size_t uHeight)
+{
+   void *pvChild;
+   void *pvSibling;
+   struct BTArrayLeaf *psLeaf;
+   struct BTArrayLeaf *psNewLeaf;
+   struct BTArrayInner *psInner;
+   struct BTArrayInner *psNewInner;
+   size_t uMoved;
+   size_t uMovedCount;
+   size_t u;
+
+   assert(psParent != NULL);
+   assert(uChild < psParent->uLength);
+   assert(psParent->uLength < MAX_FANOUT);
+
+   pvChild = psParent->apvChildren[uChild];
+   assert(BTArray_isFull(pvChild, uHeight));
+
+   if (uHeight == 0)
+   {
+      psLeaf = (struct BTArrayLeaf*)pvChild;
+      psNewLeaf = BTArray_newLeaf(oBTArray, MAX_LEAF_LENGTH);
+      if (psNewLeaf == NULL)
+         return 0;
+      uMoved = psLeaf->uLength / 2;
+      memcpy(psNewLeaf->ppvArray,
+             psLeaf->ppvArray + (psLeaf->uLength - uMoved),
+             sizeof(void*) * uMoved);
+      psNewLeaf->uLength = uMoved;
+      __atomic_store_n(&psLeaf->uLength, psLeaf->uLength - uMoved,
+                       __ATOMIC_RELEASE);
+      uMovedCount = uMoved;
+      pvSibling = psNewLeaf;
+   }
+   else
+   {
+      psInner = (struct BTArrayInner*)pvChild;
+      psNewInner = (struct BTArrayInner*)
+         BTArray_alloc(oBTArray, sizeof(struct BTArrayInner));
+      if (psNewInner == NULL)
+         return 0;
+      psNewInner->bIsLeaf = 0;
+      uMoved = psInner->uLength / 2;
+      uMovedCount = 0;
+      for (u = 0; u < uMoved; u++)
+      {
+         size_t uFrom = psInner->uLength - uMoved + u;
+         psNewInner->auCounts[u] = psInner->auCounts[uFrom];
+         psNewInner->apvFirsts[u] = psInner->apvFirsts[uFrom];
+         psNewInner->apvChildren[u] = psInner->apvChildren[uFrom];
+         uMovedCount += psInner->auCounts[uFrom];
+      }
+      psNewInner->uLength = uMoved;
+      __atomic_store_n(&psInner->uLength, psInner->uLength - uMoved,
+                       __ATOMIC_RELEASE);
+      pvSibling = psNewInner;
+   }
+
+   for (u = psParent->uLength; u > uChild + 1; u--)
+      BTArray_setEntry(psParent, u, psParent->auCounts[u-1],
+                       psParent->apvFirsts[u-1],
+                       psParent->apvChildren[u-1]);
+   psParent->auCounts[uChild] -= uMovedCount;
+   BTArray_setEntry(psParent, uChild + 1, uMovedCount,
+                    BTArray_nodeFirst(pvSibling, uHeight), pvSibling);
+   __atomic_store_n(&psParent->uLength, psParent->uLength + 1,
+                    __ATOMIC_RELEASE);
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Remove the uChild'th entry of psParent, shifting later entries
+   down.  The child itself is not freed. */
+
+static void BTArray_removeChild(struct BTArrayInner *psParent,
+                                size_t uChild)
+{
+   size_t u;
+
+   assert(psParent != NULL);
+   assert(uChild < psParent->uLength);
+
+   for (u = uChild + 1; u < psParent->uLength; u++)
+      BTArray_setEntry(psParent, u - 1, psParent->auCounts[u],
+                       psParent->apvFirsts[u],
+                       psParent->apvChildren[u]);
+   __atomic_store_n(&psParent->uLength, psParent->uLength - 1,
+                    __ATOMIC_RELEASE);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* If the uChild'th child of psParent, which is at height uHeight, has
+   become sparse, merge it with an adjacent sibling when the two fit
+   comfortably in one node.  Merging keeps the number of nodes
+   proportional to the number of elements as elements are removed. */
+
+static void BTArray_mergeChild(BTArray_T oBTArray,
+                               struct BTArrayInner *psParent,
+                               size_t uChild, size_t uHeight)
+{
+   size_t uMax;
+   size_t uLeft;
+   void *pvLeft;
+   void *pvRight;
+   struct BTArrayLeaf *psLeft;
+   struct BTArrayLeaf *psRight;
+   struct BTArrayInner *psLeftInner;
+   struct BTArrayInner *psRightInner;
+   size_t u;
+
+   assert(psParent != NULL);
+   assert(uChild < psParent->uLength);
+
+   if (psParent->uLength < 2)
+      return;
+
+   uMax = (uHeight == 0) ? MAX_LEAF_LENGTH : MAX_FANOUT;
+   if (BTArray_nodeLength(psParent->apvChildren[uChild], uHeight)
+       >= uMax / 4)
+      return;
+
+   uLeft = (uChild > 0) ? uChild - 1 : uChild;
+   pvLeft = psParent->apvChildren[uLeft];
+   pvRight = psParent->apvChildren[uLeft+1];
+   if (BTArray_nodeLength(pvLeft, uHeight) +
+       BTArray_nodeLength(pvRight, uHeight) > (uMax / 4) * 3)
+      return;
+
+   if (uHeight == 0)
+   {
+      psLeft = (struct BTArrayLeaf*)pvLeft;
+      psRight = (struct BTArrayLeaf*)pvRight;
+      assert(psLeft->uPhysLength == MAX_LEAF_LENGTH);
+      memcpy(psLeft->ppvArray + psLeft->uLength, psRight->ppvArray,
+             sizeof(void*) * psRight->uLength);
+      __atomic_store_n(&psLeft->uLength,
+                       psLeft->uLength + psRight->uLength,
+                       __ATOMIC_RELEASE);
+   }
+   else
+   {
+      psLeftInner = (struct BTArrayInner*)pvLeft;
+      psRightInner = (struct BTArrayInner*)pvRight;
+      for (u = 0; u < psRightInner->uLength; u++)
+         BTArray_setEntry(psLeftInner, psLeftInner->uLength + u,
+                          psRightInner->auCounts[u],
+                          psRightInner->apvFirsts[u],
+                          psRightInner->apvChildren[u]);
+      __atomic_store_n(&psLeftInner->uLength,
+                       psLeftInner->uLength + psRightInner->uLength,
+                       __ATOMIC_RELEASE);
+      psRightInner->uLength = 0;
+   }
+
+   psParent->auCounts[uLeft] += psParent->auCounts[uLeft+1];
+   BTArray_removeChild(psParent, uLeft+1);
+   BTArray_freeNode(oBTArray, pvRight, uHeight);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Remove and return the element at uIndex beneath pvNode, a node at
+   height uHeight. */
+
+static const void *BTArray_removeFrom(BTArray_T oBTArray,
+                                      void *pvNode, size_t uHeight,
+                                      size_t uIndex)
+{
+   struct BTArrayLeaf *psLeaf;
+   struct BTArrayInner *psInner;
+   const void *pvElement;
+   size_t uChild;
+
+   assert(pvNode != NULL);
+
+   if (uHeight == 0)
+   {
+      psLeaf = (struct BTArrayLeaf*)pvNode;
+      assert(uIndex < psLeaf->uLength);
+      pvElement = psLeaf->ppvArray[uIndex];
+      BTArray_move(psLeaf->ppvArray + uIndex,
+                   psLeaf->ppvArray + uIndex + 1,
+                   psLeaf->uLength - uIndex - 1);
+      __atomic_store_n(&psLeaf->uLength, psLeaf->uLength - 1,
+                       __ATOMIC_RELEASE);
+      return pvElement;
+   }
+
+   psInner = (struct BTArrayInner*)pvNode;
+   uChild = 0;
+   while (uIndex >= psInner->auCounts[uChild])
+   {
+      uIndex -= psInner->auCounts[uChild];
+      uChild++;
+      assert(uChild < psInner->uLength);
+   }
+
+   pvElement = BTArray_removeFrom(oBTArray,
+                                  psInner->apvChildren[uChild],
+                                  uHeight - 1, uIndex);
+   psInner->auCounts[uChild]--;
+
+   if (psInner->auCounts[uChild] == 0)
+   {
+      void *pvChild = psInner->apvChildren[uChild];
+      BTArray_removeChild(psInner, uChild);
+      BTArray_freeNode(oBTArray, pvChild, uHeight - 1);
+      return pvElement;
+   }
+
+   if (uIndex == 0)
+      __atomic_store_n(&psInner->apvFirsts[uChild],
+                       BTArray_nodeFirst(psInner->apvChildren[uChild],
+                                         uHeight - 1),
+                       __ATOMIC_RELEASE);
+   BTArray_mergeChild(oBTArray, psInner, uChild, uHeight - 1);
+   return pvElement;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Apply *pfApply to each element beneath pvNode, a node at height
+   uHeight, in order. */
+
+static void BTArray_mapNode(void *pvNode, size_t uHeight,
+                            void (*pfApply)(void *pvElement,
+                                            void *pvExtra),
+                            const void *pvExtra)
+{
+   struct BTArrayLeaf *psLeaf;
+   struct BTArrayInner *psInner;
+   size_t u;
+
+   assert(pvNode != NULL);
+
+   if (uHeight == 0)
+   {
+      psLeaf = (struct BTArrayLeaf*)pvNode;
+      for (u = 0; u < psLeaf->uLength; u++)
+         (*pfApply)((void*)psLeaf->ppvArray[u], (void*)pvExtra);
+      return;
+   }
+
+   psInner = (struct BTArrayInner*)pvNode;
+   for (u = 0; u < psInner->uLength; u++)
+      BTArray_mapNode(psInner->apvChildren[u], uHeight - 1,
+                      pfApply, pvExtra);
+}
+
+/*--------------------------------------------------------------------*/
+
+BTArray_T BTArray_new(void)
+{
+   return BTArray_newIn(NULL);
+}
+
+/*--------------------------------------------------------------------*/
+
+BTArray_T BTArray_newIn(Arena_T oArena)
+{
+   BTArray_T oBTArray;
+
+   if (oArena != NULL)
+      oBTArray = (struct BTArray*)
+         Arena_alloc(oArena, sizeof(struct BTArray));
+   else
+      oBTArray = (struct BTArray*)Pool_alloc(sizeof(struct BTArray));
+   if (oBTArray == NULL)
+      return NULL;
+
+   oBTArray->uLength = 0;
+   oBTArray->uHeight = 0;
+   oBTArray->pvRoot = NULL;
+   oBTArray->oArena = oArena;
+
+   return oBTArray;
+}
+
+/*--------------------------------------------------------------------*/
+
+BTArray_T BTArray_newFrom(const void **ppvElements, size_t uLength)
+{
+   return BTArray_newFromIn(NULL, ppvElements, uLength);
+}
+
+/*--------------------------------------------------------------------*/
+
+BTArray_T BTArray_newFromIn(Arena_T oArena, const void **ppvElements,
+                            size_t uLength)
+{
+   BTArray_T oBTArray;
+   struct BTArrayLeaf *psLeaf;
+   struct BTArrayInner *psInner;
+   void **ppvLevel;
+   size_t *puCounts;
+   size_t uNodes;
+   size_t uParents;
+   size_t uHeight;
+   size_t uFirst;
+   size_t uEnd;
+   size_t u, v;
+
+   assert(uLength == 0 || ppvElements != NULL);
+
+   oBTArray = BTArray_newIn(oArena);
+   if (oBTArray == NULL || uLength == 0)
+      return oBTArray;
+
+   /* Few enough elements for the root leaf, sized as doubling from
+      MIN_PHYS_LENGTH would have left it, so that it still grows to
+      exactly MAX_LEAF_LENGTH before it splits. */
+   if (uLength <= MAX_LEAF_LENGTH)
+   {
+      u = MIN_PHYS_LENGTH;
+      while (u < uLength)
+         u *= 2;
+      psLeaf = BTArray_newLeaf(oBTArray, u);
+      if (psLeaf == NULL)
+      {
+         BTArray_release(oBTArray, oBTArray);
+         return NULL;
+      }
+      memcpy(psLeaf->ppvArray, ppvElements, sizeof(void*) * uLength);
+      psLeaf->uLength = uLength;
+      oBTArray->pvRoot = psLeaf;
+      oBTArray->uLength = uLength;
+      assert(BTArray_isValid(oBTArray));
+      return oBTArray;
+   }
+
+   /* Otherwise, one level at a time from the leaves up, spreading
+      each level's entries evenly over as few nodes as hold them. */
+   uNodes = (uLength + MAX_LEAF_LENGTH - 1) / MAX_LEAF_LENGTH;
+   ppvLevel = (void**)malloc(sizeof(void*) * uNodes);
+   puCounts = (size_t*)malloc(sizeof(size_t) * uNodes);
+   if (ppvLevel == NULL || puCounts == NULL)
+   {
+      free(ppvLevel);
+      free(puCounts);
+      BTArray_release(oBTArray, oBTArray);
+      return NULL;
+   }
+
+   for (u = 0; u < uNodes; u++)
+   {
+      uFirst = u * uLength / uNodes;
+      uEnd = (u + 1) * uLength / uNodes;
+      psLeaf = BTArray_newLeaf(oBTArray, MAX_LEAF_LENGTH);
+      if (psLeaf == NULL)
+      {
+         for (v = 0; v < u; v++)
+            BTArray_freeNode(oBTArray, ppvLevel[v], 0);
+         free(ppvLevel);
+         free(puCounts);
+         BTArray_release(oBTArray, oBTArray);
+         return NULL;
+      }
+      memcpy(psLeaf->ppvArray, ppvElements + uFirst,
+             sizeof(void*) * (uEnd - uFirst));
+      psLeaf->uLength = uEnd - uFirst;
+      ppvLevel[u] = psLeaf;
+      puCounts[u] = uEnd - uFirst;
+   }
+
+   /* Parent u takes children from index u onwards, so each level
+      can overwrite the one below in place. */
+   for (uHeight = 0; uNodes > 1; uHeight++)
+   {
+      uParents = (uNodes + MAX_FANOUT - 1) / MAX_FANOUT;
+      for (u = 0; u < uParents; u++)
+      {
+         uFirst = u * uNodes / uParents;
+         uEnd = (u + 1) * uNodes / uParents;
+         psInner = (struct BTArrayInner*)
+            BTArray_alloc(oBTArray, sizeof(struct BTArrayInner));
+         if (psInner == NULL)
+         {
+            for (v = 0; v < u; v++)
+               BTArray_freeNode(oBTArray, ppvLevel[v], uHeight + 1);
+            for (v = uFirst; v < uNodes; v++)
+               BTArray_freeNode(oBTArray, ppvLevel[v], uHeight);
+            free(ppvLevel);
+            free(puCounts);
+            BTArray_release(oBTArray, oBTArray);
+            return NULL;
+         }
+         psInner->bIsLeaf = 0;
+         psInner->uLength = uEnd - uFirst;
+         for (v = uFirst; v < uEnd; v++)
+         {
+            psInner->auCounts[v - uFirst] = puCounts[v];
+            psInner->apvFirsts[v - uFirst] =
+               BTArray_nodeFirst(ppvLevel[v], uHeight);
+            psInner->apvChildren[v - uFirst] = ppvLevel[v];
+         }
+         ppvLevel[u] = psInner;
+         puCounts[u] = 0;
+         for (v = 0; v < psInner->uLength; v++)
+            puCounts[u] += psInner->auCounts[v];
+      }
+      uNodes = uParents;
+   }
+
+   oBTArray->pvRoot = ppvLevel[0];
+   oBTArray->uHeight = uHeight;
+   oBTArray->uLength = uLength;
+   free(ppvLevel);
+   free(puCounts);
+
+   assert(BTArray_isValid(oBTArray));
+   return oBTArray;
+}
+
+/*--------------------------------------------------------------------*/
+
+void BTArray_free(BTArray_T oBTArray)
+{
+   assert(oBTArray != NULL);
+   assert(BTArray_isValid(oBTArray));
+
+   if (oBTArray->pvRoot != NULL)
+      BTArray_freeNode(oBTArray, oBTArray->pvRoot, oBTArray->uHeight);
+   BTArray_release(oBTArray, oBTArray);
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t BTArray_getLength(BTArray_T oBTArray)
+{
+   assert(oBTArray != NULL);
+   assert(BTArray_isValid(oBTArray));
+
+   return oBTArray->uLength;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *BTArray_get(BTArray_T oBTArray, size_t uIndex)
+{
+   void *pvNode;
+   struct BTArrayInner *psInner;
+   size_t uHeight;
+   size_t uChild;
+
+   assert(oBTArray != NULL);
+   assert(uIndex < oBTArray->uLength);
+   assert(BTArray_isValid(oBTArray));
+
+   pvNode = oBTArray->pvRoot;
+   for (uHeight = oBTArray->uHeight; uHeight > 0; uHeight--)
+   {
+      psInner = (struct BTArrayInner*)pvNode;
+      uChild = 0;
+      while (uIndex >= psInner->auCounts[uChild])
+      {
+         uIndex -= psInner->auCounts[uChild];
+         uChild++;
+      }
+      pvNode = psInner->apvChildren[uChild];
+   }
+   return (void*)((struct BTArrayLeaf*)pvNode)->ppvArray[uIndex];
+}
+
+/*--------------------------------------------------------------------*/
+
+void *BTArray_set(BTArray_T oBTArray, size_t uIndex,
+                  const void *pvElement)
+{
+   void *pvNode;
+   struct BTArrayInner *psInner;
+   struct BTArrayLeaf *psLeaf;
+   const void *pvOldElement;
+   size_t uHeight;
+   size_t uChild;
+
+   assert(oBTArray != NULL);
+   assert(uIndex < oBTArray->uLength);
+   assert(BTArray_isValid(oBTArray));
+
+   pvNode = oBTArray->pvRoot;
+   for (uHeight = oBTArray->uHeight; uHeight > 0; uHeight--)
+   {
+      psInner = (struct BTArrayInner*)pvNode;
+      uChild = 0;
+      while (uIndex >= psInner->auCounts[uChild])
+      {
+         uIndex -= psInner->auCounts[uChild];
+         uChild++;
+      }
+      if (uIndex == 0)
+         __atomic_store_n(&psInner->apvFirsts[uChild], pvElement,
+                          __ATOMIC_RELEASE);
+      pvNode = psInner->apvChildren[uChild];
+   }
+
+   psLeaf = (struct BTArrayLeaf*)pvNode;
+   pvOldElement = psLeaf->ppvArray[uIndex];
+   __atomic_store_n(&psLeaf->ppvArray[uIndex], pvElement,
+                    __ATOMIC_RELEASE);
+   return (void*)pvOldElement;
+}
+
+/*--------------------------------------------------------------------*/
+
+int BTArray_addAt(BTArray_T oBTArray, size_t uIndex,
+                  const void *pvElement)
+{
+   const size_t GROWTH_FACTOR = 2;
+
+   struct BTArrayLeaf *psLeaf;
+   struct BTArrayInner *psInner;
+   const void **ppvNewArray;
+   const void **ppvOldArray;
+   void *pvNode;
+   size_t uHeight;
+   size_t uChild;
+
+   assert(oBTArray != NULL);
+   assert(uIndex <= oBTArray->uLength);
+   assert(BTArray_isValid(oBTArray));
+
+   if (oBTArray->pvRoot == NULL)
+   {
+      psLeaf = BTArray_newLeaf(oBTArray, MIN_PHYS_LENGTH);
+      if (psLeaf == NULL)
+         return 0;
+      __atomic_store_n(&oBTArray->pvRoot, psLeaf, __ATOMIC_RELEASE);
+   }
+
+   /* Split a full root under a new root, so that every node on the
+      way down has room for a split child. */
+   if (BTArray_isFull(oBTArray->pvRoot, oBTArray->uHeight))
+   {
+      psInner = (struct BTArrayInner*)
+         BTArray_alloc(oBTArray, sizeof(struct BTArrayInner));
+      if (psInner == NULL)
+         return 0;
+      psInner->bIsLeaf = 0;
+      psInner->uLength = 1;
+      psInner->auCounts[0] = oBTArray->uLength;
+      psInner->apvFirsts[0] =
+         BTArray_nodeFirst(oBTArray->pvRoot, oBTArray->uHeight);
+      psInner->apvChildren[0] = oBTArray->pvRoot;
+      if (! BTArray_splitChild(oBTArray, psInner, 0, oBTArray->uHeight))
+      {
+         BTArray_release(oBTArray, psInner);
+         return 0;
+      }
+      __atomic_store_n(&oBTArray->pvRoot, psInner, __ATOMIC_RELEASE);
+      oBTArray->uHeight++;
+   }
+
+   /* Splitting full children ahead of the descent keeps the sequence
+      unchanged if memory runs out part way down.  Below the root,
+      every leaf already has MAX_LEAF_LENGTH slots, so only a root leaf
+      ever needs to grow. */
+   pvNode = oBTArray->pvRoot;
+   for (uHeight = oBTArray->uHeight; uHeight > 0; uHeight--)
+   {
+      psInner = (struct BTArrayInner*)pvNode;
+      uChild = 0;
+      while (uChild < psInner->uLength - 1 &&
+             uIndex > psInner->auCounts[uChild])
+      {
+         uIndex -= psInner->auCounts[uChild];
+         uChild++;
+      }
+      if (BTArray_isFull(psInner->apvChildren[uChild], uHeight - 1))
+      {
+         if (! BTArray_splitChild(oBTArray, psInner, uChild,
+                                  uHeight - 1))
+            return 0;
+         if (uIndex > psInner->auCounts[uChild])
+         {
+            uIndex -= psInner->auCounts[uChild];
+            uChild++;
+         }
+      }
+      psInner->auCounts[uChild]++;
+      if (uIndex == 0)
+         __atomic_store_n(&psInner->apvFirsts[uChild], pvElement,
+                          __ATOMIC_RELEASE);
+      pvNode = psInner->apvChildren[uChild];
+   }
+
+   psLeaf = (struct BTArrayLeaf*)pvNode;
+   if (psLeaf->uLength == psLeaf->uPhysLength)
+   {
+      /* Copy rather than realloc, since a concurrent BTArray_find may
+         still be reading the old array. */
+      assert(oBTArray->uHeight == 0);
+      ppvNewArray = (const void**)
+         BTArray_alloc(oBTArray,
+                       sizeof(void*) * GROWTH_FACTOR *
+                       psLeaf->uPhysLength);
+      if (ppvNewArray == NULL)
+         return 0;
+      memcpy(ppvNewArray, psLeaf->ppvArray,
+             sizeof(void*) * psLeaf->uLength);
+      ppvOldArray = psLeaf->ppvArray;
+      __atomic_store_n(&psLeaf->ppvArray, ppvNewArray,
+                       __ATOMIC_RELEASE);
+      __atomic_store_n(&psLeaf->uPhysLength,
+                       GROWTH_FACTOR * psLeaf->uPhysLength,
+                       __ATOMIC_RELEASE);
+      BTArray_release(oBTArray, (void*)ppvOldArray);
+   }
+
+   BTArray_move(psLeaf->ppvArray + uIndex + 1,
+                psLeaf->ppvArray + uIndex, psLeaf->uLength - uIndex);
+   __atomic_store_n(&psLeaf->ppvArray[uIndex], pvElement,
+                    __ATOMIC_RELEASE);
+   __atomic_store_n(&psLeaf->uLength, psLeaf->uLength + 1,
+                    __ATOMIC_RELEASE);
+   oBTArray->uLength++;
+
+   assert(BTArray_isValid(oBTArray));
+
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *BTArray_removeAt(BTArray_T oBTArray, size_t uIndex)
+{
+   const void *pvElement;
+   struct BTArrayInner *psInner;
+
+   assert(oBTArray != NULL);
+   assert(uIndex < oBTArray->uLength);
+   assert(BTArray_isValid(oBTArray));
+
+   pvElement = BTArray_removeFrom(oBTArray, oBTArray->pvRoot,
+                                  oBTArray->uHeight, uIndex);
+   oBTArray->uLength--;
+
+   /* Drop roots left with a single child, and an empty root. */
+   while (oBTArray->uHeight > 0 &&
+          ((struct BTArrayInner*)oBTArray->pvRoot)->uLength == 1)
+   {
+      psInner = (struct BTArrayInner*)oBTArray->pvRoot;
+      __atomic_store_n(&oBTArray->pvRoot, psInner->apvChildren[0],
+                       __ATOMIC_RELEASE);
+      oBTArray->uHeight--;
+      BTArray_release(oBTArray, psInner);
+   }
+   if (oBTArray->uLength == 0)
+   {
+      void *pvRoot = oBTArray->pvRoot;
+      __atomic_store_n(&oBTArray->pvRoot, NULL, __ATOMIC_RELEASE);
+      BTArray_freeNode(oBTArray, pvRoot, oBTArray->uHeight);
+      oBTArray->uHeight = 0;
+   }
+
+   assert(BTArray_isValid(oBTArray));
+
+   return (void*)pvElement;
+}
+
+/*--------------------------------------------------------------------*/
+
+void BTArray_map(BTArray_T oBTArray,
+                 void (*pfApply)(void *pvElement, void *pvExtra),
+                 const void *pvExtra)
+{
+   assert(oBTArray != NULL);
+   assert(pfApply != NULL);
+   assert(BTArray_isValid(oBTArray));
+
+   if (oBTArray->pvRoot != NULL)
+      BTArray_mapNode(oBTArray->pvRoot, oBTArray->uHeight,
+                      pfApply, pvExtra);
+}
+
+/*--------------------------------------------------------------------*/
+
+int BTArray_bsearch(BTArray_T oBTArray,
+                    void *pvSoughtElement,
+                    size_t *puIndex,
+                    int (*pfCompare)(const void *pvElement1,
+                                     const void *pvElement2))
+{
+   void *pvNode;
+   struct BTArrayInner *psInner;
+   struct BTArrayLeaf *psLeaf;
+   size_t uHeight;
+   size_t uOffset;
+   size_t uLeft;
+   size_t uRight;
+   size_t uMid;
+   size_t u;
+   int iCompare;
+
+   assert(oBTArray != NULL);
+   assert(puIndex != NULL);
+   assert(pfCompare != NULL);
+   assert(BTArray_isValid(oBTArray));
+
+   if (oBTArray->pvRoot == NULL)
+   {
+      *puIndex = 0;
+      return 0;
+   }
+
+   /* At each interior node, descend into the last child whose first
+      element is not greater than the sought element. */
+   uOffset = 0;
+   pvNode = oBTArray->pvRoot;
+   for (uHeight = oBTArray->uHeight; uHeight > 0; uHeight--)
+   {
+      psInner = (struct BTArrayInner*)pvNode;
+      uLeft = 0;
+      uRight = psInner->uLength;
+      iCompare = 1;
+      while (uLeft + 1 < uRight)
+      {
+         uMid = uLeft + (uRight - uLeft) / 2;
+         iCompare = (*pfCompare)(psInner->apvFirsts[uMid],
+                                 pvSoughtElement);
+         if (iCompare == 0)
+         {
+            uLeft = uMid;
+            break;
+         }
+         if (iCompare < 0)
+            uLeft = uMid;
+         else
+            uRight = uMid;
+      }
+      for (u = 0; u < uLeft; u++)
+         uOffset += psInner->auCounts[u];
+      if (iCompare == 0)
+      {
+         *puIndex = uOffset;
+         return 1;
+      }
+      pvNode = psInner->apvChildren[uLeft];
+   }
+
+   psLeaf = (struct BTArrayLeaf*)pvNode;
+   uLeft = 0;
+   uRight = psLeaf->uLength;
+   while (uLeft < uRight)
+   {
+      uMid = uLeft + (uRight - uLeft) / 2;
+      iCompare = (*pfCompare)(psLeaf->ppvArray[uMid], pvSoughtElement);
+      if (iCompare == 0)
+      {
+         *puIndex = uOffset + uMid;
+         return 1;
+      }
+      if (iCompare < 0)
+         uLeft = uMid + 1;
+      else
+         uRight = uMid;
+   }
+   *puIndex = uOffset + uLeft;
+   return 0;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *BTArray_find(BTArray_T oBTArray,
+                   void *pvSoughtElement,
+                   int (*pfCompare)(const void *pvElement1,
+                                    const void *pvElement2))
+{
+   void *pvNode;
+   struct BTArrayInner *psInner;
+   struct BTArrayLeaf *psLeaf;
+   const void **ppvArray;
+   const void *pvElement;
+   size_t uLength;
+   size_t uPhysLength;
+   size_t uLeft;
+   size_t uRight;
+   size_t uMid;
+   int iCompare;
+
+   assert(oBTArray != NULL);
+   assert(pfCompare != NULL);
+
+   /* Each length is read before the array it bounds, and every read
+      is clamped, so a concurrent change can make the answer wrong but
+      never sends the search out of bounds. */
+   pvNode = __atomic_load_n(&oBTArray->pvRoot, __ATOMIC_ACQUIRE);
+   if (pvNode == NULL)
+      return NULL;
+
+   while (! ((struct BTArrayLeaf*)pvNode)->bIsLeaf)
+   {
+      psInner = (struct BTArrayInner*)pvNode;
+      uLength = __atomic_load_n(&psInner->uLength, __ATOMIC_ACQUIRE);
+      if (uLength == 0 || uLength > MAX_FANOUT)
+         return NULL;
+      uLeft = 0;
+      uRight = uLength;
+      while (uLeft + 1 < uRight)
+      {
+         uMid = uLeft + (uRight - uLeft) / 2;
+         pvElement = __atomic_load_n(&psInner->apvFirsts[uMid],
+                                     __ATOMIC_ACQUIRE);
+         iCompare = (*pfCompare)(pvElement, pvSoughtElement);
+         if (iCompare == 0)
+            return (void*)pvElement;
+         if (iCompare < 0)
+            uLeft = uMid;
+         else
+            uRight = uMid;
+      }
+      pvNode = __atomic_load_n(&psInner->apvChildren[uLeft],
+                               __ATOMIC_ACQUIRE);
+   }
+
+   psLeaf = (struct BTArrayLeaf*)pvNode;
+   uLength = __atomic_load_n(&psLeaf->uLength, __ATOMIC_ACQUIRE);
+   uPhysLength = __atomic_load_n(&psLeaf->uPhysLength,
+                                 __ATOMIC_ACQUIRE);
+   ppvArray = __atomic_load_n(&psLeaf->ppvArray, __ATOMIC_ACQUIRE);
+   if (uLength > uPhysLength)
+      uLength = uPhysLength;
+   uLeft = 0;
+   uRight = uLength;
+   while (uLeft < uRight)
+   {
+      uMid = uLeft + (uRight - uLeft) / 2;
+      pvElement = __atomic_load_n(&ppvArray[uMid], __ATOMIC_ACQUIRE);
+      iCompare = (*pfCompare)(pvElement, pvSoughtElement);
+      if (iCompare == 0)
+         return (void*)pvElement;
+      if (iCompare < 0)
+         uLeft = uMid + 1;
+      else
+         uRight = uMid;
+   }
+   return NULL;
+}
@@ -0,0 +1,140 @@
+/*--------------------------------------------------------------------*/
+/* btarray.h                                                          */
+/* Author: Matthew Okechukwu, Pinrui Huang                            */
+/*--------------------------------------------------------------------*/
+
+#ifndef BTARRAY_INCLUDED
+#define BTARRAY_INCLUDED
+
+#include <stddef.h>
+#include "arena.h"
+
+/* A BTArray_T object is a sequence of elements that, like a DynArray_T,
+   is accessed by index, but that is stored as a B+ tree whose interior
+   nodes count the elements beneath them.  Access, insertion and
+   removal at any index therefore take O(log n) time rather than
+   shifting every later element. */
+
+typedef struct BTArray *BTArray_T;
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new, empty BTArray_T object, or NULL if insufficient
+   memory is available. */
+
+BTArray_T BTArray_new(void);
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new, empty BTArray_T object whose memory, and that of
+   everything later added to it, comes from oArena, or from the pool if
+   oArena is NULL.  Return NULL if insufficient memory is available.
+   Nothing that such an object discards is released before oArena
+   is. */
+
+BTArray_T BTArray_newIn(Arena_T oArena);
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new BTArray_T object holding the uLength elements at
+   ppvElements, in order, or NULL if insufficient memory is available.
+   The tree is built bottom-up with its nodes filled evenly, in O(n)
+   time rather than the O(n log n) of as many calls to
+   BTArray_addAt. */
+
+BTArray_T BTArray_newFrom(const void **ppvElements, size_t uLength);
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new BTArray_T object as BTArray_newFrom does, but with its
+   memory coming from oArena as for BTArray_newIn. */
+
+BTArray_T BTArray_newFromIn(Arena_T oArena, const void **ppvElements,
+                            size_t uLength);
+
+/*--------------------------------------------------------------------*/
+
+/* Free oBTArray.  The elements themselves are not freed. */
+
+void BTArray_free(BTArray_T oBTArray);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the length of oBTArray. */
+
+size_t BTArray_getLength(BTArray_T oBTArray);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the uIndex'th element of oBTArray. */
+
+void *BTArray_get(BTArray_T oBTArray, size_t uIndex);
+
+/*--------------------------------------------------------------------*/
+
+/* Replace the uIndex'th element of oBTArray with pvElement, and return
+   the element replaced.  If oBTArray is sorted, pvElement must belong
+   in the same place.  Nothing is allocated, so the call cannot fail. */
+
+void *BTArray_set(BTArray_T oBTArray, size_t uIndex,
+                  const void *pvElement);
+
+/*--------------------------------------------------------------------*/
+
+/* Add pvElement to oBTArray such that it is the uIndex'th element.
+   Return 1 (TRUE) if successful, or 0 (FALSE) if insufficient memory
+   is available, in which case oBTArray is unchanged. */
+
+int BTArray_addAt(BTArray_T oBTArray, size_t uIndex,
+                  const void *pvElement);
+
+/*--------------------------------------------------------------------*/
+
+/* Remove and return the uIndex'th element of oBTArray. */
+
+void *BTArray_removeAt(BTArray_T oBTArray, size_t uIndex);
+
+/*--------------------------------------------------------------------*/
+
+/* Apply function *pfApply to each element of oBTArray in order,
+   passing pvExtra as an extra argument.  That is, for each element
+   pvElement of oBTArray, call (*pfApply)(pvElement, pvExtra). */
+
+void BTArray_map(BTArray_T oBTArray,
+                 void (*pfApply)(void *pvElement, void *pvExtra),
+                 const void *pvExtra);
+
+/*--------------------------------------------------------------------*/
+
+/* Binary search oBTArray for *pvSoughtElement using *pfCompare to
+   determine equality.  If the element is found, then assign its
+   index to *puIndex and return 1.  If the element is not found, then
+   assign the index where it would belong to *puIndex and return 0.
+   *pfCompare must return <0, 0, or >0 if *pvElement1 is less than,
+   equal to, or greater than *pvElement2.
+   oBTArray must be sorted as determined by *pfCompare. */
+
+int BTArray_bsearch(BTArray_T oBTArray,
+                    void *pvSoughtElement,
+                    size_t *puIndex,
+                    int (*pfCompare)(const void *pvElement1,
+                                     const void *pvElement2));
+
+/*--------------------------------------------------------------------*/
+
+/* Return the element of oBTArray that *pfCompare finds equal to
+   *pvSoughtElement, or NULL if there is none.  oBTArray must be
+   sorted as for BTArray_bsearch.
+
+   Unlike every other function here, BTArray_find may run while
+   another thread changes oBTArray, provided that the reading thread
+   is inside Epoch_enter and the changing thread is inside
+   Epoch_beginRetire.  It is then safe, but its answer is only
+   reliable if the caller can tell that no change overlapped it. */
+
+void *BTArray_find(BTArray_T oBTArray,
+                   void *pvSoughtElement,
+                   int (*pfCompare)(const void *pvElement1,
+                                    const void *pvElement2));
+
+#endif
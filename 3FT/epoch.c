@@ -0,0 +1,505 @@
+/*--------------------------------------------------------------------*/
+/* epoch.c                                                            */
+/* Author: Matthew Okechukwu, Pinrui Huang                            */
+/*--------------------------------------------------------------------*/
+
+/* pthread and sched_yield are POSIX extensions beyond ISO C */
+#define _XOPEN_SOURCE 600
+
+#include "epoch.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <sched.h>
+
+/*--------------------------------------------------------------------*/
+
+enum {
+   /* The number of epochs that must begin after a change ends before
+      the memory it released is freed. */
+   NUM_BUCKETS = 3,
+
+   /* The size of a cache line, for spacing out per-thread records. */
+   CACHE_LINE_SIZE = 64
+};
+
+/* The minimum physical length of a bucket's array. */
+
+static const size_t MIN_PHYS_LENGTH = 16;
+
+/*--------------------------------------------------------------------*/
+
+/* A block awaiting free and the function that frees it. */
+
+struct EpochItem
+{
+   /* The block. */
+   void *pv;
+
+   /* The function that frees pv. */
+   void (*pfFree)(void *pv);
+};
+
+/* Memory released by one thread and not yet freed. */
+
+struct EpochBucket
+{
+   /* The number of items in the bucket. */
+   size_t uLength;
+
+   /* The number of items the array can hold. */
+   size_t uPhysLength;
+
+   /* The array of items awaiting free. */
+   struct EpochItem *psArray;
+};
+
+/* The per-thread bookkeeping of one thread.  Only the owning thread
+   writes uState, so readers never write a cache line that another
+   thread writes, and only the owning thread touches the memory it
+   has released, so writers need no shared lock to release it. */
+
+struct EpochRecord
+{
+   /* While the thread is reading, the epoch it read in, shifted left
+      once and with the low bit set; 0 while it is not reading. */
+   size_t uState;
+
+   /* The next record in the list of all records. */
+   struct EpochRecord *psNext;
+
+   /* 1 (TRUE) while some thread owns the record. */
+   int bInUse;
+
+   /* Keeps the fields above, which other threads read, off the lines
+      that the owner writes below. */
+   char acPad[CACHE_LINE_SIZE];
+
+   /* 1 (TRUE) while the thread is between Epoch_beginRetire and
+      Epoch_endRetire. */
+   int bRetiring;
+
+   /* The memory released since Epoch_beginRetire. */
+   struct EpochBucket sReleased;
+
+   /* The memory released by the thread's changes that ended in each
+      of the last NUM_BUCKETS epochs it ended a change in, filed by
+      that epoch modulo NUM_BUCKETS, and the epoch itself. */
+   struct EpochBucket asLimbo[NUM_BUCKETS];
+   size_t auLimboEpoch[NUM_BUCKETS];
+};
+
+/*--------------------------------------------------------------------*/
+
+/* The key under which each thread finds its own record. */
+static pthread_key_t sKey;
+
+/* 1 (TRUE) once sKey has been created. */
+static int bKeyCreated;
+
+/* Makes sure sKey is created exactly once. */
+static pthread_once_t sKeyOnce = PTHREAD_ONCE_INIT;
+
+/* Guards the adding of records to psRecords and their bInUse. */
+static pthread_mutex_t sLock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Every record ever allocated.  Records are only ever added at the
+   front, so the list may be walked without sLock. */
+static struct EpochRecord *psRecords;
+
+/* The current epoch, which only ever grows. */
+static size_t uEpoch;
+
+/*--------------------------------------------------------------------*/
+
+/* Free every item in psBucket and empty it. */
+
+static void Epoch_emptyBucket(struct EpochBucket *psBucket)
+{
+   size_t u;
+
+   assert(psBucket != NULL);
+
+   for (u = 0; u < psBucket->uLength; u++)
+      psBucket->psArray[u].pfFree(psBucket->psArray[u].pv);
+   psBucket->uLength = 0;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Advance the epoch from uCurrent if every thread that is reading
+   began in uCurrent.  Several threads may try at once, and at most
+   one of them advances it.  Return 1 (TRUE) if the epoch is now past
+   uCurrent and 0 (FALSE) otherwise. */
+
+static int Epoch_tryAdvance(size_t uCurrent)
+{
+   struct EpochRecord *psRecord;
+   size_t uState;
+
+   /* Pairs with the fence in Epoch_enter. */
+   __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+   for (psRecord = __atomic_load_n(&psRecords, __ATOMIC_ACQUIRE);
+        psRecord != NULL; psRecord = psRecord->psNext)
+   {
+      uState = __atomic_load_n(&psRecord->uState, __ATOMIC_ACQUIRE);
+      if ((uState & 1) != 0 && (uState >> 1) != uCurrent)
+         return __atomic_load_n(&uEpoch, __ATOMIC_ACQUIRE) != uCurrent;
+   }
+
+   (void)__atomic_compare_exchange_n(&uEpoch, &uCurrent, uCurrent + 1,
+                                     0, __ATOMIC_SEQ_CST,
+                                     __ATOMIC_SEQ_CST);
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Wait until every thread that was reading when the call began has
+   finished reading. */
+
+static void Epoch_synchronize(void)
+{
+   size_t uStart;
+   size_t uCurrent;
+
+   /* A reader that began in epoch e holds up the advance from e, so
+      after two advances it has certainly left. */
+   uStart = __atomic_load_n(&uEpoch, __ATOMIC_SEQ_CST);
+   for (;;)
+   {
+      uCurrent = __atomic_load_n(&uEpoch, __ATOMIC_ACQUIRE);
+      if (uCurrent - uStart >= 2)
+         return;
+      if (! Epoch_tryAdvance(uCurrent))
+         (void)sched_yield();
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free everything that psRecord's thread has released and not yet
+   freed, first waiting out every reader that might still see it. */
+
+static void Epoch_flushRecord(struct EpochRecord *psRecord)
+{
+   int i;
+
+   assert(psRecord != NULL);
+
+   Epoch_synchronize();
+   Epoch_emptyBucket(&psRecord->sReleased);
+   for (i = 0; i < NUM_BUCKETS; i++)
+      Epoch_emptyBucket(&psRecord->asLimbo[i]);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Give up pvRecord, the record of a thread that is exiting, so that
+   another thread can reuse it, freeing what the thread released
+   first. */
+
+static void Epoch_releaseRecord(void *pvRecord)
+{
+   struct EpochRecord *psRecord = (struct EpochRecord*)pvRecord;
+
+   assert(psRecord != NULL);
+
+   __atomic_store_n(&psRecord->uState, 0, __ATOMIC_RELEASE);
+   psRecord->bRetiring = 0;
+   Epoch_flushRecord(psRecord);
+   (void)pthread_mutex_lock(&sLock);
+   psRecord->bInUse = 0;
+   (void)pthread_mutex_unlock(&sLock);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Create sKey. */
+
+static void Epoch_createKey(void)
+{
+   if (pthread_key_create(&sKey, Epoch_releaseRecord) == 0)
+      __atomic_store_n(&bKeyCreated, 1, __ATOMIC_RELEASE);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the calling thread's record, allocating and registering one
+   if it has none yet, or NULL if insufficient memory is available. */
+
+static struct EpochRecord *Epoch_getRecord(void)
+{
+   struct EpochRecord *psRecord;
+
+   (void)pthread_once(&sKeyOnce, Epoch_createKey);
+   if (! __atomic_load_n(&bKeyCreated, __ATOMIC_ACQUIRE))
+      return NULL;
+
+   psRecord = (struct EpochRecord*)pthread_getspecific(sKey);
+   if (psRecord != NULL)
+      return psRecord;
+
+   (void)pthread_mutex_lock(&sLock);
+   for (psRecord = psRecords; psRecord != NULL;
+        psRecord = psRecord->psNext)
+      if (! psRecord->bInUse)
+         break;
+   if (psRecord == NULL)
+   {
+      psRecord = (struct EpochRecord*)
+         calloc(1, sizeof(struct EpochRecord));
+      if (psRecord == NULL)
+      {
+         (void)pthread_mutex_unlock(&sLock);
+         return NULL;
+      }
+      psRecord->psNext = psRecords;
+      __atomic_store_n(&psRecords, psRecord, __ATOMIC_RELEASE);
+   }
+   psRecord->bInUse = 1;
+   (void)pthread_mutex_unlock(&sLock);
+
+   if (pthread_setspecific(sKey, psRecord) != 0)
+   {
+      Epoch_releaseRecord(psRecord);
+      return NULL;
+   }
+   return psRecord;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Make room in psBucket for uExtra more items.  Return 1 (TRUE) if
+   successful and 0 (FALSE) if insufficient memory is available. */
+
+static int Epoch_reserve(struct EpochBucket *psBucket, size_t uExtra)
+{
+   const size_t GROWTH_FACTOR = 2;
+
+   size_t uNewLength;
+   struct EpochItem *psNewArray;
+
+   assert(psBucket != NULL);
+
+   if (psBucket->uLength + uExtra <= psBucket->uPhysLength)
+      return 1;
+
+   uNewLength = GROWTH_FACTOR * psBucket->uPhysLength;
+   if (uNewLength < MIN_PHYS_LENGTH)
+      uNewLength = MIN_PHYS_LENGTH;
+   if (uNewLength < psBucket->uLength + uExtra)
+      uNewLength = psBucket->uLength + uExtra;
+   psNewArray = (struct EpochItem*)
+      realloc(psBucket->psArray, sizeof(struct EpochItem) * uNewLength);
+   if (psNewArray == NULL)
+      return 0;
+
+   psBucket->psArray = psNewArray;
+   psBucket->uPhysLength = uNewLength;
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free whatever psRecord's thread released in changes that ended at
+   least NUM_BUCKETS epochs before uCurrent, which no reader can still
+   see.  Return 1 (TRUE) if anything else remains to be freed. */
+
+static int Epoch_freeDue(struct EpochRecord *psRecord, size_t uCurrent)
+{
+   int bPending = 0;
+   int i;
+
+   assert(psRecord != NULL);
+
+   for (i = 0; i < NUM_BUCKETS; i++)
+   {
+      if (psRecord->asLimbo[i].uLength == 0)
+         continue;
+      if (uCurrent - psRecord->auLimboEpoch[i] >= NUM_BUCKETS)
+         Epoch_emptyBucket(&psRecord->asLimbo[i]);
+      else
+         bPending = 1;
+   }
+   return bPending;
+}
+
+/*--------------------------------------------------------------------*/
+
+int Epoch_enter(void)
+{
+   struct EpochRecord *psRecord;
+   size_t uCurrent;
+
+   psRecord = Epoch_getRecord();
+   if (psRecord == NULL)
+      return 0;
+   assert((psRecord->uState & 1) == 0);
+
+   uCurrent = __atomic_load_n(&uEpoch, __ATOMIC_ACQUIRE);
+   __atomic_store_n(&psRecord->uState, (uCurrent << 1) | 1,
+                    __ATOMIC_RELAXED);
+   /* Publish the state before reading anything it protects. */
+   __atomic_thread_fence(__ATOMIC_SEQ_CST);
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+void Epoch_leave(void)
+{
+   struct EpochRecord *psRecord;
+
+   psRecord = (struct EpochRecord*)pthread_getspecific(sKey);
+   assert(psRecord != NULL);
+   assert((psRecord->uState & 1) != 0);
+
+   __atomic_store_n(&psRecord->uState, 0, __ATOMIC_RELEASE);
+}
+
+/*--------------------------------------------------------------------*/
+
+int Epoch_beginRetire(void)
+{
+   struct EpochRecord *psRecord;
+
+   psRecord = Epoch_getRecord();
+   if (psRecord == NULL)
+      return 0;
+   assert(! psRecord->bRetiring);
+   assert((psRecord->uState & 1) == 0);
+
+   psRecord->bRetiring = 1;
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+void Epoch_endRetire(void)
+{
+   struct EpochRecord *psRecord;
+   struct EpochBucket *psReleased;
+   struct EpochBucket *psLimbo;
+   size_t uCurrent;
+   size_t u;
+   int i;
+
+   if (! __atomic_load_n(&bKeyCreated, __ATOMIC_ACQUIRE))
+      return;
+   psRecord = (struct EpochRecord*)pthread_getspecific(sKey);
+   if (psRecord == NULL)
+      return;
+
+   psRecord->bRetiring = 0;
+   psReleased = &psRecord->sReleased;
+   if (psReleased->uLength == 0)
+   {
+      for (i = 0; i < NUM_BUCKETS; i++)
+         if (psRecord->asLimbo[i].uLength != 0)
+            break;
+      /* Nothing to file or free: the common case costs no more. */
+      if (i == NUM_BUCKETS)
+         return;
+   }
+
+   /* Every block released so far was unreachable before this load,
+      so a reader that begins in a later epoch cannot see it. */
+   uCurrent = __atomic_load_n(&uEpoch, __ATOMIC_SEQ_CST);
+   (void)Epoch_freeDue(psRecord, uCurrent);
+
+   if (psReleased->uLength != 0)
+   {
+      psLimbo = &psRecord->asLimbo[uCurrent % NUM_BUCKETS];
+      if (psLimbo->uLength == 0)
+      {
+         /* Swap rather than copy, keeping both arrays for reuse. */
+         struct EpochBucket sTemp = *psLimbo;
+         *psLimbo = *psReleased;
+         *psReleased = sTemp;
+      }
+      else if (Epoch_reserve(psLimbo, psReleased->uLength))
+      {
+         /* Filed in the same epoch by an earlier change. */
+         assert(psRecord->auLimboEpoch[uCurrent % NUM_BUCKETS] ==
+                uCurrent);
+         for (u = 0; u < psReleased->uLength; u++)
+            psLimbo->psArray[psLimbo->uLength + u] =
+               psReleased->psArray[u];
+         psLimbo->uLength += psReleased->uLength;
+         psReleased->uLength = 0;
+      }
+      else
+      {
+         /* No room to file: wait out the readers instead. */
+         Epoch_synchronize();
+         Epoch_emptyBucket(psReleased);
+      }
+      psRecord->auLimboEpoch[uCurrent % NUM_BUCKETS] = uCurrent;
+   }
+
+   /* Help the epoch along once, so that what was filed comes due. */
+   if (Epoch_tryAdvance(uCurrent))
+      (void)Epoch_freeDue(psRecord,
+                          __atomic_load_n(&uEpoch, __ATOMIC_ACQUIRE));
+}
+
+/*--------------------------------------------------------------------*/
+
+void Epoch_flush(void)
+{
+   struct EpochRecord *psRecord;
+
+   if (! __atomic_load_n(&bKeyCreated, __ATOMIC_ACQUIRE))
+      return;
+   psRecord = (struct EpochRecord*)pthread_getspecific(sKey);
+   if (psRecord == NULL)
+      return;
+   assert(! psRecord->bRetiring);
+   assert((psRecord->uState & 1) == 0);
+
+   Epoch_flushRecord(psRecord);
+}
+
+/*--------------------------------------------------------------------*/
+
+void Epoch_release(void *pv)
+{
+   Epoch_releaseWith(pv, free);
+}
+
+/*--------------------------------------------------------------------*/
+
+void Epoch_releaseWith(void *pv, void (*pfFree)(void *pv))
+{
+   struct EpochRecord *psRecord = NULL;
+   struct EpochBucket *psReleased;
+
+   assert(pfFree != NULL);
+
+   if (pv == NULL)
+      return;
+
+   if (__atomic_load_n(&bKeyCreated, __ATOMIC_ACQUIRE))
+      psRecord = (struct EpochRecord*)pthread_getspecific(sKey);
+   if (psRecord == NULL || ! psRecord->bRetiring)
+   {
+      pfFree(pv);
+      return;
+   }
+
+   psReleased = &psRecord->sReleased;
+   if (Epoch_reserve(psReleased, 1))
+   {
+      psReleased->psArray[psReleased->uLength].pv = pv;
+      psReleased->psArray[psReleased->uLength].pfFree = pfFree;
+      psReleased->uLength++;
+      return;
+   }
+
+   /* No room to defer: wait out the readers instead. */
+   Epoch_synchronize();
+   pfFree(pv);
+}
@@ -0,0 +1,79 @@
+/*--------------------------------------------------------------------*/
+/* epoch.h                                                            */
+/* Author: Matthew Okechukwu, Pinrui Huang                            */
+/*--------------------------------------------------------------------*/
+
+#ifndef EPOCH_INCLUDED
+#define EPOCH_INCLUDED
+
+/* Epoch-based reclamation lets threads read a structure without
+   locks while another thread changes it.  Readers bracket each read
+   with Epoch_enter and Epoch_leave, which write only to memory owned
+   by the calling thread.  A thread changing the structure brackets
+   its change with Epoch_beginRetire and Epoch_endRetire; meanwhile,
+   memory it gives to Epoch_release is freed only once no reader that
+   might still see it remains.  Each thread keeps what it has
+   released to itself and frees it in its own later calls, so writers
+   share no lock. */
+
+/*--------------------------------------------------------------------*/
+
+/* Begin a read by the calling thread.  Return 1 (TRUE) if successful,
+   or 0 (FALSE) if memory for the thread's bookkeeping could not be
+   allocated, in which case the caller must not read without a lock.
+   Calls must not nest. */
+
+int Epoch_enter(void);
+
+/*--------------------------------------------------------------------*/
+
+/* End the read that the calling thread began with Epoch_enter. */
+
+void Epoch_leave(void);
+
+/*--------------------------------------------------------------------*/
+
+/* Begin a change by the calling thread: until Epoch_endRetire,
+   Epoch_release defers freeing.  Return 1 (TRUE) if successful, or 0
+   (FALSE) if memory for the thread's bookkeeping could not be
+   allocated, in which case the change must not be made while anyone
+   reads without a lock.  Calls must not nest, and the calling thread
+   must not be inside Epoch_enter. */
+
+int Epoch_beginRetire(void);
+
+/*--------------------------------------------------------------------*/
+
+/* End the change that the calling thread began with
+   Epoch_beginRetire, freeing whatever memory it released in earlier
+   changes that no reader can still see.  Memory released in this
+   change waits for a later call by the same thread, or for
+   Epoch_flush, or for the thread to exit. */
+
+void Epoch_endRetire(void);
+
+/*--------------------------------------------------------------------*/
+
+/* Free all the memory that the calling thread has released and not
+   yet freed, first waiting until every reader that might still see it
+   has ended.  The calling thread must be neither inside Epoch_enter
+   nor between Epoch_beginRetire and Epoch_endRetire. */
+
+void Epoch_flush(void);
+
+/*--------------------------------------------------------------------*/
+
+/* Free pv, which may be NULL.  Between Epoch_beginRetire and
+   Epoch_endRetire, freeing waits until every reader that began
+   before the call has ended; otherwise pv is freed at once. */
+
+void Epoch_release(void *pv);
+
+/*--------------------------------------------------------------------*/
+
+/* Like Epoch_release, but free pv by calling pfFree(pv) instead of
+   free(pv), for memory that did not come from malloc. */
+
+void Epoch_releaseWith(void *pv, void (*pfFree)(void *pv));
+
+#endif
@@ -3,32 +3,402 @@
 /* Author: Matthew Okechukwu, Pinrui Huang                            */
 /*--------------------------------------------------------------------*/
 
+/* pthread_rwlock_t, fork and mkstemp are POSIX extensions beyond
+   ISO C, and pipe2 a GNU one */
+#define _GNU_SOURCE
+#define _XOPEN_SOURCE 600
+
 #include <stddef.h>
 #include <assert.h>
+#include <errno.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/wait.h>
 
-#include "dynarray.h"
-#include "path.h"
+#include "arena.h"
+#include "epoch.h"
+#include "hashtable.h"
 #include "NodeFT.h"
+#include "pool.h"
+#include "manifest.h"
+#include "reclaim.h"
+#include "treefile.h"
+#include "treeimage.h"
+#include "journal.h"
  /* #include "checkerft.h" */
 #include "ft.h"
 
 
 /*
-  A Directory Tree is a representation of a hierarchy of directories,
-  represented as an AO with 3 state variables:
+  A File Tree is a representation of a hierarchy of directories and
+  files, represented as a struct FT with 20 state variables. Clients
+  may create any number of them with FT_new; the functions without a
+  handle operate on a single default FT, managed by FT_init and
+  FT_destroy. FT_snapshotIn makes a read-only FT that shares its
+  source's nodes, which the source copies before changing any of
+  them (see NodeFT_unshare). FT_openImage makes a read-only FT with
+  no nodes at all, whose reads go to a mapped image instead (see
+  treeimage.h). FT_setJournalIn makes an FT durable: each change is
+  logged to a journal before the call returns, and the tree is
+  rebuilt from its last checkpoint and the journal (see journal.h).
+*/
+struct FT {
+   /* 1. a flag for being in an initialized state (TRUE) or not
+         (FALSE) */
+   boolean bIsInitialized;
+   /* 2. a pointer to the root node in the hierarchy */
+   Node_T oNRoot;
+   /* 3. a counter of the number of nodes in the hierarchy */
+   size_t ulCount;
+   /* 4. an index from every node's absolute path to the node, or
+         NULL if the index is turned off (see FT_setIndexedIn) */
+   HashTable_T oHIndex;
+   /* 5. a flag for synchronizing calls through the locks below
+         (TRUE) or not (FALSE) (see FT_setSynchronizedIn); the locks
+         are initialized only while it is TRUE */
+   boolean bSynchronized;
+   /* 6. held exclusively by FT_setIndexedIn, which rebuilds the whole
+         index, and shared by every other call */
+   pthread_rwlock_t sLock;
+   /* 7. held by calls that read or change oNRoot, as the root's
+         parent's lock would be: exclusively to create or remove the
+         root, shared to pass through to it */
+   pthread_rwlock_t sRootLock;
+   /* 8. held shared by lookups through the index and exclusively by
+         changes to it; never held while waiting for a node's lock */
+   pthread_rwlock_t sIndexLock;
+   /* 9. held shared by every call that may change a node, and
+         exclusively by calls that read the whole tree, so that they
+         see it as of a single moment without taking the nodes' locks */
+   pthread_rwlock_t sChangeLock;
+   /* 10. a flag for letting lookups run without any lock (TRUE) or not
+         (FALSE) (see FT_setLockFreeReadsIn) */
+   boolean bLockFree;
+   /* 11. and 12. while bLockFree is TRUE, the number of changes
+         begun and the number ended; they differ exactly while a
+         change is under way, so that a lookup made without locks can
+         tell whether a change overlapped it */
+   size_t ulBegun;
+   size_t ulEnded;
+   /* 13. the number of threads that FT_toString uses (see
+         FT_setToStringThreadsIn) */
+   size_t ulThreads;
+   /* 14. the FT that this one is a snapshot of, or NULL if this FT
+         is not a snapshot; a snapshot is never changed */
+   FT_T oSource;
+   /* 15. the number of snapshots of this FT not yet released; while
+         any remain, changes copy the nodes they would change first */
+   size_t ulSnapshots;
+   /* 16. the image that this FT reads from, or NULL if this FT is not
+         an image; an image is never changed, and is left
+         uninitialized so that every call it does not serve fails */
+   TreeImage_T oImage;
+   /* 17. the journal that changes to this FT are logged to, or NULL
+         if this FT is not journaled (see FT_setJournalIn) */
+   Journal_T oJournal;
+   /* 18. and 19. the names of the checkpoint and journal files that
+         this FT is recovered from, or NULL if it is not journaled;
+         the default FT keeps them across FT_destroy and FT_init */
+   char *pcCheckpointFile;
+   char *pcJournalFile;
+   /* 20. the arena that this FT's nodes come from, or NULL if they
+         come from malloc (see FT_setArenaIn); the default FT keeps
+         it across FT_destroy and FT_init, emptied */
+   Arena_T oArena;
+};
+
+/* the number of times a lookup is tried without locks before it
+   falls back to taking them */
+static const int LOCK_FREE_TRIES = 4;
+
+/* the number of nodes in a removed subtree beyond which freeing it
+   is left to the reclamation thread rather than done by the call */
+static const size_t RECLAIM_THRESHOLD = 256;
+
+/* the number of nodes freed at once beyond which the pool's unused
+   slabs are returned to the system afterwards */
+static const size_t TRIM_THRESHOLD = 65536;
+
+/* the default FT, used by the functions without a handle */
+static struct FT sDefault;
+
+
+
+/* --------------------------------------------------------------------
+
+  The following functions take and release oFT's lock, if oFT is in
+  synchronized mode, around the body of each public function.
+*/
+
+/* Takes oFT's lock shared, for a call that only reads oFT */
+static void FT_lockShared(FT_T oFT) {
+   assert(oFT != NULL);
+
+   if(oFT->bSynchronized)
+      (void) pthread_rwlock_rdlock(&oFT->sLock);
+}
+
+/*
+  Takes oFT's lock for a call that may change oFT: exclusively if
+  bWholeTree or oFT has snapshots, whose nodes each change may have
+  to copy from the root down, or a journal, whose records must come
+  in the order that the changes were made, or else shared, since
+  changes along different paths keep out of one another's way
+  through the nodes' own locks. In lock-free mode, also marks a
+  change as under way and defers freeing until lookups that might
+  still see the memory are done. Returns SUCCESS, or
+  INITIALIZATION_ERROR if oFT is a snapshot, or MEMORY_ERROR if the
+  deferral could not be set up, in which case oFT is not locked.
+*/
+static int FT_beginChange(FT_T oFT, boolean bWholeTree) {
+   assert(oFT != NULL);
+
+   if(oFT->oSource != NULL)
+      return INITIALIZATION_ERROR;
+   if(oFT->bLockFree && !Epoch_beginRetire())
+      return MEMORY_ERROR;
+   if(oFT->bSynchronized && (bWholeTree || oFT->oJournal != NULL))
+      (void) pthread_rwlock_wrlock(&oFT->sLock);
+   else if(oFT->bSynchronized) {
+      (void) pthread_rwlock_rdlock(&oFT->sLock);
+      /* no snapshot can be taken while the lock is held shared */
+      if(__atomic_load_n(&oFT->ulSnapshots, __ATOMIC_ACQUIRE) > 0) {
+         (void) pthread_rwlock_unlock(&oFT->sLock);
+         (void) pthread_rwlock_wrlock(&oFT->sLock);
+      }
+   }
+   if(oFT->bSynchronized)
+      (void) pthread_rwlock_rdlock(&oFT->sChangeLock);
+   if(oFT->bLockFree) {
+      (void) __atomic_fetch_add(&oFT->ulBegun, 1, __ATOMIC_RELAXED);
+      /* the new count must be visible before any change is */
+      __atomic_thread_fence(__ATOMIC_RELEASE);
+   }
+   return SUCCESS;
+}
+
+/* Releases oFT's lock, taken by FT_lockShared */
+static void FT_unlock(FT_T oFT) {
+   assert(oFT != NULL);
+
+   if(oFT->bSynchronized)
+      (void) pthread_rwlock_unlock(&oFT->sLock);
+}
+
+/* Ends a change begun by FT_beginChange */
+static void FT_endChange(FT_T oFT) {
+   assert(oFT != NULL);
+
+   if(oFT->bLockFree)
+      (void) __atomic_fetch_add(&oFT->ulEnded, 1, __ATOMIC_RELEASE);
+   if(oFT->bSynchronized) {
+      (void) pthread_rwlock_unlock(&oFT->sChangeLock);
+      (void) pthread_rwlock_unlock(&oFT->sLock);
+   }
+   if(oFT->bLockFree)
+      Epoch_endRetire();
+}
+
+/*
+  Begins a lookup in oFT without locks, storing the counts to check
+  afterwards in *pulBegun and *pulEnded. Returns TRUE if the lookup
+  may go ahead, or FALSE if oFT is not in lock-free mode or the lookup
+  could not be registered, in which case the caller must take the
+  locks instead.
+*/
+static boolean FT_readBegin(FT_T oFT, size_t *pulBegun,
+                            size_t *pulEnded) {
+   assert(oFT != NULL);
+   assert(pulBegun != NULL);
+   assert(pulEnded != NULL);
+
+   if(!oFT->bLockFree || !Epoch_enter())
+      return FALSE;
+   /* ended first: a change that ends after it is read has begun */
+   *pulEnded = __atomic_load_n(&oFT->ulEnded, __ATOMIC_ACQUIRE);
+   *pulBegun = __atomic_load_n(&oFT->ulBegun, __ATOMIC_ACQUIRE);
+   return TRUE;
+}
+
+/*
+  Ends a lookup begun by FT_readBegin, which stored ulBegun and
+  ulEnded. Returns TRUE if no change overlapped the lookup, so its
+  result stands, or FALSE if it must be retried.
+*/
+static boolean FT_readEnd(FT_T oFT, size_t ulBegun, size_t ulEnded) {
+   boolean bValid;
+
+   assert(oFT != NULL);
+
+   /* the lookup's reads must be complete before the count is read */
+   __atomic_thread_fence(__ATOMIC_ACQUIRE);
+   bValid = (boolean) (ulBegun == ulEnded &&
+      __atomic_load_n(&oFT->ulBegun, __ATOMIC_RELAXED) == ulBegun);
+   Epoch_leave();
+   return bValid;
+}
+
+/* Takes oFT's index lock, exclusively if bExclusive, when
+   synchronized */
+static void FT_lockIndex(FT_T oFT, boolean bExclusive) {
+   assert(oFT != NULL);
+
+   if(oFT->bSynchronized && bExclusive)
+      (void) pthread_rwlock_wrlock(&oFT->sIndexLock);
+   else if(oFT->bSynchronized)
+      (void) pthread_rwlock_rdlock(&oFT->sIndexLock);
+}
+
+/* Releases oFT's index lock, taken by FT_lockIndex */
+static void FT_unlockIndex(FT_T oFT) {
+   assert(oFT != NULL);
+
+   if(oFT->bSynchronized)
+      (void) pthread_rwlock_unlock(&oFT->sIndexLock);
+}
+
+/*
+  Adds ulValue to oFT's node count, which changes along different
+  paths may update at once.
+*/
+static void FT_addCount(FT_T oFT, size_t ulValue) {
+   assert(oFT != NULL);
+
+   (void) __atomic_add_fetch(&oFT->ulCount, ulValue, __ATOMIC_RELAXED);
+}
+
+/* Subtracts ulValue from oFT's node count */
+static void FT_subtractCount(FT_T oFT, size_t ulValue) {
+   assert(oFT != NULL);
+
+   (void) __atomic_sub_fetch(&oFT->ulCount, ulValue, __ATOMIC_RELAXED);
+}
+
+/* --------------------------------------------------------------------
+
+  In synchronized mode, a call that follows a path takes each node's
+  lock while still holding its parent's, then lets the parent go
+  (lock coupling), so it holds at most two nodes at a time and calls
+  along different paths run side by side. Locks are only ever taken
+  from the root downwards, and sRootLock stands in for the root's
+  parent, so no two calls can wait for each other in a cycle.
+*/
+
+/* Releases oNHeld's lock, or sRootLock if oNHeld is NULL */
+static void FT_unlockHeld(FT_T oFT, Node_T oNHeld) {
+   assert(oFT != NULL);
+
+   if(!oFT->bSynchronized)
+      return;
+   if(oNHeld == NULL)
+      (void) pthread_rwlock_unlock(&oFT->sRootLock);
+   else
+      NodeFT_unlock(oNHeld);
+}
+
+/*
+  Descends oFT towards the well-formed absolute path pcPath through
+  at most its first ulLevels components, coupling locks on the way if
+  oFT is synchronized. On SUCCESS, sets *poNFurthest to the furthest
+  node reached and returns holding its lock, exclusively if
+  bExclusive and shared otherwise; or, if not even the root was
+  reached (because ulLevels is 0 or the FT is empty), sets
+  *poNFurthest to NULL and returns holding sRootLock the same way.
+  Otherwise, sets *poNFurthest to NULL and returns, holding nothing:
+  * CONFLICTING_PATH if the root's name is not pcPath's first
+                     component
 */
+static int FT_lockTowards(FT_T oFT, const char *pcPath, size_t ulLevels,
+                          boolean bExclusive, Node_T *poNFurthest) {
+   const char *pcStart;
+   const char *pcEnd;
+   Node_T oNPrev = NULL;
+   Node_T oNCurr;
+   Node_T oNChild;
+   boolean bHeldExclusive = FALSE;
+   boolean bMore;
+   size_t ulLevel;
+
+   assert(oFT != NULL);
+   assert(pcPath != NULL);
+   assert(poNFurthest != NULL);
+
+   *poNFurthest = NULL;
+
+   if(oFT->bSynchronized)
+      (void) pthread_rwlock_rdlock(&oFT->sRootLock);
+   if(ulLevels == 0 || oFT->oNRoot == NULL) {
+      if(!bExclusive)
+         return SUCCESS;
+      /* stopping above the root: retake sRootLock exclusively, then
+         look again, since the root may have appeared meanwhile */
+      if(oFT->bSynchronized) {
+         (void) pthread_rwlock_unlock(&oFT->sRootLock);
+         (void) pthread_rwlock_wrlock(&oFT->sRootLock);
+      }
+      if(ulLevels == 0 || oFT->oNRoot == NULL)
+         return SUCCESS;
+   }
 
-/* 1. a flag for being in an initialized state (TRUE) or not (FALSE) */
-static boolean bIsInitialized;
-/* 2. a pointer to the root node in the hierarchy */
-static Node_T oNRoot;
-/* 3. a counter of the number of nodes in the hierarchy */
-static size_t ulCount;
+   pcEnd = strchr(pcPath, '/');
+   if(pcEnd == NULL)
+      pcEnd = pcPath + strlen(pcPath);
+   if(strncmp(NodeFT_getName(oFT->oNRoot), pcPath,
+              (size_t) (pcEnd - pcPath)) ||
+      NodeFT_getName(oFT->oNRoot)[pcEnd - pcPath] != '\0') {
+      FT_unlockHeld(oFT, NULL);
+      return CONFLICTING_PATH;
+   }
 
+   oNCurr = oFT->oNRoot;
+   if(oFT->bSynchronized)
+      NodeFT_lockShared(oNCurr);
+   ulLevel = 1;
+   for(;;) {
+      oNChild = NULL;
+      bMore = (boolean) (ulLevel < ulLevels && *pcEnd != '\0');
+      if(bMore) {
+         pcStart = pcEnd + 1;
+         pcEnd = pcStart;
+         while(*pcEnd != '/' && *pcEnd != '\0')
+            pcEnd++;
+         oNChild = NodeFT_findChild(oNCurr, pcStart,
+                                    (size_t) (pcEnd - pcStart));
+      }
+      if(oNChild == NULL) {
+         if(!bExclusive || bHeldExclusive || !oFT->bSynchronized)
+            break;
+         /* stopping here: retake oNCurr exclusively, which its
+            parent's lock keeps from being removed meanwhile, then
+            look for the child again */
+         NodeFT_unlock(oNCurr);
+         NodeFT_lockExclusive(oNCurr);
+         bHeldExclusive = TRUE;
+         if(bMore)
+            oNChild = NodeFT_findChild(oNCurr, pcStart,
+                                       (size_t) (pcEnd - pcStart));
+         if(oNChild == NULL)
+            break;
+      }
+      if(oFT->bSynchronized)
+         NodeFT_lockShared(oNChild);
+      FT_unlockHeld(oFT, oNPrev);
+      oNPrev = oNCurr;
+      oNCurr = oNChild;
+      bHeldExclusive = FALSE;
+      ulLevel++;
+   }
+   FT_unlockHeld(oFT, oNPrev);
 
+   *poNFurthest = oNCurr;
+   return SUCCESS;
+}
 
 /* --------------------------------------------------------------------
 
@@ -38,603 +408,4834 @@ static size_t ulCount;
   node if the full path was reached, respectively.
 */
 
+/*
+  Returns TRUE if pcPath is well-formatted as a path, i.e., it is not
+  the empty string, does not begin or end with a '/', and contains no
+  consecutive '/' delimiters. Returns FALSE otherwise. This is the
+  same check that Path_new performs, without allocating the Path_T.
+*/
+static boolean FT_isWellFormed(const char *pcPath) {
+   const char *pc;
+
+   assert(pcPath != NULL);
+
+   if(*pcPath == '\0' || *pcPath == '/')
+      return FALSE;
+   for(pc = pcPath + 1; *pc != '\0'; pc++) {
+      if(*pc == '/' && (*(pc-1) == '/' || *(pc+1) == '\0'))
+         return FALSE;
+   }
+   return TRUE;
+}
+
 /*
   Traverses the ft starting at the root as far as possible towards
-  absolute path oPPath. If able to traverse, returns an int SUCCESS
-  status and sets *poNFurthest to the furthest node reached (which may
-  be only a prefix of oPPath, or even NULL if the root is NULL).
+  the well-formed absolute path pcPath, of ulDepth components. If
+  able to traverse, returns an int SUCCESS status and sets
+  *poNFurthest to the furthest node reached (which may be only a
+  prefix of pcPath, or even NULL if the root is NULL).
   Otherwise, sets *poNFurthest to NULL and returns with status:
-  * CONFLICTING_PATH if the root's path is not a prefix of oPPath
-  * MEMORY_ERROR if memory could not be allocated to complete request
+  * CONFLICTING_PATH if the root's path is not a prefix of pcPath
+
+  In synchronized mode, a SUCCESS return holds *poNFurthest's lock
+  exclusively, or sRootLock if *poNFurthest is NULL, so that the
+  caller may add children there; FT_unlockHeld releases it.
 */
-static int FT_traversePath(Path_T oPPath, Node_T *poNFurthest) {
-   int iStatus;
-   Path_T oPPrefix = NULL;
-   Node_T oNCurr;
+static int FT_traversePath(FT_T oFT, const char *pcPath,
+                           size_t ulDepth, Node_T *poNFurthest) {
+   assert(oFT != NULL);
+   assert(pcPath != NULL);
+   assert(poNFurthest != NULL);
+
+   return FT_lockTowards(oFT, pcPath, ulDepth, TRUE, poNFurthest);
+}
+
+/* A pathname that is not necessarily '\0'-terminated */
+struct FT_pathKey {
+   /* the first character of the pathname */
+   const char *pcPath;
+   /* the number of characters in the pathname */
+   size_t ulLength;
+};
+
+/*
+  Returns nonzero if node pvNode's absolute path is the pathname
+  described by pvKey, a struct FT_pathKey. Used to confirm index hits.
+*/
+static int FT_matchPath(const void *pvNode, const void *pvKey) {
+   const struct FT_pathKey *psKey = pvKey;
+
+   assert(pvNode != NULL);
+   assert(pvKey != NULL);
+
+   return NodeFT_hasPath((Node_T) pvNode, psKey->pcPath,
+                         psKey->ulLength);
+}
+
+/*
+  Returns the index hash of oNNode's absolute path, given
+  ulParentHash, the index hash of its parent's path. ulParentHash is
+  ignored if oNNode is the root.
+*/
+static size_t FT_hashNode(Node_T oNNode, size_t ulParentHash) {
+   const char *pcName;
+
+   assert(oNNode != NULL);
+
+   pcName = NodeFT_getName(oNNode);
+   if(NodeFT_getParent(oNNode) == NULL)
+      return HashTable_hash(HASHTABLE_SEED, pcName, strlen(pcName));
+   ulParentHash = HashTable_hash(ulParentHash, "/", 1);
+   return HashTable_hash(ulParentHash, pcName, strlen(pcName));
+}
+
+/*
+  Adds oNNode and all of its descendants to the index, where ulHash
+  is the index hash of oNNode's path. Returns SUCCESS, or MEMORY_ERROR
+  if the index could not grow, in which case some of the subtree may
+  already have been added.
+*/
+static int FT_indexSubtree(FT_T oFT, Node_T oNNode, size_t ulHash) {
    Node_T oNChild = NULL;
-   size_t ulDepth;
-   size_t i;
-   size_t ulChildID;
+   size_t c;
+   int iStatus;
 
-   assert(oPPath != NULL);
-   assert(poNFurthest != NULL);
+   assert(oFT != NULL);
+   assert(oNNode != NULL);
+   assert(oFT->oHIndex != NULL);
 
-   /* root is NULL -> won't find anything */
-   if(oNRoot == NULL) {
-      *poNFurthest = NULL;
+   if(!HashTable_add(oFT->oHIndex, ulHash, oNNode))
+      return MEMORY_ERROR;
+   if(NodeFT_isFile(oNNode))
       return SUCCESS;
+
+   for(c = 0; c < NodeFT_getNumFileChildren(oNNode); c++) {
+      iStatus = NodeFT_getFileChild(oNNode, c, &oNChild);
+      assert(iStatus == SUCCESS);
+      iStatus = FT_indexSubtree(oFT, oNChild,
+                                FT_hashNode(oNChild, ulHash));
+      if(iStatus != SUCCESS)
+         return iStatus;
+   }
+   for(c = 0; c < NodeFT_getNumDirectoryChildren(oNNode); c++) {
+      iStatus = NodeFT_getDirectoryChild(oNNode, c, &oNChild);
+      assert(iStatus == SUCCESS);
+      iStatus = FT_indexSubtree(oFT, oNChild,
+                                FT_hashNode(oNChild, ulHash));
+      if(iStatus != SUCCESS)
+         return iStatus;
    }
+   return SUCCESS;
+}
 
-   iStatus = Path_prefix(oPPath, 1, &oPPrefix);
-   if(iStatus != SUCCESS) {
-      *poNFurthest = NULL;
-      return iStatus;
+/*
+  Removes oNNode and all of its descendants from the index, where
+  ulHash is the index hash of oNNode's path. Nodes that are not in the
+  index are skipped.
+*/
+static void FT_unindexSubtree(FT_T oFT, Node_T oNNode, size_t ulHash) {
+   Node_T oNChild = NULL;
+   size_t c;
+   int iStatus;
+
+   assert(oFT != NULL);
+   assert(oNNode != NULL);
+   assert(oFT->oHIndex != NULL);
+
+   (void) HashTable_remove(oFT->oHIndex, ulHash, oNNode);
+   if(NodeFT_isFile(oNNode))
+      return;
+
+   for(c = 0; c < NodeFT_getNumFileChildren(oNNode); c++) {
+      iStatus = NodeFT_getFileChild(oNNode, c, &oNChild);
+      assert(iStatus == SUCCESS);
+      FT_unindexSubtree(oFT, oNChild, FT_hashNode(oNChild, ulHash));
    }
+   for(c = 0; c < NodeFT_getNumDirectoryChildren(oNNode); c++) {
+      iStatus = NodeFT_getDirectoryChild(oNNode, c, &oNChild);
+      assert(iStatus == SUCCESS);
+      FT_unindexSubtree(oFT, oNChild, FT_hashNode(oNChild, ulHash));
+   }
+}
 
-   if(Path_comparePath(NodeFT_getPath(oNRoot), oPPrefix)) {
-      Path_free(oPPrefix);
-      *poNFurthest = NULL;
-      return CONFLICTING_PATH;
+/*
+  Undoes a partially completed insertion whose first new node is
+  oNFirstNew, with index hash ulFirstHash: removes the new nodes from
+  the index, if it is on, and frees them.
+*/
+static void FT_discardNew(FT_T oFT, Node_T oNFirstNew,
+                          size_t ulFirstHash) {
+   assert(oFT != NULL);
+   assert(oNFirstNew != NULL);
+
+   if(oFT->oHIndex != NULL) {
+      FT_lockIndex(oFT, TRUE);
+      FT_unindexSubtree(oFT, oNFirstNew, ulFirstHash);
+      FT_unlockIndex(oFT);
+   }
+   (void) NodeFT_free(oNFirstNew);
+}
+
+/*
+  Traverses the ft to find a node with absolute path pcPath. Returns a
+  int SUCCESS status and sets *poNResult to be the node, if found.
+  Otherwise, sets *poNResult to NULL and returns with status:
+  * INITIALIZATION_ERROR if the ft is not in an initialized state
+  * BAD_PATH if pcPath does not represent a well-formatted path
+  * CONFLICTING_PATH if the root's path is not a prefix of pcPath
+  * NO_SUCH_PATH if no node with pcPath exists in the hierarchy
+
+  Rather than building a Path_T, this walks pcPath's components in
+  place, so lookups allocate no memory whether or not they succeed.
+  When the index is on, a single probe replaces the walk.
+ */
+static int FT_findNode(FT_T oFT, const char *pcPath,
+                       Node_T *poNResult) {
+   const char *pcStart;
+   const char *pcEnd;
+   Node_T oNRoot;
+   HashTable_T oHIndex;
+   Node_T oNCurr;
+   struct FT_pathKey sKey;
+
+   assert(oFT != NULL);
+   assert(pcPath != NULL);
+   assert(poNResult != NULL);
+
+   *poNResult = NULL;
+
+   if(!oFT->bIsInitialized)
+      return INITIALIZATION_ERROR;
+
+   /* read once, since in lock-free mode a change may replace them */
+   oNRoot = __atomic_load_n(&oFT->oNRoot, __ATOMIC_ACQUIRE);
+   oHIndex = __atomic_load_n(&oFT->oHIndex, __ATOMIC_ACQUIRE);
+
+   /* an index hit is necessarily a well-formed path in the tree */
+   if(oHIndex != NULL) {
+      sKey.pcPath = pcPath;
+      sKey.ulLength = strlen(pcPath);
+      oNCurr = HashTable_find(oHIndex,
+                 HashTable_hash(HASHTABLE_SEED, pcPath, sKey.ulLength),
+                 &sKey, FT_matchPath);
+      if(oNCurr != NULL) {
+         *poNResult = oNCurr;
+         return SUCCESS;
+      }
    }
-   Path_free(oPPrefix);
-   oPPrefix = NULL;
 
+   if(!FT_isWellFormed(pcPath))
+      return BAD_PATH;
+
+   if(oNRoot == NULL)
+      return NO_SUCH_PATH;
+
+   /* the first component must name the root */
+   pcEnd = strchr(pcPath, '/');
+   if(pcEnd == NULL)
+      pcEnd = pcPath + strlen(pcPath);
+   if(strncmp(NodeFT_getName(oNRoot), pcPath,
+              (size_t) (pcEnd - pcPath)) ||
+      NodeFT_getName(oNRoot)[pcEnd - pcPath] != '\0')
+      return CONFLICTING_PATH;
+
+   /* the index holds every node, so a miss there is final */
+   if(oHIndex != NULL)
+      return NO_SUCH_PATH;
+
+   /* each later component must name a child of the previous one */
    oNCurr = oNRoot;
-   ulDepth = Path_getDepth(oPPath);
-   for(i = 2; i <= ulDepth; i++) {
-      iStatus = Path_prefix(oPPath, i, &oPPrefix);
-      if(iStatus != SUCCESS) {
-         *poNFurthest = NULL;
+   while(*pcEnd != '\0') {
+      pcStart = pcEnd + 1;
+      pcEnd = pcStart;
+      while(*pcEnd != '/' && *pcEnd != '\0')
+         pcEnd++;
+      oNCurr = NodeFT_findChild(oNCurr, pcStart,
+                                (size_t) (pcEnd - pcStart));
+      if(oNCurr == NULL)
+         return NO_SUCH_PATH;
+   }
+
+   *poNResult = oNCurr;
+   return SUCCESS;
+}
+
+/*
+  Gives oFT copies of its own, through NodeFT_unshare, of the nodes
+  along pcPath that it shares with a snapshot, from the root down as
+  far as pcPath exists, leaving out pcPath's own node unless bWhole;
+  the copies take the originals' places in the tree and in the
+  index. Does nothing if oFT has no snapshots or pcPath is not
+  well-formed. Returns SUCCESS, or MEMORY_ERROR if memory could not
+  be allocated, in which case the nodes copied so far stay copied.
+*/
+static int FT_ownPath(FT_T oFT, const char *pcPath, boolean bWhole) {
+   const char *pcStart;
+   const char *pcEnd;
+   Node_T oNCurr;
+   Node_T oNCopy = NULL;
+   size_t ulHash;
+   int iStatus;
+
+   assert(oFT != NULL);
+   assert(pcPath != NULL);
+
+   if(__atomic_load_n(&oFT->ulSnapshots, __ATOMIC_ACQUIRE) == 0 ||
+      oFT->oNRoot == NULL || !FT_isWellFormed(pcPath))
+      return SUCCESS;
+
+   pcEnd = strchr(pcPath, '/');
+   if(pcEnd == NULL)
+      pcEnd = pcPath + strlen(pcPath);
+   oNCurr = oFT->oNRoot;
+   if(strncmp(NodeFT_getName(oNCurr), pcPath,
+              (size_t) (pcEnd - pcPath)) ||
+      NodeFT_getName(oNCurr)[pcEnd - pcPath] != '\0')
+      return SUCCESS;
+
+   for(;;) {
+      if(*pcEnd == '\0' && !bWhole)
+         return SUCCESS;
+      iStatus = NodeFT_unshare(oNCurr, &oNCopy);
+      if(iStatus != SUCCESS)
          return iStatus;
-      }
-      if(NodeFT_hasFileChild(oNCurr, oPPrefix, &ulChildID)) {
-         /* go to that child and continue with next prefix */
-         Path_free(oPPrefix);
-         oPPrefix = NULL;
-         iStatus = NodeFT_getFileChild(oNCurr, ulChildID, &oNChild);
-         if(iStatus != SUCCESS) {
-            *poNFurthest = NULL;
-            return iStatus;
-         }
-         oNCurr = oNChild;
-         break;
-      }
-      if(NodeFT_hasDirectoryChild(oNCurr, oPPrefix, &ulChildID)) {
-         /* go to that child and continue with next prefix */
-         Path_free(oPPrefix);
-         oPPrefix = NULL;
-         iStatus = NodeFT_getDirectoryChild(oNCurr, ulChildID, &oNChild);
-         if(iStatus != SUCCESS) {
-            *poNFurthest = NULL;
-            return iStatus;
+      if(oNCopy != oNCurr) {
+         if(oNCurr == oFT->oNRoot)
+            __atomic_store_n(&oFT->oNRoot, oNCopy, __ATOMIC_RELEASE);
+         /* the index cannot grow by trading one node for another */
+         if(oFT->oHIndex != NULL) {
+            ulHash = HashTable_hash(HASHTABLE_SEED, pcPath,
+                                    (size_t) (pcEnd - pcPath));
+            FT_lockIndex(oFT, TRUE);
+            (void) HashTable_remove(oFT->oHIndex, ulHash, oNCurr);
+            (void) HashTable_add(oFT->oHIndex, ulHash, oNCopy);
+            FT_unlockIndex(oFT);
          }
-         oNCurr = oNChild;
       }
+      if(*pcEnd == '\0' || NodeFT_isFile(oNCopy))
+         return SUCCESS;
 
-      else {
-         /* oNCurr doesn't have child with path oPPrefix:
-            this is as far as we can go */
-         break;
-      }
+      pcStart = pcEnd + 1;
+      pcEnd = pcStart;
+      while(*pcEnd != '/' && *pcEnd != '\0')
+         pcEnd++;
+      oNCurr = NodeFT_findChild(oNCopy, pcStart,
+                                (size_t) (pcEnd - pcStart));
+      if(oNCurr == NULL)
+         return SUCCESS;
    }
+}
 
-   Path_free(oPPrefix);
-   *poNFurthest = oNCurr;
+/*
+  Returns the number of components of the well-formed path pcPath.
+*/
+static size_t FT_countComponents(const char *pcPath) {
+   size_t ulDepth = 1;
+
+   assert(pcPath != NULL);
+
+   for(; *pcPath != '\0'; pcPath++)
+      if(*pcPath == '/')
+         ulDepth++;
+   return ulDepth;
+}
+
+/*
+  Finds the node with absolute path pcPath for a call that reads it,
+  as FT_findNode does, and in synchronized mode keeps it from changing
+  or going away until FT_unpinNode: through the index, if it is on,
+  by holding sIndexLock shared, and otherwise by coupling node locks
+  down the path and holding the node's lock shared. If bOptimistic,
+  the caller reads without locks as FT_readBegin allows, and this
+  takes none.
+*/
+static int FT_pinNode(FT_T oFT, const char *pcPath, boolean bOptimistic,
+                      Node_T *poNResult) {
+   Node_T oNFound = NULL;
+   size_t ulDepth;
+   int iStatus;
+
+   assert(oFT != NULL);
+   assert(pcPath != NULL);
+   assert(poNResult != NULL);
+
+   if(bOptimistic || !oFT->bSynchronized)
+      return FT_findNode(oFT, pcPath, poNResult);
+
+   /* nodes leave the index before they are freed */
+   if(oFT->oHIndex != NULL) {
+      FT_lockIndex(oFT, FALSE);
+      iStatus = FT_findNode(oFT, pcPath, poNResult);
+      if(iStatus != SUCCESS)
+         FT_unlockIndex(oFT);
+      return iStatus;
+   }
+
+   *poNResult = NULL;
+   if(!oFT->bIsInitialized)
+      return INITIALIZATION_ERROR;
+   if(!FT_isWellFormed(pcPath))
+      return BAD_PATH;
+
+   ulDepth = FT_countComponents(pcPath);
+   iStatus = FT_lockTowards(oFT, pcPath, ulDepth, FALSE, &oNFound);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   if(oNFound == NULL || NodeFT_getDepth(oNFound) != ulDepth) {
+      FT_unlockHeld(oFT, oNFound);
+      return NO_SUCH_PATH;
+   }
+
+   *poNResult = oNFound;
    return SUCCESS;
 }
 
 /*
-  Traverses the ft to find a node with absolute path pcPath. Returns a
-  int SUCCESS status and sets *poNResult to be the node, if found.
-  Otherwise, sets *poNResult to NULL and returns with status:
+  Releases what FT_pinNode held for oNPinned, which it found with the
+  same bOptimistic.
+*/
+static void FT_unpinNode(FT_T oFT, Node_T oNPinned,
+                         boolean bOptimistic) {
+   assert(oFT != NULL);
+   assert(oNPinned != NULL);
+
+   if(bOptimistic || !oFT->bSynchronized)
+      return;
+   if(oFT->oHIndex != NULL)
+      FT_unlockIndex(oFT);
+   else
+      FT_unlockHeld(oFT, oNPinned);
+}
+
+/*
+  Finds the node with absolute path pcPath for a call that will change
+  or remove it. Returns SUCCESS, setting *poNFound to the node and
+  *poNParent to its parent (NULL for the root), and in synchronized
+  mode holds both of their locks exclusively, sRootLock standing in
+  for a NULL parent, for FT_unlockHeld to release. Otherwise, sets
+  both to NULL, holds nothing, and returns with status:
   * INITIALIZATION_ERROR if the ft is not in an initialized state
   * BAD_PATH if pcPath does not represent a well-formatted path
   * CONFLICTING_PATH if the root's path is not a prefix of pcPath
   * NO_SUCH_PATH if no node with pcPath exists in the hierarchy
-  * MEMORY_ERROR if memory could not be allocated to complete request
- */
-static int FT_findNode(const char *pcPath, Node_T *poNResult) {
-   Path_T oPPath = NULL;
+*/
+static int FT_lockFound(FT_T oFT, const char *pcPath, Node_T *poNParent,
+                        Node_T *poNFound) {
+   const char *pcName;
+   Node_T oNParent = NULL;
    Node_T oNFound = NULL;
+   size_t ulDepth;
    int iStatus;
 
+   assert(oFT != NULL);
    assert(pcPath != NULL);
-   assert(poNResult != NULL);
+   assert(poNParent != NULL);
+   assert(poNFound != NULL);
+
+   *poNParent = NULL;
+   *poNFound = NULL;
+
+   if(!oFT->bSynchronized) {
+      iStatus = FT_findNode(oFT, pcPath, &oNFound);
+      if(iStatus != SUCCESS)
+         return iStatus;
+      *poNParent = NodeFT_getParent(oNFound);
+      *poNFound = oNFound;
+      return SUCCESS;
+   }
+
+   if(!oFT->bIsInitialized)
+      return INITIALIZATION_ERROR;
+   if(!FT_isWellFormed(pcPath))
+      return BAD_PATH;
+
+   ulDepth = FT_countComponents(pcPath);
+   iStatus = FT_lockTowards(oFT, pcPath, ulDepth - 1, TRUE, &oNParent);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   if(oNParent == NULL) {
+      /* the FT is empty, or pcPath names the root */
+      if(ulDepth == 1 && oFT->oNRoot != NULL &&
+         strcmp(NodeFT_getName(oFT->oNRoot), pcPath))
+         iStatus = CONFLICTING_PATH;
+      else if(ulDepth == 1)
+         oNFound = oFT->oNRoot;
+   }
+   else if(NodeFT_getDepth(oNParent) == ulDepth - 1) {
+      pcName = strrchr(pcPath, '/') + 1;
+      oNFound = NodeFT_findChild(oNParent, pcName, strlen(pcName));
+   }
+   if(oNFound == NULL) {
+      FT_unlockHeld(oFT, oNParent);
+      return (iStatus != SUCCESS) ? iStatus : NO_SUCH_PATH;
+   }
+
+   NodeFT_lockExclusive(oNFound);
+   *poNParent = oNParent;
+   *poNFound = oNFound;
+   return SUCCESS;
+}
+
+/*
+  Waits until no other call holds the lock of any node beneath
+  oNNode, taking and releasing each from the top down. The caller
+  holds oNNode exclusively, so no call can enter the subtree anew.
+*/
+static void FT_drainSubtree(Node_T oNNode) {
+   Node_T oNChild = NULL;
+   size_t c;
+   int iStatus;
+
+   assert(oNNode != NULL);
+
+   for(c = 0; c < NodeFT_getNumFileChildren(oNNode); c++) {
+      iStatus = NodeFT_getFileChild(oNNode, c, &oNChild);
+      assert(iStatus == SUCCESS);
+      NodeFT_lockExclusive(oNChild);
+      NodeFT_unlock(oNChild);
+   }
+   for(c = 0; c < NodeFT_getNumDirectoryChildren(oNNode); c++) {
+      iStatus = NodeFT_getDirectoryChild(oNNode, c, &oNChild);
+      assert(iStatus == SUCCESS);
+      NodeFT_lockExclusive(oNChild);
+      FT_drainSubtree(oNChild);
+      NodeFT_unlock(oNChild);
+   }
+}
+
+/*
+  In synchronized mode, holds off every change to oFT, so that a call
+  reading the whole tree sees it as of a single moment, even across
+  several passes, while lookups go on alongside it. Takes no node's
+  lock, so that it holds no more locks however large oFT grows.
+  FT_unlockTree releases it.
+*/
+static void FT_lockTree(FT_T oFT) {
+   assert(oFT != NULL);
+
+   if(oFT->bSynchronized)
+      (void) pthread_rwlock_wrlock(&oFT->sChangeLock);
+}
+
+/* Releases the lock that FT_lockTree took */
+static void FT_unlockTree(FT_T oFT) {
+   assert(oFT != NULL);
+
+   if(oFT->bSynchronized)
+      (void) pthread_rwlock_unlock(&oFT->sChangeLock);
+}
+/*--------------------------------------------------------------------*/
+
+
+/*
+  Builds the nodes of the well-formed absolute path pcPath, of
+  ulDepth components, that are missing below oNCurr, the furthest
+  node of pcPath that FT_traversePath found (and, in synchronized
+  mode, holds). Each new node is a directory, except that if bIsFile
+  the last is a file with contents pvContents of size ulLength bytes.
+  Returns SUCCESS, or:
+  * CONFLICTING_PATH if the root exists but is not a prefix of pcPath,
+                     or if a file would be the FT root
+  * NOT_A_DIRECTORY if a proper prefix of pcPath exists as a file
+  * ALREADY_IN_TREE if pcPath is already in the FT (as dir or file)
+  * MEMORY_ERROR if memory could not be allocated to complete request
+  in which case the FT is left unchanged.
+
+  No other call can reach the new nodes through the tree before the
+  caller releases oNCurr, so however many levels are built, oNCurr's
+  lock is the only one needed.
+*/
+static int FT_buildPath(FT_T oFT, const char *pcPath, size_t ulDepth,
+                        Node_T oNCurr, boolean bIsFile,
+                        void *pvContents, size_t ulLength) {
+   int iStatus;
+   Node_T oNFirstNew = NULL;
+   const char *pcStart = pcPath;
+   const char *pcEnd;
+   size_t ulIndex;
+   size_t ulNewNodes = 0;
+   size_t ulHash = HASHTABLE_SEED;
+   size_t ulFirstHash = HASHTABLE_SEED;
+   boolean bIndexed;
+
+   assert(oFT != NULL);
+   assert(pcPath != NULL);
+
+   /* no ancestor node found, so if root is not NULL,
+      pcPath isn't underneath root. */
+   if(oNCurr == NULL && oFT->oNRoot != NULL)
+      return CONFLICTING_PATH;
+   if(oNCurr == NULL) /* new root! */
+      ulIndex = 1;
+   else {
+      ulIndex = NodeFT_getDepth(oNCurr)+1;
+
+      /* oNCurr is the node we're trying to insert: the traversal
+         matched every component of pcPath */
+      if(ulIndex == ulDepth+1)
+         return ALREADY_IN_TREE;
+      /* the first missing component follows oNCurr's path */
+      pcStart = pcPath + NodeFT_getPathLength(oNCurr) + 1;
+   }
+
+   if(oNCurr != NULL && NodeFT_isFile(oNCurr))
+      return NOT_A_DIRECTORY;
+   /*A file cannot be the root*/
+   if(bIsFile && ulDepth == 1)
+      return CONFLICTING_PATH;
+
+   /* the index hash of each new path extends that of oNCurr's */
+   if(oFT->oHIndex != NULL && oNCurr != NULL)
+      ulHash = HashTable_hash(HASHTABLE_SEED, pcPath,
+                              NodeFT_getPathLength(oNCurr));
+
+   /* starting at oNCurr, build rest of the path one level at a time */
+   while(ulIndex <= ulDepth) {
+      Node_T oNNewNode = NULL;
+
+      /* insert the new node for this level, named by the component
+         of pcPath at this level */
+      pcEnd = pcStart;
+      while(*pcEnd != '/' && *pcEnd != '\0')
+         pcEnd++;
+      if(bIsFile && ulIndex == ulDepth)
+         iStatus = NodeFT_new(pcStart, (size_t) (pcEnd - pcStart),
+                              oNCurr, TRUE, pvContents, ulLength,
+                              oFT->oArena, &oNNewNode);
+      else
+         iStatus = NodeFT_new(pcStart, (size_t) (pcEnd - pcStart),
+                              oNCurr, FALSE, NULL, 0, oFT->oArena,
+                              &oNNewNode);
+      if(iStatus != SUCCESS) {
+         if(oNFirstNew != NULL)
+            FT_discardNew(oFT, oNFirstNew, ulFirstHash);
+         return iStatus;
+      }
+      if(oNFirstNew == NULL)
+         oNFirstNew = oNNewNode;
+
+      /* keep the index current as each level is created */
+      if(oFT->oHIndex != NULL) {
+         ulHash = FT_hashNode(oNNewNode, ulHash);
+         if(oNFirstNew == oNNewNode)
+            ulFirstHash = ulHash;
+         FT_lockIndex(oFT, TRUE);
+         bIndexed = (boolean) HashTable_add(oFT->oHIndex, ulHash,
+                                            oNNewNode);
+         FT_unlockIndex(oFT);
+         if(!bIndexed) {
+            FT_discardNew(oFT, oNFirstNew, ulFirstHash);
+            return MEMORY_ERROR;
+         }
+      }
+
+      /* set up for next level */
+      oNCurr = oNNewNode;
+      ulNewNodes++;
+      ulIndex++;
+      pcStart = pcEnd + 1;
+   }
+
+   /* update ft state variables to reflect insertion */
+   if(oFT->oNRoot == NULL)
+      __atomic_store_n(&oFT->oNRoot, oNFirstNew, __ATOMIC_RELEASE);
+   FT_addCount(oFT, ulNewNodes);
+
+   return SUCCESS;
+}
+
+/* The body of FT_insertDirIn, called with oFT locked as needed */
+static int FT_insertDirUnlocked(FT_T oFT, const char *pcPath) {
+   int iStatus;
+   size_t ulDepth;
+   Node_T oNCurr = NULL;
+
+   assert(oFT != NULL);
+   assert(pcPath != NULL);
+
+   /* validate pcPath, in place, so that no Path_T is allocated */
+   if(!oFT->bIsInitialized)
+      return INITIALIZATION_ERROR;
+   if(!FT_isWellFormed(pcPath))
+      return BAD_PATH;
+   ulDepth = FT_countComponents(pcPath);
+
+   /* find the closest ancestor of pcPath already in the tree, and
+      build the rest of the path below it */
+   iStatus = FT_ownPath(oFT, pcPath, FALSE);
+   if(iStatus == SUCCESS)
+      iStatus = FT_traversePath(oFT, pcPath, ulDepth, &oNCurr);
+   if(iStatus == SUCCESS) {
+      iStatus = FT_buildPath(oFT, pcPath, ulDepth, oNCurr, FALSE, NULL,
+                             0);
+      FT_unlockHeld(oFT, oNCurr);
+   }
+   return iStatus;
+}
+
+/* The body of FT_insertFileIn, called with oFT locked as needed */
+static int FT_insertFileUnlocked(FT_T oFT, const char *pcPath,
+                                 void *pvContents, size_t ulLength) {
+   int iStatus;
+   size_t ulDepth;
+   Node_T oNCurr = NULL;
+
+   assert(oFT != NULL);
+   assert(pcPath != NULL);
+
+   /* validate pcPath, in place, so that no Path_T is allocated */
+   if(!oFT->bIsInitialized)
+      return INITIALIZATION_ERROR;
+   if(!FT_isWellFormed(pcPath))
+      return BAD_PATH;
+   ulDepth = FT_countComponents(pcPath);
+
+   /* find the closest ancestor of pcPath already in the tree, and
+      build the rest of the path below it */
+   iStatus = FT_ownPath(oFT, pcPath, FALSE);
+   if(iStatus == SUCCESS)
+      iStatus = FT_traversePath(oFT, pcPath, ulDepth, &oNCurr);
+   if(iStatus == SUCCESS) {
+      iStatus = FT_buildPath(oFT, pcPath, ulDepth, oNCurr, TRUE,
+                             pvContents, ulLength);
+      FT_unlockHeld(oFT, oNCurr);
+   }
+   return iStatus;
+}
+
+/* --------------------------------------------------------------------
+
+  FT_insertFilesIn and FT_statManyIn keep the nodes along the
+  previous path of their batch on a stack. Each path then starts from
+  the deepest node it shares with the one before it, instead of from
+  the root, and no Path_T is built. FT_insertFilesIn first sorts its
+  batch by path, so that paths sharing a prefix are adjacent;
+  FT_statManyIn takes its batch in the order given, which costs
+  nothing when callers already group their paths.
+*/
+
+/* One path of a batch, remembered with its place in the input */
+struct FT_batchItem {
+   /* the path */
+   const char *pcPath;
+   /* its depth */
+   size_t ulDepth;
+   /* its index in the client's arrays */
+   size_t ulIndex;
+};
+
+/* The state of one batch as it moves from path to path */
+struct FT_batch {
+   /* the FT being walked */
+   FT_T oFT;
+   /* the well-formed paths of the batch, in sorted order */
+   struct FT_batchItem *psItems;
+   /* the number of entries of psItems */
+   size_t ulNumItems;
+   /* the nodes along the previous path, root first */
+   Node_T *aoNStack;
+   /* the number of entries of aoNStack that are valid */
+   size_t ulValid;
+   /* the index hash of each node's path on the stack, or NULL if the
+      batch does not keep the index current */
+   size_t *aulHashes;
+   /* TRUE if each node on the stack is held shared, so that no
+      change can remove it while the batch still relies on it */
+   boolean bLocking;
+};
+
+/*
+  Compares two struct FT_batchItem by path, breaking ties by input
+  index so that duplicates are handled in the order given. Used with
+  qsort.
+*/
+static int FT_compareItems(const void *pvFirst, const void *pvSecond) {
+   const struct FT_batchItem *psFirst = pvFirst;
+   const struct FT_batchItem *psSecond = pvSecond;
+   int iCompare;
+
+   assert(pvFirst != NULL);
+   assert(pvSecond != NULL);
+
+   iCompare = strcmp(psFirst->pcPath, psSecond->pcPath);
+   if(iCompare != 0)
+      return iCompare;
+   if(psFirst->ulIndex < psSecond->ulIndex)
+      return -1;
+   return (int) (psFirst->ulIndex > psSecond->ulIndex);
+}
+
+/*
+  Returns the number of leading components that the well-formed paths
+  pcFirst and pcSecond have in common.
+*/
+static size_t FT_sharedComponents(const char *pcFirst,
+                                  const char *pcSecond) {
+   size_t ulShared = 0;
+
+   assert(pcFirst != NULL);
+   assert(pcSecond != NULL);
+
+   for(; *pcFirst == *pcSecond && *pcFirst != '\0';
+       pcFirst++, pcSecond++)
+      if(*pcFirst == '/')
+         ulShared++;
+   if((*pcFirst == '\0' || *pcFirst == '/') &&
+      (*pcSecond == '\0' || *pcSecond == '/'))
+      ulShared++;
+   return ulShared;
+}
+
+/*
+  Sets up psBatch to walk oFT through the ulNumPaths paths ppcPaths,
+  setting piStatuses[i] to BAD_PATH for each path i that is not
+  well-formed and leaving it out of the batch. The stack keeps index
+  hashes if bHashed, and holds its nodes shared if bLocking and oFT
+  is synchronized. Returns SUCCESS, or MEMORY_ERROR if memory could
+  not be allocated for the batch.
+*/
+static int FT_openBatch(struct FT_batch *psBatch, FT_T oFT,
+                        const char **ppcPaths, size_t ulNumPaths,
+                        int *piStatuses, boolean bSorted,
+                        boolean bHashed, boolean bLocking) {
+   size_t ulMaxDepth = 1;
+   size_t ulDepth;
+   size_t i;
+
+   assert(psBatch != NULL);
+   assert(oFT != NULL);
+   assert(ulNumPaths == 0 || ppcPaths != NULL);
+   assert(ulNumPaths == 0 || piStatuses != NULL);
+
+   psBatch->oFT = oFT;
+   psBatch->ulNumItems = 0;
+   psBatch->ulValid = 0;
+   psBatch->bLocking = (boolean) (bLocking && oFT->bSynchronized);
+   psBatch->aulHashes = NULL;
+   psBatch->aoNStack = NULL;
+   psBatch->psItems = malloc(sizeof(struct FT_batchItem) *
+                             (ulNumPaths == 0 ? 1 : ulNumPaths));
+   if(psBatch->psItems == NULL)
+      return MEMORY_ERROR;
+
+   /* screen out bad paths, and size the stack for the rest */
+   for(i = 0; i < ulNumPaths; i++) {
+      assert(ppcPaths[i] != NULL);
+      if(!FT_isWellFormed(ppcPaths[i])) {
+         piStatuses[i] = BAD_PATH;
+         continue;
+      }
+      ulDepth = FT_countComponents(ppcPaths[i]);
+      psBatch->psItems[psBatch->ulNumItems].pcPath = ppcPaths[i];
+      psBatch->psItems[psBatch->ulNumItems].ulDepth = ulDepth;
+      psBatch->psItems[psBatch->ulNumItems].ulIndex = i;
+      psBatch->ulNumItems++;
+      if(ulDepth > ulMaxDepth)
+         ulMaxDepth = ulDepth;
+   }
+
+   psBatch->aoNStack = malloc(sizeof(Node_T) * ulMaxDepth);
+   if(bHashed)
+      psBatch->aulHashes = malloc(sizeof(size_t) * ulMaxDepth);
+   if(psBatch->aoNStack == NULL ||
+      (bHashed && psBatch->aulHashes == NULL)) {
+      free(psBatch->aoNStack);
+      free(psBatch->aulHashes);
+      free(psBatch->psItems);
+      return MEMORY_ERROR;
+   }
+
+   if(bSorted)
+      qsort(psBatch->psItems, psBatch->ulNumItems,
+            sizeof(struct FT_batchItem), FT_compareItems);
+   return SUCCESS;
+}
+
+/*
+  Returns the number of entries of psBatch's stack that lie along
+  the path of its item ulItem.
+*/
+static size_t FT_keptComponents(struct FT_batch *psBatch,
+                                size_t ulItem) {
+   size_t ulKept;
+
+   assert(psBatch != NULL);
+   assert(ulItem < psBatch->ulNumItems);
+
+   if(ulItem == 0)
+      return 0;
+   ulKept = FT_sharedComponents(psBatch->psItems[ulItem-1].pcPath,
+                                psBatch->psItems[ulItem].pcPath);
+   if(ulKept > psBatch->ulValid)
+      ulKept = psBatch->ulValid;
+   return ulKept;
+}
+
+/*
+  Pops psBatch's stack down to its first ulKept entries, releasing
+  the nodes popped if the batch holds them.
+*/
+static void FT_popTo(struct FT_batch *psBatch, size_t ulKept) {
+   assert(psBatch != NULL);
+   assert(ulKept <= psBatch->ulValid);
+
+   while(psBatch->ulValid > ulKept) {
+      psBatch->ulValid--;
+      if(psBatch->bLocking)
+         NodeFT_unlock(psBatch->aoNStack[psBatch->ulValid]);
+   }
+}
+
+/* Pops all of psBatch's stack and frees the batch's memory */
+static void FT_closeBatch(struct FT_batch *psBatch) {
+   assert(psBatch != NULL);
+
+   FT_popTo(psBatch, 0);
+   free(psBatch->aoNStack);
+   free(psBatch->aulHashes);
+   free(psBatch->psItems);
+}
+
+/*
+  Pushes oNNode, a child of the node on top of psBatch's stack (or the
+  root if the stack is empty), onto the stack. If the batch holds its
+  nodes, oNNode must already be held shared.
+*/
+static void FT_pushNode(struct FT_batch *psBatch, Node_T oNNode) {
+   size_t ulParentHash = HASHTABLE_SEED;
+
+   assert(psBatch != NULL);
+   assert(oNNode != NULL);
+
+   if(psBatch->aulHashes != NULL) {
+      if(psBatch->ulValid > 0)
+         ulParentHash = psBatch->aulHashes[psBatch->ulValid - 1];
+      psBatch->aulHashes[psBatch->ulValid] =
+         FT_hashNode(oNNode, ulParentHash);
+   }
+   psBatch->aoNStack[psBatch->ulValid] = oNNode;
+   psBatch->ulValid++;
+}
+
+/*
+  Walks psBatch's stack towards the well-formed path pcPath of depth
+  ulDepth, keeping its first ulKept entries, which lie along pcPath,
+  and pushing the nodes that exist below them, as far as pcPath goes.
+  Sets *ppcRest to the first component of pcPath that was not found
+  (or its end). Returns SUCCESS, or CONFLICTING_PATH if the root's
+  name is not pcPath's first component.
+*/
+static int FT_descendStack(struct FT_batch *psBatch, const char *pcPath,
+                           size_t ulDepth, size_t ulKept,
+                           const char **ppcRest) {
+   FT_T oFT;
+   const char *pcStart = pcPath;
+   const char *pcEnd;
+   Node_T oNCurr = NULL;
+   Node_T oNChild;
+   size_t ulLevel;
+
+   assert(psBatch != NULL);
+   assert(pcPath != NULL);
+   assert(ppcRest != NULL);
+
+   oFT = psBatch->oFT;
+
+   /* skip the components that the stack already holds */
+   FT_popTo(psBatch, ulKept);
+   for(ulLevel = 0; ulLevel < ulKept; ulLevel++)
+      pcStart = strchr(pcStart, '/') + 1;
+   if(ulKept > 0)
+      oNCurr = psBatch->aoNStack[ulKept - 1];
+
+   /* go on down through the nodes that exist */
+   while(psBatch->ulValid < ulDepth) {
+      pcEnd = pcStart;
+      while(*pcEnd != '/' && *pcEnd != '\0')
+         pcEnd++;
+      if(oNCurr == NULL) {
+         /* the root, which sRootLock keeps in place while it is
+            taken */
+         if(psBatch->bLocking)
+            (void) pthread_rwlock_rdlock(&oFT->sRootLock);
+         oNChild = __atomic_load_n(&oFT->oNRoot, __ATOMIC_ACQUIRE);
+         if(oNChild != NULL &&
+            (strncmp(NodeFT_getName(oNChild), pcStart,
+                     (size_t) (pcEnd - pcStart)) ||
+             NodeFT_getName(oNChild)[pcEnd - pcStart] != '\0')) {
+            if(psBatch->bLocking)
+               (void) pthread_rwlock_unlock(&oFT->sRootLock);
+            *ppcRest = pcStart;
+            return CONFLICTING_PATH;
+         }
+         if(oNChild != NULL && psBatch->bLocking)
+            NodeFT_lockShared(oNChild);
+         if(psBatch->bLocking)
+            (void) pthread_rwlock_unlock(&oFT->sRootLock);
+      }
+      else if(NodeFT_isFile(oNCurr))
+         oNChild = NULL;
+      else {
+         oNChild = NodeFT_findChild(oNCurr, pcStart,
+                                    (size_t) (pcEnd - pcStart));
+         if(oNChild != NULL && psBatch->bLocking)
+            NodeFT_lockShared(oNChild);
+      }
+      if(oNChild == NULL)
+         break;
+      FT_pushNode(psBatch, oNChild);
+      oNCurr = oNChild;
+      pcStart = *pcEnd == '\0' ? pcEnd : pcEnd + 1;
+   }
+
+   *ppcRest = pcStart;
+   return SUCCESS;
+}
+
+/*
+  Inserts the file with well-formed path pcPath, whose depth is
+  ulDepth, with contents pvContents of size ulLength bytes, starting
+  from the first ulKept entries of psBatch's stack, which lie along
+  pcPath. Leaves the stack holding the nodes along pcPath as far as
+  they exist. Returns the status that FT_insertFile would.
+*/
+static int FT_insertFromStack(struct FT_batch *psBatch,
+                              const char *pcPath, size_t ulDepth,
+                              size_t ulKept, void *pvContents,
+                              size_t ulLength) {
+   FT_T oFT;
+   const char *pcStart;
+   const char *pcEnd;
+   Node_T oNCurr = NULL;
+   Node_T oNFirstNew = NULL;
+   size_t ulFirstHash = HASHTABLE_SEED;
+   size_t ulExisting;
+   int iStatus;
+
+   assert(psBatch != NULL);
+   assert(pcPath != NULL);
+   assert(!psBatch->bLocking);
+
+   oFT = psBatch->oFT;
+
+   iStatus = FT_descendStack(psBatch, pcPath, ulDepth, ulKept,
+                             &pcStart);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   ulExisting = psBatch->ulValid;
+   if(ulExisting > 0)
+      oNCurr = psBatch->aoNStack[ulExisting - 1];
+
+   if(ulExisting == ulDepth)
+      return ALREADY_IN_TREE;
+   if(oNCurr != NULL && NodeFT_isFile(oNCurr))
+      return NOT_A_DIRECTORY;
+   /*A file cannot be the root*/
+   if(ulDepth == 1)
+      return CONFLICTING_PATH;
+
+   /* build the rest of the path, one level at a time */
+   while(psBatch->ulValid < ulDepth) {
+      Node_T oNNewNode = NULL;
+      boolean bLast;
+
+      pcEnd = pcStart;
+      while(*pcEnd != '/' && *pcEnd != '\0')
+         pcEnd++;
+
+      bLast = (boolean) (psBatch->ulValid + 1 == ulDepth);
+      iStatus = NodeFT_new(pcStart, (size_t) (pcEnd - pcStart), oNCurr,
+                           bLast, bLast ? pvContents : NULL,
+                           bLast ? ulLength : 0, psBatch->oFT->oArena,
+                           &oNNewNode);
+      if(iStatus == SUCCESS) {
+         FT_pushNode(psBatch, oNNewNode);
+         if(oNFirstNew == NULL) {
+            oNFirstNew = oNNewNode;
+            if(psBatch->aulHashes != NULL)
+               ulFirstHash = psBatch->aulHashes[ulExisting];
+         }
+         /* keep the index current as each level is created */
+         if(psBatch->aulHashes != NULL &&
+            !HashTable_add(oFT->oHIndex,
+                           psBatch->aulHashes[psBatch->ulValid - 1],
+                           oNNewNode))
+            iStatus = MEMORY_ERROR;
+      }
+      if(iStatus != SUCCESS) {
+         if(oNFirstNew != NULL)
+            FT_discardNew(oFT, oNFirstNew, ulFirstHash);
+         FT_popTo(psBatch, ulExisting);
+         return iStatus;
+      }
+      oNCurr = oNNewNode;
+      pcStart = pcEnd + 1;
+   }
+
+   if(oFT->oNRoot == NULL)
+      __atomic_store_n(&oFT->oNRoot, oNFirstNew, __ATOMIC_RELEASE);
+   FT_addCount(oFT, ulDepth - ulExisting);
+   return SUCCESS;
+}
+
+/* The body of FT_insertFilesIn, called with oFT locked as needed */
+static int FT_insertFilesUnlocked(FT_T oFT, const char **ppcPaths,
+                                  void **ppvContents,
+                                  size_t *pulLengths,
+                                  size_t ulNumFiles, int *piStatuses) {
+   struct FT_batch sBatch;
+   struct FT_batchItem *psItem;
+   size_t i;
+   int iStatus;
+
+   assert(oFT != NULL);
+   assert(ulNumFiles == 0 || ppvContents != NULL);
+   assert(ulNumFiles == 0 || pulLengths != NULL);
+
+   if(!oFT->bIsInitialized)
+      return INITIALIZATION_ERROR;
+
+   iStatus = FT_openBatch(&sBatch, oFT, ppcPaths, ulNumFiles,
+                          piStatuses, TRUE,
+                          (boolean) (oFT->oHIndex != NULL), FALSE);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   for(i = 0; i < sBatch.ulNumItems; i++) {
+      psItem = &sBatch.psItems[i];
+      /* the stack's nodes are already copied, and stay in place */
+      iStatus = FT_ownPath(oFT, psItem->pcPath, FALSE);
+      if(iStatus != SUCCESS) {
+         piStatuses[psItem->ulIndex] = iStatus;
+         FT_popTo(&sBatch, 0);
+         continue;
+      }
+      piStatuses[psItem->ulIndex] =
+         FT_insertFromStack(&sBatch, psItem->pcPath, psItem->ulDepth,
+                            FT_keptComponents(&sBatch, i),
+                            ppvContents[psItem->ulIndex],
+                            pulLengths[psItem->ulIndex]);
+   }
+
+   FT_closeBatch(&sBatch);
+   return SUCCESS;
+}
+
+/* --------------------------------------------------------------------
+
+  FT_loadManifestIn builds a tree bottom-up from a manifest, whose
+  paths come in component order (see manifest.h). Each directory
+  along the current path stays open on a stack while its children
+  arrive, already sorted, so no child is looked up or compared with
+  more than its directory's latest children; once the manifest moves
+  past a directory, NodeFT_setChildren gives it all of them at once.
+*/
+
+/* One open directory of a load, and the children found for it so far */
+struct FT_loadLevel {
+   /* the directory */
+   Node_T oNDir;
+   /* its file children so far, their number, and the room for them */
+   Node_T *aoNFiles;
+   size_t ulNumFiles;
+   size_t ulFilesLength;
+   /* its directory children so far, their number, and the room for
+      them */
+   Node_T *aoNDirectories;
+   size_t ulNumDirectories;
+   size_t ulDirectoriesLength;
+   /* when loading a save file, the number of children of each kind
+      that it gives the directory (see FT_loadIn) */
+   size_t ulFilesDue;
+   size_t ulDirectoriesDue;
+};
+
+/* The state of one load as it moves from path to path */
+struct FT_load {
+   /* the open directories, root first; the entries past ulOpen keep
+      their arrays for reuse */
+   struct FT_loadLevel *psLevels;
+   /* the number of open directories */
+   size_t ulOpen;
+   /* the number of entries of psLevels */
+   size_t ulLevelsLength;
+   /* the root, or NULL until the first path is loaded */
+   Node_T oNRoot;
+   /* the number of nodes created */
+   size_t ulCount;
+   /* the arena that the nodes come from, or NULL for malloc */
+   Arena_T oArena;
+};
+
+/*
+  Adds oNChild to the end of the *pulNum children at *paoNChildren,
+  which have room for *pulLength, growing them if needed. Returns
+  SUCCESS, or MEMORY_ERROR if they could not grow.
+*/
+static int FT_appendChild(Node_T **paoNChildren, size_t *pulNum,
+                          size_t *pulLength, Node_T oNChild) {
+   Node_T *aoNGrown;
+   size_t ulGrownLength;
+
+   assert(paoNChildren != NULL);
+   assert(pulNum != NULL);
+   assert(pulLength != NULL);
+   assert(oNChild != NULL);
+
+   if(*pulNum == *pulLength) {
+      ulGrownLength = *pulLength * 2 + 4;
+      aoNGrown = realloc(*paoNChildren, ulGrownLength * sizeof(Node_T));
+      if(aoNGrown == NULL)
+         return MEMORY_ERROR;
+      *paoNChildren = aoNGrown;
+      *pulLength = ulGrownLength;
+   }
+   (*paoNChildren)[(*pulNum)++] = oNChild;
+   return SUCCESS;
+}
+
+/*
+  Pushes the new directory oNDir onto psLoad's stack of open
+  directories. Returns SUCCESS, or MEMORY_ERROR if the stack could not
+  grow.
+*/
+static int FT_openLevel(struct FT_load *psLoad, Node_T oNDir) {
+   struct FT_loadLevel *psGrown;
+   struct FT_loadLevel *psLevel;
+   size_t ulGrownLength;
+
+   assert(psLoad != NULL);
+   assert(oNDir != NULL);
+
+   if(psLoad->ulOpen == psLoad->ulLevelsLength) {
+      ulGrownLength = psLoad->ulLevelsLength * 2 + 8;
+      psGrown = realloc(psLoad->psLevels,
+                        ulGrownLength * sizeof(struct FT_loadLevel));
+      if(psGrown == NULL)
+         return MEMORY_ERROR;
+      memset(psGrown + psLoad->ulLevelsLength, 0,
+             (ulGrownLength - psLoad->ulLevelsLength) *
+             sizeof(struct FT_loadLevel));
+      psLoad->psLevels = psGrown;
+      psLoad->ulLevelsLength = ulGrownLength;
+   }
+
+   psLevel = &psLoad->psLevels[psLoad->ulOpen++];
+   psLevel->oNDir = oNDir;
+   psLevel->ulNumFiles = 0;
+   psLevel->ulNumDirectories = 0;
+   return SUCCESS;
+}
+
+/*
+  Gives the deepest open directory of psLoad its children and pops it.
+  Returns SUCCESS, or MEMORY_ERROR if its arrays could not be
+  allocated, in which case it stays open.
+*/
+static int FT_closeLevel(struct FT_load *psLoad) {
+   struct FT_loadLevel *psLevel;
+   int iStatus;
+
+   assert(psLoad != NULL);
+   assert(psLoad->ulOpen > 0);
+
+   psLevel = &psLoad->psLevels[psLoad->ulOpen - 1];
+   iStatus = NodeFT_setChildren(psLevel->oNDir,
+                                psLevel->aoNFiles, psLevel->ulNumFiles,
+                                psLevel->aoNDirectories,
+                                psLevel->ulNumDirectories);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   psLoad->ulOpen--;
+   return SUCCESS;
+}
+
+/*
+  Returns TRUE if the ulLength characters at pcName name the latest
+  file or directory child of psLevel's directory. Since children
+  arrive sorted, no earlier child can have that name.
+*/
+static boolean FT_isLatestChild(struct FT_loadLevel *psLevel,
+                                const char *pcName, size_t ulLength) {
+   const char *pcLatest;
+
+   assert(psLevel != NULL);
+   assert(pcName != NULL);
+
+   if(psLevel->ulNumFiles > 0) {
+      pcLatest = NodeFT_getName(
+         psLevel->aoNFiles[psLevel->ulNumFiles - 1]);
+      if(strncmp(pcLatest, pcName, ulLength) == 0 &&
+         pcLatest[ulLength] == '\0')
+         return TRUE;
+   }
+   if(psLevel->ulNumDirectories > 0) {
+      pcLatest = NodeFT_getName(
+         psLevel->aoNDirectories[psLevel->ulNumDirectories - 1]);
+      if(strncmp(pcLatest, pcName, ulLength) == 0 &&
+         pcLatest[ulLength] == '\0')
+         return TRUE;
+   }
+   return FALSE;
+}
+
+/*
+  Adds psEntry, which follows the path pcPrevious (or comes first if
+  pcPrevious is NULL) in component order, to the tree that psLoad is
+  building, along with any of its ancestors not yet loaded. Closes
+  the open directories that psEntry's path leaves, and opens each
+  directory it creates. Returns SUCCESS, or otherwise returns status:
+  * BAD_PATH if psEntry's path is not well-formed
+  * CONFLICTING_PATH if the path does not begin with the root's name,
+                     or is the root and names a file
+  * NOT_A_DIRECTORY if a proper prefix of the path was loaded as a file
+  * ALREADY_IN_TREE if the path was already loaded
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+static int FT_loadEntry(struct FT_load *psLoad,
+                        const struct ManifestEntry *psEntry,
+                        const char *pcPrevious) {
+   struct FT_loadLevel *psLevel;
+   const char *pcName;
+   const char *pcEnd;
+   Node_T oNNew;
+   size_t ulDepth;
+   size_t ulShared = 0;
+   size_t ulLevel;
+   boolean bIsFile;
+   int iStatus;
+
+   assert(psLoad != NULL);
+   assert(psEntry != NULL);
+
+   if(!FT_isWellFormed(psEntry->pcPath))
+      return BAD_PATH;
+   ulDepth = FT_countComponents(psEntry->pcPath);
+   if(pcPrevious != NULL)
+      ulShared = FT_sharedComponents(pcPrevious, psEntry->pcPath);
+   if(psLoad->oNRoot != NULL && ulShared == 0)
+      return CONFLICTING_PATH;
+
+   /* close the directories that this path does not pass through */
+   if(ulShared > psLoad->ulOpen)
+      ulShared = psLoad->ulOpen;
+   while(psLoad->ulOpen > ulShared) {
+      iStatus = FT_closeLevel(psLoad);
+      if(iStatus != SUCCESS)
+         return iStatus;
+   }
+   if(ulShared >= ulDepth)
+      return ALREADY_IN_TREE;
+
+   /* create the rest of the path, opening each new directory */
+   pcName = psEntry->pcPath;
+   for(ulLevel = 0; ulLevel < ulShared; ulLevel++)
+      pcName = strchr(pcName, '/') + 1;
+   for(ulLevel = ulShared; ulLevel < ulDepth; ulLevel++) {
+      pcEnd = strchr(pcName, '/');
+      if(pcEnd == NULL)
+         pcEnd = pcName + strlen(pcName);
+      bIsFile = (boolean) (ulLevel == ulDepth - 1 &&
+                           !psEntry->bIsDirectory);
+
+      if(ulLevel == 0) {
+         if(bIsFile)
+            return CONFLICTING_PATH;
+         iStatus = NodeFT_newUnlinked(pcName, (size_t) (pcEnd - pcName),
+                                      NULL, FALSE, NULL, 0,
+                                      psLoad->oArena, &oNNew);
+         if(iStatus != SUCCESS)
+            return iStatus;
+         psLoad->oNRoot = oNNew;
+      }
+      else {
+         psLevel = &psLoad->psLevels[ulLevel - 1];
+         if(FT_isLatestChild(psLevel, pcName,
+                             (size_t) (pcEnd - pcName)))
+            return ulLevel == ulDepth - 1 ? ALREADY_IN_TREE
+                                          : NOT_A_DIRECTORY;
+         iStatus = NodeFT_newUnlinked(pcName, (size_t) (pcEnd - pcName),
+                                      psLevel->oNDir, bIsFile, NULL,
+                                      bIsFile ? psEntry->ulSize : 0,
+                                      psLoad->oArena, &oNNew);
+         if(iStatus != SUCCESS)
+            return iStatus;
+         if(bIsFile)
+            iStatus = FT_appendChild(&psLevel->aoNFiles,
+                                     &psLevel->ulNumFiles,
+                                     &psLevel->ulFilesLength, oNNew);
+         else
+            iStatus = FT_appendChild(&psLevel->aoNDirectories,
+                                     &psLevel->ulNumDirectories,
+                                     &psLevel->ulDirectoriesLength,
+                                     oNNew);
+         if(iStatus != SUCCESS) {
+            (void) NodeFT_free(oNNew);
+            return iStatus;
+         }
+      }
+      psLoad->ulCount++;
+
+      if(!bIsFile) {
+         iStatus = FT_openLevel(psLoad, oNNew);
+         if(iStatus != SUCCESS)
+            return iStatus;
+      }
+      pcName = pcEnd + 1;
+   }
+   return SUCCESS;
+}
+
+/*
+  Frees the arrays of psLoad. If bDiscard, first frees every node it
+  has created, deepest open directory first, so that each directory's
+  pending children go before the directory itself.
+*/
+static void FT_closeLoad(struct FT_load *psLoad, boolean bDiscard) {
+   struct FT_loadLevel *psLevel;
+   size_t ulLevel;
+   size_t ul;
+
+   assert(psLoad != NULL);
+
+   if(bDiscard) {
+      for(ulLevel = psLoad->ulOpen; ulLevel-- > 0;) {
+         psLevel = &psLoad->psLevels[ulLevel];
+         for(ul = 0; ul < psLevel->ulNumFiles; ul++)
+            (void) NodeFT_free(psLevel->aoNFiles[ul]);
+         for(ul = 0; ul < psLevel->ulNumDirectories; ul++)
+            (void) NodeFT_free(psLevel->aoNDirectories[ul]);
+      }
+      if(psLoad->oNRoot != NULL)
+         (void) NodeFT_free(psLoad->oNRoot);
+   }
+
+   for(ulLevel = 0; ulLevel < psLoad->ulLevelsLength; ulLevel++) {
+      free(psLoad->psLevels[ulLevel].aoNFiles);
+      free(psLoad->psLevels[ulLevel].aoNDirectories);
+   }
+   free(psLoad->psLevels);
+}
+
+/*
+  Makes the tree that psLoad built, if any, oFT's tree, adding it to
+  the index if the index is on. Returns SUCCESS, or MEMORY_ERROR if
+  the index could not grow, in which case the tree is freed and oFT
+  is left empty.
+*/
+static int FT_adoptLoad(FT_T oFT, struct FT_load *psLoad) {
+   int iStatus;
+
+   assert(oFT != NULL);
+   assert(psLoad != NULL);
+
+   if(psLoad->oNRoot == NULL)
+      return SUCCESS;
+
+   if(oFT->oHIndex != NULL) {
+      iStatus = FT_indexSubtree(oFT, psLoad->oNRoot,
+                                FT_hashNode(psLoad->oNRoot, 0));
+      if(iStatus != SUCCESS) {
+         FT_discardNew(oFT, psLoad->oNRoot,
+                       FT_hashNode(psLoad->oNRoot, 0));
+         return iStatus;
+      }
+   }
+   __atomic_store_n(&oFT->oNRoot, psLoad->oNRoot, __ATOMIC_RELEASE);
+   FT_addCount(oFT, psLoad->ulCount);
+   return SUCCESS;
+}
+
+/* The body of FT_loadManifestIn, called with oFT locked as needed */
+static int FT_loadManifestUnlocked(FT_T oFT, const char *pcFile) {
+   struct FT_load sLoad;
+   Manifest_T oManifest;
+   const struct ManifestEntry *psEntry;
+   const char *pcPrevious = NULL;
+   size_t ul;
+   int iStatus = SUCCESS;
+
+   assert(oFT != NULL);
+   assert(pcFile != NULL);
+
+   if(!oFT->bIsInitialized)
+      return INITIALIZATION_ERROR;
+   if(oFT->oNRoot != NULL)
+      return ALREADY_IN_TREE;
+
+   iStatus = Manifest_read(pcFile, &oManifest);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   sLoad.psLevels = NULL;
+   sLoad.ulOpen = 0;
+   sLoad.ulLevelsLength = 0;
+   sLoad.oNRoot = NULL;
+   sLoad.ulCount = 0;
+   sLoad.oArena = oFT->oArena;
+   for(ul = 0; ul < Manifest_getLength(oManifest) && iStatus == SUCCESS;
+       ul++) {
+      psEntry = Manifest_getEntry(oManifest, ul);
+      iStatus = FT_loadEntry(&sLoad, psEntry, pcPrevious);
+      pcPrevious = psEntry->pcPath;
+   }
+   while(iStatus == SUCCESS && sLoad.ulOpen > 0)
+      iStatus = FT_closeLevel(&sLoad);
+   Manifest_free(oManifest);
+   if(iStatus != SUCCESS) {
+      FT_closeLoad(&sLoad, TRUE);
+      return iStatus;
+   }
+   FT_closeLoad(&sLoad, FALSE);
+   return FT_adoptLoad(oFT, &sLoad);
+}
+
+/* --------------------------------------------------------------------
+
+  FT_saveIn writes the tree to a save file (see treefile.h) in
+  preorder, each node by name along with its number of children, and
+  FT_loadIn builds the tree back from one in a single pass, bottom-up
+  as FT_loadManifestIn does, with no path ever formed or looked up.
+*/
+
+/*
+  Writes oNNode, a directory, and the subtree rooted there to
+  oTreeFile in preorder, with files' contents if the file stores
+  them. Returns SUCCESS, or IO_ERROR once a write has failed.
+*/
+static int FT_saveSubtree(TreeFile_T oTreeFile, Node_T oNNode) {
+   struct TreeFileNode sNode;
+   Node_T oNChild = NULL;
+   size_t c;
+   int iStatus;
+
+   assert(oTreeFile != NULL);
+   assert(oNNode != NULL);
+
+   sNode.pcName = NodeFT_getName(oNNode);
+   sNode.ulNameLength = strlen(sNode.pcName);
+   sNode.bIsFile = FALSE;
+   sNode.ulSize = 0;
+   sNode.pvContents = NULL;
+   sNode.ulNumFiles = NodeFT_getNumFileChildren(oNNode);
+   sNode.ulNumDirectories = NodeFT_getNumDirectoryChildren(oNNode);
+   iStatus = TreeFile_write(oTreeFile, &sNode);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   sNode.bIsFile = TRUE;
+   sNode.ulNumFiles = 0;
+   sNode.ulNumDirectories = 0;
+   for(c = 0; c < NodeFT_getNumFileChildren(oNNode); c++) {
+      iStatus = NodeFT_getFileChild(oNNode, c, &oNChild);
+      assert(iStatus == SUCCESS);
+      sNode.pcName = NodeFT_getName(oNChild);
+      sNode.ulNameLength = strlen(sNode.pcName);
+      sNode.ulSize = NodeFT_getFileLength(oNChild);
+      sNode.pvContents = NodeFT_getFileContents(oNChild);
+      iStatus = TreeFile_write(oTreeFile, &sNode);
+      if(iStatus != SUCCESS)
+         return iStatus;
+   }
+   for(c = 0; c < NodeFT_getNumDirectoryChildren(oNNode); c++) {
+      iStatus = NodeFT_getDirectoryChild(oNNode, c, &oNChild);
+      assert(iStatus == SUCCESS);
+      iStatus = FT_saveSubtree(oTreeFile, oNChild);
+      if(iStatus != SUCCESS)
+         return iStatus;
+   }
+   return SUCCESS;
+}
+
+/*
+  Makes a new, empty file named pcFile followed by '.' and six
+  characters that no other file has, for a save to be written to
+  before it is renamed over pcFile, so that saves to the same pcFile
+  from several threads or processes at once never share a temporary
+  file. Returns its name, which the caller must free, or NULL after
+  setting *piStatus to MEMORY_ERROR if memory could not be allocated,
+  or to IO_ERROR if the file could not be made.
+*/
+static char *FT_makeTemporary(const char *pcFile, int *piStatus) {
+   static const char acSuffix[] = ".XXXXXX";
+   char *pcTemporary;
+   size_t ulLength;
+   int iFd;
+
+   assert(pcFile != NULL);
+   assert(piStatus != NULL);
+
+   ulLength = strlen(pcFile);
+   pcTemporary = malloc(ulLength + sizeof(acSuffix));
+   if(pcTemporary == NULL) {
+      *piStatus = MEMORY_ERROR;
+      return NULL;
+   }
+   strcpy(pcTemporary, pcFile);
+   strcpy(pcTemporary + ulLength, acSuffix);
+   iFd = mkstemp(pcTemporary);
+   if(iFd < 0) {
+      free(pcTemporary);
+      *piStatus = IO_ERROR;
+      return NULL;
+   }
+   (void) close(iFd);
+   return pcTemporary;
+}
+
+/*
+  The body of FT_saveIn, called with oFT locked as needed, which tags
+  the save file with ulTag unless it is 0 and sets *pulLength to the
+  number of bytes written
+*/
+static int FT_saveUnlocked(FT_T oFT, const char *pcFile,
+                           boolean bContents, size_t ulTag,
+                           size_t *pulLength) {
+   TreeFile_T oTreeFile;
+   int iStatus;
+   int iCloseStatus;
+
+   assert(oFT != NULL);
+   assert(pcFile != NULL);
+   assert(pulLength != NULL);
+
+   if(!oFT->bIsInitialized)
+      return INITIALIZATION_ERROR;
+
+   iStatus = TreeFile_create(pcFile, bContents, ulTag, &oTreeFile);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   if(oFT->oNRoot != NULL)
+      iStatus = FT_saveSubtree(oTreeFile, oFT->oNRoot);
+   *pulLength = TreeFile_getLength(oTreeFile);
+   iCloseStatus = TreeFile_close(oTreeFile);
+   return (iStatus != SUCCESS) ? iStatus : iCloseStatus;
+}
+
+/*
+  Saves oFT, called with it locked as FT_saveUnlocked needs, to a
+  file that FT_makeTemporary makes beside pcFile, and renames that
+  over pcFile once it is whole, first making it durable if bDurable,
+  so that a save that fails leaves any earlier pcFile as it was.
+  Tags the save file with ulTag unless it is 0 and sets *pulLength
+  to the number of bytes written.
+*/
+static int FT_saveReplacing(FT_T oFT, const char *pcFile,
+                            boolean bContents, size_t ulTag,
+                            boolean bDurable, size_t *pulLength) {
+   char *pcTemporary;
+   int iStatus;
+
+   assert(oFT != NULL);
+   assert(pcFile != NULL);
+   assert(pulLength != NULL);
+
+   if(!oFT->bIsInitialized)
+      return INITIALIZATION_ERROR;
+
+   pcTemporary = FT_makeTemporary(pcFile, &iStatus);
+   if(pcTemporary == NULL)
+      return iStatus;
+   iStatus = FT_saveUnlocked(oFT, pcTemporary, bContents, ulTag,
+                             pulLength);
+   if(iStatus == SUCCESS && bDurable)
+      iStatus = Journal_syncFile(pcTemporary);
+   if(iStatus == SUCCESS) {
+      if(bDurable)
+         iStatus = Journal_replaceFile(pcTemporary, pcFile);
+      else if(rename(pcTemporary, pcFile) != 0)
+         iStatus = IO_ERROR;
+   }
+   if(iStatus != SUCCESS)
+      (void) remove(pcTemporary);
+   free(pcTemporary);
+   return iStatus;
+}
+
+/*
+  Frees the contents of every file in the subtree rooted at oNNode,
+  whose children, if it is a directory, are all set.
+*/
+static void FT_freeSubtreeContents(Node_T oNNode) {
+   Node_T oNChild = NULL;
+   size_t c;
+
+   assert(oNNode != NULL);
+
+   if(NodeFT_isFile(oNNode)) {
+      free(NodeFT_getFileContents(oNNode));
+      return;
+   }
+   for(c = 0; c < NodeFT_getNumFileChildren(oNNode); c++) {
+      (void) NodeFT_getFileChild(oNNode, c, &oNChild);
+      free(NodeFT_getFileContents(oNChild));
+   }
+   for(c = 0; c < NodeFT_getNumDirectoryChildren(oNNode); c++) {
+      (void) NodeFT_getDirectoryChild(oNNode, c, &oNChild);
+      FT_freeSubtreeContents(oNChild);
+   }
+}
+
+/*
+  Frees the contents that a failed FT_loadIn read for the files of
+  psLoad, which FT_closeLoad does not, since nodes never own their
+  contents. Each directory still open is the latest directory child
+  of the one above it, and has no children set yet; every other
+  directory has all of its children.
+*/
+static void FT_freeLoadedContents(struct FT_load *psLoad) {
+   struct FT_loadLevel *psLevel;
+   size_t ulLevel;
+   size_t ul;
+
+   assert(psLoad != NULL);
+
+   /* a whole tree was read before the load failed */
+   if(psLoad->ulOpen == 0 && psLoad->oNRoot != NULL)
+      FT_freeSubtreeContents(psLoad->oNRoot);
+   for(ulLevel = 0; ulLevel < psLoad->ulOpen; ulLevel++) {
+      psLevel = &psLoad->psLevels[ulLevel];
+      for(ul = 0; ul < psLevel->ulNumFiles; ul++)
+         free(NodeFT_getFileContents(psLevel->aoNFiles[ul]));
+      for(ul = 0; ul < psLevel->ulNumDirectories; ul++)
+         if(ulLevel + 1 == psLoad->ulOpen ||
+            ul + 1 < psLevel->ulNumDirectories)
+            FT_freeSubtreeContents(psLevel->aoNDirectories[ul]);
+   }
+}
+
+/*
+  Returns TRUE if pcName may follow, as the name of a child of
+  psLevel's directory of the kind given by bIsFile, the children that
+  the load has read for it so far: each array must be in strictly
+  increasing order, and no directory may share a file's name. Since
+  files come first, their names are all known by then.
+*/
+static boolean FT_isNextChild(struct FT_loadLevel *psLevel,
+                              const char *pcName, boolean bIsFile) {
+   Node_T *aoNChildren;
+   size_t ulNum;
+   size_t ulLow = 0;
+   size_t ulHigh;
+   size_t ulMid;
+   int iCompare;
+
+   assert(psLevel != NULL);
+   assert(pcName != NULL);
+
+   aoNChildren = bIsFile ? psLevel->aoNFiles : psLevel->aoNDirectories;
+   ulNum = bIsFile ? psLevel->ulNumFiles : psLevel->ulNumDirectories;
+   if(ulNum > 0 &&
+      strcmp(NodeFT_getName(aoNChildren[ulNum - 1]), pcName) >= 0)
+      return FALSE;
+   if(bIsFile)
+      return TRUE;
+
+   ulHigh = psLevel->ulNumFiles;
+   while(ulLow < ulHigh) {
+      ulMid = ulLow + (ulHigh - ulLow) / 2;
+      iCompare = strcmp(NodeFT_getName(psLevel->aoNFiles[ulMid]),
+                        pcName);
+      if(iCompare == 0)
+         return FALSE;
+      if(iCompare < 0)
+         ulLow = ulMid + 1;
+      else
+         ulHigh = ulMid;
+   }
+   return TRUE;
+}
+
+/*
+  Reads the next node of oTreeFile, which must be a child of the
+  deepest open directory of psLoad of the kind that the directory
+  expects next, and adds it there, opening it if it is a directory.
+  Returns SUCCESS, or IO_ERROR if the file is malformed or cannot be
+  read, or MEMORY_ERROR if memory could not be allocated.
+*/
+static int FT_loadChild(struct FT_load *psLoad, TreeFile_T oTreeFile) {
+   struct FT_loadLevel *psLevel;
+   struct TreeFileNode sNode;
+   Node_T oNNew;
+   boolean bIsFile;
+   int iStatus;
+
+   assert(psLoad != NULL);
+   assert(psLoad->ulOpen > 0);
+   assert(oTreeFile != NULL);
+
+   psLevel = &psLoad->psLevels[psLoad->ulOpen - 1];
+   bIsFile = (boolean) (psLevel->ulNumFiles < psLevel->ulFilesDue);
+
+   iStatus = TreeFile_read(oTreeFile, &sNode);
+   if(iStatus == NO_SUCH_PATH)
+      return IO_ERROR;
+   if(iStatus != SUCCESS)
+      return iStatus;
+   if(sNode.bIsFile != bIsFile ||
+      !FT_isNextChild(psLevel, sNode.pcName, bIsFile)) {
+      free(sNode.pvContents);
+      return IO_ERROR;
+   }
+
+   iStatus = NodeFT_newUnlinked(sNode.pcName, sNode.ulNameLength,
+                                psLevel->oNDir, bIsFile,
+                                sNode.pvContents, sNode.ulSize,
+                                psLoad->oArena, &oNNew);
+   if(iStatus != SUCCESS) {
+      free(sNode.pvContents);
+      return iStatus;
+   }
+   if(bIsFile)
+      iStatus = FT_appendChild(&psLevel->aoNFiles, &psLevel->ulNumFiles,
+                               &psLevel->ulFilesLength, oNNew);
+   else
+      iStatus = FT_appendChild(&psLevel->aoNDirectories,
+                               &psLevel->ulNumDirectories,
+                               &psLevel->ulDirectoriesLength, oNNew);
+   if(iStatus != SUCCESS) {
+      (void) NodeFT_free(oNNew);
+      free(sNode.pvContents);
+      return iStatus;
+   }
+   psLoad->ulCount++;
+
+   if(!bIsFile) {
+      iStatus = FT_openLevel(psLoad, oNNew);
+      if(iStatus != SUCCESS)
+         return iStatus;
+      psLevel = &psLoad->psLevels[psLoad->ulOpen - 1];
+      psLevel->ulFilesDue = sNode.ulNumFiles;
+      psLevel->ulDirectoriesDue = sNode.ulNumDirectories;
+   }
+   return SUCCESS;
+}
+
+/*
+  Builds psLoad's tree from oTreeFile: reads the root, then the rest
+  of the nodes in preorder, closing each directory once it has all of
+  its children. Returns SUCCESS, or CONFLICTING_PATH if the root is a
+  file, or IO_ERROR if the file is malformed, cut short, runs on past
+  the tree, or cannot be read, or MEMORY_ERROR if memory could not be
+  allocated.
+*/
+static int FT_loadTree(struct FT_load *psLoad, TreeFile_T oTreeFile) {
+   struct FT_loadLevel *psLevel;
+   struct TreeFileNode sNode;
+   Node_T oNRoot;
+   int iStatus;
+
+   assert(psLoad != NULL);
+   assert(oTreeFile != NULL);
+
+   iStatus = TreeFile_read(oTreeFile, &sNode);
+   if(iStatus == NO_SUCH_PATH)
+      return SUCCESS;
+   if(iStatus != SUCCESS)
+      return iStatus;
+   if(sNode.bIsFile) {
+      free(sNode.pvContents);
+      return CONFLICTING_PATH;
+   }
+   iStatus = NodeFT_newUnlinked(sNode.pcName, sNode.ulNameLength, NULL,
+                                FALSE, NULL, 0, psLoad->oArena,
+                                &oNRoot);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   psLoad->oNRoot = oNRoot;
+   psLoad->ulCount++;
+   iStatus = FT_openLevel(psLoad, oNRoot);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   psLoad->psLevels[0].ulFilesDue = sNode.ulNumFiles;
+   psLoad->psLevels[0].ulDirectoriesDue = sNode.ulNumDirectories;
+
+   while(psLoad->ulOpen > 0) {
+      psLevel = &psLoad->psLevels[psLoad->ulOpen - 1];
+      if(psLevel->ulNumFiles == psLevel->ulFilesDue &&
+         psLevel->ulNumDirectories == psLevel->ulDirectoriesDue)
+         iStatus = FT_closeLevel(psLoad);
+      else
+         iStatus = FT_loadChild(psLoad, oTreeFile);
+      if(iStatus != SUCCESS)
+         return iStatus;
+   }
+
+   /* the tree must end the file */
+   iStatus = TreeFile_read(oTreeFile, &sNode);
+   if(iStatus == NO_SUCH_PATH)
+      return SUCCESS;
+   if(iStatus == SUCCESS)
+      free(sNode.pvContents);
+   return IO_ERROR;
+}
+
+/*
+  The body of FT_loadIn, called with oFT locked as needed, which also
+  sets *pulTag to the save file's tag
+*/
+static int FT_loadUnlocked(FT_T oFT, const char *pcFile,
+                           size_t *pulTag) {
+   struct FT_load sLoad;
+   TreeFile_T oTreeFile;
+   int iStatus;
+
+   assert(oFT != NULL);
+   assert(pcFile != NULL);
+
+   if(!oFT->bIsInitialized)
+      return INITIALIZATION_ERROR;
+   if(oFT->oNRoot != NULL)
+      return ALREADY_IN_TREE;
+
+   iStatus = TreeFile_open(pcFile, &oTreeFile);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   *pulTag = TreeFile_getTag(oTreeFile);
+
+   sLoad.psLevels = NULL;
+   sLoad.ulOpen = 0;
+   sLoad.ulLevelsLength = 0;
+   sLoad.oNRoot = NULL;
+   sLoad.ulCount = 0;
+   sLoad.oArena = oFT->oArena;
+   iStatus = FT_loadTree(&sLoad, oTreeFile);
+   (void) TreeFile_close(oTreeFile);
+   if(iStatus != SUCCESS) {
+      FT_freeLoadedContents(&sLoad);
+      FT_closeLoad(&sLoad, TRUE);
+      return iStatus;
+   }
+   FT_closeLoad(&sLoad, FALSE);
+   return FT_adoptLoad(oFT, &sLoad);
+}
+
+/*
+  Writes oNNode, a directory, and the subtree rooted there to oImage,
+  children before parents, with files' contents if bContents, and
+  sets *pulNode to oNNode's offset in the image. Returns SUCCESS, or
+  IO_ERROR if a write failed, or MEMORY_ERROR if memory could not be
+  allocated.
+*/
+static int FT_imageSubtree(TreeImage_T oImage, Node_T oNNode,
+                           boolean bContents, size_t *pulNode) {
+   struct TreeImageNode sNode;
+   Node_T oNChild = NULL;
+   size_t *aulChildren;
+   size_t ulNumFiles;
+   size_t ulNumDirectories;
+   size_t c;
+   int iStatus = SUCCESS;
+
+   assert(oImage != NULL);
+   assert(oNNode != NULL);
+   assert(pulNode != NULL);
+
+   ulNumFiles = NodeFT_getNumFileChildren(oNNode);
+   ulNumDirectories = NodeFT_getNumDirectoryChildren(oNNode);
+   aulChildren = malloc((ulNumFiles + ulNumDirectories + 1) *
+                        sizeof(size_t));
+   if(aulChildren == NULL)
+      return MEMORY_ERROR;
+
+   sNode.bIsFile = TRUE;
+   sNode.aulFiles = NULL;
+   sNode.ulNumFiles = 0;
+   sNode.aulDirectories = NULL;
+   sNode.ulNumDirectories = 0;
+   for(c = 0; c < ulNumFiles && iStatus == SUCCESS; c++) {
+      iStatus = NodeFT_getFileChild(oNNode, c, &oNChild);
+      assert(iStatus == SUCCESS);
+      sNode.pcName = NodeFT_getName(oNChild);
+      sNode.ulNameLength = strlen(sNode.pcName);
+      sNode.ulSize = NodeFT_getFileLength(oNChild);
+      sNode.pvContents = bContents ? NodeFT_getFileContents(oNChild)
+                                   : NULL;
+      iStatus = TreeImage_add(oImage, &sNode, &aulChildren[c]);
+   }
+   for(c = 0; c < ulNumDirectories && iStatus == SUCCESS; c++) {
+      iStatus = NodeFT_getDirectoryChild(oNNode, c, &oNChild);
+      assert(iStatus == SUCCESS);
+      iStatus = FT_imageSubtree(oImage, oNChild, bContents,
+                                &aulChildren[ulNumFiles + c]);
+   }
+
+   if(iStatus == SUCCESS) {
+      sNode.pcName = NodeFT_getName(oNNode);
+      sNode.ulNameLength = strlen(sNode.pcName);
+      sNode.bIsFile = FALSE;
+      sNode.ulSize = 0;
+      sNode.pvContents = NULL;
+      sNode.aulFiles = aulChildren;
+      sNode.ulNumFiles = ulNumFiles;
+      sNode.aulDirectories = aulChildren + ulNumFiles;
+      sNode.ulNumDirectories = ulNumDirectories;
+      iStatus = TreeImage_add(oImage, &sNode, pulNode);
+   }
+   free(aulChildren);
+   return iStatus;
+}
+
+/* The body of FT_saveImageIn, called with oFT locked as needed */
+static int FT_saveImageUnlocked(FT_T oFT, const char *pcFile,
+                                boolean bContents) {
+   TreeImage_T oImage;
+   size_t ulRoot = 0;
+   int iStatus = SUCCESS;
+   int iFinishStatus;
+
+   assert(oFT != NULL);
+   assert(pcFile != NULL);
+
+   if(!oFT->bIsInitialized)
+      return INITIALIZATION_ERROR;
+
+   iStatus = TreeImage_create(pcFile, &oImage);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   if(oFT->oNRoot != NULL)
+      iStatus = FT_imageSubtree(oImage, oFT->oNRoot, bContents,
+                                &ulRoot);
+   iFinishStatus = TreeImage_finish(oImage, ulRoot);
+   return (iStatus != SUCCESS) ? iStatus : iFinishStatus;
+}
+
+/* --------------------------------------------------------------------
+
+  FT_bgsaveIn forks, and the child, which has the tree exactly as it
+  was at the fork and shares its pages with the parent until the
+  parent changes them, writes the save file while the parent goes
+  on. The child reports its status and the bytes it wrote through a
+  pipe before exiting.
+*/
+
+/* A save under way in a child process */
+struct FTBgsave {
+   /* the child writing the save file */
+   pid_t iPid;
+   /* the read end of the pipe that the child reports through */
+   int iFd;
+   /* TRUE once the child has been waited for */
+   boolean bExited;
+};
+
+/* What the child of FT_bgsaveIn reports */
+struct FT_bgsaveReport {
+   /* the status of the save */
+   int iStatus;
+   /* the number of bytes written */
+   size_t ulLength;
+};
+
+/*
+  The body of the child of FT_bgsaveIn: saves oFT, with contents if
+  bContents, to pcTemporary, makes it durable, and renames it over
+  pcFile, so that a save that fails or is cut short leaves the last
+  good pcFile in place; then reports through iFd and exits, without
+  returning.
+*/
+static void FT_bgsaveChild(FT_T oFT, const char *pcFile,
+                           const char *pcTemporary, boolean bContents,
+                           int iFd) {
+   struct FT_bgsaveReport sReport;
+
+   assert(oFT != NULL);
+   assert(pcFile != NULL);
+   assert(pcTemporary != NULL);
+
+   /* the child has only this thread, so no lock is needed */
+   sReport.ulLength = 0;
+   sReport.iStatus = FT_saveUnlocked(oFT, pcTemporary, bContents, 0,
+                                     &sReport.ulLength);
+   if(sReport.iStatus == SUCCESS)
+      sReport.iStatus = Journal_syncFile(pcTemporary);
+   if(sReport.iStatus == SUCCESS)
+      sReport.iStatus = Journal_replaceFile(pcTemporary, pcFile);
+   else
+      (void) remove(pcTemporary);
+   if(sReport.iStatus != SUCCESS)
+      sReport.ulLength = 0;
+   /* a report this small is written whole or not at all */
+   (void) write(iFd, &sReport, sizeof(sReport));
+   /* skip exit handlers and stdio buffers, which are the parent's */
+   _exit(0);
+}
+
+
+/* The body of FT_containsDirIn, called with oFT locked as needed, or
+   reading optimistically if bOptimistic */
+static boolean FT_containsDirUnlocked(FT_T oFT, const char *pcPath,
+                                      boolean bOptimistic) {
+   int iStatus;
+   Node_T oNFound = NULL;
+   boolean bResult;
+
+   assert(oFT != NULL);
+   assert(pcPath != NULL);
+
+   iStatus = FT_pinNode(oFT, pcPath, bOptimistic, &oNFound);
+   if(iStatus != SUCCESS)
+      return FALSE;
+   bResult = (boolean) !NodeFT_isFile(oNFound);
+   FT_unpinNode(oFT, oNFound, bOptimistic);
+   return bResult;
+}
+
+/* The body of FT_containsFileIn, called with oFT locked as needed, or
+   reading optimistically if bOptimistic */
+static boolean FT_containsFileUnlocked(FT_T oFT, const char *pcPath,
+                                       boolean bOptimistic) {
+   int iStatus;
+   Node_T oNFound = NULL;
+   boolean bResult;
+
+   assert(oFT != NULL);
+   assert(pcPath != NULL);
+
+   iStatus = FT_pinNode(oFT, pcPath, bOptimistic, &oNFound);
+   if(iStatus != SUCCESS)
+      return FALSE;
+   bResult = NodeFT_isFile(oNFound);
+   FT_unpinNode(oFT, oNFound, bOptimistic);
+   return bResult;
+}
+
+/* The body of FT_rmFileIn, called with oFT locked as needed */
+static int FT_rmFileUnlocked(FT_T oFT, const char *pcPath) {
+   int iStatus;
+   Node_T oNParent = NULL;
+   Node_T oNFound = NULL;
+
+   assert(oFT != NULL);
+   assert(pcPath != NULL);
+
+   /* if(!oFT->bIsInitialized)
+      return INITIALIZATION_ERROR; */
+   /* assert(CheckerFT_isValid(oFT)); */
+
+   iStatus = FT_ownPath(oFT, pcPath, FALSE);
+   if(iStatus == SUCCESS)
+      iStatus = FT_lockFound(oFT, pcPath, &oNParent, &oNFound);
+
+   if(iStatus != SUCCESS)
+       return iStatus;
+
+   if(!NodeFT_isFile(oNFound)) {
+      FT_unlockHeld(oFT, oNFound);
+      FT_unlockHeld(oFT, oNParent);
+      return NOT_A_FILE;
+   }
+
+   if(oFT->oHIndex != NULL) {
+      FT_lockIndex(oFT, TRUE);
+      (void) HashTable_remove(oFT->oHIndex,
+                HashTable_hash(HASHTABLE_SEED, pcPath, strlen(pcPath)),
+                oNFound);
+      FT_unlockIndex(oFT);
+   }
+   FT_unlockHeld(oFT, oNFound);
+   /* a snapshot may keep the node, so count it out as detached */
+   FT_subtractCount(oFT, NodeFT_detach(oNFound));
+   (void) NodeFT_free(oNFound);
+   FT_unlockHeld(oFT, oNParent);
+
+   /* assert(CheckerFT_isValid(oFT)); */ 
+   return SUCCESS;
+}
+
+/* Frees pvNode, a Node_T detached from its FT, for Reclaim_defer */
+static void FT_freeReclaimed(void *pvNode) {
+   assert(pvNode != NULL);
+
+   (void) NodeFT_free((Node_T) pvNode);
+}
+
+/* Returns the slabs left unused to the system, for Reclaim_defer */
+static void FT_trimReclaimed(void *pvUnused) {
+   assert(pvUnused == NULL);
+
+   Pool_trim();
+}
+
+/*
+  Frees oNDetached, the root of a subtree of ulNodes nodes of oFT that
+  NodeFT_detach has cut loose and that no call still inside it can
+  reach. A large subtree is handed to the reclamation thread, unless
+  it cannot take it, so that the caller does not wait for the frees.
+  A subtree from oFT's arena is left for the arena to release; only
+  its references from snapshots are let go of. Once a subtree of more
+  than TRIM_THRESHOLD nodes is freed, the slabs it leaves unused are
+  returned; the trim is an item of its own, queued behind the free,
+  because in lock-free mode the free's blocks reach the pool only
+  when the reclamation thread has waited out the readers after it.
+*/
+static void FT_freeDetached(FT_T oFT, Node_T oNDetached,
+                            size_t ulNodes) {
+   assert(oFT != NULL);
+   assert(oNDetached != NULL);
+
+   if(oFT->oArena != NULL) {
+      if(oFT->ulSnapshots > 0)
+         (void) NodeFT_free(oNDetached);
+      return;
+   }
+
+   if(ulNodes <= RECLAIM_THRESHOLD)
+      (void) NodeFT_free(oNDetached);
+   else if(!Reclaim_defer(FT_freeReclaimed, oNDetached, ulNodes,
+                          (int) oFT->bLockFree)) {
+      FT_freeReclaimed(oNDetached);
+      if(ulNodes > TRIM_THRESHOLD)
+         Pool_trim();
+   }
+   else if(ulNodes > TRIM_THRESHOLD &&
+           !Reclaim_defer(FT_trimReclaimed, NULL, 0, 0))
+      Pool_trim();
+}
+
+/* The body of FT_rmDirIn, called with oFT locked as needed */
+static int FT_rmDirUnlocked(FT_T oFT, const char *pcPath) {
+   int iStatus;
+   Node_T oNParent = NULL;
+   Node_T oNFound = NULL;
+   size_t ulNodes;
+
+   assert(oFT != NULL);
+   assert(pcPath != NULL);
+   /* assert(CheckerFT_isValid(oFT)); */
+
+   iStatus = FT_ownPath(oFT, pcPath, FALSE);
+   if(iStatus == SUCCESS)
+      iStatus = FT_lockFound(oFT, pcPath, &oNParent, &oNFound);
+   if(iStatus != SUCCESS)
+       return iStatus;
+   if(NodeFT_isFile(oNFound)) {
+      FT_unlockHeld(oFT, oNFound);
+      FT_unlockHeld(oFT, oNParent);
+      return NOT_A_DIRECTORY;
+   }
+   /* wait out calls still inside the subtree; none can enter it */
+   if(oFT->bSynchronized)
+      FT_drainSubtree(oNFound);
+   if(oNFound == oFT->oNRoot)
+      __atomic_store_n(&oFT->oNRoot, NULL, __ATOMIC_RELEASE);
+   if(oFT->oHIndex != NULL) {
+      FT_lockIndex(oFT, TRUE);
+      FT_unindexSubtree(oFT, oNFound,
+                HashTable_hash(HASHTABLE_SEED, pcPath, strlen(pcPath)));
+      FT_unlockIndex(oFT);
+   }
+   /* cut the subtree loose now, but free it later */
+   ulNodes = NodeFT_detach(oNFound);
+   FT_subtractCount(oFT, ulNodes);
+   FT_unlockHeld(oFT, oNFound);
+   FT_unlockHeld(oFT, oNParent);
+   FT_freeDetached(oFT, oNFound, ulNodes);
+
+   /* assert(CheckerFT_isValid(oFT)); */ 
+   return SUCCESS;
+}
+
+/*
+  Finds the directory that would be the parent of well-formed path
+  pcPath, which has at least two components, storing it in
+  *poNParent. Returns SUCCESS, or the status of FT_findNode for the
+  parent's path, or NOT_A_DIRECTORY if that path is a file, or
+  MEMORY_ERROR if memory could not be allocated for it.
+*/
+static int FT_findParent(FT_T oFT, const char *pcPath,
+                         Node_T *poNParent) {
+   char *pcParent;
+   size_t ulLength;
+   int iStatus;
+
+   assert(oFT != NULL);
+   assert(pcPath != NULL);
+   assert(poNParent != NULL);
+
+   ulLength = (size_t) (strrchr(pcPath, '/') - pcPath);
+   pcParent = malloc(ulLength + 1);
+   if(pcParent == NULL)
+      return MEMORY_ERROR;
+   memcpy(pcParent, pcPath, ulLength);
+   pcParent[ulLength] = '\0';
+   iStatus = FT_findNode(oFT, pcParent, poNParent);
+   free(pcParent);
+   if(iStatus == SUCCESS && NodeFT_isFile(*poNParent))
+      return NOT_A_DIRECTORY;
+   return iStatus;
+}
+
+/*
+  The body of FT_moveIn, called with oFT held exclusively. The subtree
+  is relinked whole, so its size matters only to the index, which
+  files every node under its absolute path: the moved paths are filed
+  under their new paths before the relink and unfiled from their old
+  ones after, so a failure at any step leaves oFT as it was.
+*/
+static int FT_moveUnlocked(FT_T oFT, const char *pcFrom,
+                           const char *pcTo) {
+   int iStatus;
+   Node_T oNFrom = NULL;
+   Node_T oNTo = NULL;
+   Node_T oNNewParent = NULL;
+   const char *pcName;
+   const char *pcFromName;
+   size_t ulFromLength;
+   size_t ulToHash;
+
+   assert(oFT != NULL);
+   assert(pcFrom != NULL);
+   assert(pcTo != NULL);
+
+   /* copy what a snapshot shares before finding anything: both
+      parents, and the moved node itself if its name changes */
+   pcName = strrchr(pcTo, '/');
+   pcName = (pcName == NULL) ? pcTo : pcName + 1;
+   pcFromName = strrchr(pcFrom, '/');
+   pcFromName = (pcFromName == NULL) ? pcFrom : pcFromName + 1;
+   iStatus = FT_ownPath(oFT, pcFrom,
+                        (boolean) (strcmp(pcName, pcFromName) != 0));
+   if(iStatus == SUCCESS)
+      iStatus = FT_ownPath(oFT, pcTo, FALSE);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   iStatus = FT_findNode(oFT, pcFrom, &oNFrom);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   if(!FT_isWellFormed(pcTo))
+      return BAD_PATH;
+
+   /* a subtree cannot move beneath itself */
+   ulFromLength = strlen(pcFrom);
+   if(!strncmp(pcTo, pcFrom, ulFromLength) && pcTo[ulFromLength] == '/')
+      return CONFLICTING_PATH;
+
+   pcName = strrchr(pcTo, '/');
+   if(pcName == NULL) {
+      /* only the root may take a one-component path: renaming it */
+      if(oNFrom != oFT->oNRoot)
+         return CONFLICTING_PATH;
+      if(!strcmp(pcTo, pcFrom))
+         return ALREADY_IN_TREE;
+      pcName = pcTo;
+   }
+   else {
+      iStatus = FT_findNode(oFT, pcTo, &oNTo);
+      if(iStatus == SUCCESS)
+         return ALREADY_IN_TREE;
+      if(iStatus != NO_SUCH_PATH)
+         return iStatus;
+      iStatus = FT_findParent(oFT, pcTo, &oNNewParent);
+      if(iStatus != SUCCESS)
+         return iStatus;
+      pcName++;
+   }
+
+   ulToHash = HashTable_hash(HASHTABLE_SEED, pcTo, strlen(pcTo));
+   if(oFT->oHIndex != NULL) {
+      FT_lockIndex(oFT, TRUE);
+      iStatus = FT_indexSubtree(oFT, oNFrom, ulToHash);
+      if(iStatus != SUCCESS) {
+         FT_unindexSubtree(oFT, oNFrom, ulToHash);
+         FT_unlockIndex(oFT);
+         return iStatus;
+      }
+      FT_unlockIndex(oFT);
+   }
+
+   iStatus = NodeFT_relink(oNFrom, oNNewParent, pcName, strlen(pcName));
+
+   if(oFT->oHIndex != NULL) {
+      FT_lockIndex(oFT, TRUE);
+      if(iStatus == SUCCESS)
+         FT_unindexSubtree(oFT, oNFrom,
+                HashTable_hash(HASHTABLE_SEED, pcFrom, ulFromLength));
+      else
+         FT_unindexSubtree(oFT, oNFrom, ulToHash);
+      FT_unlockIndex(oFT);
+   }
+   return iStatus;
+}
+
+/* --------------------------------------------------------------------
+
+  A journaled FT logs each change while still locked for it, so that
+  records come in the order that the changes were made, and waits for
+  the record to be durable only once unlocked, so that changes made
+  meanwhile by other threads are written out by the same fsync. A
+  checkpoint saves the whole tree, with contents, tagged with a new
+  generation, and then empties the journal; recovery replays the
+  journal over the checkpoint only if it follows that generation.
+*/
+
+/*
+  Logs the change of kind iKind to pcPath that oFT has just made, with
+  pcOther, pvContents and ulLength as struct JournalRecord describes,
+  and sets *pulSequence to its number for FT_commitChange. If oFT is
+  not journaled, only sets *pulSequence to 0. Returns SUCCESS, or the
+  status with which oFT's journal has failed.
+*/
+static int FT_logChange(FT_T oFT, int iKind, const char *pcPath,
+                        const char *pcOther, void *pvContents,
+                        size_t ulLength, size_t *pulSequence) {
+   struct JournalRecord sRecord;
+
+   assert(oFT != NULL);
+   assert(pcPath != NULL);
+   assert(pulSequence != NULL);
+
+   *pulSequence = 0;
+   if(oFT->oJournal == NULL)
+      return SUCCESS;
+
+   sRecord.iKind = iKind;
+   sRecord.pcPath = pcPath;
+   sRecord.pcOther = pcOther;
+   sRecord.pvContents = pvContents;
+   sRecord.ulLength = ulLength;
+   return Journal_log(oFT->oJournal, &sRecord, pulSequence);
+}
+
+/*
+  Waits, with oFT unlocked, until the record that FT_logChange
+  numbered ulSequence is durable. Returns SUCCESS, or the status with
+  which oFT's journal failed first.
+*/
+static int FT_commitChange(FT_T oFT, size_t ulSequence) {
+   assert(oFT != NULL);
+
+   if(ulSequence == 0)
+      return SUCCESS;
+   return Journal_commit(oFT->oJournal, ulSequence);
+}
+
+/*
+  Checkpoints oFT, which is journaled and locked for a whole-tree
+  change: saves the tree, with contents, to a temporary file tagged
+  with the next generation, makes it durable, renames it over the
+  checkpoint file, and begins the journal again as following that
+  generation. A crash between any two steps leaves a checkpoint and a
+  journal that recover the same tree. Returns SUCCESS, or IO_ERROR if
+  a file could not be written, or MEMORY_ERROR if memory could not be
+  allocated.
+*/
+static int FT_checkpointUnlocked(FT_T oFT) {
+   size_t ulGeneration;
+   size_t ulLength;
+   int iStatus;
+
+   assert(oFT != NULL);
+   assert(oFT->oJournal != NULL);
+
+   ulGeneration = Journal_getGeneration(oFT->oJournal) + 1;
+   iStatus = FT_saveReplacing(oFT, oFT->pcCheckpointFile, TRUE,
+                              ulGeneration, TRUE, &ulLength);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   return Journal_reset(oFT->oJournal, ulGeneration);
+}
+
+/* The state of a recovery, for FT_replayChange */
+struct FT_replay {
+   /* the FT being recovered */
+   FT_T oFT;
+   /* SUCCESS, or MEMORY_ERROR once a record could not be applied */
+   int iStatus;
+};
+
+/*
+  Applies *psRecord, which Journal_replay read, to the FT of pvReplay,
+  a struct FT_replay, unless an earlier record failed. Every file's
+  contents in a recovered tree are blocks from malloc, so those that
+  the record removes or replaces are freed, as are its own if they go
+  unused. Since only changes that succeeded are logged, a record
+  fails only for want of memory.
+*/
+static void FT_replayChange(struct JournalRecord *psRecord,
+                            void *pvReplay) {
+   struct FT_replay *psReplay = pvReplay;
+   FT_T oFT;
+   Node_T oNFound = NULL;
+   int iStatus = SUCCESS;
+
+   assert(psRecord != NULL);
+   assert(psReplay != NULL);
+
+   oFT = psReplay->oFT;
+   if(psReplay->iStatus != SUCCESS) {
+      free(psRecord->pvContents);
+      return;
+   }
+
+   switch(psRecord->iKind) {
+      case JOURNAL_INSERT_DIR:
+         iStatus = FT_insertDirUnlocked(oFT, psRecord->pcPath);
+         break;
+      case JOURNAL_INSERT_FILE:
+         iStatus = FT_insertFileUnlocked(oFT, psRecord->pcPath,
+                                         psRecord->pvContents,
+                                         psRecord->ulLength);
+         if(iStatus != SUCCESS)
+            free(psRecord->pvContents);
+         break;
+      case JOURNAL_RM_DIR:
+      case JOURNAL_RM_FILE:
+         if(FT_findNode(oFT, psRecord->pcPath, &oNFound) != SUCCESS ||
+            NodeFT_isFile(oNFound) !=
+            (boolean) (psRecord->iKind == JOURNAL_RM_FILE))
+            break;
+         FT_freeSubtreeContents(oNFound);
+         if(psRecord->iKind == JOURNAL_RM_FILE)
+            iStatus = FT_rmFileUnlocked(oFT, psRecord->pcPath);
+         else
+            iStatus = FT_rmDirUnlocked(oFT, psRecord->pcPath);
+         break;
+      case JOURNAL_REPLACE_CONTENTS:
+         /* nothing else runs during recovery, so no lock is needed */
+         if(FT_findNode(oFT, psRecord->pcPath, &oNFound) == SUCCESS &&
+            NodeFT_isFile(oNFound))
+            free(NodeFT_setFile(oNFound, psRecord->pvContents,
+                                psRecord->ulLength));
+         else
+            free(psRecord->pvContents);
+         break;
+      case JOURNAL_MOVE:
+         iStatus = FT_moveUnlocked(oFT, psRecord->pcPath,
+                                   psRecord->pcOther);
+         break;
+      default:
+         assert(FALSE);
+   }
+   if(iStatus == MEMORY_ERROR)
+      psReplay->iStatus = iStatus;
+}
+
+/*
+  Empties oFT, which is locked for a whole-tree change, after its
+  recovery failed partway, freeing the contents of the files
+  recovered so far.
+*/
+static void FT_discardRecovered(FT_T oFT) {
+   Node_T oNRoot;
+   size_t ulNodes;
+
+   assert(oFT != NULL);
+
+   oNRoot = oFT->oNRoot;
+   if(oNRoot == NULL)
+      return;
+   FT_freeSubtreeContents(oNRoot);
+   __atomic_store_n(&oFT->oNRoot, NULL, __ATOMIC_RELEASE);
+   if(oFT->oHIndex != NULL) {
+      FT_lockIndex(oFT, TRUE);
+      FT_unindexSubtree(oFT, oNRoot, FT_hashNode(oNRoot, 0));
+      FT_unlockIndex(oFT);
+   }
+   ulNodes = NodeFT_detach(oNRoot);
+   FT_subtractCount(oFT, ulNodes);
+   FT_freeDetached(oFT, oNRoot, ulNodes);
+}
+
+/*
+  Rebuilds oFT, which is empty and locked for a whole-tree change,
+  from its checkpoint file, if there is one, and the records of its
+  journal file that follow that checkpoint, and opens the journal for
+  logging after them. Returns SUCCESS, or otherwise leaves oFT empty,
+  with no journal open, and returns status:
+  * IO_ERROR if a file could not be read or written, or the
+             checkpoint is damaged
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+static int FT_recover(FT_T oFT) {
+   struct FT_replay sReplay;
+   FILE *psFile;
+   size_t ulGeneration = 0;
+   size_t ulLength = 0;
+   int iStatus;
+
+   assert(oFT != NULL);
+   assert(oFT->oNRoot == NULL);
+   assert(oFT->oJournal == NULL);
+
+   /* with no checkpoint yet, the journal holds the whole tree */
+   psFile = fopen(oFT->pcCheckpointFile, "rb");
+   if(psFile == NULL && errno != ENOENT)
+      return IO_ERROR;
+   if(psFile != NULL) {
+      (void) fclose(psFile);
+      iStatus = FT_loadUnlocked(oFT, oFT->pcCheckpointFile,
+                                &ulGeneration);
+      if(iStatus != SUCCESS)
+         return iStatus;
+   }
+
+   sReplay.oFT = oFT;
+   sReplay.iStatus = SUCCESS;
+   iStatus = Journal_replay(oFT->pcJournalFile, ulGeneration,
+                            FT_replayChange, &sReplay, &ulLength);
+   if(iStatus == NO_SUCH_PATH) {
+      iStatus = SUCCESS;
+      ulLength = 0;
+   }
+   if(iStatus == SUCCESS)
+      iStatus = sReplay.iStatus;
+   if(iStatus == SUCCESS)
+      iStatus = Journal_open(oFT->pcJournalFile, ulGeneration, ulLength,
+                             &oFT->oJournal);
+   if(iStatus != SUCCESS)
+      FT_discardRecovered(oFT);
+   return iStatus;
+}
+
+/*
+  Closes oFT's journal, if it has one, and frees the names of its
+  checkpoint and journal files if bForget. Returns SUCCESS, or the
+  status with which the journal has failed.
+*/
+static int FT_closeJournal(FT_T oFT, boolean bForget) {
+   int iStatus = SUCCESS;
+
+   assert(oFT != NULL);
+
+   if(oFT->oJournal != NULL) {
+      iStatus = Journal_close(oFT->oJournal);
+      oFT->oJournal = NULL;
+   }
+   if(bForget) {
+      free(oFT->pcCheckpointFile);
+      free(oFT->pcJournalFile);
+      oFT->pcCheckpointFile = NULL;
+      oFT->pcJournalFile = NULL;
+   }
+   return iStatus;
+}
+
+/*
+  Frees every node of oFT and its index, leaving it empty. The nodes
+  of a large tree are freed by the reclamation thread, and those from
+  an arena by emptying it, without visiting them.
+*/
+static void FT_clear(FT_T oFT) {
+   Node_T oNRoot;
+   size_t ulNodes;
+
+   assert(oFT != NULL);
+   /* a snapshot still to be released would outlive its source */
+   assert(oFT->ulSnapshots == 0);
+
+   if(oFT->oNRoot) {
+      oNRoot = oFT->oNRoot;
+      oFT->oNRoot = NULL;
+      ulNodes = NodeFT_detach(oNRoot);
+      FT_subtractCount(oFT, ulNodes);
+      FT_freeDetached(oFT, oNRoot, ulNodes);
+   }
+   if(oFT->oHIndex != NULL) {
+      HashTable_free(oFT->oHIndex);
+      oFT->oHIndex = NULL;
+   }
+   if(oFT->oArena != NULL)
+      Arena_clear(oFT->oArena);
+}
+
+/* Destroy the locks that FT_setSynchronizedIn created for oFT */
+static void FT_destroyLocks(FT_T oFT) {
+   assert(oFT != NULL);
+
+   (void) pthread_rwlock_destroy(&oFT->sChangeLock);
+   (void) pthread_rwlock_destroy(&oFT->sIndexLock);
+   (void) pthread_rwlock_destroy(&oFT->sRootLock);
+   (void) pthread_rwlock_destroy(&oFT->sLock);
+}
+
+FT_T FT_new(void) {
+   FT_T oFT;
+
+   oFT = malloc(sizeof(struct FT));
+   if(oFT == NULL)
+      return NULL;
+
+   oFT->bIsInitialized = TRUE;
+   oFT->oNRoot = NULL;
+   oFT->ulCount = 0;
+   oFT->oHIndex = NULL;
+   oFT->bSynchronized = FALSE;
+   oFT->bLockFree = FALSE;
+   oFT->ulBegun = 0;
+   oFT->ulEnded = 0;
+   oFT->ulThreads = 1;
+   oFT->oSource = NULL;
+   oFT->ulSnapshots = 0;
+   oFT->oImage = NULL;
+   oFT->oJournal = NULL;
+   oFT->pcCheckpointFile = NULL;
+   oFT->pcJournalFile = NULL;
+   oFT->oArena = NULL;
+
+   return oFT;
+}
+
+void FT_free(FT_T oFT) {
+   assert(oFT != NULL);
+   assert(oFT != &sDefault);
+   assert(oFT->oSource == NULL);
+   assert(oFT->oImage == NULL);
+
+   (void) FT_closeJournal(oFT, TRUE);
+   FT_clear(oFT);
+   Arena_free(oFT->oArena);
+   if(oFT->bSynchronized)
+      FT_destroyLocks(oFT);
+   free(oFT);
+}
+
+int FT_init(void) {
+   int iStatus;
+
+   if(sDefault.bIsInitialized)
+      return INITIALIZATION_ERROR;
+
+   sDefault.bIsInitialized = TRUE;
+   sDefault.oNRoot = NULL;
+   sDefault.ulCount = 0;
+   sDefault.oHIndex = NULL;
+   sDefault.bSynchronized = FALSE;
+   sDefault.bLockFree = FALSE;
+   sDefault.ulBegun = 0;
+   sDefault.ulEnded = 0;
+   sDefault.ulThreads = 1;
+   sDefault.oSource = NULL;
+   sDefault.ulSnapshots = 0;
+   sDefault.oImage = NULL;
+   sDefault.oJournal = NULL;
+
+   if(sDefault.pcCheckpointFile != NULL) {
+      iStatus = FT_recover(&sDefault);
+      if(iStatus != SUCCESS) {
+         sDefault.bIsInitialized = FALSE;
+         return iStatus;
+      }
+   }
+
+   return SUCCESS;
+}
+
+int FT_destroy(void) {
+
+   if(!sDefault.bIsInitialized)
+      return INITIALIZATION_ERROR;
+
+   /* every change has been committed, or failed to be, already */
+   (void) FT_closeJournal(&sDefault, FALSE);
+   FT_clear(&sDefault);
+   if(sDefault.bSynchronized) {
+      FT_destroyLocks(&sDefault);
+      sDefault.bSynchronized = FALSE;
+      sDefault.bLockFree = FALSE;
+   }
+   sDefault.bIsInitialized = FALSE;
+
+   return SUCCESS;
+}
+
+
+FT_T FT_snapshotIn(FT_T oFT) {
+   FT_T oFTSnapshot;
+
+   assert(oFT != NULL);
+
+   if(!oFT->bIsInitialized || oFT->oSource != NULL)
+      return NULL;
+   oFTSnapshot = malloc(sizeof(struct FT));
+   if(oFTSnapshot == NULL)
+      return NULL;
+
+   /* no change is under way while the lock is held exclusively */
+   if(oFT->bSynchronized)
+      (void) pthread_rwlock_wrlock(&oFT->sLock);
+   oFTSnapshot->bIsInitialized = TRUE;
+   oFTSnapshot->oNRoot = oFT->oNRoot;
+   oFTSnapshot->ulCount = oFT->ulCount;
+   oFTSnapshot->oHIndex = NULL;
+   oFTSnapshot->bSynchronized = FALSE;
+   oFTSnapshot->bLockFree = FALSE;
+   oFTSnapshot->ulBegun = 0;
+   oFTSnapshot->ulEnded = 0;
+   oFTSnapshot->ulThreads = oFT->ulThreads;
+   oFTSnapshot->oSource = oFT;
+   oFTSnapshot->ulSnapshots = 0;
+   oFTSnapshot->oImage = NULL;
+   oFTSnapshot->oJournal = NULL;
+   oFTSnapshot->pcCheckpointFile = NULL;
+   oFTSnapshot->pcJournalFile = NULL;
+   oFTSnapshot->oArena = NULL;
+   if(oFT->oNRoot != NULL)
+      NodeFT_retain(oFT->oNRoot);
+   (void) __atomic_add_fetch(&oFT->ulSnapshots, 1, __ATOMIC_RELEASE);
+   if(oFT->bSynchronized)
+      (void) pthread_rwlock_unlock(&oFT->sLock);
+
+   return oFTSnapshot;
+}
+
+FT_T FT_snapshot(void) {
+   return FT_snapshotIn(&sDefault);
+}
+
+void FT_snapshotRelease(FT_T oFTSnapshot) {
+   if(oFTSnapshot == NULL)
+      return;
+   assert(oFTSnapshot->oSource != NULL);
+
+   /* lock-free lookups in the source may still be reading nodes that
+      only the snapshot kept */
+   if(oFTSnapshot->oNRoot != NULL) {
+      while(!Epoch_beginRetire())
+         (void) sched_yield();
+      (void) NodeFT_free(oFTSnapshot->oNRoot);
+      Epoch_endRetire();
+   }
+   (void) __atomic_sub_fetch(&oFTSnapshot->oSource->ulSnapshots, 1,
+                             __ATOMIC_RELEASE);
+   free(oFTSnapshot);
+}
+
+int FT_openImage(const char *pcFile, FT_T *poFTImage) {
+   FT_T oFTImage;
+   int iStatus;
+
+   assert(pcFile != NULL);
+   assert(poFTImage != NULL);
+
+   *poFTImage = NULL;
+   oFTImage = FT_new();
+   if(oFTImage == NULL)
+      return MEMORY_ERROR;
+   iStatus = TreeImage_open(pcFile, &oFTImage->oImage);
+   if(iStatus != SUCCESS) {
+      FT_free(oFTImage);
+      return iStatus;
+   }
+   oFTImage->bIsInitialized = FALSE;
+
+   *poFTImage = oFTImage;
+   return SUCCESS;
+}
+
+void FT_closeImage(FT_T oFTImage) {
+   if(oFTImage == NULL)
+      return;
+   assert(oFTImage->oImage != NULL);
+
+   TreeImage_close(oFTImage->oImage);
+   free(oFTImage);
+}
+
+size_t FT_getPendingReclaim(void) {
+   return Reclaim_getPending();
+}
+
+void FT_waitReclaim(void) {
+   Reclaim_wait();
+}
+
+/* The body of FT_setIndexedIn, called with oFT locked as needed */
+static int FT_setIndexedUnlocked(FT_T oFT, boolean bIndexed) {
+   HashTable_T oHIndex;
+   int iStatus;
+
+   assert(oFT != NULL);
+
+   if(!oFT->bIsInitialized)
+      return INITIALIZATION_ERROR;
+
+   oHIndex = oFT->oHIndex;
+   if(!bIndexed) {
+      if(oHIndex != NULL) {
+         __atomic_store_n(&oFT->oHIndex, NULL, __ATOMIC_RELEASE);
+         HashTable_free(oHIndex);
+      }
+      return SUCCESS;
+   }
+
+   if(oHIndex != NULL)
+      return SUCCESS;
+
+   oHIndex = HashTable_new();
+   if(oHIndex == NULL)
+      return MEMORY_ERROR;
+   __atomic_store_n(&oFT->oHIndex, oHIndex, __ATOMIC_RELEASE);
+   if(oFT->oNRoot != NULL) {
+      iStatus = FT_indexSubtree(oFT, oFT->oNRoot,
+                                FT_hashNode(oFT->oNRoot, 0));
+      if(iStatus != SUCCESS) {
+         __atomic_store_n(&oFT->oHIndex, NULL, __ATOMIC_RELEASE);
+         HashTable_free(oHIndex);
+         return iStatus;
+      }
+   }
+   return SUCCESS;
+}
+
+
+/* --------------------------------------------------------------------
+
+  The following auxiliary functions are used for generating the
+  string representation of the ft.
+*/
+
+/* The state of one serialization of the ft */
+struct FT_writer {
+   /* the absolute path of the node being visited, followed by room
+      for a newline; not '\0'-terminated */
+   char *pcPath;
+   /* the number of characters pcPath can hold */
+   size_t ulPhysLength;
+   /* the client's sink, and the extra argument to pass it */
+   int (*pfWrite)(const char *pcChunk, size_t ulLength, void *pvExtra);
+   void *pvExtra;
+};
+
+/*
+  Makes sure psWriter->pcPath can hold at least ulLength characters,
+  keeping its contents. Returns SUCCESS, or MEMORY_ERROR if memory
+  could not be allocated.
+*/
+static int FT_reserve(struct FT_writer *psWriter, size_t ulLength) {
+   size_t ulNewLength;
+   char *pcNew;
+
+   assert(psWriter != NULL);
+
+   if(ulLength <= psWriter->ulPhysLength)
+      return SUCCESS;
+   ulNewLength = 2 * psWriter->ulPhysLength;
+   if(ulNewLength < ulLength)
+      ulNewLength = ulLength;
+   pcNew = realloc(psWriter->pcPath, ulNewLength);
+   if(pcNew == NULL)
+      return MEMORY_ERROR;
+   psWriter->pcPath = pcNew;
+   psWriter->ulPhysLength = ulNewLength;
+   return SUCCESS;
+}
+
+/*
+  Appends "/" and the name of oNChild to the ulLength-character path
+  in psWriter. Sets *pulNewLength to the length of the child's path.
+  Returns SUCCESS, or MEMORY_ERROR if memory could not be allocated.
+*/
+static int FT_appendName(struct FT_writer *psWriter, size_t ulLength,
+                         Node_T oNChild, size_t *pulNewLength) {
+   const char *pcName;
+   size_t ulNameLength;
+   int iStatus;
+
+   assert(psWriter != NULL);
+   assert(oNChild != NULL);
+   assert(pulNewLength != NULL);
+
+   pcName = NodeFT_getName(oNChild);
+   ulNameLength = strlen(pcName);
+   /* leave room for the newline too */
+   iStatus = FT_reserve(psWriter, ulLength + 1 + ulNameLength + 1);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   psWriter->pcPath[ulLength] = '/';
+   memcpy(psWriter->pcPath + ulLength + 1, pcName, ulNameLength);
+   *pulNewLength = ulLength + 1 + ulNameLength;
+   return SUCCESS;
+}
+
+/*
+  Hands the ulLength-character path in psWriter, followed by a
+  newline, to the client's sink. The caller has already reserved room
+  for the newline. Returns the sink's status.
+*/
+static int FT_emit(struct FT_writer *psWriter, size_t ulLength) {
+   assert(psWriter != NULL);
+   assert(ulLength < psWriter->ulPhysLength);
+
+   psWriter->pcPath[ulLength] = '\n';
+   return (*psWriter->pfWrite)(psWriter->pcPath, ulLength + 1,
+                               psWriter->pvExtra);
+}
+
+/*
+  Emits the path of oNNode, whose ulLength-character path is already
+  in psWriter, followed by the paths of its file children in the
+  order of the children array. Returns SUCCESS, or the first status
+  other than SUCCESS from allocation or from the sink.
+*/
+static int FT_writeHead(struct FT_writer *psWriter, Node_T oNNode,
+                        size_t ulLength) {
+   size_t c;
+   size_t ulChildLength;
+   Node_T oNChild = NULL;
+   int iStatus;
+
+   assert(psWriter != NULL);
+   assert(oNNode != NULL);
+
+   iStatus = FT_emit(psWriter, ulLength);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   for(c = 0; c < NodeFT_getNumFileChildren(oNNode); c++) {
+      iStatus = NodeFT_getFileChild(oNNode, c, &oNChild);
+      assert(iStatus == SUCCESS);
+      iStatus = FT_appendName(psWriter, ulLength, oNChild,
+                              &ulChildLength);
+      if(iStatus != SUCCESS)
+         return iStatus;
+      iStatus = FT_emit(psWriter, ulChildLength);
+      if(iStatus != SUCCESS)
+         return iStatus;
+   }
+   return SUCCESS;
+}
+
+/*
+  Performs a pre-order traversal of the tree rooted at oNNode, whose
+  ulLength-character path is already in psWriter, emitting each
+  node's path: files before directories at each level, and each kind
+  in the order of the children arrays. Returns SUCCESS, or the first
+  status other than SUCCESS from allocation or from the sink.
+*/
+static int FT_writeSubtree(struct FT_writer *psWriter, Node_T oNNode,
+                           size_t ulLength) {
+   size_t c;
+   size_t ulChildLength;
+   Node_T oNChild = NULL;
+   int iStatus;
+
+   assert(psWriter != NULL);
+   assert(oNNode != NULL);
+
+   iStatus = FT_writeHead(psWriter, oNNode, ulLength);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   for(c = 0; c < NodeFT_getNumDirectoryChildren(oNNode); c++) {
+      iStatus = NodeFT_getDirectoryChild(oNNode, c, &oNChild);
+      assert(iStatus == SUCCESS);
+      iStatus = FT_appendName(psWriter, ulLength, oNChild,
+                              &ulChildLength);
+      if(iStatus != SUCCESS)
+         return iStatus;
+      iStatus = FT_writeSubtree(psWriter, oNChild, ulChildLength);
+      if(iStatus != SUCCESS)
+         return iStatus;
+   }
+   return SUCCESS;
+}
+
+/*
+  Sink for FT_writeTo: writes the ulLength characters at pcChunk to
+  the stream pvStream.
+*/
+static int FT_writeToStream(const char *pcChunk, size_t ulLength,
+                            void *pvStream) {
+   assert(pcChunk != NULL);
+   assert(pvStream != NULL);
+
+   if(fwrite(pcChunk, 1, ulLength, (FILE *) pvStream) != ulLength)
+      return IO_ERROR;
+   return SUCCESS;
+}
+
+/*
+  Sink for FT_toString's first pass: adds ulLength to the total at
+  pvTotal.
+*/
+static int FT_measure(const char *pcChunk, size_t ulLength,
+                      void *pvTotal) {
+   assert(pvTotal != NULL);
+   (void) pcChunk;
+
+   *(size_t *) pvTotal += ulLength;
+   return SUCCESS;
+}
+
+/*
+  Sink for FT_toString's second pass: copies the ulLength characters
+  at pcChunk to the cursor at *pvCursor and advances the cursor.
+*/
+static int FT_copy(const char *pcChunk, size_t ulLength,
+                   void *pvCursor) {
+   assert(pcChunk != NULL);
+   assert(pvCursor != NULL);
+
+   memcpy(*(char **) pvCursor, pcChunk, ulLength);
+   *(char **) pvCursor += ulLength;
+   return SUCCESS;
+}
+
+/*
+  FT_toString in parallel splits the tree into segments, in the order
+  the string lists them: each directory above a certain depth
+  contributes its own line and its files' lines as one segment, and
+  each directory at that depth its whole subtree as another. Worker
+  threads claim segments in turn, first measuring each, then, once a
+  prefix sum of the lengths gives every segment its offset, copying
+  each straight into its place in the result.
+*/
+
+/* The number of segments to aim for per thread, so that threads
+   that draw small subtrees can go on to claim others */
+enum { SEGMENTS_PER_THREAD = 8 };
+
+/* The deepest level at which the tree is split into segments */
+enum { MAX_SPLIT_DEPTH = 16 };
+
+/* One segment of a parallel serialization */
+struct FT_segment {
+   /* the directory at the top of the segment */
+   Node_T oNNode;
+   /* the index of the segment of oNNode's parent, or of this segment
+      if oNNode is the root; a snapshot's nodes cannot be relied on
+      to lead back to their parents */
+   size_t ulParent;
+   /* TRUE if the segment is oNNode's whole subtree, or FALSE if it is
+      only oNNode and its files */
+   boolean bWhole;
+   /* the segment's length, once measured, and then its offset in the
+      result */
+   size_t ulOffset;
+};
+
+/* The state of one parallel serialization, shared by its workers */
+struct FT_parallel {
+   /* the segments, in order */
+   struct FT_segment *psSegments;
+   /* the number of segments, and the room for them */
+   size_t ulNumSegments;
+   size_t ulPhysLength;
+   /* the next segment to claim, taken atomically */
+   size_t ulNext;
+   /* the result to copy into, or NULL while measuring */
+   char *pcResult;
+   /* SUCCESS, or a worker's failure status */
+   int iStatus;
+};
+
+/*
+  Returns the number of directories ulDepth levels beneath oNNode, a
+  directory.
+*/
+static size_t FT_countLevel(Node_T oNNode, size_t ulDepth) {
+   Node_T oNChild = NULL;
+   size_t ulCount = 0;
+   size_t c;
+
+   assert(oNNode != NULL);
+
+   if(ulDepth == 0)
+      return 1;
+   for(c = 0; c < NodeFT_getNumDirectoryChildren(oNNode); c++) {
+      (void) NodeFT_getDirectoryChild(oNNode, c, &oNChild);
+      ulCount += FT_countLevel(oNChild, ulDepth - 1);
+   }
+   return ulCount;
+}
+
+/*
+  Appends the segments for the subtree rooted at oNNode to
+  psParallel, splitting it down to ulDepth levels beneath oNNode,
+  whose parent's segment is the ulParent'th (or which is the root if
+  ulParent is the index its own segment will take). Returns SUCCESS,
+  or MEMORY_ERROR if memory could not be allocated.
+*/
+static int FT_addSegments(struct FT_parallel *psParallel,
+                          Node_T oNNode, size_t ulDepth,
+                          size_t ulParent) {
+   struct FT_segment *psGrown;
+   Node_T oNChild = NULL;
+   size_t ulSegment;
+   size_t c;
+   int iStatus;
+
+   assert(psParallel != NULL);
+   assert(oNNode != NULL);
+
+   if(psParallel->ulNumSegments == psParallel->ulPhysLength) {
+      psGrown = realloc(psParallel->psSegments,
+                        (psParallel->ulPhysLength * 2 + 16) *
+                        sizeof(struct FT_segment));
+      if(psGrown == NULL)
+         return MEMORY_ERROR;
+      psParallel->psSegments = psGrown;
+      psParallel->ulPhysLength = psParallel->ulPhysLength * 2 + 16;
+   }
+   ulSegment = psParallel->ulNumSegments;
+   psParallel->psSegments[ulSegment].oNNode = oNNode;
+   psParallel->psSegments[ulSegment].ulParent = ulParent;
+   psParallel->psSegments[ulSegment].bWhole = (boolean) (ulDepth == 0);
+   psParallel->ulNumSegments++;
+   if(ulDepth == 0)
+      return SUCCESS;
+
+   for(c = 0; c < NodeFT_getNumDirectoryChildren(oNNode); c++) {
+      (void) NodeFT_getDirectoryChild(oNNode, c, &oNChild);
+      iStatus = FT_addSegments(psParallel, oNChild, ulDepth - 1,
+                               ulSegment);
+      if(iStatus != SUCCESS)
+         return iStatus;
+   }
+   return SUCCESS;
+}
+
+/*
+  Writes the absolute path of the directory at the top of the
+  ulSegment'th segment of psParallel into psWriter, from the names
+  along the chain of parent segments, and returns its length in
+  *pulLength. Returns SUCCESS, or MEMORY_ERROR if memory could not be
+  allocated.
+*/
+static int FT_segmentPath(struct FT_parallel *psParallel,
+                          size_t ulSegment, struct FT_writer *psWriter,
+                          size_t *pulLength) {
+   const char *pcName;
+   size_t ulNameLength;
+   size_t ulLength = 0;
+   size_t ul;
+   int iStatus;
+
+   assert(psParallel != NULL);
+   assert(psWriter != NULL);
+   assert(pulLength != NULL);
+
+   /* measure, then fill in from the end back */
+   for(ul = ulSegment; ; ul = psParallel->psSegments[ul].ulParent) {
+      pcName = NodeFT_getName(psParallel->psSegments[ul].oNNode);
+      ulLength += strlen(pcName);
+      if(psParallel->psSegments[ul].ulParent == ul)
+         break;
+      ulLength++;
+   }
+   /* leave room for the newline too */
+   iStatus = FT_reserve(psWriter, ulLength + 1);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   *pulLength = ulLength;
+   for(ul = ulSegment; ; ul = psParallel->psSegments[ul].ulParent) {
+      pcName = NodeFT_getName(psParallel->psSegments[ul].oNNode);
+      ulNameLength = strlen(pcName);
+      ulLength -= ulNameLength;
+      memcpy(psWriter->pcPath + ulLength, pcName, ulNameLength);
+      if(psParallel->psSegments[ul].ulParent == ul)
+         break;
+      psWriter->pcPath[--ulLength] = '/';
+   }
+   return SUCCESS;
+}
+
+/*
+  Worker for a parallel serialization: claims segments of the struct
+  FT_parallel at pvParallel until none remain, measuring each or, if
+  there is a result to copy into, copying it there. Returns NULL.
+*/
+static void *FT_writeSegments(void *pvParallel) {
+   struct FT_parallel *psParallel = pvParallel;
+   struct FT_segment *psSegment;
+   struct FT_writer sWriter;
+   size_t ulLength;
+   size_t ulTotal;
+   char *pcCursor;
+   size_t ul;
+   int iStatus;
+
+   assert(pvParallel != NULL);
+
+   sWriter.pcPath = NULL;
+   sWriter.ulPhysLength = 0;
+   for(;;) {
+      ul = __atomic_fetch_add(&psParallel->ulNext, 1, __ATOMIC_RELAXED);
+      if(ul >= psParallel->ulNumSegments)
+         break;
+      psSegment = &psParallel->psSegments[ul];
+
+      iStatus = FT_segmentPath(psParallel, ul, &sWriter, &ulLength);
+      if(iStatus == SUCCESS) {
+         ulTotal = 0;
+         if(psParallel->pcResult == NULL) {
+            sWriter.pfWrite = FT_measure;
+            sWriter.pvExtra = &ulTotal;
+         }
+         else {
+            pcCursor = psParallel->pcResult + psSegment->ulOffset;
+            sWriter.pfWrite = FT_copy;
+            sWriter.pvExtra = &pcCursor;
+         }
+         if(psSegment->bWhole)
+            iStatus = FT_writeSubtree(&sWriter, psSegment->oNNode,
+                                      ulLength);
+         else
+            iStatus = FT_writeHead(&sWriter, psSegment->oNNode,
+                                   ulLength);
+         if(psParallel->pcResult == NULL)
+            psSegment->ulOffset = ulTotal;
+      }
+      if(iStatus != SUCCESS)
+         __atomic_store_n(&psParallel->iStatus, iStatus,
+                          __ATOMIC_RELAXED);
+   }
+   free(sWriter.pcPath);
+   return NULL;
+}
+
+/*
+  Runs FT_writeSegments over psParallel on the calling thread and up
+  to ulThreads - 1 others, returning once every segment is done.
+  Threads that cannot be created leave more of the work to the rest.
+  Returns psParallel's status.
+*/
+static int FT_runWorkers(struct FT_parallel *psParallel,
+                         size_t ulThreads) {
+   pthread_t *psThreads;
+   size_t ulStarted = 0;
+   size_t ul;
+
+   assert(psParallel != NULL);
+
+   psParallel->ulNext = 0;
+   psThreads = malloc((ulThreads - 1) * sizeof(pthread_t));
+   if(psThreads != NULL)
+      for(; ulStarted < ulThreads - 1; ulStarted++)
+         if(pthread_create(&psThreads[ulStarted], NULL,
+                           FT_writeSegments, psParallel) != 0)
+            break;
+   (void) FT_writeSegments(psParallel);
+   for(ul = 0; ul < ulStarted; ul++)
+      (void) pthread_join(psThreads[ul], NULL);
+   free(psThreads);
+   return psParallel->iStatus;
+}
+
+/*
+  Returns the string representation of oFT's nonempty tree, built by
+  ulThreads threads as described above, or NULL if memory could not
+  be allocated.
+*/
+static char *FT_toStringParallel(FT_T oFT, size_t ulThreads) {
+   struct FT_parallel sParallel;
+   size_t ulDepth;
+   size_t ulTotal = 0;
+   size_t ulLength;
+   size_t ul;
+
+   assert(oFT != NULL);
+   assert(oFT->oNRoot != NULL);
+   assert(ulThreads > 1);
+
+   /* split at the first level with enough directories */
+   for(ulDepth = 1; ulDepth < MAX_SPLIT_DEPTH; ulDepth++)
+      if(FT_countLevel(oFT->oNRoot, ulDepth) >=
+         ulThreads * SEGMENTS_PER_THREAD)
+         break;
+
+   sParallel.psSegments = NULL;
+   sParallel.ulNumSegments = 0;
+   sParallel.ulPhysLength = 0;
+   sParallel.pcResult = NULL;
+   sParallel.iStatus = SUCCESS;
+   if(FT_addSegments(&sParallel, oFT->oNRoot, ulDepth, 0) != SUCCESS ||
+      FT_runWorkers(&sParallel, ulThreads) != SUCCESS) {
+      free(sParallel.psSegments);
+      return NULL;
+   }
+
+   /* turn each segment's length into its offset */
+   for(ul = 0; ul < sParallel.ulNumSegments; ul++) {
+      ulLength = sParallel.psSegments[ul].ulOffset;
+      sParallel.psSegments[ul].ulOffset = ulTotal;
+      ulTotal += ulLength;
+   }
+
+   sParallel.pcResult = malloc(ulTotal + 1);
+   if(sParallel.pcResult == NULL ||
+      FT_runWorkers(&sParallel, ulThreads) != SUCCESS) {
+      free(sParallel.pcResult);
+      free(sParallel.psSegments);
+      return NULL;
+   }
+   sParallel.pcResult[ulTotal] = '\0';
+
+   free(sParallel.psSegments);
+   return sParallel.pcResult;
+}
+/*--------------------------------------------------------------------*/
+
+/* The body of FT_writeChunksIn, called with oFT locked as needed */
+static int FT_writeChunksUnlocked(FT_T oFT,
+                                  int (*pfWrite)(const char *pcChunk,
+                                                 size_t ulLength,
+                                                 void *pvExtra),
+                                  void *pvExtra) {
+   struct FT_writer sWriter;
+   size_t ulLength;
+   int iStatus;
+
+   assert(oFT != NULL);
+   assert(pfWrite != NULL);
+
+   if(!oFT->bIsInitialized)
+      return INITIALIZATION_ERROR;
+   if(oFT->oNRoot == NULL)
+      return SUCCESS;
+
+   sWriter.pcPath = NULL;
+   sWriter.ulPhysLength = 0;
+   sWriter.pfWrite = pfWrite;
+   sWriter.pvExtra = pvExtra;
+
+   ulLength = strlen(NodeFT_getName(oFT->oNRoot));
+   iStatus = FT_reserve(&sWriter, ulLength + 1);
+   if(iStatus == SUCCESS) {
+      memcpy(sWriter.pcPath, NodeFT_getName(oFT->oNRoot), ulLength);
+      iStatus = FT_writeSubtree(&sWriter, oFT->oNRoot, ulLength);
+   }
+   free(sWriter.pcPath);
+   return iStatus;
+}
+
+/* The body of FT_writeToIn, called with oFT locked as needed */
+static int FT_writeToUnlocked(FT_T oFT, FILE *psFile) {
+   assert(oFT != NULL);
+   assert(psFile != NULL);
+
+   return FT_writeChunksUnlocked(oFT, FT_writeToStream, psFile);
+}
+
+/* The body of FT_toStringIn, called with oFT locked as needed */
+static char *FT_toStringUnlocked(FT_T oFT) {
+   size_t ulThreads;
+   size_t totalStrlen = 0;
+   char *result = NULL;
+   char *pcCursor;
+
+   assert(oFT != NULL);
+
+   if(!oFT->bIsInitialized)
+      return NULL;
+
+   ulThreads = __atomic_load_n(&oFT->ulThreads, __ATOMIC_RELAXED);
+   if(ulThreads > 1 && oFT->oNRoot != NULL)
+      return FT_toStringParallel(oFT, ulThreads);
+
+   /* measure first, so the result is allocated exactly once */
+   if(FT_writeChunksUnlocked(oFT, FT_measure, &totalStrlen) != SUCCESS)
+      return NULL;
+
+   result = malloc(totalStrlen + 1);
+   if(result == NULL)
+      return NULL;
+
+   pcCursor = result;
+   if(FT_writeChunksUnlocked(oFT, FT_copy, &pcCursor) != SUCCESS) {
+      free(result);
+      return NULL;
+   }
+   *pcCursor = '\0';
+
+   return result;
+}
+
+/* --------------------------------------------------------------------
+
+  An FTIter_T visits the nodes in the order of FT_toString, but holds
+  no node between calls. It keeps only the kind and path of the last
+  node it returned, which also serve as its token, and each call
+  walks down that path again and steps to the next node. So the FT
+  may change freely between calls, and an iteration resumes from a
+  token just as it does from the iterator that made it.
+*/
+
+/* The state of one iteration */
+struct FTIter {
+   /* the FT being iterated over */
+   FT_T oFT;
+   /* the token: 'F' or 'D' for the kind of the last node returned,
+      followed by its absolute path, or "" before the first node */
+   char *pcToken;
+   /* the number of characters pcToken can hold */
+   size_t ulTokenLength;
+   /* room for the nodes along the token's path, root first */
+   Node_T *aoNStack;
+   /* for an image, the same room for the nodes' offsets instead */
+   size_t *aulImageStack;
+   /* the number of entries the stack in use can hold */
+   size_t ulStackLength;
+};
+
+/*
+  Makes room in psIter for a token whose path has ulLength characters
+  and ulDepth components. Returns SUCCESS, or MEMORY_ERROR if memory
+  could not be allocated, in which case psIter is unchanged.
+*/
+static int FT_iterReserve(struct FTIter *psIter, size_t ulLength,
+                          size_t ulDepth) {
+   char *pcGrown;
+   Node_T *aoNGrown;
+   size_t *aulGrown;
+
+   assert(psIter != NULL);
+
+   if(ulLength + 2 > psIter->ulTokenLength) {
+      pcGrown = realloc(psIter->pcToken, ulLength * 2 + 2);
+      if(pcGrown == NULL)
+         return MEMORY_ERROR;
+      psIter->pcToken = pcGrown;
+      psIter->ulTokenLength = ulLength * 2 + 2;
+   }
+   if(ulDepth > psIter->ulStackLength &&
+      psIter->oFT->oImage != NULL) {
+      aulGrown = realloc(psIter->aulImageStack,
+                         ulDepth * 2 * sizeof(size_t));
+      if(aulGrown == NULL)
+         return MEMORY_ERROR;
+      psIter->aulImageStack = aulGrown;
+      psIter->ulStackLength = ulDepth * 2;
+   }
+   else if(ulDepth > psIter->ulStackLength) {
+      aoNGrown = realloc(psIter->aoNStack,
+                         ulDepth * 2 * sizeof(Node_T));
+      if(aoNGrown == NULL)
+         return MEMORY_ERROR;
+      psIter->aoNStack = aoNGrown;
+      psIter->ulStackLength = ulDepth * 2;
+   }
+   return SUCCESS;
+}
+
+/*
+  Returns the node that follows, in the order of FT_toString, the
+  file (if bIsFile) or directory named by the ulLength characters at
+  pcName, which need not exist, in the directory on top of psBatch's
+  stack. Pops each directory that has nothing left to follow, and
+  returns NULL if the stack empties.
+*/
+static Node_T FT_iterAfter(struct FT_batch *psBatch, const char *pcName,
+                           size_t ulLength, boolean bIsFile) {
+   Node_T oNDir;
+   Node_T oNNext = NULL;
+   size_t ulChild;
+
+   assert(psBatch != NULL);
+   assert(pcName != NULL);
+
+   while(psBatch->ulValid > 0) {
+      oNDir = psBatch->aoNStack[psBatch->ulValid - 1];
+      if(bIsFile) {
+         if(NodeFT_hasFileChildName(oNDir, pcName, ulLength, &ulChild))
+            ulChild++;
+         if(ulChild < NodeFT_getNumFileChildren(oNDir)) {
+            (void) NodeFT_getFileChild(oNDir, ulChild, &oNNext);
+            return oNNext;
+         }
+         /* files come first, so every directory follows */
+         ulChild = 0;
+      }
+      else if(NodeFT_hasDirectoryChildName(oNDir, pcName, ulLength,
+                                           &ulChild))
+         ulChild++;
+      if(ulChild < NodeFT_getNumDirectoryChildren(oNDir)) {
+         (void) NodeFT_getDirectoryChild(oNDir, ulChild, &oNNext);
+         return oNNext;
+      }
+
+      /* oNDir is done, so go on from it within its parent, which
+         keeps it from going away meanwhile */
+      pcName = NodeFT_getName(oNDir);
+      ulLength = strlen(pcName);
+      bIsFile = FALSE;
+      FT_popTo(psBatch, psBatch->ulValid - 1);
+   }
+   return NULL;
+}
+
+/*
+  Returns the length of the absolute path of oNNext, a child of the
+  directory on top of psBatch's stack, or the root if the stack is
+  empty, and if pcBuf is not NULL writes the path there,
+  '\0'-terminated. Only the names along the stack are read, since a
+  snapshot's nodes cannot be relied on to lead back to their parents.
+*/
+static size_t FT_stackPath(struct FT_batch *psBatch, Node_T oNNext,
+                           char *pcBuf) {
+   const char *pcName;
+   size_t ulNameLength;
+   size_t ulLength = 0;
+   size_t ul;
+
+   assert(psBatch != NULL);
+   assert(oNNext != NULL);
+
+   for(ul = 0; ul <= psBatch->ulValid; ul++) {
+      if(ul > 0) {
+         if(pcBuf != NULL)
+            pcBuf[ulLength] = '/';
+         ulLength++;
+      }
+      pcName = NodeFT_getName(ul < psBatch->ulValid ?
+                              psBatch->aoNStack[ul] : oNNext);
+      ulNameLength = strlen(pcName);
+      if(pcBuf != NULL)
+         memcpy(pcBuf + ulLength, pcName, ulNameLength);
+      ulLength += ulNameLength;
+   }
+   if(pcBuf != NULL)
+      pcBuf[ulLength] = '\0';
+   return ulLength;
+}
+
+/* --------------------------------------------------------------------
+
+  The following functions serve the reads that an FT opened from an
+  image answers (see FT_openImageIn) straight from the mapping, which
+  never changes, through the lookups of treeimage.h, which take no
+  lock and allocate nothing.
+*/
+
+/*
+  Finds the node of oFT's image with absolute path pcPath, setting
+  *psNode to it. Returns SUCCESS, or BAD_PATH, CONFLICTING_PATH or
+  NO_SUCH_PATH just as FT_findNode does, or IO_ERROR if a node along
+  the way is damaged.
+*/
+static int FT_findImageNode(FT_T oFT, const char *pcPath,
+                            struct TreeImageNode *psNode) {
+   assert(oFT != NULL);
+   assert(oFT->oImage != NULL);
+   assert(pcPath != NULL);
+   assert(psNode != NULL);
+
+   if(!FT_isWellFormed(pcPath))
+      return BAD_PATH;
+   return TreeImage_find(oFT->oImage, pcPath, psNode);
+}
+
+/*
+  Returns TRUE if oFT's image holds a file (if bIsFile) or directory
+  with absolute path pcPath, and FALSE if not or on any error.
+*/
+static boolean FT_containsImage(FT_T oFT, const char *pcPath,
+                                boolean bIsFile) {
+   struct TreeImageNode sNode;
+
+   assert(oFT != NULL);
+   assert(pcPath != NULL);
+
+   return (boolean) (FT_findImageNode(oFT, pcPath, &sNode) == SUCCESS &&
+                     sNode.bIsFile == bIsFile);
+}
+
+/*
+  Returns the contents of the file of oFT's image with absolute path
+  pcPath, which lie in the mapping itself, or NULL if there is no
+  such file, it has no contents, or there is any error.
+*/
+static void *FT_getImageContents(FT_T oFT, const char *pcPath) {
+   struct TreeImageNode sNode;
+
+   assert(oFT != NULL);
+   assert(pcPath != NULL);
+
+   if(FT_findImageNode(oFT, pcPath, &sNode) != SUCCESS ||
+      !sNode.bIsFile)
+      return NULL;
+   /* the FT interface hands out contents as void *, but the mapping is
+      read-only */
+   return (void *) sNode.pvContents;
+}
+
+/* FT_statIn for oFT's image */
+static int FT_statImage(FT_T oFT, const char *pcPath, boolean *pbIsFile,
+                        size_t *pulSize) {
+   struct TreeImageNode sNode;
+   int iStatus;
+
+   assert(oFT != NULL);
+   assert(pcPath != NULL);
+   assert(pbIsFile != NULL);
+   assert(pulSize != NULL);
+
+   iStatus = FT_findImageNode(oFT, pcPath, &sNode);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   *pbIsFile = sNode.bIsFile;
+   if(sNode.bIsFile)
+      *pulSize = sNode.ulSize;
+   return SUCCESS;
+}
+
+/*
+  FT_statManyIn for oFT's image, which looks each path up from the
+  root, since doing so takes no locks and allocates nothing.
+*/
+static int FT_statManyImage(FT_T oFT, const char **ppcPaths,
+                            size_t ulNumPaths, boolean *pbIsFile,
+                            size_t *pulSizes, int *piStatuses) {
+   size_t i;
+
+   assert(oFT != NULL);
+   assert(ulNumPaths == 0 || ppcPaths != NULL);
+   assert(ulNumPaths == 0 || pbIsFile != NULL);
+   assert(ulNumPaths == 0 || pulSizes != NULL);
+   assert(ulNumPaths == 0 || piStatuses != NULL);
+
+   for(i = 0; i < ulNumPaths; i++) {
+      pbIsFile[i] = FALSE;
+      pulSizes[i] = 0;
+      piStatuses[i] = FT_statImage(oFT, ppcPaths[i], &pbIsFile[i],
+                                   &pulSizes[i]);
+      if(piStatuses[i] != SUCCESS) {
+         pbIsFile[i] = FALSE;
+         pulSizes[i] = 0;
+      }
+   }
+   return SUCCESS;
+}
+
+/*
+  FT_iterNextUnlocked for an image: finds the node after psIter's
+  token with TreeImage_next and makes it the new token, storing its
+  kind and size in *pbIsFile and *pulSize. Returns SUCCESS, or
+  NO_SUCH_PATH if no nodes remain, or MEMORY_ERROR if the token could
+  not grow, or IO_ERROR if a node is damaged.
+*/
+static int FT_iterNextImage(struct FTIter *psIter, boolean *pbIsFile,
+                            size_t *pulSize) {
+   TreeImage_T oImage;
+   struct TreeImageNode sNode;
+   size_t ulDepth;
+   size_t ulNext;
+   int iStatus;
+
+   assert(psIter != NULL);
+   assert(pbIsFile != NULL);
+   assert(pulSize != NULL);
+
+   oImage = psIter->oFT->oImage;
+   iStatus = TreeImage_next(oImage, psIter->pcToken,
+                            psIter->aulImageStack, &ulDepth, &ulNext);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   iStatus = TreeImage_getNode(oImage, ulNext, &sNode);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   iStatus = FT_iterReserve(psIter,
+                            TreeImage_getPath(oImage,
+                                              psIter->aulImageStack,
+                                              ulDepth, ulNext, NULL),
+                            ulDepth + 1);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   *pbIsFile = sNode.bIsFile;
+   *pulSize = sNode.bIsFile ? sNode.ulSize : 0;
+   psIter->pcToken[0] = sNode.bIsFile ? 'F' : 'D';
+   (void) TreeImage_getPath(oImage, psIter->aulImageStack, ulDepth,
+                            ulNext, psIter->pcToken + 1);
+   return SUCCESS;
+}
+
+/*
+  The body of FT_iterNext, called with psIter's FT locked as needed:
+  finds the node after psIter's token and makes it the new token,
+  storing its kind and size in *pbIsFile and *pulSize.
+*/
+static int FT_iterNextUnlocked(struct FTIter *psIter, boolean *pbIsFile,
+                               size_t *pulSize) {
+   FT_T oFT;
+   struct FT_batch sBatch;
+   const char *pcPath;
+   const char *pcRest;
+   const char *pcEnd;
+   const char *pcName;
+   Node_T oNTop;
+   Node_T oNNext = NULL;
+   size_t ulDepth;
+   boolean bTokenFile;
+   int iStatus;
+
+   assert(psIter != NULL);
+   assert(pbIsFile != NULL);
+   assert(pulSize != NULL);
+
+   oFT = psIter->oFT;
+   if(oFT->oImage != NULL)
+      return FT_iterNextImage(psIter, pbIsFile, pulSize);
+   if(!oFT->bIsInitialized)
+      return INITIALIZATION_ERROR;
+
+   /* a batch of no paths, whose stack is the iterator's own */
+   sBatch.oFT = oFT;
+   sBatch.psItems = NULL;
+   sBatch.ulNumItems = 0;
+   sBatch.aoNStack = psIter->aoNStack;
+   sBatch.ulValid = 0;
+   sBatch.aulHashes = NULL;
+   sBatch.bLocking = oFT->bSynchronized;
+
+   if(psIter->pcToken[0] == '\0') {
+      /* the first node is the root */
+      if(sBatch.bLocking)
+         (void) pthread_rwlock_rdlock(&oFT->sRootLock);
+      oNNext = __atomic_load_n(&oFT->oNRoot, __ATOMIC_ACQUIRE);
+      if(oNNext != NULL && sBatch.bLocking)
+         NodeFT_lockShared(oNNext);
+      if(sBatch.bLocking)
+         (void) pthread_rwlock_unlock(&oFT->sRootLock);
+      if(oNNext == NULL)
+         return NO_SUCH_PATH;
+   }
+   else {
+      pcPath = psIter->pcToken + 1;
+      bTokenFile = (boolean) (psIter->pcToken[0] == 'F');
+      ulDepth = FT_countComponents(pcPath);
+      iStatus = FT_descendStack(&sBatch, pcPath, ulDepth, 0, &pcRest);
+      if(iStatus != SUCCESS || sBatch.ulValid == 0) {
+         /* the root is gone or has been replaced */
+         FT_popTo(&sBatch, 0);
+         return NO_SUCH_PATH;
+      }
+
+      oNTop = sBatch.aoNStack[sBatch.ulValid - 1];
+      if(sBatch.ulValid == ulDepth && !bTokenFile &&
+         !NodeFT_isFile(oNTop)) {
+         /* the token's directory is still there: enter it */
+         if(NodeFT_getNumFileChildren(oNTop) > 0)
+            (void) NodeFT_getFileChild(oNTop, 0, &oNNext);
+         else if(NodeFT_getNumDirectoryChildren(oNTop) > 0)
+            (void) NodeFT_getDirectoryChild(oNTop, 0, &oNNext);
+         else {
+            pcName = NodeFT_getName(oNTop);
+            FT_popTo(&sBatch, sBatch.ulValid - 1);
+            oNNext = FT_iterAfter(&sBatch, pcName, strlen(pcName),
+                                  FALSE);
+         }
+      }
+      else if(sBatch.ulValid == ulDepth || NodeFT_isFile(oNTop)) {
+         /* the walk reached the token's node, which is a file or
+            has changed kind, or a file where a directory was */
+         pcName = NodeFT_getName(oNTop);
+         FT_popTo(&sBatch, sBatch.ulValid - 1);
+         oNNext = FT_iterAfter(&sBatch, pcName, strlen(pcName),
+                               (boolean) (sBatch.ulValid + 1 == ulDepth
+                                          && bTokenFile));
+      }
+      else {
+         /* the walk stopped above the token's node, which is gone */
+         pcEnd = strchr(pcRest, '/');
+         if(pcEnd == NULL)
+            pcEnd = pcRest + strlen(pcRest);
+         oNNext = FT_iterAfter(&sBatch, pcRest,
+                               (size_t) (pcEnd - pcRest),
+                               (boolean) (sBatch.ulValid + 1 == ulDepth
+                                          && bTokenFile));
+      }
+      if(oNNext == NULL)
+         return NO_SUCH_PATH;
+      if(sBatch.bLocking)
+         NodeFT_lockShared(oNNext);
+   }
+
+   /* the stack's directories keep oNNext's ancestors in place */
+   iStatus = FT_iterReserve(psIter, FT_stackPath(&sBatch, oNNext, NULL),
+                            sBatch.ulValid + 1);
+   sBatch.aoNStack = psIter->aoNStack;
+   if(iStatus == SUCCESS) {
+      *pbIsFile = NodeFT_isFile(oNNext);
+      *pulSize = *pbIsFile ? NodeFT_getFileLength(oNNext) : 0;
+      psIter->pcToken[0] = *pbIsFile ? 'F' : 'D';
+      (void) FT_stackPath(&sBatch, oNNext, psIter->pcToken + 1);
+   }
+   if(sBatch.bLocking)
+      NodeFT_unlock(oNNext);
+   FT_popTo(&sBatch, 0);
+   return iStatus;
+}
+
+/* The body of FT_statIn, called with oFT locked as needed, or reading
+   optimistically if bOptimistic */
+static int FT_statUnlocked(FT_T oFT, const char *pcPath,
+                           boolean *pbIsFile, size_t *pulSize,
+                           boolean bOptimistic) {
+   int iStatus;
+   Node_T oNFound = NULL;
+
+   assert(oFT != NULL);
+   assert(pcPath != NULL);
+   assert(pbIsFile != NULL);
+   assert(pulSize != NULL);
+
+   iStatus = FT_pinNode(oFT, pcPath, bOptimistic, &oNFound);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   if(!NodeFT_isFile(oNFound)) {
+      *pbIsFile = FALSE;
+   } else { /*We know that it's a file*/
+      *pbIsFile = TRUE;
+      *pulSize = NodeFT_getFileLength(oNFound);
+   }
+   FT_unpinNode(oFT, oNFound, bOptimistic);
+   return SUCCESS;
+}
+
+/* The body of FT_statManyIn, called with oFT locked as needed, or
+   reading without locks if bOptimistic */
+static int FT_statManyUnlocked(FT_T oFT, const char **ppcPaths,
+                               size_t ulNumPaths, boolean *pbIsFile,
+                               size_t *pulSizes, int *piStatuses,
+                               boolean bOptimistic) {
+   struct FT_batch sBatch;
+   struct FT_batchItem *psItem;
+   const char *pcRest;
+   Node_T oNFound;
+   size_t ulDepth;
+   size_t i;
+   int iStatus;
+
+   assert(oFT != NULL);
+   assert(ulNumPaths == 0 || pbIsFile != NULL);
+   assert(ulNumPaths == 0 || pulSizes != NULL);
+
+   if(!oFT->bIsInitialized)
+      return INITIALIZATION_ERROR;
+
+   for(i = 0; i < ulNumPaths; i++) {
+      pbIsFile[i] = FALSE;
+      pulSizes[i] = 0;
+   }
+
+   /* a locked walk holds the nodes along the current path shared */
+   iStatus = FT_openBatch(&sBatch, oFT, ppcPaths, ulNumPaths,
+                          piStatuses, FALSE, FALSE,
+                          (boolean) !bOptimistic);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   for(i = 0; i < sBatch.ulNumItems; i++) {
+      psItem = &sBatch.psItems[i];
+      ulDepth = psItem->ulDepth;
+      iStatus = FT_descendStack(&sBatch, psItem->pcPath, ulDepth,
+                                FT_keptComponents(&sBatch, i),
+                                &pcRest);
+      if(iStatus == SUCCESS && sBatch.ulValid != ulDepth)
+         iStatus = NO_SUCH_PATH;
+      piStatuses[psItem->ulIndex] = iStatus;
+      if(iStatus != SUCCESS)
+         continue;
+
+      oNFound = sBatch.aoNStack[ulDepth - 1];
+      if(NodeFT_isFile(oNFound)) {
+         pbIsFile[psItem->ulIndex] = TRUE;
+         pulSizes[psItem->ulIndex] = NodeFT_getFileLength(oNFound);
+      }
+   }
+
+   FT_closeBatch(&sBatch);
+   return SUCCESS;
+}
+
+/* The body of FT_getFileContentsIn, called with oFT locked as needed,
+   or reading optimistically if bOptimistic */
+static void *FT_getFileContentsUnlocked(FT_T oFT, const char *pcPath,
+                                        boolean bOptimistic) {
+   int iStatus;
+   Node_T oNFound = NULL;
+   void *pvResult = NULL;
+
+   assert(oFT != NULL);
+   assert(pcPath != NULL);
+
+   iStatus = FT_pinNode(oFT, pcPath, bOptimistic, &oNFound);
+   if(iStatus != SUCCESS)
+      return NULL;
+
+   if(NodeFT_isFile(oNFound))
+      pvResult = NodeFT_getFileContents(oNFound);
+   FT_unpinNode(oFT, oNFound, bOptimistic);
+   return pvResult;
+}
+
+/*
+  The body of FT_replaceFileContentsIn, called with oFT locked as
+  needed, which also sets *pbReplaced to whether it replaced them
+*/
+static void *FT_replaceFileContentsUnlocked(FT_T oFT,
+                                            const char *pcPath,
+                                            void *pvNewContents,
+                                            size_t ulNewLength,
+                                            boolean *pbReplaced) {
+   int iStatus;
+   Node_T oNParent = NULL;
+   Node_T oNFound = NULL;
+   void *pvResult = NULL;
+
+   assert(oFT != NULL);
+   assert(pcPath != NULL);
+   assert(pbReplaced != NULL);
+
+   *pbReplaced = FALSE;
+   iStatus = FT_ownPath(oFT, pcPath, TRUE);
+   if(iStatus == SUCCESS)
+      iStatus = FT_lockFound(oFT, pcPath, &oNParent, &oNFound);
+   if(iStatus != SUCCESS)
+      return NULL;
+   /* holding oNFound alone keeps it from being removed */
+   FT_unlockHeld(oFT, oNParent);
+
+   if(NodeFT_isFile(oNFound)) {
+      pvResult = NodeFT_setFile(oNFound, pvNewContents, ulNewLength);
+      *pbReplaced = TRUE;
+   }
+   FT_unlockHeld(oFT, oNFound);
+   return pvResult;
+}
+
+/*--------------------------------------------------------------------*/
+
+int FT_setSynchronizedIn(FT_T oFT, boolean bSynchronized) {
+   assert(oFT != NULL);
+
+   if(!oFT->bIsInitialized || oFT->oSource != NULL)
+      return INITIALIZATION_ERROR;
+
+   if(bSynchronized == oFT->bSynchronized)
+      return SUCCESS;
+   if(!bSynchronized) {
+      FT_destroyLocks(oFT);
+      oFT->bSynchronized = FALSE;
+      oFT->bLockFree = FALSE;
+      return SUCCESS;
+   }
+   if(pthread_rwlock_init(&oFT->sLock, NULL) != 0)
+      return MEMORY_ERROR;
+   if(pthread_rwlock_init(&oFT->sRootLock, NULL) != 0) {
+      (void) pthread_rwlock_destroy(&oFT->sLock);
+      return MEMORY_ERROR;
+   }
+   if(pthread_rwlock_init(&oFT->sIndexLock, NULL) != 0) {
+      (void) pthread_rwlock_destroy(&oFT->sRootLock);
+      (void) pthread_rwlock_destroy(&oFT->sLock);
+      return MEMORY_ERROR;
+   }
+   if(pthread_rwlock_init(&oFT->sChangeLock, NULL) != 0) {
+      (void) pthread_rwlock_destroy(&oFT->sIndexLock);
+      (void) pthread_rwlock_destroy(&oFT->sRootLock);
+      (void) pthread_rwlock_destroy(&oFT->sLock);
+      return MEMORY_ERROR;
+   }
+   oFT->bSynchronized = TRUE;
+   return SUCCESS;
+}
+
+int FT_setLockFreeReadsIn(FT_T oFT, boolean bLockFree) {
+   int iStatus;
+
+   assert(oFT != NULL);
+
+   if(!oFT->bIsInitialized || oFT->oSource != NULL)
+      return INITIALIZATION_ERROR;
+
+   if(bLockFree && !oFT->bSynchronized) {
+      iStatus = FT_setSynchronizedIn(oFT, TRUE);
+      if(iStatus != SUCCESS)
+         return iStatus;
+   }
+   oFT->bLockFree = bLockFree;
+   return SUCCESS;
+}
+
+int FT_setArenaIn(FT_T oFT, boolean bArena) {
+   Arena_T oArena;
+
+   assert(oFT != NULL);
+
+   if(!oFT->bIsInitialized || oFT->oSource != NULL)
+      return INITIALIZATION_ERROR;
+
+   if(bArena == (oFT->oArena != NULL))
+      return SUCCESS;
+   if(oFT->oNRoot != NULL)
+      return ALREADY_IN_TREE;
+   if(!bArena) {
+      /* a snapshot may still hold nodes from the arena */
+      if(oFT->ulSnapshots > 0)
+         return INITIALIZATION_ERROR;
+      Arena_free(oFT->oArena);
+      oFT->oArena = NULL;
+      return SUCCESS;
+   }
+   oArena = Arena_new();
+   if(oArena == NULL)
+      return MEMORY_ERROR;
+   oFT->oArena = oArena;
+   return SUCCESS;
+}
+
+int FT_setJournalIn(FT_T oFT, const char *pcCheckpointFile,
+                    const char *pcJournalFile) {
+   char *pcCheckpointCopy = NULL;
+   char *pcJournalCopy = NULL;
+   int iStatus;
+
+   assert(oFT != NULL);
+   assert((pcCheckpointFile == NULL) == (pcJournalFile == NULL));
+
+   if(oFT->oSource != NULL || oFT->oImage != NULL)
+      return INITIALIZATION_ERROR;
+   if(pcCheckpointFile != NULL) {
+      pcCheckpointCopy = malloc(strlen(pcCheckpointFile) + 1);
+      pcJournalCopy = malloc(strlen(pcJournalFile) + 1);
+      if(pcCheckpointCopy == NULL || pcJournalCopy == NULL) {
+         free(pcCheckpointCopy);
+         free(pcJournalCopy);
+         return MEMORY_ERROR;
+      }
+      strcpy(pcCheckpointCopy, pcCheckpointFile);
+      strcpy(pcJournalCopy, pcJournalFile);
+   }
+
+   /* the default FT recovers when FT_init next initializes it */
+   if(!oFT->bIsInitialized) {
+      (void) FT_closeJournal(oFT, TRUE);
+      oFT->pcCheckpointFile = pcCheckpointCopy;
+      oFT->pcJournalFile = pcJournalCopy;
+      return SUCCESS;
+   }
+
+   iStatus = FT_beginChange(oFT, TRUE);
+   if(iStatus == SUCCESS && pcCheckpointCopy != NULL &&
+      oFT->oNRoot != NULL) {
+      FT_endChange(oFT);
+      iStatus = ALREADY_IN_TREE;
+   }
+   if(iStatus != SUCCESS) {
+      free(pcCheckpointCopy);
+      free(pcJournalCopy);
+      return iStatus;
+   }
+
+   iStatus = FT_closeJournal(oFT, TRUE);
+   if(iStatus == SUCCESS && pcCheckpointCopy != NULL) {
+      oFT->pcCheckpointFile = pcCheckpointCopy;
+      oFT->pcJournalFile = pcJournalCopy;
+      iStatus = FT_recover(oFT);
+      if(iStatus != SUCCESS)
+         (void) FT_closeJournal(oFT, TRUE);
+   }
+   else {
+      free(pcCheckpointCopy);
+      free(pcJournalCopy);
+   }
+   FT_endChange(oFT);
+   return iStatus;
+}
+
+int FT_checkpointIn(FT_T oFT) {
+   int iStatus;
+
+   iStatus = FT_beginChange(oFT, TRUE);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   if(!oFT->bIsInitialized || oFT->oJournal == NULL)
+      iStatus = INITIALIZATION_ERROR;
+   else
+      iStatus = FT_checkpointUnlocked(oFT);
+   FT_endChange(oFT);
+   return iStatus;
+}
+
+int FT_insertDirIn(FT_T oFT, const char *pcPath) {
+   size_t ulSequence = 0;
+   int iStatus;
+
+   iStatus = FT_beginChange(oFT, FALSE);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   iStatus = FT_insertDirUnlocked(oFT, pcPath);
+   if(iStatus == SUCCESS)
+      iStatus = FT_logChange(oFT, JOURNAL_INSERT_DIR, pcPath, NULL,
+                             NULL, 0, &ulSequence);
+   FT_endChange(oFT);
+   if(iStatus == SUCCESS)
+      iStatus = FT_commitChange(oFT, ulSequence);
+   return iStatus;
+}
+
+boolean FT_containsDirIn(FT_T oFT, const char *pcPath) {
+   boolean bResult;
+   size_t ulBegun, ulEnded;
+   int iTry;
+
+   if(oFT->oImage != NULL)
+      return FT_containsImage(oFT, pcPath, FALSE);
+   for(iTry = 0; iTry < LOCK_FREE_TRIES; iTry++) {
+      if(!FT_readBegin(oFT, &ulBegun, &ulEnded))
+         break;
+      bResult = FT_containsDirUnlocked(oFT, pcPath, TRUE);
+      if(FT_readEnd(oFT, ulBegun, ulEnded))
+         return bResult;
+   }
+
+   FT_lockShared(oFT);
+   bResult = FT_containsDirUnlocked(oFT, pcPath, FALSE);
+   FT_unlock(oFT);
+   return bResult;
+}
+
+int FT_rmDirIn(FT_T oFT, const char *pcPath) {
+   size_t ulSequence = 0;
+   int iStatus;
+
+   iStatus = FT_beginChange(oFT, FALSE);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   iStatus = FT_rmDirUnlocked(oFT, pcPath);
+   if(iStatus == SUCCESS)
+      iStatus = FT_logChange(oFT, JOURNAL_RM_DIR, pcPath, NULL, NULL, 0,
+                             &ulSequence);
+   FT_endChange(oFT);
+   if(iStatus == SUCCESS)
+      iStatus = FT_commitChange(oFT, ulSequence);
+   return iStatus;
+}
+
+int FT_moveIn(FT_T oFT, const char *pcFrom, const char *pcTo) {
+   size_t ulSequence = 0;
+   int iStatus;
+
+   iStatus = FT_beginChange(oFT, TRUE);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   iStatus = FT_moveUnlocked(oFT, pcFrom, pcTo);
+   if(iStatus == SUCCESS)
+      iStatus = FT_logChange(oFT, JOURNAL_MOVE, pcFrom, pcTo, NULL, 0,
+                             &ulSequence);
+   FT_endChange(oFT);
+   if(iStatus == SUCCESS)
+      iStatus = FT_commitChange(oFT, ulSequence);
+   return iStatus;
+}
+
+int FT_insertFileIn(FT_T oFT, const char *pcPath, void *pvContents,
+                    size_t ulLength) {
+   size_t ulSequence = 0;
+   int iStatus;
+
+   iStatus = FT_beginChange(oFT, FALSE);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   iStatus = FT_insertFileUnlocked(oFT, pcPath, pvContents, ulLength);
+   if(iStatus == SUCCESS)
+      iStatus = FT_logChange(oFT, JOURNAL_INSERT_FILE, pcPath, NULL,
+                             pvContents, ulLength, &ulSequence);
+   FT_endChange(oFT);
+   if(iStatus == SUCCESS)
+      iStatus = FT_commitChange(oFT, ulSequence);
+   return iStatus;
+}
+
+int FT_insertFilesIn(FT_T oFT, const char **ppcPaths,
+                     void **ppvContents, size_t *pulLengths,
+                     size_t ulNumFiles, int *piStatuses) {
+   size_t ulSequence = 0;
+   int iStatus;
+   size_t i;
+
+   iStatus = FT_beginChange(oFT, TRUE);
+   if(iStatus == SUCCESS) {
+      iStatus = FT_insertFilesUnlocked(oFT, ppcPaths, ppvContents,
+                                       pulLengths, ulNumFiles,
+                                       piStatuses);
+      if(iStatus == SUCCESS) {
+         /* the files inserted cannot conflict, so order is moot */
+         for(i = 0; i < ulNumFiles && iStatus == SUCCESS; i++)
+            if(piStatuses[i] == SUCCESS)
+               iStatus = FT_logChange(oFT, JOURNAL_INSERT_FILE,
+                                      ppcPaths[i], NULL, ppvContents[i],
+                                      pulLengths[i], &ulSequence);
+         FT_endChange(oFT);
+         if(iStatus == SUCCESS)
+            iStatus = FT_commitChange(oFT, ulSequence);
+         return iStatus;
+      }
+      FT_endChange(oFT);
+   }
+   for(i = 0; i < ulNumFiles; i++)
+      piStatuses[i] = iStatus;
+   return iStatus;
+}
+
+int FT_loadManifestIn(FT_T oFT, const char *pcFile) {
+   int iStatus;
+
+   iStatus = FT_beginChange(oFT, TRUE);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   iStatus = FT_loadManifestUnlocked(oFT, pcFile);
+   if(iStatus == SUCCESS && oFT->oJournal != NULL)
+      iStatus = FT_checkpointUnlocked(oFT);
+   FT_endChange(oFT);
+   return iStatus;
+}
+
+int FT_saveIn(FT_T oFT, const char *pcFile, boolean bContents) {
+   size_t ulLength;
+   int iStatus;
+
+   FT_lockShared(oFT);
+   FT_lockTree(oFT);
+   iStatus = FT_saveReplacing(oFT, pcFile, bContents, 0, FALSE,
+                              &ulLength);
+   FT_unlockTree(oFT);
+   FT_unlock(oFT);
+   return iStatus;
+}
+
+int FT_saveImageIn(FT_T oFT, const char *pcFile, boolean bContents) {
+   int iStatus;
+
+   FT_lockShared(oFT);
+   FT_lockTree(oFT);
+   iStatus = FT_saveImageUnlocked(oFT, pcFile, bContents);
+   FT_unlockTree(oFT);
+   FT_unlock(oFT);
+   return iStatus;
+}
+
+int FT_bgsaveIn(FT_T oFT, const char *pcFile, boolean bContents,
+                FTBgsave_T *poBgsave) {
+   FTBgsave_T oBgsave;
+   char *pcTemporary;
+   int iStatus;
+   int aiFds[2];
+   pid_t iPid;
+
+   assert(oFT != NULL);
+   assert(pcFile != NULL);
+   assert(poBgsave != NULL);
 
-   if(!bIsInitialized) {
-      *poNResult = NULL;
+   *poBgsave = NULL;
+   if(!oFT->bIsInitialized)
       return INITIALIZATION_ERROR;
-   }
-
-   iStatus = Path_new(pcPath, &oPPath);
-   if(iStatus != SUCCESS) {
-      *poNResult = NULL;
+   oBgsave = malloc(sizeof(struct FTBgsave));
+   if(oBgsave == NULL)
+      return MEMORY_ERROR;
+   /* made here, so that the child need not allocate */
+   pcTemporary = FT_makeTemporary(pcFile, &iStatus);
+   if(pcTemporary == NULL) {
+      free(oBgsave);
       return iStatus;
    }
-
-   iStatus = FT_traversePath(oPPath, &oNFound);
-   if(iStatus != SUCCESS)
-   {
-      Path_free(oPPath);
-      *poNResult = NULL;
-      return iStatus;
+   /* a program that another thread forks and execs must not hold the
+      pipe open, or FT_bgsaveFinish would wait on it, so the pipe is
+      made close-on-exec at once, leaving no moment for a fork */
+   if(pipe2(aiFds, O_CLOEXEC) != 0) {
+      (void) remove(pcTemporary);
+      free(pcTemporary);
+      free(oBgsave);
+      return IO_ERROR;
    }
 
-   if(oNFound == NULL) {
-      Path_free(oPPath);
-      *poNResult = NULL;
-      return NO_SUCH_PATH;
+   /* no change is under way while the lock is held exclusively, so
+      the child's copy of the tree is whole */
+   if(oFT->bSynchronized)
+      (void) pthread_rwlock_wrlock(&oFT->sLock);
+   iPid = fork();
+   if(iPid == 0) {
+      (void) close(aiFds[0]);
+      FT_bgsaveChild(oFT, pcFile, pcTemporary, bContents, aiFds[1]);
    }
-
-   if(Path_comparePath(NodeFT_getPath(oNFound), oPPath) != 0) {
-      Path_free(oPPath);
-      *poNResult = NULL;
-      return NO_SUCH_PATH;
+   if(oFT->bSynchronized)
+      (void) pthread_rwlock_unlock(&oFT->sLock);
+   if(iPid < 0)
+      (void) remove(pcTemporary);
+   free(pcTemporary);
+   (void) close(aiFds[1]);
+   if(iPid < 0) {
+      (void) close(aiFds[0]);
+      free(oBgsave);
+      return IO_ERROR;
    }
 
-   Path_free(oPPath);
-   *poNResult = oNFound;
+   oBgsave->iPid = iPid;
+   oBgsave->iFd = aiFds[0];
+   oBgsave->bExited = FALSE;
+   *poBgsave = oBgsave;
    return SUCCESS;
 }
-/*--------------------------------------------------------------------*/
 
+boolean FT_bgsaveIsDone(FTBgsave_T oBgsave) {
+   int iWaitStatus;
 
-int FT_insertDir(const char *pcPath) {
-   int iStatus;
-   Path_T oPPath = NULL;
-   Node_T oNFirstNew = NULL;
-   Node_T oNCurr = NULL;
-   size_t ulDepth, ulIndex;
-   size_t ulNewNodes = 0;
-   /* void* pvFile; */
-   /* Node_T *poNResult; */
-
+   assert(oBgsave != NULL);
 
+   /* a child that cannot be waited for is as good as done */
+   if(!oBgsave->bExited &&
+      waitpid(oBgsave->iPid, &iWaitStatus, WNOHANG) != 0)
+      oBgsave->bExited = TRUE;
+   return oBgsave->bExited;
+}
 
+int FT_bgsaveFinish(FTBgsave_T oBgsave, size_t *pulLength) {
+   struct FT_bgsaveReport sReport;
+   ssize_t lRead;
+   int iWaitStatus;
 
+   assert(oBgsave != NULL);
+   assert(pulLength != NULL);
 
-   assert(pcPath != NULL);
-   /* assert(CheckerFT_isValid(bIsInitialized, oNRoot, ulCount)); */
+   /* the report arrives, or else the pipe closes, as the child ends */
+   do
+      lRead = read(oBgsave->iFd, &sReport, sizeof(sReport));
+   while(lRead < 0 && errno == EINTR);
+   (void) close(oBgsave->iFd);
+   if(!oBgsave->bExited)
+      while(waitpid(oBgsave->iPid, &iWaitStatus, 0) < 0 &&
+            errno == EINTR)
+         ;
+   free(oBgsave);
 
-   /* validate pcPath and generate a Path_T for it */
-   if(!bIsInitialized)
-      return INITIALIZATION_ERROR;
+   if(lRead != (ssize_t) sizeof(sReport)) {
+      *pulLength = 0;
+      return IO_ERROR;
+   }
+   *pulLength = sReport.ulLength;
+   return sReport.iStatus;
+}
 
-   iStatus = Path_new(pcPath, &oPPath);
-   if(iStatus != SUCCESS)
-      return iStatus;
+int FT_loadIn(FT_T oFT, const char *pcFile) {
+   size_t ulTag;
+   int iStatus;
 
-   /* find the closest ancestor of oPPath already in the tree */
-   iStatus= FT_traversePath(oPPath, &oNCurr);
+   iStatus = FT_beginChange(oFT, TRUE);
    if(iStatus != SUCCESS)
-   {
-      Path_free(oPPath);
       return iStatus;
-   }
+   iStatus = FT_loadUnlocked(oFT, pcFile, &ulTag);
+   if(iStatus == SUCCESS && oFT->oJournal != NULL)
+      iStatus = FT_checkpointUnlocked(oFT);
+   FT_endChange(oFT);
+   return iStatus;
+}
 
-   /* no ancestor node found, so if root is not NULL,
-      pcPath isn't underneath root. */
-   if(oNCurr == NULL && oNRoot != NULL) {
-      Path_free(oPPath);
-      return CONFLICTING_PATH;
-   }
-   ulDepth = Path_getDepth(oPPath);
-   if(oNCurr == NULL) /* new root! */
-      ulIndex = 1;
-   else {
-      ulIndex = Path_getDepth(NodeFT_getPath(oNCurr))+1;
+boolean FT_containsFileIn(FT_T oFT, const char *pcPath) {
+   boolean bResult;
+   size_t ulBegun, ulEnded;
+   int iTry;
 
-      /* oNCurr is the node we're trying to insert */
-      if(ulIndex == ulDepth+1 && !Path_comparePath(oPPath,
-                                       NodeFT_getPath(oNCurr))) {
-         Path_free(oPPath);
-         return ALREADY_IN_TREE;
-      }
+   if(oFT->oImage != NULL)
+      return FT_containsImage(oFT, pcPath, TRUE);
+   for(iTry = 0; iTry < LOCK_FREE_TRIES; iTry++) {
+      if(!FT_readBegin(oFT, &ulBegun, &ulEnded))
+         break;
+      bResult = FT_containsFileUnlocked(oFT, pcPath, TRUE);
+      if(FT_readEnd(oFT, ulBegun, ulEnded))
+         return bResult;
    }
 
-   if(oNCurr != NULL && NodeFT_isFile(oNCurr)) {
-      Path_free(oPPath);
-      return NOT_A_DIRECTORY;
-   }
+   FT_lockShared(oFT);
+   bResult = FT_containsFileUnlocked(oFT, pcPath, FALSE);
+   FT_unlock(oFT);
+   return bResult;
+}
 
-   /* starting at oNCurr, build rest of the path one level at a time */
-   while(ulIndex <= ulDepth) {
-      Path_T oPPrefix = NULL;
-      Node_T oNNewNode = NULL;
+int FT_rmFileIn(FT_T oFT, const char *pcPath) {
+   size_t ulSequence = 0;
+   int iStatus;
 
-      /* generate a Path_T for this level */
-      iStatus = Path_prefix(oPPath, ulIndex, &oPPrefix);
-      if(iStatus != SUCCESS) {
-         Path_free(oPPath);
-         if(oNFirstNew != NULL)
-            (void) NodeFT_free(oNFirstNew);
-        /* assert(CheckerFT_isValid(bIsInitialized, oNRoot, ulCount)); */
-         return iStatus;
-      }
+   iStatus = FT_beginChange(oFT, FALSE);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   iStatus = FT_rmFileUnlocked(oFT, pcPath);
+   if(iStatus == SUCCESS)
+      iStatus = FT_logChange(oFT, JOURNAL_RM_FILE, pcPath, NULL, NULL,
+                             0, &ulSequence);
+   FT_endChange(oFT);
+   if(iStatus == SUCCESS)
+      iStatus = FT_commitChange(oFT, ulSequence);
+   return iStatus;
+}
 
-      /* insert the new node for this level */
-      iStatus = NodeFT_new(oPPrefix, oNCurr, FALSE, NULL, 0, &oNNewNode);
-      /* NodeFT_new(Path_T oPPath, Node_T oNParent, boolean isFile, void* pvFile, size_t fileSize, Node_T *poNResult); */
-      if(iStatus != SUCCESS) {
-         Path_free(oPPath);
-         Path_free(oPPrefix);
-         if(oNFirstNew != NULL)
-            (void) NodeFT_free(oNFirstNew);
-         /* assert(CheckerFT_isValid(bIsInitialized, oNRoot, ulCount)); */
-         return iStatus;
-      }
+void *FT_getFileContentsIn(FT_T oFT, const char *pcPath) {
+   void *pvResult;
+   size_t ulBegun, ulEnded;
+   int iTry;
 
-      /* set up for next level */
-      Path_free(oPPrefix);
-      oNCurr = oNNewNode;
-      ulNewNodes++;
-      if(oNFirstNew == NULL)
-         oNFirstNew = oNCurr;
-      ulIndex++;
+   if(oFT->oImage != NULL)
+      return FT_getImageContents(oFT, pcPath);
+   for(iTry = 0; iTry < LOCK_FREE_TRIES; iTry++) {
+      if(!FT_readBegin(oFT, &ulBegun, &ulEnded))
+         break;
+      pvResult = FT_getFileContentsUnlocked(oFT, pcPath, TRUE);
+      if(FT_readEnd(oFT, ulBegun, ulEnded))
+         return pvResult;
    }
 
-   Path_free(oPPath);
-   /* update ft state variables to reflect insertion */
-   if(oNRoot == NULL)
-      oNRoot = oNFirstNew;
-   ulCount += ulNewNodes;
+   FT_lockShared(oFT);
+   pvResult = FT_getFileContentsUnlocked(oFT, pcPath, FALSE);
+   FT_unlock(oFT);
+   return pvResult;
+}
 
-   return SUCCESS;
+void *FT_replaceFileContentsIn(FT_T oFT, const char *pcPath,
+                               void *pvNewContents,
+                               size_t ulNewLength) {
+   void *pvResult;
+   boolean bReplaced;
+   size_t ulSequence = 0;
 
+   if(FT_beginChange(oFT, FALSE) != SUCCESS)
+      return NULL;
+   pvResult = FT_replaceFileContentsUnlocked(oFT, pcPath, pvNewContents,
+                                             ulNewLength, &bReplaced);
+   /* the result has no room for the journal's status */
+   if(bReplaced)
+      (void) FT_logChange(oFT, JOURNAL_REPLACE_CONTENTS, pcPath, NULL,
+                          pvNewContents, ulNewLength, &ulSequence);
+   FT_endChange(oFT);
+   (void) FT_commitChange(oFT, ulSequence);
+   return pvResult;
 }
-int FT_insertFile(const char *pcPath, void *pvContents,
-                  size_t ulLength) {
-   int iStatus;
-   Path_T oPPath = NULL;
-   Node_T oNFirstNew = NULL;
-   Node_T oNCurr = NULL;
-   size_t ulDepth, ulIndex;
-   size_t ulNewNodes = 0;
-
 
+int FT_statIn(FT_T oFT, const char *pcPath, boolean *pbIsFile,
+              size_t *pulSize) {
+   int iStatus;
+   boolean bIsFile;
+   size_t ulSize;
+   size_t ulBegun, ulEnded;
+   int iTry;
 
+   if(oFT->oImage != NULL)
+      return FT_statImage(oFT, pcPath, pbIsFile, pulSize);
 
+   /* an overlapped attempt must leave *pbIsFile and *pulSize alone */
+   for(iTry = 0; iTry < LOCK_FREE_TRIES; iTry++) {
+      if(!FT_readBegin(oFT, &ulBegun, &ulEnded))
+         break;
+      iStatus = FT_statUnlocked(oFT, pcPath, &bIsFile, &ulSize, TRUE);
+      if(FT_readEnd(oFT, ulBegun, ulEnded)) {
+         if(iStatus == SUCCESS) {
+            *pbIsFile = bIsFile;
+            if(bIsFile)
+               *pulSize = ulSize;
+         }
+         return iStatus;
+      }
+   }
 
-   assert(pcPath != NULL);
-   /* assert(CheckerFT_isValid(bIsInitialized, oNRoot, ulCount)); */
+   FT_lockShared(oFT);
+   iStatus = FT_statUnlocked(oFT, pcPath, pbIsFile, pulSize, FALSE);
+   FT_unlock(oFT);
+   return iStatus;
+}
 
-   /* validate pcPath and generate a Path_T for it */
-   if(!bIsInitialized)
-      return INITIALIZATION_ERROR;
+int FT_statManyIn(FT_T oFT, const char **ppcPaths, size_t ulNumPaths,
+                  boolean *pbIsFile, size_t *pulSizes,
+                  int *piStatuses) {
+   int iStatus = SUCCESS;
+   boolean bDone = FALSE;
+   size_t ulBegun, ulEnded;
+   int iTry;
+   size_t i;
 
-   iStatus = Path_new(pcPath, &oPPath);
-   if(iStatus != SUCCESS)
-      return iStatus;
+   if(oFT->oImage != NULL)
+      return FT_statManyImage(oFT, ppcPaths, ulNumPaths, pbIsFile,
+                              pulSizes, piStatuses);
 
-   /* find the closest ancestor of oPPath already in the tree */
-   iStatus= FT_traversePath(oPPath, &oNCurr);
-   if(iStatus != SUCCESS)
-   {
-      Path_free(oPPath);
-      return iStatus;
+   /* an overlapped attempt is simply redone, overwriting every slot */
+   for(iTry = 0; iTry < LOCK_FREE_TRIES && !bDone; iTry++) {
+      if(!FT_readBegin(oFT, &ulBegun, &ulEnded))
+         break;
+      iStatus = FT_statManyUnlocked(oFT, ppcPaths, ulNumPaths, pbIsFile,
+                                    pulSizes, piStatuses, TRUE);
+      bDone = FT_readEnd(oFT, ulBegun, ulEnded);
    }
 
-   /* no ancestor node found, so if root is not NULL,
-      pcPath isn't underneath root. */
-   if(oNCurr == NULL && oNRoot != NULL) {
-      Path_free(oPPath);
-      return CONFLICTING_PATH;
+   if(!bDone) {
+      FT_lockShared(oFT);
+      iStatus = FT_statManyUnlocked(oFT, ppcPaths, ulNumPaths, pbIsFile,
+                                    pulSizes, piStatuses, FALSE);
+      FT_unlock(oFT);
    }
-   ulDepth = Path_getDepth(oPPath);
-   if(oNCurr == NULL) /* new root! */
-      ulIndex = 1;
-   else {
-      ulIndex = Path_getDepth(NodeFT_getPath(oNCurr))+1;
 
-      /* oNCurr is the node we're trying to insert */
-      if(ulIndex == ulDepth+1 && !Path_comparePath(oPPath,
-                                       NodeFT_getPath(oNCurr))) {
-         Path_free(oPPath);
-         return ALREADY_IN_TREE;
+   if(iStatus != SUCCESS)
+      for(i = 0; i < ulNumPaths; i++) {
+         piStatuses[i] = iStatus;
+         pbIsFile[i] = FALSE;
+         pulSizes[i] = 0;
       }
-   }
+   return iStatus;
+}
 
-   if(oNCurr != NULL && NodeFT_isFile(oNCurr)) {
-      Path_free(oPPath);
-      return NOT_A_DIRECTORY;
-   }
-   /*A file cannot be the root*/
-   if(ulDepth == 1) {
-      return CONFLICTING_PATH;
-   }
-   /* starting at oNCurr, build rest of the path one level at a time */
-   while(ulIndex <= ulDepth) {
-      Path_T oPPrefix = NULL;
-      Node_T oNNewNode = NULL;
+int FT_setIndexedIn(FT_T oFT, boolean bIndexed) {
+   int iStatus;
 
-      /* generate a Path_T for this level */
-      iStatus = Path_prefix(oPPath, ulIndex, &oPPrefix);
-      if(iStatus != SUCCESS) {
-         Path_free(oPPath);
-         if(oNFirstNew != NULL)
-            (void) NodeFT_free(oNFirstNew);
-        /* assert(CheckerFT_isValid(bIsInitialized, oNRoot, ulCount)); */
-         return iStatus;
-      }
+   iStatus = FT_beginChange(oFT, TRUE);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   iStatus = FT_setIndexedUnlocked(oFT, bIndexed);
+   FT_endChange(oFT);
+   return iStatus;
+}
 
-      /* insert the new node for this level */
-      if(ulIndex == ulDepth) {
-         iStatus = NodeFT_new(oPPrefix, oNCurr, TRUE, pvContents, ulLength, &oNNewNode);
-      }
-      else {
-         iStatus = NodeFT_new(oPPrefix, oNCurr, FALSE, NULL, 0, &oNNewNode);
-      }
-      /* NodeFT_new(Path_T oPPath, Node_T oNParent, boolean isFile, void* pvFile, size_t fileSize, Node_T *poNResult); */
-      if(iStatus != SUCCESS) {
-         Path_free(oPPath);
-         Path_free(oPPrefix);
-         if(oNFirstNew != NULL)
-            (void) NodeFT_free(oNFirstNew);
-         /* assert(CheckerFT_isValid(bIsInitialized, oNRoot, ulCount)); */
-         return iStatus;
-      }
+int FT_iterOpenIn(FT_T oFT, const char *pcToken, FTIter_T *poIter) {
+   struct FTIter *psIter;
+   size_t ulLength = 0;
+   size_t ulDepth = 1;
 
-      /* set up for next level */
-      Path_free(oPPrefix);
-      oNCurr = oNNewNode;
-      ulNewNodes++;
-      if(oNFirstNew == NULL)
-         oNFirstNew = oNCurr;
-      ulIndex++;
+   assert(oFT != NULL);
+   assert(poIter != NULL);
+
+   *poIter = NULL;
+   if(!oFT->bIsInitialized && oFT->oImage == NULL)
+      return INITIALIZATION_ERROR;
+   if(pcToken == NULL)
+      pcToken = "";
+   if(*pcToken != '\0') {
+      if((*pcToken != 'F' && *pcToken != 'D') ||
+         !FT_isWellFormed(pcToken + 1))
+         return BAD_PATH;
+      ulLength = strlen(pcToken + 1);
+      ulDepth = FT_countComponents(pcToken + 1);
    }
 
-   Path_free(oPPath);
-   /* update ft state variables to reflect insertion */
-   if(oNRoot == NULL)
-      oNRoot = oNFirstNew;
-   ulCount += ulNewNodes;
+   psIter = malloc(sizeof(struct FTIter));
+   if(psIter == NULL)
+      return MEMORY_ERROR;
+   psIter->oFT = oFT;
+   psIter->pcToken = NULL;
+   psIter->ulTokenLength = 0;
+   psIter->aoNStack = NULL;
+   psIter->aulImageStack = NULL;
+   psIter->ulStackLength = 0;
+   if(FT_iterReserve(psIter, ulLength, ulDepth) != SUCCESS) {
+      FT_iterClose(psIter);
+      return MEMORY_ERROR;
+   }
+   strcpy(psIter->pcToken, pcToken);
 
+   *poIter = psIter;
    return SUCCESS;
-
 }
-boolean FT_containsDir(const char *pcPath) {
-   int iStatus;
-   Node_T oNFound = NULL;
 
-   assert(pcPath != NULL);
-
-   iStatus = FT_findNode(pcPath, &oNFound);
-   return (boolean) ((iStatus == SUCCESS) && !NodeFT_isFile(oNFound));
-}
+int FT_iterNext(FTIter_T oIter, const char **ppcPath, boolean *pbIsFile,
+                size_t *pulSize) {
+   int iStatus;
 
-boolean FT_containsFile(const char *pcPath) {
-      int iStatus;
-   Node_T oNFound = NULL;
+   assert(oIter != NULL);
+   assert(ppcPath != NULL);
+   assert(pbIsFile != NULL);
+   assert(pulSize != NULL);
 
-   assert(pcPath != NULL);
+   FT_lockShared(oIter->oFT);
+   iStatus = FT_iterNextUnlocked(oIter, pbIsFile, pulSize);
+   FT_unlock(oIter->oFT);
 
-   iStatus = FT_findNode(pcPath, &oNFound);
-   return (boolean) ((iStatus == SUCCESS) && NodeFT_isFile(oNFound));
+   if(iStatus != SUCCESS) {
+      *ppcPath = NULL;
+      *pbIsFile = FALSE;
+      *pulSize = 0;
+      return iStatus;
+   }
+   *ppcPath = oIter->pcToken + 1;
+   return SUCCESS;
 }
 
-int FT_rmFile(const char *pcPath) {
-   int iStatus;
-   Node_T oNFound = NULL;
-
-   assert(pcPath != NULL);
+const char *FT_iterGetToken(FTIter_T oIter) {
+   assert(oIter != NULL);
 
-   /* if(!bIsInitialized)
-      return INITIALIZATION_ERROR; */
-   /* assert(CheckerFT_isValid(bIsInitialized, oNRoot, ulCount)); */
+   return oIter->pcToken;
+}
 
-   iStatus = FT_findNode(pcPath, &oNFound);
+void FT_iterClose(FTIter_T oIter) {
+   if(oIter == NULL)
+      return;
+   free(oIter->pcToken);
+   free(oIter->aoNStack);
+   free(oIter->aulImageStack);
+   free(oIter);
+}
 
-   if(iStatus != SUCCESS)
-       return iStatus;
+int FT_setToStringThreadsIn(FT_T oFT, size_t ulThreads) {
+   assert(oFT != NULL);
 
-   if(!NodeFT_isFile(oNFound))
-      return NOT_A_FILE;
+   if(!oFT->bIsInitialized)
+      return INITIALIZATION_ERROR;
+   if(ulThreads == 0)
+      ulThreads = 1;
+   __atomic_store_n(&oFT->ulThreads, ulThreads, __ATOMIC_RELAXED);
+   return SUCCESS;
+}
 
-   ulCount -= NodeFT_free(oNFound);
+char *FT_toStringIn(FT_T oFT) {
+   char *pcResult;
 
-   /* assert(CheckerFT_isValid(bIsInitialized, oNRoot, ulCount)); */ 
-   return SUCCESS;
+   FT_lockShared(oFT);
+   FT_lockTree(oFT);
+   pcResult = FT_toStringUnlocked(oFT);
+   FT_unlockTree(oFT);
+   FT_unlock(oFT);
+   return pcResult;
 }
 
-int FT_rmDir(const char *pcPath) {
+int FT_writeChunksIn(FT_T oFT,
+                     int (*pfWrite)(const char *pcChunk,
+                                    size_t ulLength, void *pvExtra),
+                     void *pvExtra) {
    int iStatus;
-   Node_T oNFound = NULL;
 
-   assert(pcPath != NULL);
-   /* assert(CheckerFT_isValid(bIsInitialized, oNRoot, ulCount)); */
+   FT_lockShared(oFT);
+   FT_lockTree(oFT);
+   iStatus = FT_writeChunksUnlocked(oFT, pfWrite, pvExtra);
+   FT_unlockTree(oFT);
+   FT_unlock(oFT);
+   return iStatus;
+}
 
-   iStatus = FT_findNode(pcPath, &oNFound);
-   if(iStatus != SUCCESS)
-       return iStatus;
-   if(NodeFT_isFile(oNFound)) {
-      return NOT_A_DIRECTORY;
-   }
-   ulCount -= NodeFT_free(oNFound);
-   if(ulCount == 0)
-      oNRoot = NULL;
+int FT_writeToIn(FT_T oFT, FILE *psFile) {
+   int iStatus;
 
-   /* assert(CheckerFT_isValid(bIsInitialized, oNRoot, ulCount)); */ 
-   return SUCCESS;
+   FT_lockShared(oFT);
+   FT_lockTree(oFT);
+   iStatus = FT_writeToUnlocked(oFT, psFile);
+   FT_unlockTree(oFT);
+   FT_unlock(oFT);
+   return iStatus;
 }
 
+/* --------------------------------------------------------------------
 
-int FT_init(void) {
-
-   if(bIsInitialized)
-      return INITIALIZATION_ERROR;
+  The following functions operate on the default FT.
+*/
 
-   bIsInitialized = TRUE;
-   oNRoot = NULL;
-   ulCount = 0;
+int FT_insertDir(const char *pcPath) {
+   return FT_insertDirIn(&sDefault, pcPath);
+}
 
-   return SUCCESS;
+boolean FT_containsDir(const char *pcPath) {
+   return FT_containsDirIn(&sDefault, pcPath);
 }
 
-int FT_destroy(void) {
+int FT_rmDir(const char *pcPath) {
+   return FT_rmDirIn(&sDefault, pcPath);
+}
 
-   if(!bIsInitialized)
-      return INITIALIZATION_ERROR;
+int FT_move(const char *pcFrom, const char *pcTo) {
+   return FT_moveIn(&sDefault, pcFrom, pcTo);
+}
 
-   if(oNRoot) {
-      ulCount -= NodeFT_free(oNRoot);
-      oNRoot = NULL;
-   }
+int FT_insertFile(const char *pcPath, void *pvContents,
+                  size_t ulLength) {
+   return FT_insertFileIn(&sDefault, pcPath, pvContents, ulLength);
+}
 
-   bIsInitialized = FALSE;
+int FT_insertFiles(const char **ppcPaths, void **ppvContents,
+                   size_t *pulLengths, size_t ulNumFiles,
+                   int *piStatuses) {
+   return FT_insertFilesIn(&sDefault, ppcPaths, ppvContents, pulLengths,
+                           ulNumFiles, piStatuses);
+}
 
-   return SUCCESS;
+int FT_save(const char *pcFile, boolean bContents) {
+   return FT_saveIn(&sDefault, pcFile, bContents);
 }
 
+int FT_load(const char *pcFile) {
+   return FT_loadIn(&sDefault, pcFile);
+}
 
-/* --------------------------------------------------------------------
+int FT_saveImage(const char *pcFile, boolean bContents) {
+   return FT_saveImageIn(&sDefault, pcFile, bContents);
+}
 
-  The following auxiliary functions are used for generating the
-  string representation of the ft.
-*/
+int FT_bgsave(const char *pcFile, boolean bContents,
+              FTBgsave_T *poBgsave) {
+   return FT_bgsaveIn(&sDefault, pcFile, bContents, poBgsave);
+}
 
-/*
-  Performs a pre-order traversal of the tree rooted at n,
-  inserting each payload to DynArray_T d beginning at index i.
-  Returns the next unused index in d after the insertion(s).
-*/
-static size_t FT_preOrderTraversal(Node_T n, DynArray_T d, size_t i) {
-   size_t c;
+int FT_loadManifest(const char *pcFile) {
+   return FT_loadManifestIn(&sDefault, pcFile);
+}
 
-   assert(d != NULL);
+boolean FT_containsFile(const char *pcPath) {
+   return FT_containsFileIn(&sDefault, pcPath);
+}
 
-   if(n != NULL) {
-      (void) DynArray_set(d, i, n);
-      i++;
-      for(c = 0; c < NodeFT_getNumFileChildren(n); c++) {
-         int iStatus;
-         Node_T oNChild = NULL;
-         iStatus = NodeFT_getFileChild(n,c, &oNChild);
-         assert(iStatus == SUCCESS);
-         DynArray_set(d, i, oNChild);
-         i++;
-      }
-      for(c = 0; c < NodeFT_getNumDirectoryChildren(n); c++) {
-         int iStatus;
-         Node_T oNChild = NULL;
-         iStatus = NodeFT_getDirectoryChild(n, c, &oNChild);
-         assert(iStatus == SUCCESS);
-         i = FT_preOrderTraversal(oNChild, d, i);
-      }
-   }
-   return i;
+int FT_rmFile(const char *pcPath) {
+   return FT_rmFileIn(&sDefault, pcPath);
 }
 
-/*
-  Alternate version of strlen that uses pulAcc as an in-out parameter
-  to accumulate a string length, rather than returning the length of
-  oNNode's path, and also always adds one addition byte to the sum.
-*/
-static void FT_strlenAccumulate(Node_T oNNode, size_t *pulAcc) {
-   assert(pulAcc != NULL);
+void *FT_getFileContents(const char *pcPath) {
+   return FT_getFileContentsIn(&sDefault, pcPath);
+}
 
-   if(oNNode != NULL)
-      *pulAcc += (Path_getStrLength(NodeFT_getPath(oNNode)) + 1);
+void *FT_replaceFileContents(const char *pcPath, void *pvNewContents,
+                             size_t ulNewLength) {
+   return FT_replaceFileContentsIn(&sDefault, pcPath, pvNewContents,
+                                   ulNewLength);
 }
 
-/*
-  Alternate version of strcat that inverts the typical argument
-  order, appending oNNode's path onto pcAcc, and also always adds one
-  newline at the end of the concatenated string.
-*/
-static void FT_strcatAccumulate(Node_T oNNode, char *pcAcc) {
-   assert(pcAcc != NULL);
+int FT_stat(const char *pcPath, boolean *pbIsFile, size_t *pulSize) {
+   return FT_statIn(&sDefault, pcPath, pbIsFile, pulSize);
+}
 
-   if(oNNode != NULL) {
-      strcat(pcAcc, Path_getPathname(NodeFT_getPath(oNNode)));
-      strcat(pcAcc, "\n");
-   }
+int FT_statMany(const char **ppcPaths, size_t ulNumPaths,
+                boolean *pbIsFile, size_t *pulSizes, int *piStatuses) {
+   return FT_statManyIn(&sDefault, ppcPaths, ulNumPaths, pbIsFile,
+                        pulSizes, piStatuses);
 }
-/*--------------------------------------------------------------------*/
 
-char *FT_toString(void) {
-   DynArray_T nodes;
-   size_t totalStrlen = 1;
-   char *result = NULL;
+int FT_setIndexed(boolean bIndexed) {
+   return FT_setIndexedIn(&sDefault, bIndexed);
+}
 
-   if(!bIsInitialized)
-      return NULL;
+int FT_setSynchronized(boolean bSynchronized) {
+   return FT_setSynchronizedIn(&sDefault, bSynchronized);
+}
 
-   nodes = DynArray_new(ulCount);
-   (void) FT_preOrderTraversal(oNRoot, nodes, 0);
+int FT_setJournal(const char *pcCheckpointFile,
+                  const char *pcJournalFile) {
+   return FT_setJournalIn(&sDefault, pcCheckpointFile, pcJournalFile);
+}
 
-   DynArray_map(nodes, (void (*)(void *, void*)) FT_strlenAccumulate,
-                (void*) &totalStrlen);
+int FT_checkpoint(void) {
+   return FT_checkpointIn(&sDefault);
+}
 
-   result = malloc(totalStrlen);
-   if(result == NULL) {
-      DynArray_free(nodes);
-      return NULL;
-   }
-   *result = '\0';
+int FT_setArena(boolean bArena) {
+   return FT_setArenaIn(&sDefault, bArena);
+}
 
-   DynArray_map(nodes, (void (*)(void *, void*)) FT_strcatAccumulate,
-                (void *) result);
+int FT_setLockFreeReads(boolean bLockFree) {
+   return FT_setLockFreeReadsIn(&sDefault, bLockFree);
+}
 
-   DynArray_free(nodes);
+int FT_iterOpen(const char *pcToken, FTIter_T *poIter) {
+   return FT_iterOpenIn(&sDefault, pcToken, poIter);
+}
 
-   return result;
+int FT_setToStringThreads(size_t ulThreads) {
+   return FT_setToStringThreadsIn(&sDefault, ulThreads);
 }
 
-int FT_stat(const char *pcPath, boolean *pbIsFile, size_t *pulSize) { /*NOT DONE?*/
-   int status;
-   Node_T foundNode = NULL;
-   if(!bIsInitialized) {
-      return(INITIALIZATION_ERROR);
-   }
-   status = FT_findNode(pcPath, foundNode);
-   if(status != SUCCESS) {
-      return status;
-   }
-   if(!NodeFT_isFile(foundNode)) {
-      *pbIsFile = FALSE;
-      return SUCCESS;
-   } else { /*We know that it's a file*/
-      *pbIsFile = TRUE;
-      *pulSize = NodeFT_getFileLength(foundNode);
-      return SUCCESS;
-   }
+char *FT_toString(void) {
+   return FT_toStringIn(&sDefault);
 }
 
-void *FT_getFileContents(const char *pcPath) { /*NOT DONE*/
-   void* contents;
-   Node_T file = NULL;
-   int status;
-   if(!bIsInitialized) {
-      return NULL;
-   }
-   status = FT_findNode(pcPath, file);
-   if(status != SUCCESS) {
-      return NULL;
-   }
-   if(!NodeFT_isFile(file)) {
-      return NULL;
-   } else {
-      return NodeFT_getFileContents(file);
-   }
+int FT_writeChunks(int (*pfWrite)(const char *pcChunk, size_t ulLength,
+                                  void *pvExtra),
+                   void *pvExtra) {
+   return FT_writeChunksIn(&sDefault, pfWrite, pvExtra);
 }
 
-void *FT_replaceFileContents(const char *pcPath, void *pvNewContents,
-                             size_t ulNewLength) { /*NOT DONE*/
-   void* oldContents = NULL;
-   Node_T file = NULL;
-   int status;
-   if(!bIsInitialized) {
-      return NULL;
-   }
-   status = FT_findNode(pcPath, file);
-   if(status != SUCCESS) {
-      return NULL;
-   }
-   if(!NodeFT_isFile(file)) {
-      return NULL;
-   } else {
-      oldContents = FT_getFileContents(file);
-      NodeFT_setFile(file, pvNewContents, ulNewLength);
-      return oldContents;
-   }
-}
\ No newline at end of file
+int FT_writeTo(FILE *psFile) {
+   return FT_writeToIn(&sDefault, psFile);
+}
@@ -13,8 +13,28 @@
 */
 
 #include <stddef.h>
+#include <stdio.h>
 #include "a4def.h"
 
+/*
+  An FT_T is a handle to one File Tree. A process may hold any number
+  of them. The functions that take no handle all operate on a single
+  default FT, which FT_init and FT_destroy manage.
+*/
+typedef struct FT *FT_T;
+
+/*
+  An FTIter_T is a place in a walk over one FT in the order of
+  FT_toString (see FT_iterOpen).
+*/
+typedef struct FTIter *FTIter_T;
+
+/*
+  An FTBgsave_T is a save of one FT under way in the background (see
+  FT_bgsave).
+*/
+typedef struct FTBgsave *FTBgsave_T;
+
 /*
    Inserts a new directory into the FT with absolute path pcPath.
    Returns SUCCESS if the new directory is inserted successfully.
@@ -44,9 +64,32 @@ boolean FT_containsDir(const char *pcPath);
   * NO_SUCH_PATH if absolute path pcPath does not exist in the FT
   * NOT_A_DIRECTORY if pcPath is in the FT as a file not a directory
   * MEMORY_ERROR if memory could not be allocated to complete request
+
+  The subtree leaves the FT, and its nodes leave the count, before
+  FT_rmDir returns, but a large subtree's memory is freed afterwards
+  by a background thread (see FT_getPendingReclaim).
 */
 int FT_rmDir(const char *pcPath);
 
+/*
+  Moves the file or directory with absolute path pcFrom, along with
+  everything beneath it, to absolute path pcTo, whose parent must
+  already exist as a directory. Renaming the root is a move to a
+  one-component path. The subtree is relinked whole, in time that does
+  not depend on its size, except that with the index on every path in
+  it is filed anew.
+  Returns SUCCESS if moved. Otherwise, returns:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * BAD_PATH if pcFrom or pcTo does not represent a well-formatted path
+  * CONFLICTING_PATH if the root is not a prefix of pcFrom or pcTo,
+                     or if pcTo lies beneath pcFrom
+  * NO_SUCH_PATH if pcFrom, or pcTo's parent, does not exist in the FT
+  * NOT_A_DIRECTORY if pcTo's parent is in the FT as a file
+  * ALREADY_IN_TREE if pcTo is already in the FT (as dir or file)
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int FT_move(const char *pcFrom, const char *pcTo);
+
 
 /*
    Inserts a new file into the FT with absolute path pcPath, with
@@ -64,6 +107,138 @@ int FT_rmDir(const char *pcPath);
 int FT_insertFile(const char *pcPath, void *pvContents,
                   size_t ulLength);
 
+/*
+  Inserts ulNumFiles files into the FT at once: file i has absolute
+  path ppcPaths[i] and contents ppvContents[i] of size pulLengths[i]
+  bytes. Sets piStatuses[i] to the status that FT_insertFile would
+  return for file i, as if the files were inserted one at a time in
+  order of path (by strcmp), with equal paths in the order given.
+  So a file may become a directory for a later path only if that path
+  sorts before it; otherwise the later path gets NOT_A_DIRECTORY.
+  Rather than starting from the root for each file, each file starts
+  from the deepest directory it shares with the one before it, so
+  batches whose paths share long prefixes insert far faster than the
+  same files one at a time.
+  Returns SUCCESS once every file has its status, or:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * MEMORY_ERROR if memory could not be allocated to sort the batch
+  in which case every piStatuses[i] is set to that status and the FT
+  is unchanged.
+*/
+int FT_insertFiles(const char **ppcPaths, void **ppvContents,
+                   size_t *pulLengths, size_t ulNumFiles,
+                   int *piStatuses);
+
+/*
+  Loads the empty FT from the manifest file named pcFile, a list of
+  absolute paths one per line, as described for Manifest_read in
+  manifest.h: "path" or "path<TAB>size" names a file of that many
+  bytes (0 if no size is given), whose contents are NULL, and "path/"
+  names a directory. Directories that are not listed but lie along a
+  listed path are created too. The tree is built bottom-up, giving
+  each directory all of its children at once, which is far faster
+  than inserting the same paths one at a time. The lines may come in
+  any order, but they load fastest already sorted as strcmp would
+  sort them if '/' came before every other character, since
+  otherwise they are sorted first.
+  The load is all or nothing. Returns SUCCESS, or:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * ALREADY_IN_TREE if the FT is not empty, or a path is listed twice
+  * IO_ERROR if pcFile could not be opened or read
+  * BAD_PATH if a path is not well-formatted or a size is malformed
+  * CONFLICTING_PATH if the paths do not all share one first
+                     component, or a file would be the FT root
+  * NOT_A_DIRECTORY if a proper prefix of a path is listed as a file
+  * MEMORY_ERROR if memory could not be allocated to complete request
+  in which case the FT is left empty.
+*/
+int FT_loadManifest(const char *pcFile);
+
+/*
+  Saves the FT to the file named pcFile, replacing any file of that
+  name, in the compact binary form described in treefile.h: the nodes
+  in the order FT_toString lists them, each stored by its name alone
+  with its size or its number of children, and, if bContents, each
+  file's contents, which must then be at least as long as its size.
+  An empty FT saves as a file with no nodes. The save is written to
+  a new file, named pcFile followed by '.' and six characters that
+  no other file has, and renamed over pcFile only once it is whole,
+  so saves to the same pcFile at once, from any threads or
+  processes, each leave it whole. Returns SUCCESS, or:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * IO_ERROR if pcFile could not be created or written
+  * MEMORY_ERROR if memory could not be allocated to complete request
+  in which case any earlier pcFile is left as it was.
+*/
+int FT_save(const char *pcFile, boolean bContents);
+
+/*
+  Loads the empty FT from the file named pcFile, which FT_save wrote,
+  in one pass that builds the tree bottom-up as FT_loadManifest does,
+  without forming or looking up a single path. If the file was saved
+  with contents, each file's contents are a new block from malloc,
+  which the client then owns as it would contents it inserted;
+  otherwise they are NULL. The load is all or nothing. Returns
+  SUCCESS, or:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * ALREADY_IN_TREE if the FT is not empty
+  * CONFLICTING_PATH if the saved root is a file
+  * IO_ERROR if pcFile could not be opened or read, or is not a save
+             file, or is malformed or cut short
+  * MEMORY_ERROR if memory could not be allocated to complete request
+  in which case the FT is left empty.
+*/
+int FT_load(const char *pcFile);
+
+/*
+  Saves the FT to the file named pcFile, replacing any file of that
+  name, as an image for FT_openImage (see treeimage.h), with each
+  file's contents if bContents, which must then be at least as long
+  as its size. Returns SUCCESS, or:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * IO_ERROR if pcFile could not be created or written
+  * MEMORY_ERROR if memory could not be allocated to complete request
+  in which case pcFile may be left incomplete.
+*/
+int FT_saveImage(const char *pcFile, boolean bContents);
+
+/*
+  Saves the FT to the file named pcFile as FT_save does, but in the
+  background: forks a child process, which writes the FT as it was at
+  the fork while this process goes on changing it. The two share the
+  FT's memory, and the kernel copies a page only when this process
+  changes it, so the FT is held, in synchronized mode exclusively,
+  only while the fork copies the page tables, whatever the save then
+  takes. The child writes to a new file named as FT_save names its
+  own, and renames that over pcFile only once it is whole and
+  durable, so a save that fails or is cut short leaves any earlier
+  pcFile as it was; the new pcFile is in place once FT_bgsaveFinish
+  reports SUCCESS. Returns SUCCESS and sets *poBgsave to the save
+  under way if successful. Otherwise, sets *poBgsave to NULL and
+  returns status:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * IO_ERROR if the new file could not be made or the process could
+             not be forked
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int FT_bgsave(const char *pcFile, boolean bContents,
+              FTBgsave_T *poBgsave);
+
+/*
+  Returns TRUE if the save oBgsave, which FT_bgsave started, has
+  ended, and FALSE if it is still under way, without waiting.
+*/
+boolean FT_bgsaveIsDone(FTBgsave_T oBgsave);
+
+/*
+  Waits for the save oBgsave, which FT_bgsave started, to end, and
+  frees oBgsave. Sets *pulLength to the number of bytes written to
+  the save file, or to 0 if the save failed. Returns the status with
+  which FT_save would have returned, or IO_ERROR if the child ended
+  without reporting one.
+*/
+int FT_bgsaveFinish(FTBgsave_T oBgsave, size_t *pulLength);
+
 /*
   Returns TRUE if the FT contains a file with absolute path
   pcPath and FALSE if not or if there is an error while checking.
@@ -119,11 +294,31 @@ void *FT_replaceFileContents(const char *pcPath, void *pvNewContents,
 */
 int FT_stat(const char *pcPath, boolean *pbIsFile, size_t *pulSize);
 
+/*
+  Looks up ulNumPaths paths at once: for each path ppcPaths[i], sets
+  piStatuses[i] to the status that FT_stat would return for it and,
+  when that is SUCCESS, sets pbIsFile[i] and pulSizes[i] as FT_stat
+  would set *pbIsFile and *pulSize, except that pulSizes[i] is 0 for
+  a directory. For any other status, pbIsFile[i] is FALSE and
+  pulSizes[i] is 0. Each path is looked up starting from the deepest
+  directory it shares with the path before it, so batches in which
+  paths under the same directory are adjacent walk far less of the
+  FT than the same lookups one at a time.
+  Returns SUCCESS once every path has its status, or:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * MEMORY_ERROR if memory could not be allocated to sort the batch
+  in which case every piStatuses[i] is set to that status.
+*/
+int FT_statMany(const char **ppcPaths, size_t ulNumPaths,
+                boolean *pbIsFile, size_t *pulSizes, int *piStatuses);
+
 /*
   Sets the FT data structure to an initialized state.
-  The data structure is initially empty.
+  The data structure is initially empty, unless FT_setJournal has
+  named its files, in which case it is recovered from them.
   Returns INITIALIZATION_ERROR if already initialized,
-  and SUCCESS otherwise.
+  and SUCCESS otherwise, or the status with which recovery failed
+  (see FT_setJournal), in which case the FT is left uninitialized.
 */
 int FT_init(void);
 
@@ -131,10 +326,170 @@ int FT_init(void);
   Removes all contents of the data structure and
   returns it to an uninitialized state.
   Returns INITIALIZATION_ERROR if not already initialized,
-  and SUCCESS otherwise.
+  and SUCCESS otherwise. As with FT_rmDir, a large tree's memory is
+  freed afterwards by a background thread, unless the FT uses an
+  arena (see FT_setArena), which is emptied a chunk at a time in time
+  independent of the number of nodes. A journal is closed, but its
+  files stay named for the next FT_init.
 */
 int FT_destroy(void);
 
+/*
+  Returns the number of nodes that FT_rmDir, FT_destroy and FT_free,
+  for every FT, have removed but whose memory the background thread
+  has not yet freed.
+*/
+size_t FT_getPendingReclaim(void);
+
+/*
+  Waits until the background thread has freed every node removed
+  before the call, so that, for instance, a leak checker run at exit
+  sees none of them.
+*/
+void FT_waitReclaim(void);
+
+/*
+  Turns the whole-tree path index on (bIndexed is TRUE) or off.
+  While the index is on, every node is also filed under its absolute
+  path, so an exact lookup by FT_containsDir, FT_containsFile,
+  FT_stat, FT_getFileContents, FT_replaceFileContents, FT_rmDir and
+  FT_rmFile is a single hash probe rather than a walk from the root,
+  at the cost of extra work and memory on every insertion and
+  removal. Turning the index on visits every node already in the FT.
+  The index is off after FT_init.
+  Returns SUCCESS, or:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * MEMORY_ERROR if memory could not be allocated for the index, in
+                 which case the index is left off
+*/
+int FT_setIndexed(boolean bIndexed);
+
+/*
+  Turns synchronized mode on (bSynchronized is TRUE) or off. While it
+  is on, the FT may be used from any number of threads at once. Each
+  directory has its own reader-writer lock, and every call locks its
+  way down pcPath from the root, holding a directory exclusively only
+  where it changes it. So lookups run concurrently with one another,
+  and FT_insertDir, FT_insertFile, FT_rmDir, FT_rmFile and
+  FT_replaceFileContents run concurrently with lookups and with each
+  other except where their paths meet: two changes wait for each
+  other only at the deepest directory they both change, and any call
+  that passes through a directory being removed waits until the
+  removal is done. FT_toString, FT_writeChunks and FT_writeTo hold
+  off every change, though not lookups, while they run, so they see
+  the FT as it was at one moment.
+  FT_statMany holds each directory along its current path shared,
+  and lets go of it only once the batch has moved past it; FT_iterNext
+  holds the directories along its path shared until it returns.
+  FT_insertFiles, FT_loadManifest, FT_load, FT_move and FT_setIndexed
+  hold the whole FT exclusively, as does every change while the FT
+  has snapshots not yet released (see FT_snapshot) or is journaled
+  (see FT_setJournal).
+  FT_init, FT_destroy and this function itself are never
+  synchronized, and must not overlap any other call on the same FT.
+  Synchronized mode is off after FT_init.
+  Returns SUCCESS, or:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * MEMORY_ERROR if the locks could not be created, in which case
+                 synchronized mode is left off
+*/
+int FT_setSynchronized(boolean bSynchronized);
+
+/*
+  Turns lock-free reads on (bLockFree is TRUE) or off. While they are
+  on, FT_containsDir, FT_containsFile, FT_stat, FT_statMany and
+  FT_getFileContents look their paths up without taking the lock, so
+  they neither wait for nor hold up a change; a lookup that a change
+  overlapped is retried, and after a few tries takes the lock shared
+  after all. Memory that a change removes is freed only once no
+  lookup can still see it.
+  Turning lock-free reads on also turns synchronized mode on, and
+  turning synchronized mode off also turns them off. Like
+  FT_setSynchronized, this function must not overlap any other call
+  on the same FT.
+  Lock-free reads are off after FT_init.
+  Returns SUCCESS, or:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * MEMORY_ERROR if the lock could not be created, in which case
+                 lock-free reads are left off
+
+  While they are on, a change may also fail with MEMORY_ERROR (or,
+  for FT_replaceFileContents, return NULL) if memory could not be
+  allocated to track deferred freeing.
+*/
+int FT_setLockFreeReads(boolean bLockFree);
+
+/*
+  Makes the FT durable, with pcCheckpointFile and pcJournalFile as
+  the names of its checkpoint and its journal (see journal.h), or, if
+  both are NULL, stops doing so. Each successful FT_insertDir,
+  FT_insertFile, FT_insertFiles, FT_rmDir, FT_rmFile, FT_move and
+  FT_replaceFileContents is then logged to the journal, with the
+  contents of any file inserted or replaced, and returns only once
+  the record is on disk. Records logged by several threads meanwhile
+  share one fsync, so concurrent changes cost far fewer than one each.
+  FT_checkpoint saves the whole tree and empties the journal, as do
+  FT_loadManifest and FT_load after loading. If the FT is in an
+  initialized state, it must be empty, and is at once recovered: the
+  checkpoint, if there is one, is loaded as by FT_load, and the
+  changes in the journal since are made again; otherwise, the FT is
+  recovered when FT_init next initializes it. Recovered contents are
+  new blocks from malloc, which the client then owns as it would
+  contents it inserted. A journal cut short by a crash recovers every
+  change that returned; changes after the first record found
+  damaged are lost. Returns SUCCESS, or:
+  * INITIALIZATION_ERROR if the FT is a snapshot or an image
+  * ALREADY_IN_TREE if the FT is in an initialized state and not empty
+  * IO_ERROR if a file could not be read or written, or the
+             checkpoint is damaged
+  * MEMORY_ERROR if memory could not be allocated to complete request
+  in which case the FT is left empty and not durable.
+
+  While the FT is durable, a change that succeeded in memory but
+  could not be logged returns IO_ERROR or MEMORY_ERROR, and may not
+  survive a crash; FT_replaceFileContents cannot report this. Every
+  later change fails likewise until FT_checkpoint succeeds.
+*/
+int FT_setJournal(const char *pcCheckpointFile,
+                  const char *pcJournalFile);
+
+/*
+  Saves the durable FT, with contents, as its new checkpoint, and
+  empties its journal, so that recovery need not replay what the
+  journal held. The checkpoint is written to a new file, which then
+  replaces the old one, so that a crash at any point leaves files
+  that recover the FT. Returns SUCCESS, or:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state, or
+                         not durable
+  * IO_ERROR if the checkpoint or journal could not be written
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int FT_checkpoint(void);
+
+/*
+  Turns the FT's arena on (bArena is TRUE) or off. While it is on,
+  every node, and every array and table that a directory keeps of its
+  children, is carved from large chunks that belong to the FT, rather
+  than allocated one block at a time, and FT_destroy releases the
+  chunks without visiting any node. Memory that a change frees is not
+  reused, but kept until the arena is emptied, so the arena suits an
+  FT that is built up and then destroyed whole; FT_rmDir and
+  FT_rmFile never hand nodes from it to the background thread. The
+  FT must be empty, since its nodes all come from one place; turning
+  the arena off releases it. Like FT_setSynchronized, this function
+  must not overlap any other call on the same FT. The arena is off
+  after FT_new, and the default FT keeps its setting across
+  FT_destroy and FT_init, so that a journaled FT is recovered into it.
+  Returns SUCCESS, or:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state, or
+                         bArena is FALSE and a snapshot of the FT has
+                         not been released
+  * ALREADY_IN_TREE if the FT is not empty
+  * MEMORY_ERROR if memory could not be allocated for the arena, in
+                 which case it is left off
+*/
+int FT_setArena(boolean bArena);
+
 /*
   Returns a string representation of the
   data structure, or NULL if the structure is
@@ -149,4 +504,203 @@ int FT_destroy(void);
 */
 char *FT_toString(void);
 
+/*
+  Sets the number of threads that FT_toString uses to ulThreads, or 1
+  if ulThreads is 0. With more than one, FT_toString splits the tree
+  into subtrees at the first level with several directories for each
+  thread; the threads measure the subtrees, and then, each knowing
+  where its subtrees' text begins, copy them straight into the
+  result, which is exactly as with a single thread. FT_writeChunks
+  and FT_writeTo, which stream the tree node by node, still use one.
+  FT_toString uses one thread after FT_init.
+  Returns SUCCESS, or:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+*/
+int FT_setToStringThreads(size_t ulThreads);
+
+/*
+  Streams the representation that FT_toString would return to the
+  client, one node at a time, without building it in memory: for
+  each node in turn, calls (*pfWrite)(pcChunk, ulLength, pvExtra),
+  where the ulLength characters at pcChunk are the node's absolute
+  path followed by a newline. pcChunk is not '\0'-terminated and is
+  valid only during the call. pfWrite returns SUCCESS to continue;
+  any other status stops the traversal and is returned.
+  Beyond the client's sink, uses memory only for the longest path.
+  Returns SUCCESS, or:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * MEMORY_ERROR if memory could not be allocated for the path
+  * the first status other than SUCCESS returned by pfWrite
+*/
+int FT_writeChunks(int (*pfWrite)(const char *pcChunk, size_t ulLength,
+                                  void *pvExtra),
+                   void *pvExtra);
+
+/*
+  Writes the representation that FT_toString would return to the
+  stream psFile, one node at a time, as with FT_writeChunks.
+  Returns SUCCESS, or:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * MEMORY_ERROR if memory could not be allocated for the path
+  * IO_ERROR if writing to psFile fails
+*/
+int FT_writeTo(FILE *psFile);
+
+/*
+  Starts a walk over the FT that returns its nodes one at a time, in
+  the order of FT_toString: each directory, then its files, then each
+  of its directories in turn, siblings in order of name. If pcToken
+  is NULL or "", the walk starts from the root; otherwise it starts
+  after the node that a token from FT_iterGetToken marks, even in
+  another walk and after the FT has changed. Returns SUCCESS and sets
+  *poIter to the new walk if successful. Otherwise, sets *poIter to
+  NULL and returns status:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * BAD_PATH if pcToken did not come from FT_iterGetToken
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int FT_iterOpen(const char *pcToken, FTIter_T *poIter);
+
+/*
+  Moves oIter on to the next node, setting *ppcPath to its absolute
+  path, which is valid until the next call on oIter, *pbIsFile to
+  TRUE if it is a file, and *pulSize to its size in bytes, or 0 for a
+  directory. The walk holds no node between calls, only the path of
+  the last: it needs memory only for that path, and the FT may change
+  between calls, in which case the walk goes on from where that path
+  lies in the FT's new order, whether or not its node remains. If the
+  root is replaced, the walk ends. Returns SUCCESS, or sets *ppcPath
+  to NULL and returns status:
+  * NO_SUCH_PATH if no nodes remain
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * MEMORY_ERROR if memory could not be allocated for the path, in
+                 which case oIter stays where it was
+*/
+int FT_iterNext(FTIter_T oIter, const char **ppcPath, boolean *pbIsFile,
+                size_t *pulSize);
+
+/*
+  Returns a token marking oIter's place, the last node it returned,
+  for FT_iterOpen to resume from; it is a '\0'-terminated string that
+  the client may store anywhere, and is valid until the next call on
+  oIter. Before the first node, the token is "".
+*/
+const char *FT_iterGetToken(FTIter_T oIter);
+
+/* Frees oIter, which may be NULL. */
+void FT_iterClose(FTIter_T oIter);
+
+/*
+  Returns a new, empty FT that is independent of the default FT and
+  of every other FT_T, or NULL if memory could not be allocated. The
+  new FT is already in an initialized state, with synchronized mode
+  off.
+*/
+FT_T FT_new(void);
+
+/*
+  Removes all contents of oFT, closes its journal, if any, and frees
+  it, along with its arena, if any. oFT must have come from FT_new,
+  and every snapshot of it must have been released.
+*/
+void FT_free(FT_T oFT);
+
+/*
+  Returns a snapshot of the default FT: a new FT_T that keeps the
+  contents the FT has now, however the FT changes afterwards, or NULL
+  if the FT is not in an initialized state or memory could not be
+  allocated. Taking it costs O(1): the snapshot shares the FT's
+  nodes, and each later change to the FT first copies the shared
+  nodes along its own path, so no change is ever seen through the
+  snapshot and none costs more than copying that path's directories.
+  The snapshot may be read with any of the "In" functions below that
+  do not change an FT, by any number of threads at once and without
+  locks, however long they take; the rest fail with
+  INITIALIZATION_ERROR (or return NULL). While any snapshot remains,
+  changes to the FT in synchronized mode hold the whole FT
+  exclusively. A snapshot must be released with FT_snapshotRelease
+  before FT_destroy is called, and may not itself be snapshotted.
+*/
+FT_T FT_snapshot(void);
+
+/*
+  Releases oFTSnapshot, which FT_snapshot or FT_snapshotIn made and
+  which no call may still be reading, freeing whatever it alone still
+  holds. oFTSnapshot may be NULL.
+*/
+void FT_snapshotRelease(FT_T oFTSnapshot);
+
+/*
+  Opens the image named pcFile, which FT_saveImage wrote, as a new
+  read-only FT_T whose reads go straight to the image, mapped into
+  memory, rather than to nodes: opening it costs O(1) however large
+  the tree, and every process that opens the same image shares one
+  copy of it in memory. FT_containsDirIn, FT_containsFileIn,
+  FT_getFileContentsIn, FT_statIn, FT_statManyIn and FT_iterOpenIn
+  serve it, by any number of threads at once and without locks; the
+  rest fail with INITIALIZATION_ERROR (or return NULL or FALSE). The
+  contents that FT_getFileContentsIn returns lie in the image itself,
+  and must not be changed or freed. If the image proves damaged, the
+  calls that read the damaged part return IO_ERROR (or NULL or
+  FALSE). Returns SUCCESS and sets *poFTImage to the new FT if
+  successful. Otherwise, sets *poFTImage to NULL and returns status:
+  * IO_ERROR if pcFile could not be opened or mapped, or is not an
+             image written on a machine like this one
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int FT_openImage(const char *pcFile, FT_T *poFTImage);
+
+/*
+  Closes oFTImage, which FT_openImage opened and which no call may
+  still be reading, unmapping its image. oFTImage may be NULL.
+*/
+void FT_closeImage(FT_T oFTImage);
+
+/*
+  Each of the following behaves exactly as the function above of the
+  same name without the "In" suffix, but on oFT rather than on the
+  default FT.
+*/
+int FT_insertDirIn(FT_T oFT, const char *pcPath);
+boolean FT_containsDirIn(FT_T oFT, const char *pcPath);
+int FT_rmDirIn(FT_T oFT, const char *pcPath);
+int FT_moveIn(FT_T oFT, const char *pcFrom, const char *pcTo);
+int FT_insertFileIn(FT_T oFT, const char *pcPath, void *pvContents,
+                    size_t ulLength);
+int FT_insertFilesIn(FT_T oFT, const char **ppcPaths,
+                     void **ppvContents, size_t *pulLengths,
+                     size_t ulNumFiles, int *piStatuses);
+int FT_loadManifestIn(FT_T oFT, const char *pcFile);
+int FT_saveIn(FT_T oFT, const char *pcFile, boolean bContents);
+int FT_loadIn(FT_T oFT, const char *pcFile);
+int FT_saveImageIn(FT_T oFT, const char *pcFile, boolean bContents);
+int FT_bgsaveIn(FT_T oFT, const char *pcFile, boolean bContents,
+                FTBgsave_T *poBgsave);
+boolean FT_containsFileIn(FT_T oFT, const char *pcPath);
+int FT_rmFileIn(FT_T oFT, const char *pcPath);
+void *FT_getFileContentsIn(FT_T oFT, const char *pcPath);
+void *FT_replaceFileContentsIn(FT_T oFT, const char *pcPath,
+                               void *pvNewContents, size_t ulNewLength);
+int FT_statIn(FT_T oFT, const char *pcPath, boolean *pbIsFile,
+              size_t *pulSize);
+int FT_statManyIn(FT_T oFT, const char **ppcPaths, size_t ulNumPaths,
+                  boolean *pbIsFile, size_t *pulSizes,
+                  int *piStatuses);
+int FT_setIndexedIn(FT_T oFT, boolean bIndexed);
+int FT_setSynchronizedIn(FT_T oFT, boolean bSynchronized);
+int FT_setLockFreeReadsIn(FT_T oFT, boolean bLockFree);
+int FT_setArenaIn(FT_T oFT, boolean bArena);
+int FT_setJournalIn(FT_T oFT, const char *pcCheckpointFile,
+                    const char *pcJournalFile);
+int FT_checkpointIn(FT_T oFT);
+int FT_setToStringThreadsIn(FT_T oFT, size_t ulThreads);
+char *FT_toStringIn(FT_T oFT);
+int FT_writeChunksIn(FT_T oFT,
+                     int (*pfWrite)(const char *pcChunk,
+                                    size_t ulLength, void *pvExtra),
+                     void *pvExtra);
+int FT_writeToIn(FT_T oFT, FILE *psFile);
+int FT_iterOpenIn(FT_T oFT, const char *pcToken, FTIter_T *poIter);
+FT_T FT_snapshotIn(FT_T oFT);
+
 #endif
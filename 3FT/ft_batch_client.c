@@ -0,0 +1,339 @@
+/*--------------------------------------------------------------------*/
+/* ft_batch_client.c                                                  */
+/* Author: Matthew Okechukwu, Pinrui Huang                            */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "ft.h"
+
+/* The most files that a single batch holds */
+enum {MAX_BATCH = 512};
+
+/* The longest path that a batch holds, with its '\0' */
+enum {MAX_PATH = 64};
+
+/* The modes that a run may set on its FTs */
+enum {MODE_SYNCHRONIZED = 1, MODE_INDEXED = 2, MODE_ARENA = 4,
+      MODE_LOCK_FREE = 8};
+
+/* The file that the runs save their images in */
+static const char *pcImageFile = "ft_batch_client.img";
+
+/* The bytes that the batches' files hold: file i of a batch holds
+   the first i bytes of acContents, so that each has its own address
+   and its own length */
+static char acContents[MAX_BATCH];
+
+/* Returns a new FT in mode iMode */
+static FT_T newTree(int iMode) {
+  FT_T oFT;
+
+  oFT = FT_new();
+  assert(oFT != NULL);
+  if(iMode & MODE_ARENA)
+    assert(FT_setArenaIn(oFT, TRUE) == SUCCESS);
+  if(iMode & MODE_SYNCHRONIZED)
+    assert(FT_setSynchronizedIn(oFT, TRUE) == SUCCESS);
+  if(iMode & MODE_INDEXED)
+    assert(FT_setIndexedIn(oFT, TRUE) == SUCCESS);
+  if(iMode & MODE_LOCK_FREE)
+    assert(FT_setLockFreeReadsIn(oFT, TRUE) == SUCCESS);
+  return oFT;
+}
+
+/* Inserts the ulNumFiles files of ppcPaths into oFTBatch with one
+   call to FT_insertFilesIn, and into oFTSerial one FT_insertFileIn
+   at a time, in order of path with equal paths in the order given,
+   and checks that every file gets the same status both ways and
+   that the two FTs end up alike, down to each file's contents */
+static void checkBatch(FT_T oFTBatch, FT_T oFTSerial,
+                       const char **ppcPaths, size_t ulNumFiles) {
+  void *apvContents[MAX_BATCH];
+  size_t aulLengths[MAX_BATCH];
+  int aiStatuses[MAX_BATCH];
+  size_t aulOrder[MAX_BATCH];
+  char *pcBatch;
+  char *pcSerial;
+  boolean bBatchIsFile, bSerialIsFile;
+  size_t ulBatchSize, ulSerialSize;
+  size_t i, j, ulIndex;
+  int iStatus;
+
+  assert(ulNumFiles <= MAX_BATCH);
+  for(i = 0; i < ulNumFiles; i++) {
+    apvContents[i] = acContents;
+    aulLengths[i] = i;
+    aiStatuses[i] = -1;
+  }
+  assert(FT_insertFilesIn(oFTBatch, ppcPaths, apvContents, aulLengths,
+                          ulNumFiles, aiStatuses) == SUCCESS);
+
+  /* a stable insertion sort gives the order of the serial inserts */
+  for(i = 0; i < ulNumFiles; i++) {
+    for(j = i; j > 0 &&
+          strcmp(ppcPaths[aulOrder[j - 1]], ppcPaths[i]) > 0; j--)
+      aulOrder[j] = aulOrder[j - 1];
+    aulOrder[j] = i;
+  }
+  for(i = 0; i < ulNumFiles; i++) {
+    ulIndex = aulOrder[i];
+    iStatus = FT_insertFileIn(oFTSerial, ppcPaths[ulIndex],
+                              apvContents[ulIndex],
+                              aulLengths[ulIndex]);
+    assert(aiStatuses[ulIndex] == iStatus);
+  }
+
+  pcBatch = FT_toStringIn(oFTBatch);
+  pcSerial = FT_toStringIn(oFTSerial);
+  assert(pcBatch != NULL && pcSerial != NULL);
+  assert(!strcmp(pcBatch, pcSerial));
+  free(pcBatch);
+  free(pcSerial);
+
+  for(i = 0; i < ulNumFiles; i++) {
+    bBatchIsFile = bSerialIsFile = FALSE;
+    ulBatchSize = ulSerialSize = 0;
+    iStatus = FT_statIn(oFTBatch, ppcPaths[i], &bBatchIsFile,
+                        &ulBatchSize);
+    assert(FT_statIn(oFTSerial, ppcPaths[i], &bSerialIsFile,
+                     &ulSerialSize) == iStatus);
+    assert(bBatchIsFile == bSerialIsFile);
+    assert(ulBatchSize == ulSerialSize);
+    if(iStatus == SUCCESS && bBatchIsFile)
+      assert(FT_getFileContentsIn(oFTBatch, ppcPaths[i]) ==
+             FT_getFileContentsIn(oFTSerial, ppcPaths[i]));
+  }
+}
+
+/* Looks up the ulNumPaths paths of ppcPaths in oFT with one call to
+   FT_statManyIn, and checks that each gets the status that FT_statIn
+   gives it, with what FT_statIn sets on success and FALSE and 0
+   otherwise */
+static void checkStatMany(FT_T oFT, const char **ppcPaths,
+                          size_t ulNumPaths) {
+  boolean abIsFile[MAX_BATCH];
+  size_t aulSizes[MAX_BATCH];
+  int aiStatuses[MAX_BATCH];
+  boolean bIsFile;
+  size_t ulSize;
+  size_t i;
+  int iStatus;
+
+  assert(ulNumPaths <= MAX_BATCH);
+  /* every slot must be set, whatever it held */
+  for(i = 0; i < ulNumPaths; i++) {
+    abIsFile[i] = TRUE;
+    aulSizes[i] = MAX_BATCH;
+    aiStatuses[i] = -1;
+  }
+  assert(FT_statManyIn(oFT, ppcPaths, ulNumPaths, abIsFile, aulSizes,
+                       aiStatuses) == SUCCESS);
+  for(i = 0; i < ulNumPaths; i++) {
+    bIsFile = FALSE;
+    ulSize = 0;
+    iStatus = FT_statIn(oFT, ppcPaths[i], &bIsFile, &ulSize);
+    assert(aiStatuses[i] == iStatus);
+    assert(abIsFile[i] == bIsFile);
+    assert(aulSizes[i] == ulSize);
+  }
+}
+
+/* Fills apcPaths, using aacPaths for the paths it must build, with
+   paths to look up in the FT that runMode builds: its directories
+   and files, some twice and not all in order, along with missing
+   paths, paths through a file, and paths that are malformed or lie
+   outside the root. Returns the number of paths */
+static size_t fillStatPaths(char aacPaths[][MAX_PATH],
+                            const char **apcPaths) {
+  size_t ulNumPaths = 0;
+  int i;
+
+  apcPaths[ulNumPaths++] = "1root";
+  apcPaths[ulNumPaths++] = "1root/shared/deep";
+  for(i = 0; i < 400; i++) {
+    sprintf(aacPaths[ulNumPaths], "1root/shared/deep/d%d/e/f%d",
+            i % 7, i);
+    apcPaths[ulNumPaths] = aacPaths[ulNumPaths];
+    ulNumPaths++;
+    if(i % 50 == 0) {
+      sprintf(aacPaths[ulNumPaths], "1root/shared/deep/d%d/e",
+              (i + 3) % 7);
+      apcPaths[ulNumPaths] = aacPaths[ulNumPaths];
+      ulNumPaths++;
+      apcPaths[ulNumPaths++] = "1root/mixed/dir/new7";
+    }
+  }
+  apcPaths[ulNumPaths++] = "1root/shared/deep/d9/e/f1";
+  apcPaths[ulNumPaths++] = "1root/shared/deep/d0/e/f1";
+  apcPaths[ulNumPaths++] = "1root/nothere";
+  apcPaths[ulNumPaths++] = "1root/mixed/file/under";
+  apcPaths[ulNumPaths++] = "1root/shared/deep/d0/e/f0/g/h";
+  apcPaths[ulNumPaths++] = "1root/partial/b";
+  apcPaths[ulNumPaths++] = "1root/partial/b/under";
+  apcPaths[ulNumPaths++] = "1root//empty";
+  apcPaths[ulNumPaths++] = "/1root";
+  apcPaths[ulNumPaths++] = "1root/";
+  apcPaths[ulNumPaths++] = "";
+  apcPaths[ulNumPaths++] = "2other";
+  apcPaths[ulNumPaths++] = "2other/partial";
+  apcPaths[ulNumPaths++] = "1root";
+  return ulNumPaths;
+}
+
+/* Runs the batches in mode iMode: one of many files under a few
+   long shared prefixes, given out of order; one in which some files
+   fail and the rest must still go in; and one that mixes paths
+   already in the FT with new paths under them; then looks up a batch
+   of paths in the FT, in a snapshot of it and in an image of it */
+static void runMode(int iMode) {
+  static char aacPaths[MAX_BATCH][MAX_PATH];
+  const char *apcPaths[MAX_BATCH];
+  FT_T oFTBatch;
+  FT_T oFTSerial;
+  FT_T oFTOther;
+  size_t ulNumFiles;
+  int i;
+
+  oFTBatch = newTree(iMode);
+  oFTSerial = newTree(iMode);
+
+  /* lookups in an empty FT */
+  ulNumFiles = fillStatPaths(aacPaths, apcPaths);
+  checkStatMany(oFTBatch, apcPaths, ulNumFiles);
+  checkStatMany(oFTBatch, apcPaths, 0);
+
+  /* an empty batch changes nothing */
+  checkBatch(oFTBatch, oFTSerial, apcPaths, 0);
+
+  /* a lone file cannot be the root */
+  apcPaths[0] = "1root";
+  checkBatch(oFTBatch, oFTSerial, apcPaths, 1);
+
+  /* shared prefixes, in an order that jumps between them */
+  for(i = 0; i < 400; i++) {
+    sprintf(aacPaths[i], "1root/shared/deep/d%d/e/f%d",
+            ((i * 37) % 400) % 7, (i * 37) % 400);
+    apcPaths[i] = aacPaths[i];
+  }
+  checkBatch(oFTBatch, oFTSerial, apcPaths, 400);
+
+  /* partial failure: the bad paths fail, and the good ones after
+     them, in both the given order and the sorted order, go in */
+  ulNumFiles = 0;
+  apcPaths[ulNumFiles++] = "1root/partial/b";
+  apcPaths[ulNumFiles++] = "1root//empty";
+  apcPaths[ulNumFiles++] = "/1root/partial/leading";
+  apcPaths[ulNumFiles++] = "1root/partial/trailing/";
+  apcPaths[ulNumFiles++] = "";
+  apcPaths[ulNumFiles++] = "2other/partial/c";
+  apcPaths[ulNumFiles++] = "1root/partial/b/under";
+  apcPaths[ulNumFiles++] = "1root/partial/a";
+  apcPaths[ulNumFiles++] = "1root/partial/a";
+  apcPaths[ulNumFiles++] = "1root/partial/d";
+  apcPaths[ulNumFiles++] = "1root/shared/deep/d0/e/f0";
+  apcPaths[ulNumFiles++] = "1root/shared/deep/d0/e/f0/g";
+  apcPaths[ulNumFiles++] = "1root/partial/z";
+  checkBatch(oFTBatch, oFTSerial, apcPaths, ulNumFiles);
+
+  /* paths already in the FT, as files and as directories, mixed with
+     new files under those directories */
+  assert(FT_insertDirIn(oFTBatch, "1root/mixed/dir") == SUCCESS);
+  assert(FT_insertDirIn(oFTSerial, "1root/mixed/dir") == SUCCESS);
+  assert(FT_insertFileIn(oFTBatch, "1root/mixed/file", NULL, 0) ==
+         SUCCESS);
+  assert(FT_insertFileIn(oFTSerial, "1root/mixed/file", NULL, 0) ==
+         SUCCESS);
+  ulNumFiles = 0;
+  for(i = 0; i < 100; i++) {
+    sprintf(aacPaths[ulNumFiles], "1root/mixed/dir/new%d", i);
+    apcPaths[ulNumFiles] = aacPaths[ulNumFiles];
+    ulNumFiles++;
+    if(i % 10 == 0) {
+      apcPaths[ulNumFiles++] = "1root/mixed/dir";
+      apcPaths[ulNumFiles++] = "1root/mixed/file";
+      apcPaths[ulNumFiles++] = "1root/mixed/file/new";
+      sprintf(aacPaths[ulNumFiles], "1root/shared/deep/d%d/e/f%d",
+              i % 7, i);
+      apcPaths[ulNumFiles] = aacPaths[ulNumFiles];
+      ulNumFiles++;
+    }
+  }
+  checkBatch(oFTBatch, oFTSerial, apcPaths, ulNumFiles);
+
+  /* lookups in the full FT, in a snapshot of it taken before it
+     shrinks, and in an image of it */
+  ulNumFiles = fillStatPaths(aacPaths, apcPaths);
+  checkStatMany(oFTBatch, apcPaths, ulNumFiles);
+  oFTOther = FT_snapshotIn(oFTBatch);
+  assert(oFTOther != NULL);
+  assert(FT_rmDirIn(oFTBatch, "1root/shared/deep/d3") == SUCCESS);
+  assert(FT_rmFileIn(oFTBatch, "1root/mixed/file") == SUCCESS);
+  checkStatMany(oFTOther, apcPaths, ulNumFiles);
+  checkStatMany(oFTBatch, apcPaths, ulNumFiles);
+  FT_snapshotRelease(oFTOther);
+  assert(FT_saveImageIn(oFTSerial, pcImageFile, TRUE) == SUCCESS);
+  assert(FT_openImage(pcImageFile, &oFTOther) == SUCCESS);
+  checkStatMany(oFTOther, apcPaths, ulNumFiles);
+  FT_closeImage(oFTOther);
+  remove(pcImageFile);
+
+  FT_free(oFTBatch);
+  FT_free(oFTSerial);
+  FT_waitReclaim();
+}
+
+/* Tests FT_insertFiles and FT_statMany: in every mode, a batch must
+   give each file the status that FT_insertFile gives it when the same
+   files go in one at a time in order of path, and must leave the FT
+   just as those calls do; and a batch of lookups must give each path
+   just what FT_stat gives it, in the FT, a snapshot and an image.
+   Prints the status of the data structure along the way to stderr.
+   Prints the status of the data structure along the way to stderr.
+   Returns 0. */
+int main(void) {
+  const char *apcPaths[2];
+  void *apvContents[2];
+  size_t aulLengths[2];
+  int aiStatuses[2];
+  boolean abIsFile[2];
+  int iMode;
+
+  /* the default FT takes no batch until it is initialized */
+  apcPaths[0] = "1root/a";
+  apcPaths[1] = "1root/b";
+  apvContents[0] = apvContents[1] = NULL;
+  aulLengths[0] = aulLengths[1] = 0;
+  assert(FT_insertFiles(apcPaths, apvContents, aulLengths, 2,
+                        aiStatuses) == INITIALIZATION_ERROR);
+  assert(aiStatuses[0] == INITIALIZATION_ERROR);
+  assert(aiStatuses[1] == INITIALIZATION_ERROR);
+  abIsFile[0] = abIsFile[1] = TRUE;
+  aulLengths[0] = aulLengths[1] = 1;
+  assert(FT_statMany(apcPaths, 2, abIsFile, aulLengths, aiStatuses) ==
+         INITIALIZATION_ERROR);
+  assert(aiStatuses[0] == INITIALIZATION_ERROR);
+  assert(aiStatuses[1] == INITIALIZATION_ERROR);
+  assert(!abIsFile[0] && !abIsFile[1]);
+  assert(aulLengths[0] == 0 && aulLengths[1] == 0);
+  assert(FT_init() == SUCCESS);
+  assert(FT_insertFiles(apcPaths, apvContents, aulLengths, 2,
+                        aiStatuses) == SUCCESS);
+  assert(aiStatuses[0] == SUCCESS && aiStatuses[1] == SUCCESS);
+  assert(FT_containsFile("1root/a") && FT_containsFile("1root/b"));
+  assert(FT_statMany(apcPaths, 2, abIsFile, aulLengths, aiStatuses) ==
+         SUCCESS);
+  assert(aiStatuses[0] == SUCCESS && aiStatuses[1] == SUCCESS);
+  assert(abIsFile[0] && abIsFile[1]);
+  assert(FT_destroy() == SUCCESS);
+
+  for(iMode = 0; iMode < 16; iMode++) {
+    runMode(iMode);
+    fprintf(stderr, "Mode %d: every batch matched %s\n", iMode,
+            "FT_insertFile and FT_stat");
+  }
+  return 0;
+}
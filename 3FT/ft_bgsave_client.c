@@ -0,0 +1,274 @@
+/*--------------------------------------------------------------------*/
+/* ft_bgsave_client.c                                                 */
+/* Author: Matthew Okechukwu, Pinrui Huang                            */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include "ft.h"
+
+/* The file that the tests save to */
+static const char *pcSaveFile = "ft_bgsave_client.sav";
+
+/* A file in a directory that the tests never create */
+static const char *pcUnreachableFile = "ft_bgsave_client.none/sav";
+
+/* The number of files in each tree, spread over NUM_DIRS directories,
+   and the number of threads that save at once */
+enum {NUM_FILES = 2000, NUM_DIRS = 10, NUM_SAVERS = 4};
+
+/* The modes that a run may set on its FT */
+enum {MODE_SYNCHRONIZED = 1, MODE_INDEXED = 2, MODE_ARENA = 4};
+
+/* The contents of file f<i>, which the client overwrites, keeping
+   their length, once a save is under way, and what they held when it
+   began */
+static char aacContents[NUM_FILES][16];
+static char aacSaved[NUM_FILES][16];
+
+/* The FT that the saver threads save */
+static FT_T oFTSaved;
+
+/* Returns a new FT in mode iMode, holding the files r/d<i % NUM_DIRS>
+   /f<i> with the contents "old<i>" */
+static FT_T newTree(int iMode) {
+  char acPath[64];
+  FT_T oFT;
+  int i;
+
+  oFT = FT_new();
+  assert(oFT != NULL);
+  if(iMode & MODE_ARENA)
+    assert(FT_setArenaIn(oFT, TRUE) == SUCCESS);
+  if(iMode & MODE_SYNCHRONIZED)
+    assert(FT_setSynchronizedIn(oFT, TRUE) == SUCCESS);
+  if(iMode & MODE_INDEXED)
+    assert(FT_setIndexedIn(oFT, TRUE) == SUCCESS);
+  for(i = 0; i < NUM_FILES; i++) {
+    sprintf(aacContents[i], "old%d", i);
+    sprintf(acPath, "r/d%d/f%d", i % NUM_DIRS, i);
+    assert(FT_insertFileIn(oFT, acPath, aacContents[i],
+                           strlen(aacContents[i]) + 1) == SUCCESS);
+  }
+  return oFT;
+}
+
+/* Returns the size in bytes of the file named pcFile */
+static size_t fileSize(const char *pcFile) {
+  FILE *psFile;
+  long lSize;
+
+  psFile = fopen(pcFile, "rb");
+  assert(psFile != NULL);
+  assert(fseek(psFile, 0, SEEK_END) == 0);
+  lSize = ftell(psFile);
+  assert(lSize >= 0);
+  fclose(psFile);
+  return (size_t) lSize;
+}
+
+/* Loads the save file into a new FT, and checks that it has the
+   FT_toString pcExpected and that each file's contents are those in
+   aacSaved; frees the contents, which the load allocated */
+static void checkSaved(const char *pcExpected) {
+  FT_T oFT;
+  FTIter_T oIter;
+  const char *pcPath;
+  char *pcString;
+  char *pcContents;
+  boolean bIsFile;
+  size_t ulSize;
+  int i;
+
+  oFT = FT_new();
+  assert(oFT != NULL);
+  assert(FT_loadIn(oFT, pcSaveFile) == SUCCESS);
+  pcString = FT_toStringIn(oFT);
+  assert(pcString != NULL);
+  assert(!strcmp(pcString, pcExpected));
+  free(pcString);
+
+  assert(FT_iterOpenIn(oFT, NULL, &oIter) == SUCCESS);
+  while(FT_iterNext(oIter, &pcPath, &bIsFile, &ulSize) == SUCCESS) {
+    if(!bIsFile)
+      continue;
+    if(strstr(pcPath, "/new/") != NULL) {
+      assert(ulSize == 0);
+      free(FT_getFileContentsIn(oFT, pcPath));
+      continue;
+    }
+    i = atoi(strrchr(pcPath, 'f') + 1);
+    assert(i >= 0 && i < NUM_FILES);
+    pcContents = FT_getFileContentsIn(oFT, pcPath);
+    assert(pcContents != NULL);
+    assert(ulSize == strlen(aacSaved[i]) + 1);
+    assert(!strcmp(pcContents, aacSaved[i]));
+    free(pcContents);
+  }
+  FT_iterClose(oIter);
+  FT_free(oFT);
+}
+
+/* Changes oFT while a save of it is under way, on each call in a
+   different way, uIteration being the number of earlier calls */
+static void changeTree(FT_T oFT, unsigned uIteration) {
+  char acPath[64];
+  int i = (int) (uIteration % NUM_FILES);
+
+  sprintf(acPath, "r/d%d/f%d", i % NUM_DIRS, i);
+  switch(uIteration % 3) {
+  case 0:
+    (void) FT_rmFileIn(oFT, acPath);
+    break;
+  case 1:
+    sprintf(acPath, "r/new/n%u", uIteration);
+    assert(FT_insertFileIn(oFT, acPath, NULL, 0) == SUCCESS);
+    break;
+  default:
+    sprintf(aacContents[i], "new%d", i);
+    break;
+  }
+}
+
+/* Saves oFT in the background, changes it while the child runs,
+   starting by removing the directory pcDir, and checks that the save
+   holds the FT as it was when the save began */
+static void checkBgsave(FT_T oFT, const char *pcDir) {
+  FTBgsave_T oBgsave;
+  char *pcExpected;
+  /* never reset, so that each change is new to every tree */
+  static unsigned uIteration = 0;
+  size_t ulLength = 0;
+  int i;
+
+  pcExpected = FT_toStringIn(oFT);
+  assert(pcExpected != NULL);
+  memcpy(aacSaved, aacContents, sizeof(aacSaved));
+
+  assert(FT_bgsaveIn(oFT, pcSaveFile, TRUE, &oBgsave) == SUCCESS);
+  assert(oBgsave != NULL);
+  /* some changes certainly overlap the save */
+  assert(FT_rmDirIn(oFT, pcDir) == SUCCESS);
+  for(i = 0; i < NUM_FILES; i++)
+    sprintf(aacContents[i], "chg%d", i);
+  while(!FT_bgsaveIsDone(oBgsave))
+    changeTree(oFT, uIteration++);
+  assert(FT_bgsaveIsDone(oBgsave));
+  assert(FT_bgsaveFinish(oBgsave, &ulLength) == SUCCESS);
+  assert(ulLength == fileSize(pcSaveFile));
+
+  checkSaved(pcExpected);
+  free(pcExpected);
+}
+
+/* Saves oFTSaved with FT_saveIn, for a thread that saves at the same
+   time as others */
+static void *saveShared(void *pvSaver) {
+  assert(pvSaver == NULL);
+  assert(FT_saveIn(oFTSaved, pcSaveFile, TRUE) == SUCCESS);
+  return NULL;
+}
+
+/* Saves oFT to the same file from several children at once, and,
+   if oFT is synchronized, from several threads at once, and checks
+   that the file ends up whole */
+static void checkConcurrentSaves(FT_T oFT, boolean bSynchronized) {
+  pthread_t aThreads[NUM_SAVERS];
+  FTBgsave_T aoBgsaves[NUM_SAVERS];
+  char *pcExpected;
+  size_t ulLength;
+  int i;
+
+  pcExpected = FT_toStringIn(oFT);
+  assert(pcExpected != NULL);
+  memcpy(aacSaved, aacContents, sizeof(aacSaved));
+
+  if(bSynchronized) {
+    oFTSaved = oFT;
+    for(i = 0; i < NUM_SAVERS; i++)
+      assert(pthread_create(&aThreads[i], NULL, saveShared, NULL) ==
+             0);
+    for(i = 0; i < NUM_SAVERS; i++)
+      assert(pthread_join(aThreads[i], NULL) == 0);
+    checkSaved(pcExpected);
+  }
+
+  for(i = 0; i < NUM_SAVERS; i++)
+    assert(FT_bgsaveIn(oFT, pcSaveFile, TRUE, &aoBgsaves[i]) ==
+           SUCCESS);
+  for(i = 0; i < NUM_SAVERS; i++) {
+    assert(FT_bgsaveFinish(aoBgsaves[i], &ulLength) == SUCCESS);
+    assert(ulLength > 0);
+  }
+  assert(ulLength == fileSize(pcSaveFile));
+  checkSaved(pcExpected);
+  free(pcExpected);
+}
+
+/* Runs every save in mode iMode */
+static void runMode(int iMode) {
+  FTBgsave_T oBgsave;
+  FT_T oFT;
+
+  oFT = newTree(iMode);
+  checkBgsave(oFT, "r/d0");
+  /* the save replaces the last one whole, changed tree and all */
+  checkBgsave(oFT, "r/d1");
+  checkConcurrentSaves(oFT, (boolean) (iMode & MODE_SYNCHRONIZED));
+
+  /* a save that cannot make its file fails at once */
+  assert(FT_bgsaveIn(oFT, pcUnreachableFile, TRUE, &oBgsave) ==
+         IO_ERROR);
+  assert(oBgsave == NULL);
+  assert(FT_saveIn(oFT, pcUnreachableFile, TRUE) == IO_ERROR);
+  FT_free(oFT);
+  FT_waitReclaim();
+}
+
+/* Tests FT_bgsave, FT_bgsaveIsDone and FT_bgsaveFinish: in every
+   mode, a save made in the background while the FT changes must
+   hold the FT, contents and all, as it was when the save began, and
+   saves to the same file at once, in the background or not, must
+   each leave it whole.
+   Prints the status of the data structure along the way to stderr.
+   Returns 0. */
+int main(void) {
+  FTBgsave_T oBgsave;
+  char *pcExpected;
+  char *pcLoaded;
+  size_t ulLength;
+  int iMode;
+
+  /* the default FT saves nothing until it is initialized */
+  assert(FT_bgsave(pcSaveFile, FALSE, &oBgsave) ==
+         INITIALIZATION_ERROR);
+  assert(oBgsave == NULL);
+  assert(FT_init() == SUCCESS);
+  assert(FT_insertFile("r/a", NULL, 0) == SUCCESS);
+  pcExpected = FT_toString();
+  assert(pcExpected != NULL);
+  assert(FT_bgsave(pcSaveFile, FALSE, &oBgsave) == SUCCESS);
+  assert(FT_rmFile("r/a") == SUCCESS);
+  assert(FT_bgsaveFinish(oBgsave, &ulLength) == SUCCESS);
+  assert(FT_destroy() == SUCCESS);
+  assert(FT_init() == SUCCESS);
+  assert(FT_load(pcSaveFile) == SUCCESS);
+  pcLoaded = FT_toString();
+  assert(pcLoaded != NULL);
+  assert(!strcmp(pcLoaded, pcExpected));
+  assert(FT_destroy() == SUCCESS);
+  free(pcLoaded);
+  free(pcExpected);
+
+  for(iMode = 0; iMode < 8; iMode++) {
+    runMode(iMode);
+    fprintf(stderr, "Mode %d: every save held the tree as it was\n",
+            iMode);
+  }
+  remove(pcSaveFile);
+  return 0;
+}
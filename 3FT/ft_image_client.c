@@ -0,0 +1,225 @@
+/*--------------------------------------------------------------------*/
+/* ft_image_client.c                                                  */
+/* Author: Matthew Okechukwu, Pinrui Huang                            */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "ft.h"
+
+/* The image that the tests write and then read back */
+static const char *pcImageFile = "ft_image_client.img";
+
+/* Checks that oFTImage answers every lookup of pcPath as oFT does */
+static void checkLookup(FT_T oFT, FT_T oFTImage, const char *pcPath) {
+  boolean bIsFile, bImageIsFile;
+  size_t l, lImage;
+  int iStatus, iImageStatus;
+  void *pvContents, *pvImageContents;
+
+  assert(FT_containsDirIn(oFTImage, pcPath) ==
+         FT_containsDirIn(oFT, pcPath));
+  assert(FT_containsFileIn(oFTImage, pcPath) ==
+         FT_containsFileIn(oFT, pcPath));
+
+  bIsFile = bImageIsFile = FALSE;
+  l = lImage = 0;
+  iStatus = FT_statIn(oFT, pcPath, &bIsFile, &l);
+  iImageStatus = FT_statIn(oFTImage, pcPath, &bImageIsFile, &lImage);
+  assert(iImageStatus == iStatus);
+  if(iStatus == SUCCESS) {
+    assert(bImageIsFile == bIsFile);
+    if(bIsFile)
+      assert(lImage == l);
+  }
+
+  pvContents = FT_getFileContentsIn(oFT, pcPath);
+  pvImageContents = FT_getFileContentsIn(oFTImage, pcPath);
+  assert((pvContents == NULL) == (pvImageContents == NULL));
+  if(pvContents != NULL)
+    assert(!memcmp(pvImageContents, pvContents, l));
+}
+
+/* Checks that the walks over oFT and oFTImage that resume after
+   pcToken return the same next node */
+static void checkResume(FT_T oFT, FT_T oFTImage, const char *pcToken) {
+  FTIter_T oIter, oImageIter;
+  const char *pcPath, *pcImagePath;
+  boolean bIsFile, bImageIsFile;
+  size_t l, lImage;
+  int iStatus;
+
+  assert(FT_iterOpenIn(oFT, pcToken, &oIter) == SUCCESS);
+  assert(FT_iterOpenIn(oFTImage, pcToken, &oImageIter) == SUCCESS);
+  iStatus = FT_iterNext(oIter, &pcPath, &bIsFile, &l);
+  assert(FT_iterNext(oImageIter, &pcImagePath, &bImageIsFile,
+                     &lImage) == iStatus);
+  if(iStatus == SUCCESS) {
+    assert(!strcmp(pcImagePath, pcPath));
+    assert(bImageIsFile == bIsFile);
+  }
+  FT_iterClose(oIter);
+  FT_iterClose(oImageIter);
+}
+
+/* Checks that walks over oFT and oFTImage return the same nodes and
+   tokens, and resume alike from each token */
+static void checkWalk(FT_T oFT, FT_T oFTImage) {
+  FTIter_T oIter, oImageIter;
+  const char *pcPath, *pcImagePath;
+  boolean bIsFile, bImageIsFile;
+  size_t l, lImage;
+  int iStatus;
+
+  assert(FT_iterOpenIn(oFT, NULL, &oIter) == SUCCESS);
+  assert(FT_iterOpenIn(oFTImage, NULL, &oImageIter) == SUCCESS);
+  for(;;) {
+    iStatus = FT_iterNext(oIter, &pcPath, &bIsFile, &l);
+    assert(FT_iterNext(oImageIter, &pcImagePath, &bImageIsFile,
+                       &lImage) == iStatus);
+    if(iStatus != SUCCESS)
+      break;
+    assert(!strcmp(pcImagePath, pcPath));
+    assert(bImageIsFile == bIsFile);
+    assert(lImage == l);
+    assert(!strcmp(FT_iterGetToken(oImageIter),
+                   FT_iterGetToken(oIter)));
+    checkResume(oFT, oFTImage, FT_iterGetToken(oIter));
+  }
+  assert(iStatus == NO_SUCH_PATH);
+  FT_iterClose(oIter);
+  FT_iterClose(oImageIter);
+
+  /* tokens for nodes that are not there resume alike too */
+  checkResume(oFT, oFTImage, "D1root/2chil");
+  checkResume(oFT, oFTImage, "F1root/2child/3gkid/4ggkz");
+  checkResume(oFT, oFTImage, "D1root/d5/f0");
+  checkResume(oFT, oFTImage, "F1root/zzz/f0");
+  checkResume(oFT, oFTImage, "D2root");
+}
+
+/* Tests FT_saveImage and FT_openImage against the tree saved:
+   an image must answer each lookup and walk as the live tree does.
+   Prints the status of the data structure along the way to stderr.
+   Returns 0. */
+int main(void) {
+  enum {NUM_DIRS = 20, NUM_FILES = 30};
+  static const char *apcProbes[] = {
+    "1root", "1root/2child", "1root/2child/3gkid",
+    "1root/2child/3gkid/4ggk", "1root/2second/3gfile",
+    "1root/2child/3nothere", "1root/2file", "1root/2file/3under",
+    "2root", "2root/2child", "1roo", "1rootx",
+    "", "/1root", "1root/", "1root//2child", "1root/2empty"
+  };
+  FT_T oFT, oFTImage;
+  char *pcLive, *pcAfter;
+  char acPath[64];
+  char acContents[96];
+  size_t i, j;
+
+  oFT = FT_new();
+  assert(oFT != NULL);
+
+  /* An empty tree's image holds nothing */
+  assert(FT_saveImageIn(oFT, pcImageFile, TRUE) == SUCCESS);
+  assert(FT_openImage(pcImageFile, &oFTImage) == SUCCESS);
+  for(i = 0; i < sizeof(apcProbes) / sizeof(apcProbes[0]); i++)
+    checkLookup(oFT, oFTImage, apcProbes[i]);
+  checkWalk(oFT, oFTImage);
+  FT_closeImage(oFTImage);
+
+  /* A tree of directories and files, some with contents, some
+     without, and some with names that are prefixes of others */
+  assert(FT_insertDirIn(oFT, "1root/2child/3gkid") == SUCCESS);
+  assert(FT_insertFileIn(oFT, "1root/2child/3gkid/4ggk",
+                         "4ggk", 5) == SUCCESS);
+  assert(FT_insertFileIn(oFT, "1root/2second/3gfile", NULL, 0) ==
+         SUCCESS);
+  assert(FT_insertFileIn(oFT, "1root/2file", "2file", 6) == SUCCESS);
+  assert(FT_insertDirIn(oFT, "1root/2empty") == SUCCESS);
+  for(i = 0; i < NUM_DIRS; i++) {
+    sprintf(acPath, "1root/d%lu", (unsigned long) i);
+    assert(FT_insertDirIn(oFT, acPath) == SUCCESS);
+    for(j = 0; j < NUM_FILES; j += 1 + i % 3) {
+      sprintf(acPath, "1root/d%lu/f%lu", (unsigned long) i,
+              (unsigned long) j);
+      sprintf(acContents, "contents of %s", acPath);
+      assert(FT_insertFileIn(oFT, acPath, acContents,
+                             strlen(acContents) + 1) == SUCCESS);
+    }
+  }
+
+  assert(FT_saveImageIn(oFT, pcImageFile, TRUE) == SUCCESS);
+  assert(FT_openImage(pcImageFile, &oFTImage) == SUCCESS);
+
+  /* Every lookup, of nodes present, absent, under files, and of
+     badly formed paths, agrees with the live tree */
+  for(i = 0; i < sizeof(apcProbes) / sizeof(apcProbes[0]); i++)
+    checkLookup(oFT, oFTImage, apcProbes[i]);
+  for(i = 0; i <= NUM_DIRS; i++) {
+    sprintf(acPath, "1root/d%lu", (unsigned long) i);
+    checkLookup(oFT, oFTImage, acPath);
+    for(j = 0; j <= NUM_FILES; j++) {
+      sprintf(acPath, "1root/d%lu/f%lu", (unsigned long) i,
+              (unsigned long) j);
+      checkLookup(oFT, oFTImage, acPath);
+    }
+  }
+
+  /* A walk over the image returns the live tree's nodes in order */
+  checkWalk(oFT, oFTImage);
+
+  /* An image is read-only */
+  assert(FT_insertDirIn(oFTImage, "1root/2new") ==
+         INITIALIZATION_ERROR);
+  assert(FT_rmFileIn(oFTImage, "1root/2file") ==
+         INITIALIZATION_ERROR);
+  assert(FT_containsFileIn(oFTImage, "1root/2file"));
+
+  /* The live tree may change without the image seeing it */
+  assert(FT_rmDirIn(oFT, "1root/d0") == SUCCESS);
+  assert(FT_containsDirIn(oFTImage, "1root/d0"));
+  FT_closeImage(oFTImage);
+
+  /* An image saved without contents has sizes but no contents */
+  assert(FT_saveImageIn(oFT, pcImageFile, FALSE) == SUCCESS);
+  assert(FT_openImage(pcImageFile, &oFTImage) == SUCCESS);
+  assert(FT_getFileContentsIn(oFTImage, "1root/2file") == NULL);
+  {
+    boolean bIsFile = FALSE;
+    size_t l = 0;
+    assert(FT_statIn(oFTImage, "1root/2file", &bIsFile, &l) ==
+           SUCCESS);
+    assert(bIsFile && l == 6);
+  }
+  FT_closeImage(oFTImage);
+
+  /* A file that is not an image is refused */
+  pcLive = FT_toStringIn(oFT);
+  assert(pcLive != NULL);
+  {
+    FILE *psFile = fopen(pcImageFile, "w");
+    assert(psFile != NULL);
+    fputs(pcLive, psFile);
+    fclose(psFile);
+  }
+  assert(FT_openImage(pcImageFile, &oFTImage) == IO_ERROR);
+  assert(oFTImage == NULL);
+  assert(FT_openImage("ft_image_client.none", &oFTImage) == IO_ERROR);
+
+  /* The live tree is unaffected by all of the above */
+  pcAfter = FT_toStringIn(oFT);
+  assert(pcAfter != NULL);
+  assert(!strcmp(pcAfter, pcLive));
+  fprintf(stderr, "Checking the live tree:\n%s\n", pcLive);
+  free(pcLive);
+  free(pcAfter);
+
+  remove(pcImageFile);
+  FT_free(oFT);
+  FT_waitReclaim();
+  return 0;
+}
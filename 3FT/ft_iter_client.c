@@ -0,0 +1,321 @@
+/*--------------------------------------------------------------------*/
+/* ft_iter_client.c                                                   */
+/* Author: Matthew Okechukwu, Pinrui Huang                            */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include "ft.h"
+
+/* The most nodes that the tests' trees hold */
+enum {MAX_NODES = 1024};
+
+/* The FT that the walker and the changer share */
+static FT_T oFTShared;
+
+/* Returns a copy of pcString in a new block that the caller owns */
+static char *copyString(const char *pcString) {
+  char *pcCopy;
+
+  pcCopy = malloc(strlen(pcString) + 1);
+  assert(pcCopy != NULL);
+  return strcpy(pcCopy, pcString);
+}
+
+/* Returns the length of the first component of pcPath */
+static size_t componentLength(const char *pcPath) {
+  const char *pcEnd = strchr(pcPath, '/');
+  return pcEnd == NULL ? strlen(pcPath) : (size_t) (pcEnd - pcPath);
+}
+
+/* Returns a negative number, 0 or a positive number as the node that
+   the token pcA marks comes before, at or after the one that pcB
+   marks in the order of FT_toString: each directory before its
+   children, and its files, by name, before its directories, by
+   name. The nodes need not exist. */
+static int compareTokens(const char *pcA, const char *pcB) {
+  boolean bAFile = (boolean) (pcA[0] == 'F');
+  boolean bBFile = (boolean) (pcB[0] == 'F');
+  size_t ulA, ulB;
+  int iCompare;
+
+  pcA++;
+  pcB++;
+  for(;;) {
+    ulA = componentLength(pcA);
+    ulB = componentLength(pcB);
+    /* a component names a file only if it is the last of a file's */
+    if(pcA[ulA] == '\0' && pcB[ulB] != '\0' && bAFile)
+      return -1;
+    if(pcB[ulB] == '\0' && pcA[ulA] != '\0' && bBFile)
+      return 1;
+    iCompare = strncmp(pcA, pcB, ulA < ulB ? ulA : ulB);
+    if(iCompare == 0 && ulA != ulB)
+      iCompare = ulA < ulB ? -1 : 1;
+    if(iCompare == 0 && pcA[ulA] == '\0' && pcB[ulB] == '\0')
+      return bAFile == bBFile ? 0 : (bAFile ? -1 : 1);
+    if(iCompare != 0)
+      return iCompare;
+    /* an ancestor comes before its descendants */
+    if(pcA[ulA] == '\0')
+      return -1;
+    if(pcB[ulB] == '\0')
+      return 1;
+    pcA += ulA + 1;
+    pcB += ulB + 1;
+  }
+}
+
+/* Walks oFT from the start, storing each node's token in a new block
+   at apcTokens, and returns their number, after checking that they
+   come in order */
+static size_t listTokens(FT_T oFT, char **apcTokens) {
+  FTIter_T oIter;
+  const char *pcPath;
+  boolean bIsFile;
+  size_t l;
+  size_t ulNum = 0;
+
+  assert(FT_iterOpenIn(oFT, NULL, &oIter) == SUCCESS);
+  while(FT_iterNext(oIter, &pcPath, &bIsFile, &l) == SUCCESS) {
+    assert(ulNum < MAX_NODES);
+    apcTokens[ulNum] = copyString(FT_iterGetToken(oIter));
+    assert(apcTokens[ulNum][0] == (bIsFile ? 'F' : 'D'));
+    assert(!strcmp(apcTokens[ulNum] + 1, pcPath));
+    if(ulNum > 0)
+      assert(compareTokens(apcTokens[ulNum - 1],
+                           apcTokens[ulNum]) < 0);
+    ulNum++;
+  }
+  FT_iterClose(oIter);
+  return ulNum;
+}
+
+/* Frees the ulNum tokens at apcTokens */
+static void freeTokens(char **apcTokens, size_t ulNum) {
+  size_t i;
+
+  for(i = 0; i < ulNum; i++)
+    free(apcTokens[i]);
+}
+
+/* Moves oIter, whose last node had token pcToken, on, checking that
+   it goes to the first node of oFT as it is now that follows
+   pcToken, or ends if none does, and returns FT_iterNext's status */
+static int checkNext(FT_T oFT, FTIter_T oIter, const char *pcToken) {
+  static char *apcTokens[MAX_NODES];
+  const char *pcPath;
+  boolean bIsFile;
+  size_t l, ulNum, i;
+  int iStatus;
+
+  ulNum = listTokens(oFT, apcTokens);
+  for(i = 0; i < ulNum; i++)
+    if(compareTokens(apcTokens[i], pcToken) > 0)
+      break;
+  iStatus = FT_iterNext(oIter, &pcPath, &bIsFile, &l);
+  if(i == ulNum)
+    assert(iStatus == NO_SUCH_PATH);
+  else {
+    assert(iStatus == SUCCESS);
+    assert(!strcmp(FT_iterGetToken(oIter), apcTokens[i]));
+  }
+  freeTokens(apcTokens, ulNum);
+  return iStatus;
+}
+
+/* Fills oFT with directories d0 to d5 under 1root, each holding
+   files f0 to f5 and one directory, sub, with a file of its own */
+static void fillTree(FT_T oFT) {
+  char acPath[32];
+  int i, j;
+
+  for(i = 0; i < 6; i++) {
+    for(j = 0; j < 6; j++) {
+      sprintf(acPath, "1root/d%d/f%d", i, j);
+      assert(FT_insertFileIn(oFT, acPath, NULL, (size_t) j) ==
+             SUCCESS);
+    }
+    sprintf(acPath, "1root/d%d/sub/x", i);
+    assert(FT_insertFileIn(oFT, acPath, NULL, 0) == SUCCESS);
+  }
+}
+
+/* Makes change iChange, one of a cycle of inserts and removals that
+   falls before, at and after a walk's place, to oFT */
+static void makeChange(FT_T oFT, int iChange) {
+  char acPath[32];
+  int iDir = (iChange * 5) % 6;
+  int iFile = (iChange * 7) % 8;
+
+  sprintf(acPath, "1root/d%d/f%d", iDir, iFile);
+  switch(iChange % 4) {
+  case 0:
+    (void) FT_insertFileIn(oFT, acPath, NULL, 0);
+    break;
+  case 1:
+    (void) FT_rmFileIn(oFT, acPath);
+    break;
+  case 2:
+    sprintf(acPath, "1root/d%d/sub", iDir);
+    if(FT_rmDirIn(oFT, acPath) != SUCCESS) {
+      strcat(acPath, "/y");
+      (void) FT_insertFileIn(oFT, acPath, NULL, 0);
+    }
+    break;
+  default:
+    sprintf(acPath, "1root/d%d", (iDir + 3) % 7);
+    if(FT_rmDirIn(oFT, acPath) != SUCCESS)
+      (void) FT_insertDirIn(oFT, acPath);
+    break;
+  }
+}
+
+/* Inserts and removes nodes of oFTShared until *pvDone is nonzero */
+static void *changeShared(void *pvDone) {
+  int iChange = 0;
+
+  while(!__atomic_load_n((int *) pvDone, __ATOMIC_ACQUIRE))
+    makeChange(oFTShared, iChange++);
+  return NULL;
+}
+
+/* Tests FT_iterOpen and FT_iterNext as the FT changes during a walk:
+   after any change between calls, a walk, and one resumed from its
+   token, must go on from where its last node lies in the FT's new
+   order, whether or not that node remains; a walk must end once the
+   root is replaced; and a walk alongside a thread making changes
+   must return nodes in order, including every node that no change
+   touches.
+   Prints the status of the data structure along the way to stderr.
+   Returns 0. */
+int main(void) {
+  FT_T oFT;
+  FTIter_T oIter, oResumed;
+  pthread_t sThread;
+  const char *pcPath;
+  char *pcToken;
+  char *pcLast;
+  boolean bIsFile;
+  size_t l;
+  size_t ulSeen;
+  int iDone;
+  int iChange;
+  int iStatus;
+
+  oFT = FT_new();
+  assert(oFT != NULL);
+  fillTree(oFT);
+
+  /* A change between every two calls, before, at or after the
+     walk's place, moves the walk along with it */
+  assert(FT_iterOpenIn(oFT, NULL, &oIter) == SUCCESS);
+  assert(FT_iterNext(oIter, &pcPath, &bIsFile, &l) == SUCCESS);
+  iChange = 0;
+  do {
+    pcToken = copyString(FT_iterGetToken(oIter));
+    makeChange(oFT, iChange);
+    if(iChange % 3 == 0) {
+      /* the node just returned goes away */
+      if(pcToken[0] == 'F')
+        (void) FT_rmFileIn(oFT, pcToken + 1);
+      else if(strstr(pcToken, "/sub") != NULL)
+        (void) FT_rmDirIn(oFT, pcToken + 1);
+    }
+
+    /* a walk resumed from the token goes on as the walk does */
+    assert(FT_iterOpenIn(oFT, pcToken, &oResumed) == SUCCESS);
+    (void) checkNext(oFT, oResumed, pcToken);
+    FT_iterClose(oResumed);
+
+    iStatus = checkNext(oFT, oIter, pcToken);
+    free(pcToken);
+    iChange++;
+    assert(iChange < MAX_NODES);
+  } while(iStatus == SUCCESS);
+  FT_iterClose(oIter);
+  fprintf(stderr, "Walked on through %d changes\n", iChange);
+
+  /* Resuming after a node that was never there, or from a bad
+     token */
+  assert(FT_iterOpenIn(oFT, "F1root/d0/f55", &oIter) == SUCCESS);
+  (void) checkNext(oFT, oIter, "F1root/d0/f55");
+  FT_iterClose(oIter);
+  assert(FT_iterOpenIn(oFT, "D1root/d9/zz/top", &oIter) == SUCCESS);
+  (void) checkNext(oFT, oIter, "D1root/d9/zz/top");
+  FT_iterClose(oIter);
+  assert(FT_iterOpenIn(oFT, "X1root", &oIter) == BAD_PATH);
+  assert(oIter == NULL);
+  assert(FT_iterOpenIn(oFT, "F1root//d0", &oIter) == BAD_PATH);
+
+  /* Once the root is replaced, the walk ends, as does one resumed
+     from a token of the old tree */
+  assert(FT_iterOpenIn(oFT, NULL, &oIter) == SUCCESS);
+  assert(FT_iterNext(oIter, &pcPath, &bIsFile, &l) == SUCCESS);
+  assert(FT_iterNext(oIter, &pcPath, &bIsFile, &l) == SUCCESS);
+  pcToken = copyString(FT_iterGetToken(oIter));
+  assert(FT_rmDirIn(oFT, "1root") == SUCCESS);
+  assert(FT_insertDirIn(oFT, "2root/d0") == SUCCESS);
+  assert(FT_insertFileIn(oFT, "2root/d0/f0", NULL, 0) == SUCCESS);
+  assert(FT_iterNext(oIter, &pcPath, &bIsFile, &l) == NO_SUCH_PATH);
+  assert(pcPath == NULL);
+  FT_iterClose(oIter);
+  assert(FT_iterOpenIn(oFT, pcToken, &oIter) == SUCCESS);
+  assert(FT_iterNext(oIter, &pcPath, &bIsFile, &l) == NO_SUCH_PATH);
+  FT_iterClose(oIter);
+  free(pcToken);
+
+  /* Once the root is gone, the walk ends too */
+  assert(FT_iterOpenIn(oFT, NULL, &oIter) == SUCCESS);
+  assert(FT_iterNext(oIter, &pcPath, &bIsFile, &l) == SUCCESS);
+  assert(FT_rmDirIn(oFT, "2root") == SUCCESS);
+  assert(FT_iterNext(oIter, &pcPath, &bIsFile, &l) == NO_SUCH_PATH);
+  FT_iterClose(oIter);
+  FT_free(oFT);
+
+  /* A walk alongside a thread making changes returns its nodes in
+     order, and every node that no change touches: the files of sub
+     directories other than the ones removed, and the root */
+  oFTShared = FT_new();
+  assert(oFTShared != NULL);
+  assert(FT_setSynchronizedIn(oFTShared, TRUE) == SUCCESS);
+  fillTree(oFTShared);
+  assert(FT_insertDirIn(oFTShared, "1root/zstable") == SUCCESS);
+  assert(FT_insertFileIn(oFTShared, "1root/zstable/a", NULL, 0) ==
+         SUCCESS);
+  assert(FT_insertFileIn(oFTShared, "1root/astable", NULL, 0) ==
+         SUCCESS);
+  iDone = 0;
+  assert(pthread_create(&sThread, NULL, changeShared, &iDone) == 0);
+  for(iChange = 0; iChange < 200; iChange++) {
+    assert(FT_iterOpenIn(oFTShared, NULL, &oIter) == SUCCESS);
+    pcLast = NULL;
+    ulSeen = 0;
+    while((iStatus = FT_iterNext(oIter, &pcPath, &bIsFile, &l)) ==
+          SUCCESS) {
+      if(pcLast != NULL)
+        assert(compareTokens(pcLast, FT_iterGetToken(oIter)) < 0);
+      free(pcLast);
+      pcLast = copyString(FT_iterGetToken(oIter));
+      if(!strcmp(pcPath, "1root") || !strcmp(pcPath, "1root/astable") ||
+         !strcmp(pcPath, "1root/zstable") ||
+         !strcmp(pcPath, "1root/zstable/a"))
+        ulSeen++;
+    }
+    assert(iStatus == NO_SUCH_PATH);
+    assert(ulSeen == 4);
+    free(pcLast);
+    FT_iterClose(oIter);
+  }
+  __atomic_store_n(&iDone, 1, __ATOMIC_RELEASE);
+  assert(pthread_join(sThread, NULL) == 0);
+  fprintf(stderr, "Walked %d times alongside changes\n", iChange);
+  FT_free(oFTShared);
+
+  FT_waitReclaim();
+  return 0;
+}
@@ -0,0 +1,234 @@
+/*--------------------------------------------------------------------*/
+/* ft_journal_client.c                                                */
+/* Author: Matthew Okechukwu, Pinrui Huang                            */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "ft.h"
+
+/* The checkpoint and journal that the tests write and recover */
+static const char *pcCheckpointFile = "ft_journal_client.ckpt";
+static const char *pcJournalFile = "ft_journal_client.jnl";
+
+/* The most changes that one phase of the tests makes */
+enum {MAX_CHANGES = 32};
+
+/* The tree after each change of a phase, and the journal's length
+   once that change has returned; entry 0 is before the first */
+static char *apcStates[MAX_CHANGES + 1];
+static size_t aulLengths[MAX_CHANGES + 1];
+static size_t ulNumChanges;
+
+/* Returns the number of bytes in the file pcFile */
+static size_t fileLength(const char *pcFile) {
+  FILE *psFile;
+  long lLength;
+
+  psFile = fopen(pcFile, "rb");
+  assert(psFile != NULL);
+  assert(fseek(psFile, 0L, SEEK_END) == 0);
+  lLength = ftell(psFile);
+  assert(lLength >= 0);
+  fclose(psFile);
+  return (size_t) lLength;
+}
+
+/* Returns the contents of the file pcFile, in a new block that the
+   caller owns, and stores their length in *pulLength */
+static char *readFile(const char *pcFile, size_t *pulLength) {
+  FILE *psFile;
+  char *pcBytes;
+
+  *pulLength = fileLength(pcFile);
+  pcBytes = malloc(*pulLength + 1);
+  assert(pcBytes != NULL);
+  psFile = fopen(pcFile, "rb");
+  assert(psFile != NULL);
+  assert(fread(pcBytes, 1, *pulLength, psFile) == *pulLength);
+  fclose(psFile);
+  return pcBytes;
+}
+
+/* Replaces the file pcFile with the ulLength bytes at pcBytes */
+static void writeFile(const char *pcFile, const char *pcBytes,
+                      size_t ulLength) {
+  FILE *psFile;
+
+  psFile = fopen(pcFile, "wb");
+  assert(psFile != NULL);
+  assert(fwrite(pcBytes, 1, ulLength, psFile) == ulLength);
+  assert(fclose(psFile) == 0);
+}
+
+/* Records oFT, just changed, as the next state of the phase */
+static void recordState(FT_T oFT) {
+  assert(ulNumChanges < MAX_CHANGES);
+  ulNumChanges++;
+  apcStates[ulNumChanges] = FT_toStringIn(oFT);
+  assert(apcStates[ulNumChanges] != NULL);
+  aulLengths[ulNumChanges] = fileLength(pcJournalFile);
+  assert(aulLengths[ulNumChanges] > aulLengths[ulNumChanges - 1]);
+}
+
+/* Starts a phase of changes to oFT, whose journal is now as long as
+   it will be before the first of them */
+static void beginPhase(FT_T oFT) {
+  size_t i;
+
+  for(i = 0; i <= ulNumChanges; i++)
+    free(apcStates[i]);
+  ulNumChanges = 0;
+  apcStates[0] = FT_toStringIn(oFT);
+  assert(apcStates[0] != NULL);
+  aulLengths[0] = fileLength(pcJournalFile);
+}
+
+/* Frees oFT, which was recovered, along with the contents that
+   recovery gave its files, which the client owns */
+static void freeRecovered(FT_T oFT) {
+  FTIter_T oIter;
+  const char *pcPath;
+  boolean bIsFile;
+  size_t l;
+
+  assert(FT_iterOpenIn(oFT, NULL, &oIter) == SUCCESS);
+  while(FT_iterNext(oIter, &pcPath, &bIsFile, &l) == SUCCESS)
+    if(bIsFile)
+      free(FT_getFileContentsIn(oFT, pcPath));
+  FT_iterClose(oIter);
+  FT_free(oFT);
+}
+
+/* Recovers a tree from the checkpoint and the ulLength bytes at
+   pcJournal as its journal, and checks that it is pcExpected */
+static void checkRecovery(const char *pcJournal, size_t ulLength,
+                          const char *pcExpected) {
+  FT_T oFT;
+  char *pcRecovered;
+
+  writeFile(pcJournalFile, pcJournal, ulLength);
+  oFT = FT_new();
+  assert(oFT != NULL);
+  assert(FT_setJournalIn(oFT, pcCheckpointFile, pcJournalFile) ==
+         SUCCESS);
+  pcRecovered = FT_toStringIn(oFT);
+  assert(pcRecovered != NULL);
+  assert(!strcmp(pcRecovered, pcExpected));
+  free(pcRecovered);
+  freeRecovered(oFT);
+}
+
+/* Checks that the journal of the phase just ended, cut short at
+   every byte, recovers exactly the changes whose records it still
+   holds whole, and that a damaged record loses it and every later
+   one */
+static void checkPhase(void) {
+  char *pcJournal;
+  size_t ulLength;
+  size_t ulCut;
+  size_t ulChange = 0;
+  size_t i;
+
+  pcJournal = readFile(pcJournalFile, &ulLength);
+  assert(ulLength == aulLengths[ulNumChanges]);
+
+  /* a journal cut inside its header holds no changes at all */
+  for(ulCut = 0; ulCut < aulLengths[0]; ulCut++)
+    checkRecovery(pcJournal, ulCut, apcStates[0]);
+
+  for(ulCut = aulLengths[0]; ulCut <= ulLength; ulCut++) {
+    while(ulChange < ulNumChanges && aulLengths[ulChange + 1] <= ulCut)
+      ulChange++;
+    checkRecovery(pcJournal, ulCut, apcStates[ulChange]);
+  }
+
+  /* a byte damaged in a record's middle drops it and all after */
+  for(i = 0; i < ulNumChanges; i++) {
+    ulCut = (aulLengths[i] + aulLengths[i + 1]) / 2;
+    pcJournal[ulCut] = (char) ~pcJournal[ulCut];
+    checkRecovery(pcJournal, ulLength, apcStates[i]);
+    pcJournal[ulCut] = (char) ~pcJournal[ulCut];
+  }
+
+  free(pcJournal);
+}
+
+/* Tests FT_setJournal's recovery: a journal cut short mid-record, as
+   by a crash, must recover the tree as of the last change whose
+   record it holds whole, both with and without a checkpoint.
+   Prints the status of the data structure along the way to stderr.
+   Returns 0. */
+int main(void) {
+  FT_T oFT;
+  size_t i;
+
+  remove(pcCheckpointFile);
+  remove(pcJournalFile);
+
+  /* With no checkpoint yet, the journal holds the whole tree */
+  oFT = FT_new();
+  assert(oFT != NULL);
+  assert(FT_setJournalIn(oFT, pcCheckpointFile, pcJournalFile) ==
+         SUCCESS);
+  beginPhase(oFT);
+  assert(FT_insertDirIn(oFT, "1root/2child/3gkid") == SUCCESS);
+  recordState(oFT);
+  assert(FT_insertFileIn(oFT, "1root/2child/3gkid/4ggk", "4ggk", 5) ==
+         SUCCESS);
+  recordState(oFT);
+  assert(FT_insertFileIn(oFT, "1root/2second", NULL, 0) == SUCCESS);
+  recordState(oFT);
+  assert(FT_replaceFileContentsIn(oFT, "1root/2second", "2second",
+                                  8) == NULL);
+  recordState(oFT);
+  assert(FT_moveIn(oFT, "1root/2child/3gkid", "1root/2moved") ==
+         SUCCESS);
+  recordState(oFT);
+  assert(FT_rmFileIn(oFT, "1root/2moved/4ggk") == SUCCESS);
+  recordState(oFT);
+  assert(FT_rmDirIn(oFT, "1root/2child") == SUCCESS);
+  recordState(oFT);
+  FT_free(oFT);
+  checkPhase();
+  fprintf(stderr, "Recovered every cut of a journal of %lu changes\n",
+          (unsigned long) ulNumChanges);
+
+  /* After a checkpoint, recovery loads it and replays the rest */
+  checkRecovery("", 0, "");
+  oFT = FT_new();
+  assert(oFT != NULL);
+  assert(FT_setJournalIn(oFT, pcCheckpointFile, pcJournalFile) ==
+         SUCCESS);
+  for(i = 0; i < 4; i++) {
+    char acPath[32];
+    sprintf(acPath, "1root/d%lu/f%lu", (unsigned long) i,
+            (unsigned long) i);
+    assert(FT_insertFileIn(oFT, acPath, "f", 2) == SUCCESS);
+  }
+  assert(FT_checkpointIn(oFT) == SUCCESS);
+  beginPhase(oFT);
+  assert(FT_insertDirIn(oFT, "1root/d0/2new") == SUCCESS);
+  recordState(oFT);
+  assert(FT_rmDirIn(oFT, "1root/d1") == SUCCESS);
+  recordState(oFT);
+  assert(FT_insertFileIn(oFT, "1root/d0/2new/3file", "3file", 6) ==
+         SUCCESS);
+  recordState(oFT);
+  assert(FT_moveIn(oFT, "1root/d2", "1root/d0/2new/3dir") == SUCCESS);
+  recordState(oFT);
+  FT_free(oFT);
+  checkPhase();
+  fprintf(stderr, "Recovered every cut of a journal of %lu changes "
+          "after a checkpoint\n", (unsigned long) ulNumChanges);
+
+  for(i = 0; i <= ulNumChanges; i++)
+    free(apcStates[i]);
+  remove(pcCheckpointFile);
+  remove(pcJournalFile);
+  FT_waitReclaim();
+  return 0;
+}
@@ -0,0 +1,261 @@
+/*--------------------------------------------------------------------*/
+/* ft_manifest_client.c                                               */
+/* Author: Matthew Okechukwu, Pinrui Huang                            */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "ft.h"
+
+/* The file that the tests write their manifests to */
+static const char *pcManifestFile = "ft_manifest_client.tmp";
+
+/* A file that the tests never create */
+static const char *pcMissingFile = "ft_manifest_client.missing";
+
+/* The modes that a run may set on its FTs */
+enum {MODE_SYNCHRONIZED = 1, MODE_INDEXED = 2, MODE_ARENA = 4};
+
+/* The number of files in the large manifests, which reject a load
+   only after most of the tree is built */
+enum {LARGE_FILES = 2000};
+
+/* A manifest that loads, with its lines out of order: '/' sorts
+   below '.' in component order but above it for strcmp, directories
+   come after the files beneath them, and one directory is listed
+   although a file below it already implies it */
+static const char *pcUnsorted =
+  "1root/a.b\t7\n"
+  "1root/a/z/\n"
+  "\n"
+  "1root/a/b\n"
+  "1root/c/d/e\t12\n"
+  "1root/a/\n"
+  "1root/a-\t3\n"
+  "1root/c/\n"
+  "1root/b/\n"
+  "1root/a/b.c\t1\n";
+
+/* Returns a new FT in mode iMode */
+static FT_T newTree(int iMode) {
+  FT_T oFT;
+
+  oFT = FT_new();
+  assert(oFT != NULL);
+  if(iMode & MODE_ARENA)
+    assert(FT_setArenaIn(oFT, TRUE) == SUCCESS);
+  if(iMode & MODE_SYNCHRONIZED)
+    assert(FT_setSynchronizedIn(oFT, TRUE) == SUCCESS);
+  if(iMode & MODE_INDEXED)
+    assert(FT_setIndexedIn(oFT, TRUE) == SUCCESS);
+  return oFT;
+}
+
+/* Writes pcText to the manifest file */
+static void writeManifest(const char *pcText) {
+  FILE *psFile;
+
+  psFile = fopen(pcManifestFile, "w");
+  assert(psFile != NULL);
+  assert(fputs(pcText, psFile) >= 0);
+  assert(fclose(psFile) == 0);
+}
+
+/* Inserts the lines of pcText, a manifest that loads, into oFT one
+   at a time in the order given: a directory with FT_insertDirIn,
+   which may find it already made for an earlier line, and a file
+   with FT_insertFileIn, with NULL contents of the size given. If
+   oFTLoaded is not NULL, checks that it holds each line alike */
+static void insertLines(FT_T oFT, const char *pcText,
+                        FT_T oFTLoaded) {
+  char *pcCopy;
+  char *pcLine;
+  char *pcTab;
+  size_t ulLength;
+  size_t ulSize;
+  boolean bIsFile;
+  size_t ulLoadedSize;
+  int iStatus;
+
+  pcCopy = malloc(strlen(pcText) + 1);
+  assert(pcCopy != NULL);
+  strcpy(pcCopy, pcText);
+  for(pcLine = strtok(pcCopy, "\n"); pcLine != NULL;
+      pcLine = strtok(NULL, "\n")) {
+    ulSize = 0;
+    pcTab = strchr(pcLine, '\t');
+    if(pcTab != NULL) {
+      *pcTab = '\0';
+      ulSize = (size_t) strtoul(pcTab + 1, NULL, 10);
+    }
+    ulLength = strlen(pcLine);
+    if(pcLine[ulLength - 1] == '/') {
+      pcLine[ulLength - 1] = '\0';
+      iStatus = FT_insertDirIn(oFT, pcLine);
+      assert(iStatus == SUCCESS || iStatus == ALREADY_IN_TREE);
+    }
+    else
+      assert(FT_insertFileIn(oFT, pcLine, NULL, ulSize) == SUCCESS);
+
+    if(oFTLoaded != NULL) {
+      bIsFile = FALSE;
+      ulLoadedSize = 0;
+      assert(FT_statIn(oFTLoaded, pcLine, &bIsFile, &ulLoadedSize) ==
+             SUCCESS);
+      assert(bIsFile == (pcLine[ulLength - 1] != '\0'));
+      assert(ulLoadedSize == ulSize);
+      assert(!bIsFile ||
+             FT_getFileContentsIn(oFTLoaded, pcLine) == NULL);
+    }
+  }
+  free(pcCopy);
+}
+
+/* Checks that oFT and oFTExpected have the same FT_toString */
+static void checkSame(FT_T oFT, FT_T oFTExpected) {
+  char *pcLoaded;
+  char *pcExpected;
+
+  pcLoaded = FT_toStringIn(oFT);
+  pcExpected = FT_toStringIn(oFTExpected);
+  assert(pcLoaded != NULL && pcExpected != NULL);
+  assert(!strcmp(pcLoaded, pcExpected));
+  free(pcLoaded);
+  free(pcExpected);
+}
+
+/* Loads pcText into a new FT in mode iMode, and checks that the load
+   returns iStatus and leaves the FT just as inserting the lines one
+   at a time leaves one, if the load succeeds, or empty otherwise, in
+   which case pcUnsorted must still load into it */
+static void checkLoad(int iMode, const char *pcText, int iStatus) {
+  FT_T oFT;
+  FT_T oFTExpected;
+
+  writeManifest(pcText);
+  oFT = newTree(iMode);
+  oFTExpected = newTree(iMode);
+  assert(FT_loadManifestIn(oFT, pcManifestFile) == iStatus);
+  if(iStatus == SUCCESS)
+    insertLines(oFTExpected, pcText, oFT);
+  checkSame(oFT, oFTExpected);
+
+  if(iStatus != SUCCESS) {
+    writeManifest(pcUnsorted);
+    assert(FT_loadManifestIn(oFT, pcManifestFile) == SUCCESS);
+    insertLines(oFTExpected, pcUnsorted, oFT);
+    checkSame(oFT, oFTExpected);
+  }
+  FT_free(oFT);
+  FT_free(oFTExpected);
+}
+
+/* Returns a manifest of LARGE_FILES files in many directories, in
+   an order that jumps between them, with pcLast as its last line;
+   the caller must free it */
+static char *largeManifest(const char *pcLast) {
+  char *pcText;
+  size_t ulLength = 0;
+  int i, iFile;
+
+  pcText = malloc(LARGE_FILES * 32 + strlen(pcLast) + 1);
+  assert(pcText != NULL);
+  for(i = 0; i < LARGE_FILES; i++) {
+    iFile = (i * 37) % LARGE_FILES;
+    ulLength += (size_t) sprintf(pcText + ulLength,
+                                 "1root/d%d/e%d/f%d\t%d\n", iFile % 13,
+                                 iFile % 5, iFile, iFile);
+  }
+  strcpy(pcText + ulLength, pcLast);
+  return pcText;
+}
+
+/* Runs every load in mode iMode */
+static void runMode(int iMode) {
+  char *pcText;
+  FT_T oFT;
+
+  /* manifests that load, in and out of component order */
+  checkLoad(iMode, "", SUCCESS);
+  checkLoad(iMode, "1root/\n", SUCCESS);
+  checkLoad(iMode,
+            "1root/\n1root/a/\n1root/a/b\n1root/a/b.c\t1\n"
+            "1root/a/z/\n1root/a-\t3\n1root/a.b\t7\n1root/b/\n"
+            "1root/c/\n1root/c/d/\n1root/c/d/e\t12\n", SUCCESS);
+  checkLoad(iMode, pcUnsorted, SUCCESS);
+  pcText = largeManifest("");
+  checkLoad(iMode, pcText, SUCCESS);
+  free(pcText);
+
+  /* paths listed twice, whether or not the lines are adjacent */
+  checkLoad(iMode, "1root/a\n1root/b\n1root/a\n", ALREADY_IN_TREE);
+  checkLoad(iMode, "1root/d/\n1root/d/x\n1root/d/\n", ALREADY_IN_TREE);
+  checkLoad(iMode, "1root/a\t1\n1root/a\t2\n", ALREADY_IN_TREE);
+
+  /* a file used as a directory, listed before or after it */
+  checkLoad(iMode, "1root/f\n1root/f/g\n", NOT_A_DIRECTORY);
+  checkLoad(iMode, "1root/f/g/h\n1root/a\n1root/f\n", NOT_A_DIRECTORY);
+  checkLoad(iMode, "1root/f/\n1root/f/g\n1root/f/g/h/\n",
+            NOT_A_DIRECTORY);
+
+  /* other lines that no load may take */
+  checkLoad(iMode, "1root/a\n2root/b\n", CONFLICTING_PATH);
+  checkLoad(iMode, "1root\n", CONFLICTING_PATH);
+  checkLoad(iMode, "1root/a\n1root//b\n", BAD_PATH);
+  checkLoad(iMode, "1root/a\tx\n", BAD_PATH);
+  checkLoad(iMode, "1root/a/\t5\n", BAD_PATH);
+
+  /* loads rejected only once most of the tree is built */
+  pcText = largeManifest("1root/d9/e3/f1998\n");
+  checkLoad(iMode, pcText, ALREADY_IN_TREE);
+  free(pcText);
+  pcText = largeManifest("1root/d10/e4/f1999/g\n");
+  checkLoad(iMode, pcText, NOT_A_DIRECTORY);
+  free(pcText);
+  pcText = largeManifest("1root/d12/e4//g\n");
+  checkLoad(iMode, pcText, BAD_PATH);
+  free(pcText);
+  pcText = largeManifest("2root/d12/e4/g\n");
+  checkLoad(iMode, pcText, CONFLICTING_PATH);
+  free(pcText);
+
+  /* a load that cannot start leaves the FT as it was */
+  oFT = newTree(iMode);
+  assert(FT_loadManifestIn(oFT, pcMissingFile) == IO_ERROR);
+  assert(FT_insertFileIn(oFT, "1root/x", NULL, 0) == SUCCESS);
+  writeManifest(pcUnsorted);
+  assert(FT_loadManifestIn(oFT, pcManifestFile) == ALREADY_IN_TREE);
+  assert(FT_containsFileIn(oFT, "1root/x"));
+  assert(!FT_containsFileIn(oFT, "1root/a/b"));
+  FT_free(oFT);
+  FT_waitReclaim();
+}
+
+/* Tests FT_loadManifest: in every mode, a manifest that loads, in
+   component order or not, must leave the FT just as inserting its
+   lines one at a time does, and one with a path listed twice, a file
+   used as a directory or another bad line must be rejected with its
+   status and leave the FT empty, however much of it had been built.
+   Prints the status of the data structure along the way to stderr.
+   Returns 0. */
+int main(void) {
+  int iMode;
+
+  writeManifest(pcUnsorted);
+  assert(FT_loadManifest(pcManifestFile) == INITIALIZATION_ERROR);
+  assert(FT_init() == SUCCESS);
+  assert(FT_loadManifest(pcManifestFile) == SUCCESS);
+  assert(FT_containsFile("1root/a/b.c"));
+  assert(FT_destroy() == SUCCESS);
+
+  for(iMode = 0; iMode < 8; iMode++) {
+    runMode(iMode);
+    fprintf(stderr, "Mode %d: every load matched FT_insertFile\n",
+            iMode);
+  }
+  remove(pcManifestFile);
+  return 0;
+}
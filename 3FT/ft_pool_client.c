@@ -0,0 +1,178 @@
+/*--------------------------------------------------------------------*/
+/* ft_pool_client.c                                                   */
+/* Author: Matthew Okechukwu, Pinrui Huang                            */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include "ft.h"
+#include "pool.h"
+
+/* The number of threads that churn at once, the number of times each
+   builds and removes its subtree, and the files in that subtree,
+   few enough that the removing thread frees them itself */
+enum {NUM_CHURNERS = 4, NUM_ROUNDS = 200, CHURN_FILES = 150};
+
+/* The number of files in a subtree large enough that freeing it
+   trims the pool, spread over BIG_DIRS directories */
+enum {BIG_FILES = 70000, BIG_DIRS = 256};
+
+/* The number of blocks that the client takes from the pool itself */
+enum {NUM_BLOCKS = 5000, BLOCK_SIZE = 200};
+
+/* The modes that a run may set on its FT */
+enum {MODE_INDEXED = 1, MODE_LOCK_FREE = 2};
+
+/* The FT that the churning threads share */
+static FT_T oFTShared;
+
+/* Inserts the files <pcDir>/f<i> into oFT, then checks and removes
+   them, as one round of churn */
+static void churnOnce(FT_T oFT, const char *pcDir) {
+  char acPath[64];
+  int i;
+
+  assert(FT_insertDirIn(oFT, pcDir) == SUCCESS);
+  for(i = 0; i < CHURN_FILES; i++) {
+    sprintf(acPath, "%s/f%d", pcDir, i);
+    assert(FT_insertFileIn(oFT, acPath, NULL, (size_t) i) == SUCCESS);
+    assert(FT_insertFileIn(oFT, acPath, NULL, 0) == ALREADY_IN_TREE);
+  }
+  assert(FT_insertDirIn(oFT, pcDir) == ALREADY_IN_TREE);
+  sprintf(acPath, "%s/f%d", pcDir, CHURN_FILES - 1);
+  assert(FT_containsFileIn(oFT, acPath));
+  assert(FT_rmDirIn(oFT, pcDir) == SUCCESS);
+  assert(!FT_containsFileIn(oFT, acPath));
+  assert(FT_rmDirIn(oFT, pcDir) == NO_SUCH_PATH);
+}
+
+/* Churns the directory r/t<i> of oFTShared NUM_ROUNDS times, i being
+   the int at piChurner */
+static void *churn(void *piChurner) {
+  char acDir[32];
+  int iRound;
+
+  sprintf(acDir, "r/t%d", *(int *) piChurner);
+  for(iRound = 0; iRound < NUM_ROUNDS; iRound++)
+    churnOnce(oFTShared, acDir);
+  return NULL;
+}
+
+/* Checks that blocks given back to the pool are handed out again
+   rather than new slabs being taken, and that Pool_trim frees the
+   slabs left with no block in use */
+static void checkPool(void) {
+  void *apvBlocks[NUM_BLOCKS];
+  void *pv;
+  size_t ulBefore;
+  size_t ulFull;
+  int i;
+
+  pv = Pool_alloc(BLOCK_SIZE);
+  assert(pv != NULL);
+  Pool_free(pv);
+  assert(Pool_alloc(BLOCK_SIZE) == pv);
+  Pool_free(pv);
+
+  ulBefore = Pool_getSlabs();
+  for(i = 0; i < NUM_BLOCKS; i++) {
+    apvBlocks[i] = Pool_alloc(BLOCK_SIZE);
+    assert(apvBlocks[i] != NULL);
+  }
+  ulFull = Pool_getSlabs();
+  assert(ulFull > ulBefore);
+  for(i = 0; i < NUM_BLOCKS; i++)
+    Pool_free(apvBlocks[i]);
+  /* the slabs stay until they are trimmed... */
+  assert(Pool_getSlabs() == ulFull);
+  for(i = 0; i < NUM_BLOCKS; i++) {
+    apvBlocks[i] = Pool_alloc(BLOCK_SIZE);
+    assert(apvBlocks[i] != NULL);
+  }
+  /* ...and are used again meanwhile */
+  assert(Pool_getSlabs() == ulFull);
+  for(i = 0; i < NUM_BLOCKS; i++)
+    Pool_free(apvBlocks[i]);
+  Pool_trim();
+  assert(Pool_getSlabs() <= ulBefore);
+}
+
+/* Churns a shared FT in mode iMode from several threads at once,
+   checking that the pool reuses what each round frees instead of
+   growing with every round, then removes a subtree large enough that
+   freeing it in the background trims the pool */
+static void runMode(int iMode) {
+  pthread_t aThreads[NUM_CHURNERS];
+  int aiChurners[NUM_CHURNERS];
+  char acPath[64];
+  size_t ulBefore;
+  size_t ulOneRound;
+  size_t ulPeak;
+  int i;
+
+  oFTShared = FT_new();
+  assert(oFTShared != NULL);
+  assert(FT_setSynchronizedIn(oFTShared, TRUE) == SUCCESS);
+  if(iMode & MODE_INDEXED)
+    assert(FT_setIndexedIn(oFTShared, TRUE) == SUCCESS);
+  if(iMode & MODE_LOCK_FREE)
+    assert(FT_setLockFreeReadsIn(oFTShared, TRUE) == SUCCESS);
+  assert(FT_insertDirIn(oFTShared, "r") == SUCCESS);
+
+  /* what a single round takes at most, had nothing been freed */
+  ulBefore = Pool_getSlabs();
+  churnOnce(oFTShared, "r/t");
+  ulOneRound = Pool_getSlabs() - ulBefore + 1;
+
+  for(i = 0; i < NUM_CHURNERS; i++) {
+    aiChurners[i] = i;
+    assert(pthread_create(&aThreads[i], NULL, churn, &aiChurners[i])
+           == 0);
+  }
+  for(i = 0; i < NUM_CHURNERS; i++)
+    assert(pthread_join(aThreads[i], NULL) == 0);
+  /* without reuse, the threads would have taken NUM_ROUNDS times as
+     many slabs as a round needs */
+  assert(Pool_getSlabs() <= ulBefore + 2 * NUM_CHURNERS * ulOneRound);
+
+  ulBefore = Pool_getSlabs();
+  for(i = 0; i < BIG_FILES; i++) {
+    sprintf(acPath, "r/big/d%d/f%d", i % BIG_DIRS, i);
+    assert(FT_insertFileIn(oFTShared, acPath, NULL, 0) == SUCCESS);
+  }
+  ulPeak = Pool_getSlabs();
+  assert(ulPeak > ulBefore);
+  assert(FT_rmDirIn(oFTShared, "r/big") == SUCCESS);
+  FT_waitReclaim();
+  assert(FT_getPendingReclaim() == 0);
+  /* most of the subtree's slabs went back to the system */
+  assert(Pool_getSlabs() <= ulBefore + (ulPeak - ulBefore) / 2);
+
+  FT_free(oFTShared);
+  FT_waitReclaim();
+}
+
+/* Tests the pool that FT nodes come from: blocks freed must be
+   handed out again, and, in every mode of a synchronized FT, threads
+   building and removing subtrees at once must keep reusing the same
+   slabs, while removing a subtree of more than 65536 nodes must give
+   the slabs it leaves unused back to the system.
+   Prints the status of the data structure along the way to stderr.
+   Returns 0. */
+int main(void) {
+  int iMode;
+
+  checkPool();
+  fprintf(stderr, "The pool reuses and trims its slabs\n");
+
+  for(iMode = 0; iMode < 4; iMode++) {
+    runMode(iMode);
+    fprintf(stderr, "Mode %d: churn reused slabs, removal trimmed "
+            "them\n", iMode);
+  }
+  return 0;
+}
@@ -0,0 +1,204 @@
+/*--------------------------------------------------------------------*/
+/* ft_reclaim_client.c                                                */
+/* Author: Matthew Okechukwu, Pinrui Huang                            */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include "ft.h"
+#include "reclaim.h"
+
+/* The weight of the item that holds the background thread back */
+enum {BLOCKER_WEIGHT = 7};
+
+/* The number of files in a subtree too large to free at once, and in
+   one just small enough; each subtree also has its own directory */
+enum {LARGE_FILES = 3000, SMALL_FILES = 255};
+
+/* The modes that a run may set on its FT */
+enum {MODE_SYNCHRONIZED = 1, MODE_LOCK_FREE = 2, MODE_INDEXED = 4};
+
+/* The lock and condition with which the client releases the item
+   that holds the background thread back, and the flag they guard */
+static pthread_mutex_t sBlockerLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sBlockerReleased = PTHREAD_COND_INITIALIZER;
+static int iReleased;
+
+/* The thread that freed the last item that recordFree was given */
+static pthread_t sFreer;
+
+/* Frees nothing, but waits until the client releases it, so that the
+   background thread frees nothing deferred after it until then */
+static void waitForRelease(void *pvItem) {
+  assert(pvItem != NULL);
+  (void) pthread_mutex_lock(&sBlockerLock);
+  while(!iReleased)
+    (void) pthread_cond_wait(&sBlockerReleased, &sBlockerLock);
+  (void) pthread_mutex_unlock(&sBlockerLock);
+}
+
+/* Records that the thread it runs on freed pvItem, a malloc'd int */
+static void recordFree(void *pvItem) {
+  sFreer = pthread_self();
+  free(pvItem);
+}
+
+/* Holds the background thread back until releaseReclaim is called,
+   so that every subtree deferred meanwhile stays pending */
+static void holdReclaim(void) {
+  static int iItem;
+
+  iReleased = 0;
+  assert(Reclaim_defer(waitForRelease, &iItem, BLOCKER_WEIGHT, 0));
+}
+
+/* Lets the background thread go on after holdReclaim */
+static void releaseReclaim(void) {
+  (void) pthread_mutex_lock(&sBlockerLock);
+  iReleased = 1;
+  (void) pthread_cond_signal(&sBlockerReleased);
+  (void) pthread_mutex_unlock(&sBlockerLock);
+}
+
+/* Inserts the directory pcDir into oFT with ulFiles files in it */
+static void insertFiles(FT_T oFT, const char *pcDir, size_t ulFiles) {
+  char acPath[64];
+  size_t ul;
+
+  assert(FT_insertDirIn(oFT, pcDir) == SUCCESS);
+  for(ul = 0; ul < ulFiles; ul++) {
+    sprintf(acPath, "%s/f%lu", pcDir, (unsigned long) ul);
+    assert(FT_insertFileIn(oFT, acPath, NULL, 0) == SUCCESS);
+  }
+}
+
+/* Returns a new FT in mode iMode */
+static FT_T newTree(int iMode) {
+  FT_T oFT;
+
+  oFT = FT_new();
+  assert(oFT != NULL);
+  if(iMode & MODE_SYNCHRONIZED)
+    assert(FT_setSynchronizedIn(oFT, TRUE) == SUCCESS);
+  if(iMode & MODE_LOCK_FREE)
+    assert(FT_setLockFreeReadsIn(oFT, TRUE) == SUCCESS);
+  if(iMode & MODE_INDEXED)
+    assert(FT_setIndexedIn(oFT, TRUE) == SUCCESS);
+  return oFT;
+}
+
+/* Checks in mode iMode that a subtree too large to free at once is
+   left pending until the background thread frees it, that one just
+   small enough, and one from an arena, never is, and that the count
+   comes back to 0 once FT_waitReclaim returns, even for nodes that a
+   snapshot still shares */
+static void runMode(int iMode) {
+  FT_T oFT;
+  FT_T oFTSnapshot;
+
+  assert(FT_getPendingReclaim() == 0);
+  oFT = newTree(iMode);
+  insertFiles(oFT, "r", 0);
+  insertFiles(oFT, "r/small", SMALL_FILES);
+  insertFiles(oFT, "r/large", LARGE_FILES);
+  insertFiles(oFT, "r/kept", LARGE_FILES);
+
+  holdReclaim();
+  assert(FT_getPendingReclaim() == BLOCKER_WEIGHT);
+  assert(FT_rmDirIn(oFT, "r/small") == SUCCESS);
+  assert(FT_getPendingReclaim() == BLOCKER_WEIGHT);
+  assert(FT_rmDirIn(oFT, "r/large") == SUCCESS);
+  assert(FT_getPendingReclaim() == BLOCKER_WEIGHT + LARGE_FILES + 1);
+  assert(!FT_containsDirIn(oFT, "r/large"));
+
+  /* the nodes a snapshot still shares are pending all the same, and
+     freeing them lets go only of the FT's references */
+  oFTSnapshot = FT_snapshotIn(oFT);
+  assert(oFTSnapshot != NULL);
+  assert(FT_rmDirIn(oFT, "r/kept") == SUCCESS);
+  assert(FT_getPendingReclaim() ==
+         BLOCKER_WEIGHT + 2 * (LARGE_FILES + 1));
+  assert(FT_containsFileIn(oFTSnapshot, "r/kept/f0"));
+  releaseReclaim();
+  FT_waitReclaim();
+  assert(FT_getPendingReclaim() == 0);
+  assert(FT_containsFileIn(oFTSnapshot, "r/kept/f0"));
+  FT_snapshotRelease(oFTSnapshot);
+
+  /* freeing the whole FT */
+  insertFiles(oFT, "r/again", LARGE_FILES);
+  holdReclaim();
+  FT_free(oFT);
+  assert(FT_getPendingReclaim() == BLOCKER_WEIGHT + LARGE_FILES + 2);
+  releaseReclaim();
+  FT_waitReclaim();
+  assert(FT_getPendingReclaim() == 0);
+
+  /* an arena is emptied at once */
+  oFT = newTree(iMode);
+  assert(FT_setArenaIn(oFT, TRUE) == SUCCESS);
+  insertFiles(oFT, "r", LARGE_FILES);
+  holdReclaim();
+  assert(FT_rmDirIn(oFT, "r") == SUCCESS);
+  insertFiles(oFT, "r", LARGE_FILES);
+  FT_free(oFT);
+  assert(FT_getPendingReclaim() == BLOCKER_WEIGHT);
+  releaseReclaim();
+  FT_waitReclaim();
+  assert(FT_getPendingReclaim() == 0);
+}
+
+/* Tests the background reclamation behind FT_rmDir, FT_destroy and
+   FT_free: a subtree larger than the threshold must stay pending,
+   counted by FT_getPendingReclaim, until the background thread frees
+   it, and FT_waitReclaim must leave nothing pending, whether or not
+   the thread was held back meanwhile.
+   Prints the status of the data structure along the way to stderr.
+   Returns 0. */
+int main(void) {
+  char acPath[64];
+  int *piItem;
+  int iMode;
+  int i;
+
+  /* the background thread frees what it is given, off this thread */
+  piItem = malloc(sizeof(int));
+  assert(piItem != NULL);
+  sFreer = pthread_self();
+  assert(Reclaim_defer(recordFree, piItem, 3, 0));
+  Reclaim_wait();
+  assert(!pthread_equal(sFreer, pthread_self()));
+  assert(Reclaim_getPending() == 0);
+
+  /* the default FT, changed and destroyed while the thread is held
+     back */
+  assert(FT_init() == SUCCESS);
+  holdReclaim();
+  for(i = 0; i < LARGE_FILES; i++) {
+    sprintf(acPath, "r/d/f%d", i);
+    assert(FT_insertFile(acPath, NULL, 0) == SUCCESS);
+  }
+  assert(FT_rmDir("r/d") == SUCCESS);
+  assert(FT_getPendingReclaim() == BLOCKER_WEIGHT + LARGE_FILES + 1);
+  for(i = 0; i < LARGE_FILES; i++) {
+    sprintf(acPath, "r/d/f%d", i);
+    assert(FT_insertFile(acPath, NULL, 0) == SUCCESS);
+  }
+  assert(FT_destroy() == SUCCESS);
+  assert(FT_getPendingReclaim() ==
+         BLOCKER_WEIGHT + 2 * (LARGE_FILES + 1) + 1);
+  releaseReclaim();
+  FT_waitReclaim();
+  assert(FT_getPendingReclaim() == 0);
+  fprintf(stderr, "The background thread frees what it is given\n");
+
+  for(iMode = 0; iMode < 8; iMode++) {
+    runMode(iMode);
+    fprintf(stderr, "Mode %d: nothing left pending\n", iMode);
+  }
+  return 0;
+}
@@ -0,0 +1,250 @@
+/*--------------------------------------------------------------------*/
+/* ft_snapshot_client.c                                               */
+/* Author: Matthew Okechukwu, Pinrui Huang                            */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "ft.h"
+
+/* The number of snapshots that each run takes along the way */
+enum {NUM_SNAPSHOTS = 6};
+
+/* The modes that a run may set on its FT */
+enum {MODE_SYNCHRONIZED = 1, MODE_INDEXED = 2, MODE_ARENA = 4};
+
+/* Returns, in a new block that the caller owns, the contents of
+   oFT's files, in the order of FT_toString, one per line */
+static char *listContents(FT_T oFT) {
+  FTIter_T oIter;
+  const char *pcPath;
+  const char *pcContents;
+  char *pcList;
+  size_t ulLength = 0;
+  boolean bIsFile;
+  size_t l;
+
+  pcList = malloc(1);
+  assert(pcList != NULL);
+  pcList[0] = '\0';
+  assert(FT_iterOpenIn(oFT, NULL, &oIter) == SUCCESS);
+  while(FT_iterNext(oIter, &pcPath, &bIsFile, &l) == SUCCESS) {
+    if(!bIsFile)
+      continue;
+    pcContents = FT_getFileContentsIn(oFT, pcPath);
+    assert(pcContents != NULL);
+    assert(strlen(pcContents) + 1 == l);
+    /* each file's contents begin with the path it was inserted at */
+    assert(!strncmp(pcContents, pcPath, strlen(pcPath)));
+    pcList = realloc(pcList, ulLength + l + 1);
+    assert(pcList != NULL);
+    sprintf(pcList + ulLength, "%s\n", pcContents);
+    ulLength += l;
+  }
+  FT_iterClose(oIter);
+  return pcList;
+}
+
+/* Checks that oFTSnapshot still holds just what pcExpected, the
+   FT_toString of its source when it was taken, lists, and that its
+   files still have the contents that pcContents, its listContents
+   then, lists */
+static void checkSnapshot(FT_T oFTSnapshot, const char *pcExpected,
+                          const char *pcContents) {
+  char *pcNow;
+
+  pcNow = FT_toStringIn(oFTSnapshot);
+  assert(pcNow != NULL);
+  assert(!strcmp(pcNow, pcExpected));
+  free(pcNow);
+  pcNow = listContents(oFTSnapshot);
+  assert(!strcmp(pcNow, pcContents));
+  free(pcNow);
+}
+
+/* Returns new contents for the file pcPath, numbered ulVersion, in a
+   new block that the client owns: the path and the version */
+static char *newContents(const char *pcPath, size_t ulVersion) {
+  char *pcContents;
+
+  pcContents = malloc(strlen(pcPath) + 32);
+  assert(pcContents != NULL);
+  sprintf(pcContents, "%s#%lu", pcPath, (unsigned long) ulVersion);
+  return pcContents;
+}
+
+/* Makes change iChange to oFT: a cycle of inserts, removals,
+   replaced contents and moves spread over the tree. Contents that
+   a change replaces or removes go to *ppvRetired, since a snapshot
+   may still hold them */
+static void makeChange(FT_T oFT, int iChange, void ***ppvRetired,
+                       size_t *pulRetired) {
+  char acPath[64];
+  char acTo[64];
+  void *pvOld;
+  int iDir = (iChange * 5) % 7;
+  int iFile = (iChange * 3) % 5;
+
+  sprintf(acPath, "1root/d%d/f%d", iDir, iFile);
+  switch(iChange % 5) {
+  case 0:
+    pvOld = newContents(acPath, (size_t) iChange);
+    if(FT_insertFileIn(oFT, acPath, pvOld, strlen(pvOld) + 1) !=
+       SUCCESS)
+      free(pvOld);
+    return;
+  case 1:
+    pvOld = FT_getFileContentsIn(oFT, acPath);
+    if(FT_rmFileIn(oFT, acPath) != SUCCESS)
+      return;
+    break;
+  case 2: {
+    char *pcNew = newContents(acPath, (size_t) iChange);
+    if(!FT_containsFileIn(oFT, acPath)) {
+      free(pcNew);
+      return;
+    }
+    pvOld = FT_replaceFileContentsIn(oFT, acPath, pcNew,
+                                     strlen(pcNew) + 1);
+    break;
+  }
+  case 3:
+    sprintf(acPath, "1root/d%d/sub", iDir);
+    if(FT_rmDirIn(oFT, acPath) != SUCCESS)
+      (void) FT_insertDirIn(oFT, acPath);
+    return;
+  default:
+    /* contents name their file's path, so move only directories
+       that hold no files */
+    sprintf(acPath, "1root/d%d/sub", iDir);
+    sprintf(acTo, "1root/d%d/sub", (iDir + 1) % 7);
+    if(FT_moveIn(oFT, acPath, acTo) != SUCCESS) {
+      sprintf(acTo, "1root/e%d", iChange);
+      (void) FT_moveIn(oFT, acPath, acTo);
+    }
+    return;
+  }
+
+  /* pvOld is no longer in oFT, but may be in a snapshot */
+  if(pvOld == NULL)
+    return;
+  *ppvRetired = realloc(*ppvRetired,
+                        (*pulRetired + 1) * sizeof(void *));
+  assert(*ppvRetired != NULL);
+  (*ppvRetired)[(*pulRetired)++] = pvOld;
+}
+
+/* Frees oFT, along with its files' contents, which the client owns */
+static void freeTree(FT_T oFT) {
+  FTIter_T oIter;
+  const char *pcPath;
+  boolean bIsFile;
+  size_t l;
+
+  assert(FT_iterOpenIn(oFT, NULL, &oIter) == SUCCESS);
+  while(FT_iterNext(oIter, &pcPath, &bIsFile, &l) == SUCCESS)
+    if(bIsFile)
+      free(FT_getFileContentsIn(oFT, pcPath));
+  FT_iterClose(oIter);
+  FT_free(oFT);
+}
+
+/* Builds a tree in mode iMode, takes snapshots of it between rounds
+   of changes, and checks after each round that every snapshot is
+   still as it was taken, releasing them early or late as
+   bReleaseEarly says */
+static void runMode(int iMode, boolean bReleaseEarly) {
+  FT_T oFT;
+  FT_T aoFTSnapshots[NUM_SNAPSHOTS];
+  char *apcExpected[NUM_SNAPSHOTS];
+  char *apcContents[NUM_SNAPSHOTS];
+  void **ppvRetired = NULL;
+  size_t ulRetired = 0;
+  char acPath[64];
+  int iChange = 0;
+  int i, j;
+
+  oFT = FT_new();
+  assert(oFT != NULL);
+  if(iMode & MODE_ARENA)
+    assert(FT_setArenaIn(oFT, TRUE) == SUCCESS);
+  if(iMode & MODE_SYNCHRONIZED)
+    assert(FT_setSynchronizedIn(oFT, TRUE) == SUCCESS);
+  if(iMode & MODE_INDEXED)
+    assert(FT_setIndexedIn(oFT, TRUE) == SUCCESS);
+  for(i = 0; i < 7; i++) {
+    for(j = 0; j < 5; j += 2) {
+      sprintf(acPath, "1root/d%d/f%d", i, j);
+      assert(FT_insertFileIn(oFT, acPath, newContents(acPath, 0),
+                             strlen(acPath) + 3) == SUCCESS);
+    }
+    sprintf(acPath, "1root/d%d/sub/x", i);
+    assert(FT_insertDirIn(oFT, acPath) == SUCCESS);
+  }
+
+  for(i = 0; i < NUM_SNAPSHOTS; i++) {
+    aoFTSnapshots[i] = FT_snapshotIn(oFT);
+    assert(aoFTSnapshots[i] != NULL);
+    apcExpected[i] = FT_toStringIn(oFT);
+    assert(apcExpected[i] != NULL);
+    apcContents[i] = listContents(oFT);
+
+    /* a snapshot is read-only, and cannot itself be snapshotted */
+    assert(FT_insertDirIn(aoFTSnapshots[i], "1root/new") ==
+           INITIALIZATION_ERROR);
+    assert(FT_rmDirIn(aoFTSnapshots[i], "1root/d0") ==
+           INITIALIZATION_ERROR);
+    assert(FT_snapshotIn(aoFTSnapshots[i]) == NULL);
+
+    for(j = 0; j < 40; j++)
+      makeChange(oFT, iChange++, &ppvRetired, &ulRetired);
+    for(j = 0; j <= i; j++)
+      if(aoFTSnapshots[j] != NULL)
+        checkSnapshot(aoFTSnapshots[j], apcExpected[j],
+                      apcContents[j]);
+
+    if(bReleaseEarly && i % 2 == 1) {
+      FT_snapshotRelease(aoFTSnapshots[i - 1]);
+      aoFTSnapshots[i - 1] = NULL;
+    }
+  }
+
+  /* release the rest, newest first, checking each to the last */
+  for(i = NUM_SNAPSHOTS - 1; i >= 0; i--) {
+    if(aoFTSnapshots[i] != NULL) {
+      checkSnapshot(aoFTSnapshots[i], apcExpected[i], apcContents[i]);
+      FT_snapshotRelease(aoFTSnapshots[i]);
+    }
+    free(apcExpected[i]);
+    free(apcContents[i]);
+  }
+
+  /* with no snapshot left, the source changes and frees as ever */
+  for(j = 0; j < 20; j++)
+    makeChange(oFT, iChange++, &ppvRetired, &ulRetired);
+  freeTree(oFT);
+  FT_waitReclaim();
+  for(i = 0; i < (int) ulRetired; i++)
+    free(ppvRetired[i]);
+  free(ppvRetired);
+}
+
+/* Tests FT_snapshot: each snapshot must keep the tree as it was when
+   taken, however its source changes afterwards by inserts, removals,
+   replaced contents and moves, in every mode, whichever order the
+   snapshots are released in, and every tree must then free cleanly.
+   Prints the status of the data structure along the way to stderr.
+   Returns 0. */
+int main(void) {
+  int iMode;
+
+  for(iMode = 0; iMode < 8; iMode++) {
+    runMode(iMode, FALSE);
+    runMode(iMode, TRUE);
+    fprintf(stderr, "Mode %d: every snapshot kept its tree\n", iMode);
+  }
+  return 0;
+}
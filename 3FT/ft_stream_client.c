@@ -0,0 +1,227 @@
+/*--------------------------------------------------------------------*/
+/* ft_stream_client.c                                                 */
+/* Author: Matthew Okechukwu, Pinrui Huang                            */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "ft.h"
+
+/* The file that the tests open only for reading */
+static const char *pcReadOnlyFile = "ft_stream_client.tmp";
+
+/* The modes that a run may set on its FT */
+enum {MODE_SYNCHRONIZED = 1, MODE_INDEXED = 2, MODE_ARENA = 4};
+
+/* The text that a sink has been given so far, and the number of
+   chunks that it accepts before it fails, or -1 to accept all */
+struct Sink {
+  char *pcText;
+  size_t ulLength;
+  size_t ulChunks;
+  long lLimit;
+};
+
+/* Appends the ulLength characters at pcChunk, a single node's line,
+   to the struct Sink pvSink, or returns NO_SUCH_PATH, a status that
+   FT_writeChunks itself never returns, once its limit is reached */
+static int collectChunk(const char *pcChunk, size_t ulLength,
+                        void *pvSink) {
+  struct Sink *psSink = pvSink;
+
+  assert(ulLength > 0);
+  /* each chunk is one whole line */
+  assert(pcChunk[ulLength - 1] == '\n');
+  assert(memchr(pcChunk, '\n', ulLength - 1) == NULL);
+  if(psSink->lLimit >= 0 && psSink->ulChunks == (size_t) psSink->lLimit)
+    return NO_SUCH_PATH;
+  psSink->pcText = realloc(psSink->pcText,
+                           psSink->ulLength + ulLength + 1);
+  assert(psSink->pcText != NULL);
+  memcpy(psSink->pcText + psSink->ulLength, pcChunk, ulLength);
+  psSink->ulLength += ulLength;
+  psSink->pcText[psSink->ulLength] = '\0';
+  psSink->ulChunks++;
+  return SUCCESS;
+}
+
+/* Returns the number of lines in pcText */
+static size_t countLines(const char *pcText) {
+  size_t ulLines = 0;
+
+  for(; *pcText != '\0'; pcText++)
+    if(*pcText == '\n')
+      ulLines++;
+  return ulLines;
+}
+
+/* Checks that FT_writeChunksIn gives oFT's FT_toString, one node per
+   chunk, and that a sink that fails after its first k chunks, for
+   every k, stops the stream with its status after exactly the first
+   k lines of FT_toString */
+static void checkChunks(FT_T oFT, const char *pcExpected) {
+  struct Sink sSink;
+  size_t ulLines = countLines(pcExpected);
+  size_t ulPrefix = 0;
+  long k;
+
+  sSink.pcText = NULL;
+  sSink.ulLength = 0;
+  sSink.ulChunks = 0;
+  sSink.lLimit = -1;
+  assert(FT_writeChunksIn(oFT, collectChunk, &sSink) == SUCCESS);
+  assert(sSink.ulChunks == ulLines);
+  assert(sSink.ulLength == strlen(pcExpected));
+  assert(ulLines == 0 || !strcmp(sSink.pcText, pcExpected));
+  free(sSink.pcText);
+
+  for(k = 0; k < (long) ulLines; k++) {
+    sSink.pcText = NULL;
+    sSink.ulLength = 0;
+    sSink.ulChunks = 0;
+    sSink.lLimit = k;
+    assert(FT_writeChunksIn(oFT, collectChunk, &sSink) ==
+           NO_SUCH_PATH);
+    assert(sSink.ulChunks == (size_t) k);
+    assert(sSink.ulLength == ulPrefix);
+    assert(k == 0 || !strncmp(sSink.pcText, pcExpected, ulPrefix));
+    free(sSink.pcText);
+    ulPrefix = (size_t) (strchr(pcExpected + ulPrefix, '\n') -
+                         pcExpected) + 1;
+  }
+}
+
+/* Checks that FT_writeToIn writes oFT's FT_toString to a file, and
+   that it returns IO_ERROR for a stream that cannot be written */
+static void checkStream(FT_T oFT, const char *pcExpected) {
+  FILE *psFile;
+  char *pcRead;
+  size_t ulLength = strlen(pcExpected);
+
+  psFile = tmpfile();
+  assert(psFile != NULL);
+  assert(FT_writeToIn(oFT, psFile) == SUCCESS);
+  assert((size_t) ftell(psFile) == ulLength);
+  rewind(psFile);
+  pcRead = malloc(ulLength + 1);
+  assert(pcRead != NULL);
+  assert(fread(pcRead, 1, ulLength + 1, psFile) == ulLength);
+  pcRead[ulLength] = '\0';
+  assert(!strcmp(pcRead, pcExpected));
+  free(pcRead);
+  fclose(psFile);
+
+  /* a stream opened only for reading fails every write */
+  if(ulLength > 0) {
+    psFile = fopen(pcReadOnlyFile, "w");
+    assert(psFile != NULL);
+    fclose(psFile);
+    psFile = fopen(pcReadOnlyFile, "r");
+    assert(psFile != NULL);
+    assert(FT_writeToIn(oFT, psFile) == IO_ERROR);
+    fclose(psFile);
+    remove(pcReadOnlyFile);
+  }
+}
+
+/* Checks both ways of streaming oFT against its FT_toString */
+static void checkTree(FT_T oFT) {
+  char *pcExpected;
+
+  pcExpected = FT_toStringIn(oFT);
+  assert(pcExpected != NULL);
+  checkChunks(oFT, pcExpected);
+  checkStream(oFT, pcExpected);
+  free(pcExpected);
+}
+
+/* Builds a tree in mode iMode, with a wide directory, a deep path
+   and names that sort differently by length and by character, and
+   checks the streams of it and of a snapshot of it as it grows and
+   shrinks */
+static void runMode(int iMode) {
+  FT_T oFT;
+  FT_T oFTSnapshot;
+  char acPath[512];
+  size_t ulLength;
+  int i;
+
+  oFT = FT_new();
+  assert(oFT != NULL);
+  if(iMode & MODE_ARENA)
+    assert(FT_setArenaIn(oFT, TRUE) == SUCCESS);
+  if(iMode & MODE_SYNCHRONIZED)
+    assert(FT_setSynchronizedIn(oFT, TRUE) == SUCCESS);
+  if(iMode & MODE_INDEXED)
+    assert(FT_setIndexedIn(oFT, TRUE) == SUCCESS);
+  checkTree(oFT);
+
+  assert(FT_insertDirIn(oFT, "1root") == SUCCESS);
+  checkTree(oFT);
+  for(i = 0; i < 150; i++) {
+    sprintf(acPath, "1root/wide/f%d", (i * 37) % 150);
+    assert(FT_insertFileIn(oFT, acPath, NULL, 0) == SUCCESS);
+    sprintf(acPath, "1root/wide/d%d", (i * 37) % 150);
+    assert(FT_insertDirIn(oFT, acPath) == SUCCESS);
+  }
+  assert(FT_insertFileIn(oFT, "1root/a", "a", 2) == SUCCESS);
+  assert(FT_insertFileIn(oFT, "1root/aa", "aa", 3) == SUCCESS);
+  assert(FT_insertDirIn(oFT, "1root/A/B") == SUCCESS);
+  strcpy(acPath, "1root/deep");
+  ulLength = strlen(acPath);
+  for(i = 0; i < 40; i++) {
+    sprintf(acPath + ulLength, "/level%d", i);
+    ulLength = strlen(acPath);
+  }
+  assert(FT_insertFileIn(oFT, acPath, NULL, 0) == SUCCESS);
+  checkTree(oFT);
+
+  oFTSnapshot = FT_snapshotIn(oFT);
+  assert(oFTSnapshot != NULL);
+  assert(FT_rmDirIn(oFT, "1root/wide") == SUCCESS);
+  assert(FT_rmFileIn(oFT, "1root/a") == SUCCESS);
+  checkTree(oFTSnapshot);
+  checkTree(oFT);
+  FT_snapshotRelease(oFTSnapshot);
+
+  assert(FT_rmDirIn(oFT, "1root") == SUCCESS);
+  checkTree(oFT);
+  FT_free(oFT);
+  FT_waitReclaim();
+}
+
+/* Tests FT_writeChunks and FT_writeTo: in every mode, and for a
+   snapshot, both must give exactly what FT_toString returns, one
+   node per chunk, and a sink that fails partway must stop the stream
+   with its own status after exactly the lines it accepted.
+   Prints the status of the data structure along the way to stderr.
+   Returns 0. */
+int main(void) {
+  struct Sink sSink;
+  int iMode;
+
+  /* the default FT streams nothing until it is initialized */
+  sSink.pcText = NULL;
+  sSink.ulLength = 0;
+  sSink.ulChunks = 0;
+  sSink.lLimit = -1;
+  assert(FT_writeChunks(collectChunk, &sSink) == INITIALIZATION_ERROR);
+  assert(FT_writeTo(stdout) == INITIALIZATION_ERROR);
+  assert(sSink.ulChunks == 0);
+  assert(FT_init() == SUCCESS);
+  assert(FT_insertFile("1root/2file", NULL, 0) == SUCCESS);
+  assert(FT_writeChunks(collectChunk, &sSink) == SUCCESS);
+  assert(!strcmp(sSink.pcText, "1root\n1root/2file\n"));
+  free(sSink.pcText);
+  assert(FT_destroy() == SUCCESS);
+
+  for(iMode = 0; iMode < 8; iMode++) {
+    runMode(iMode);
+    fprintf(stderr, "Mode %d: every stream matched FT_toString\n",
+            iMode);
+  }
+  return 0;
+}
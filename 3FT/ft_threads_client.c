@@ -0,0 +1,330 @@
+/*--------------------------------------------------------------------*/
+/* ft_threads_client.c                                                */
+/* Author: Matthew Okechukwu, Pinrui Huang                            */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include "ft.h"
+
+/* The numbers of writers and readers, and of changes per writer */
+enum {NUM_WRITERS = 4, NUM_READERS = 3, NUM_CHANGES = 3000};
+
+/* The numbers of directories and files that each writer uses */
+enum {NUM_DIRS = 8, NUM_FILES = 24};
+
+/* The FT that the threads share, and the mode of the current run */
+static FT_T oFTShared;
+static int iMode;
+
+/* The modes: each run sets some of them on oFTShared */
+enum {MODE_LOCK_FREE = 1, MODE_INDEXED = 2, MODE_SNAPSHOTS = 4,
+      MODE_MOVES = 8};
+
+/* The contents that files are given; never freed */
+static char acContents[NUM_FILES + 1][8];
+
+/* Each writer's record of the status of each of its changes */
+static int aaiStatuses[NUM_WRITERS][NUM_CHANGES];
+
+/* Returns the next pseudo-random number from *puSeed, which it
+   advances; unlike rand, it keeps each thread's sequence its own */
+static unsigned nextRandom(unsigned *puSeed) {
+  *puSeed = *puSeed * 1103515245u + 12345u;
+  return (*puSeed >> 16) & 0x7fffu;
+}
+
+/* Makes writer iWriter's iChange-th change to oFT, drawn from
+   *puSeed, and returns its status. Every writer changes only the
+   subtree r/t<iWriter>, so the changes of different writers commute
+   and the tree they leave does not depend on how they interleave. */
+static int makeChange(FT_T oFT, int iWriter, unsigned *puSeed) {
+  char acPath[64];
+  char acTo[64];
+  unsigned uKind = nextRandom(puSeed) % 10;
+  unsigned uDir = nextRandom(puSeed) % NUM_DIRS;
+  unsigned uFile = nextRandom(puSeed) % NUM_FILES;
+  unsigned uOther = nextRandom(puSeed) % NUM_DIRS;
+
+  switch(uKind) {
+  case 0:
+  case 1:
+    sprintf(acPath, "r/t%d/d%u", iWriter, uDir);
+    return FT_insertDirIn(oFT, acPath);
+  case 2:
+  case 3:
+  case 4:
+    sprintf(acPath, "r/t%d/d%u/f%u", iWriter, uDir, uFile);
+    return FT_insertFileIn(oFT, acPath, acContents[uFile],
+                           strlen(acContents[uFile]));
+  case 5:
+  case 6:
+    sprintf(acPath, "r/t%d/d%u/f%u", iWriter, uDir, uFile);
+    return FT_rmFileIn(oFT, acPath);
+  case 7:
+    sprintf(acPath, "r/t%d/d%u/f%u", iWriter, uDir, uFile);
+    return FT_replaceFileContentsIn(oFT, acPath, acContents[uOther],
+                                    strlen(acContents[uOther])) ==
+      NULL ? NO_SUCH_PATH : SUCCESS;
+  case 8:
+    if(uFile % 4 != 0)
+      return SUCCESS;
+    sprintf(acPath, "r/t%d/d%u", iWriter, uDir);
+    return FT_rmDirIn(oFT, acPath);
+  default:
+    if(!(iMode & MODE_MOVES))
+      return SUCCESS;
+    sprintf(acPath, "r/t%d/d%u", iWriter, uDir);
+    sprintf(acTo, "r/t%d/d%u/m%u", iWriter, uOther, uFile);
+    return FT_moveIn(oFT, acPath, acTo);
+  }
+}
+
+/* Makes writer (long) pvWriter's changes to oFTShared */
+static void *writeShared(void *pvWriter) {
+  int iWriter = (int) (long) pvWriter;
+  unsigned uSeed = (unsigned) iWriter * 7919u + 1u;
+  int i;
+
+  for(i = 0; i < NUM_CHANGES; i++)
+    aaiStatuses[iWriter][i] = makeChange(oFTShared, iWriter, &uSeed);
+  return NULL;
+}
+
+/* Reads oFTShared in every way it can be read while the writers
+   change it, checking only what no interleaving of them can falsify */
+static void *readShared(void *pvReader) {
+  unsigned uSeed = (unsigned) (long) pvReader;
+  char acPath[64];
+  char *pcString;
+  const char *pcIterPath;
+  FTIter_T oIter;
+  FT_T oFTSnapshot;
+  boolean bIsFile;
+  size_t l;
+  int i;
+
+  for(i = 0; i < 2 * NUM_CHANGES; i++) {
+    sprintf(acPath, "r/t%u/d%u/f%u", nextRandom(&uSeed) % NUM_WRITERS,
+            nextRandom(&uSeed) % NUM_DIRS,
+            nextRandom(&uSeed) % NUM_FILES);
+    if(FT_statIn(oFTShared, acPath, &bIsFile, &l) == SUCCESS)
+      assert(!bIsFile || l <= strlen(acContents[NUM_FILES - 1]));
+    (void) FT_containsFileIn(oFTShared, acPath);
+    (void) FT_getFileContentsIn(oFTShared, acPath);
+    assert(FT_containsDirIn(oFTShared, "r"));
+
+    if(i % 400 == 0) {
+      pcString = FT_toStringIn(oFTShared);
+      assert(pcString != NULL);
+      assert(!strncmp(pcString, "r\n", 2));
+      free(pcString);
+    }
+    if(i % 900 == 0) {
+      assert(FT_iterOpenIn(oFTShared, NULL, &oIter) == SUCCESS);
+      while(FT_iterNext(oIter, &pcIterPath, &bIsFile, &l) == SUCCESS)
+        assert(pcIterPath[0] == 'r');
+      FT_iterClose(oIter);
+    }
+    if((iMode & MODE_SNAPSHOTS) && i % 700 == 0) {
+      oFTSnapshot = FT_snapshotIn(oFTShared);
+      assert(oFTSnapshot != NULL);
+      pcString = FT_toStringIn(oFTSnapshot);
+      assert(pcString != NULL);
+      free(pcString);
+      FT_snapshotRelease(oFTSnapshot);
+    }
+  }
+  return NULL;
+}
+
+/* Checks that FT_toStringIn gives oFT's single-threaded string,
+   byte for byte, whatever number of threads it uses, from too few
+   for the tree to split at all to many more than it has segments */
+static void checkToStringThreads(FT_T oFT) {
+  static const size_t aulThreads[] = {0, 2, 3, 4, 5, 7, 8, 9, 16, 64};
+  char *pcSingle, *pcParallel;
+  size_t i;
+
+  assert(FT_setToStringThreadsIn(oFT, 1) == SUCCESS);
+  pcSingle = FT_toStringIn(oFT);
+  assert(pcSingle != NULL);
+  for(i = 0; i < sizeof(aulThreads) / sizeof(aulThreads[0]); i++) {
+    assert(FT_setToStringThreadsIn(oFT, aulThreads[i]) == SUCCESS);
+    pcParallel = FT_toStringIn(oFT);
+    assert(pcParallel != NULL);
+    assert(!strcmp(pcParallel, pcSingle));
+    free(pcParallel);
+  }
+  assert(FT_setToStringThreadsIn(oFT, 1) == SUCCESS);
+  free(pcSingle);
+}
+
+/* Inserts into oFT, below the directory pcPath, a directory tree
+   ulDepth levels deep in which each directory has ulFanout
+   subdirectories and a file or two whose names sort differently by
+   length and by character */
+static void insertBushy(FT_T oFT, const char *pcPath, size_t ulDepth,
+                        size_t ulFanout) {
+  char acPath[128];
+  size_t ul;
+
+  sprintf(acPath, "%s/a.b", pcPath);
+  assert(FT_insertFileIn(oFT, acPath, NULL, 0) == SUCCESS);
+  if(ulDepth % 2 == 0) {
+    sprintf(acPath, "%s/a", pcPath);
+    assert(FT_insertFileIn(oFT, acPath, NULL, 0) == SUCCESS);
+  }
+  if(ulDepth == 0)
+    return;
+  for(ul = 0; ul < ulFanout; ul++) {
+    sprintf(acPath, "%s/%c%lu", pcPath, (ul % 2 == 0) ? 'd' : 'a',
+            (unsigned long) ul);
+    assert(FT_insertDirIn(oFT, acPath) == SUCCESS);
+    insertBushy(oFT, acPath, ulDepth - 1, ulFanout);
+  }
+}
+
+/* Checks the parallel FT_toString on trees of several shapes: empty,
+   a lone root, a root of files alone, one wide level, many bushy
+   levels, and a chain deeper than the tree is ever split, each with
+   far more segments than threads at some thread counts and fewer at
+   others */
+static void checkToStringShapes(void) {
+  char acPath[256];
+  size_t ulLength;
+  FT_T oFT;
+  int i;
+
+  oFT = FT_new();
+  assert(oFT != NULL);
+  checkToStringThreads(oFT);
+  assert(FT_insertDirIn(oFT, "s") == SUCCESS);
+  checkToStringThreads(oFT);
+  for(i = 0; i < 20; i++) {
+    sprintf(acPath, "s/f%d", i);
+    assert(FT_insertFileIn(oFT, acPath, NULL, 0) == SUCCESS);
+  }
+  checkToStringThreads(oFT);
+
+  for(i = 0; i < 300; i++) {
+    sprintf(acPath, "s/wide/w%d/x", (i * 7) % 300);
+    assert(FT_insertFileIn(oFT, acPath, NULL, 0) == SUCCESS);
+  }
+  checkToStringThreads(oFT);
+
+  assert(FT_insertDirIn(oFT, "s/bushy") == SUCCESS);
+  insertBushy(oFT, "s/bushy", 5, 3);
+  checkToStringThreads(oFT);
+
+  strcpy(acPath, "s/chain");
+  ulLength = strlen(acPath);
+  for(i = 0; i < 30; i++) {
+    sprintf(acPath + ulLength, "/c%d", i);
+    ulLength = strlen(acPath);
+    assert(FT_insertDirIn(oFT, acPath) == SUCCESS);
+    strcpy(acPath + ulLength, "/f");
+    assert(FT_insertFileIn(oFT, acPath, NULL, 0) == SUCCESS);
+    acPath[ulLength] = '\0';
+  }
+  checkToStringThreads(oFT);
+  assert(FT_rmDirIn(oFT, "s/wide") == SUCCESS);
+  checkToStringThreads(oFT);
+  FT_free(oFT);
+  FT_waitReclaim();
+}
+
+/* Returns a new FT with the directories that every run starts with */
+static FT_T newTree(void) {
+  FT_T oFT;
+  char acPath[16];
+  int i;
+
+  oFT = FT_new();
+  assert(oFT != NULL);
+  for(i = 0; i < NUM_WRITERS; i++) {
+    sprintf(acPath, "r/t%d", i);
+    assert(FT_insertDirIn(oFT, acPath) == SUCCESS);
+  }
+  return oFT;
+}
+
+/* Runs the writers and readers at once on a tree in mode iRunMode,
+   then makes the same changes one writer after another on a tree
+   of its own, and checks that both trees, and the statuses of all
+   of the changes, come out the same */
+static void runMode(int iRunMode) {
+  pthread_t aThreads[NUM_WRITERS + NUM_READERS];
+  FT_T oFTSerial;
+  char *pcShared, *pcSerial;
+  unsigned uSeed;
+  long l;
+  int i;
+
+  iMode = iRunMode;
+  oFTShared = newTree();
+  assert(FT_setSynchronizedIn(oFTShared, TRUE) == SUCCESS);
+  if(iMode & MODE_LOCK_FREE)
+    assert(FT_setLockFreeReadsIn(oFTShared, TRUE) == SUCCESS);
+  if(iMode & MODE_INDEXED)
+    assert(FT_setIndexedIn(oFTShared, TRUE) == SUCCESS);
+  /* the readers' FT_toString calls use threads of their own */
+  assert(FT_setToStringThreadsIn(oFTShared, (size_t) iMode % 4 + 1) ==
+         SUCCESS);
+
+  for(l = 0; l < NUM_WRITERS; l++)
+    assert(pthread_create(&aThreads[l], NULL, writeShared,
+                          (void *) l) == 0);
+  for(l = 0; l < NUM_READERS; l++)
+    assert(pthread_create(&aThreads[NUM_WRITERS + l], NULL, readShared,
+                          (void *) (l + 1)) == 0);
+  for(l = 0; l < NUM_WRITERS + NUM_READERS; l++)
+    assert(pthread_join(aThreads[l], NULL) == 0);
+
+  oFTSerial = newTree();
+  for(i = 0; i < NUM_WRITERS; i++) {
+    uSeed = (unsigned) i * 7919u + 1u;
+    for(l = 0; l < NUM_CHANGES; l++)
+      assert(makeChange(oFTSerial, i, &uSeed) == aaiStatuses[i][l]);
+  }
+
+  pcShared = FT_toStringIn(oFTShared);
+  pcSerial = FT_toStringIn(oFTSerial);
+  assert(pcShared != NULL && pcSerial != NULL);
+  assert(!strcmp(pcShared, pcSerial));
+  checkToStringThreads(oFTShared);
+  fprintf(stderr, "Mode %d: %lu characters agree\n", iRunMode,
+          (unsigned long) strlen(pcShared));
+  free(pcShared);
+  free(pcSerial);
+
+  FT_free(oFTShared);
+  FT_free(oFTSerial);
+  FT_waitReclaim();
+}
+
+/* Tests the FT in synchronized mode, with and without lock-free
+   reads, the index, snapshots and moves, by changing it from several
+   threads at once while others read it, and checking the result
+   against the same changes made by one thread; and checks that
+   FT_toString with several threads gives exactly what it gives with
+   one, on those trees and on trees of other shapes.
+   Prints the status of each run to stderr.
+   Returns 0. */
+int main(void) {
+  int i;
+
+  for(i = 0; i <= NUM_FILES; i++)
+    sprintf(acContents[i], "%d", i * 1000);
+
+  assert(FT_setToStringThreads(4) == INITIALIZATION_ERROR);
+  checkToStringShapes();
+  fprintf(stderr, "Every parallel FT_toString agrees\n");
+  for(i = 0; i < 16; i++)
+    runMode(i);
+  return 0;
+}
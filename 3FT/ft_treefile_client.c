@@ -0,0 +1,316 @@
+/*--------------------------------------------------------------------*/
+/* ft_treefile_client.c                                               */
+/* Author: Matthew Okechukwu, Pinrui Huang                            */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "ft.h"
+#include "treefile.h"
+
+/* The save files that the tests write and then load */
+static const char *pcSaveFile = "ft_treefile_client.sav";
+static const char *pcCutFile = "ft_treefile_client.cut";
+
+/* One node of a hand-made save file: its kind, 'D' or 'F', its
+   name, and for a directory, its numbers of file and directory
+   children */
+struct Node {
+  char cKind;
+  const char *pcName;
+  size_t ulNumFiles;
+  size_t ulNumDirectories;
+};
+
+/* Returns a copy of pcString in a new block that the FT it is
+   inserted into then holds, as FT_load's contents are held */
+static char *copyString(const char *pcString) {
+  char *pcCopy;
+
+  pcCopy = malloc(strlen(pcString) + 1);
+  assert(pcCopy != NULL);
+  return strcpy(pcCopy, pcString);
+}
+
+/* Frees oFT, which was loaded or else given contents by
+   copyString, along with its files' contents, which the client owns */
+static void freeLoaded(FT_T oFT) {
+  FTIter_T oIter;
+  const char *pcPath;
+  boolean bIsFile;
+  size_t l;
+
+  assert(FT_iterOpenIn(oFT, NULL, &oIter) == SUCCESS);
+  while(FT_iterNext(oIter, &pcPath, &bIsFile, &l) == SUCCESS)
+    if(bIsFile)
+      free(FT_getFileContentsIn(oFT, pcPath));
+  FT_iterClose(oIter);
+  FT_free(oFT);
+}
+
+/* Loads pcFile into a new FT and checks that the load returns
+   iExpected and leaves the FT empty if it fails */
+static void checkLoadFails(const char *pcFile, int iExpected) {
+  FT_T oFT;
+  char *pcLoaded;
+
+  oFT = FT_new();
+  assert(oFT != NULL);
+  assert(FT_loadIn(oFT, pcFile) == iExpected);
+  pcLoaded = FT_toStringIn(oFT);
+  assert(pcLoaded != NULL);
+  assert(!strcmp(pcLoaded, ""));
+  free(pcLoaded);
+  assert(FT_insertDirIn(oFT, "1root") == SUCCESS);
+  FT_free(oFT);
+}
+
+/* Writes the ulNumNodes nodes at asNodes, in order, as the save file
+   pcSaveFile, without contents, and checks that loading it returns
+   iExpected */
+static void checkMadeFile(const struct Node *asNodes, size_t ulNumNodes,
+                          int iExpected) {
+  TreeFile_T oTreeFile;
+  struct TreeFileNode sNode;
+  size_t i;
+
+  assert(TreeFile_create(pcSaveFile, FALSE, 0, &oTreeFile) == SUCCESS);
+  for(i = 0; i < ulNumNodes; i++) {
+    sNode.pcName = asNodes[i].pcName;
+    sNode.ulNameLength = strlen(asNodes[i].pcName);
+    sNode.bIsFile = (boolean) (asNodes[i].cKind == 'F');
+    sNode.ulSize = 0;
+    sNode.pvContents = NULL;
+    sNode.ulNumFiles = asNodes[i].ulNumFiles;
+    sNode.ulNumDirectories = asNodes[i].ulNumDirectories;
+    assert(TreeFile_write(oTreeFile, &sNode) == SUCCESS);
+  }
+  assert(TreeFile_close(oTreeFile) == SUCCESS);
+  if(iExpected == SUCCESS) {
+    FT_T oFT = FT_new();
+    assert(oFT != NULL);
+    assert(FT_loadIn(oFT, pcSaveFile) == SUCCESS);
+    FT_free(oFT);
+  }
+  else
+    checkLoadFails(pcSaveFile, iExpected);
+}
+
+/* Returns the number of bytes in the file pcFile, and if ppcBytes is
+   not NULL, sets *ppcBytes to them, in a new block that the caller
+   owns */
+static size_t readFile(const char *pcFile, char **ppcBytes) {
+  FILE *psFile;
+  long lLength;
+
+  psFile = fopen(pcFile, "rb");
+  assert(psFile != NULL);
+  assert(fseek(psFile, 0L, SEEK_END) == 0);
+  lLength = ftell(psFile);
+  assert(lLength >= 0);
+  if(ppcBytes != NULL) {
+    *ppcBytes = malloc((size_t) lLength + 1);
+    assert(*ppcBytes != NULL);
+    rewind(psFile);
+    assert(fread(*ppcBytes, 1, (size_t) lLength, psFile) ==
+           (size_t) lLength);
+  }
+  fclose(psFile);
+  return (size_t) lLength;
+}
+
+/* Saves oFT to pcSaveFile, with contents if bContents, and checks
+   that every cut of the file short of its end but past its header
+   fails to load with IO_ERROR, leaving the FT empty */
+static void checkCuts(FT_T oFT, boolean bContents) {
+  FT_T oFTEmpty;
+  FILE *psFile;
+  char *pcBytes;
+  size_t ulHeader, ulLength, ulCut;
+
+  oFTEmpty = FT_new();
+  assert(oFTEmpty != NULL);
+  assert(FT_saveIn(oFTEmpty, pcSaveFile, bContents) == SUCCESS);
+  ulHeader = readFile(pcSaveFile, NULL);
+  FT_free(oFTEmpty);
+
+  assert(FT_saveIn(oFT, pcSaveFile, bContents) == SUCCESS);
+  ulLength = readFile(pcSaveFile, &pcBytes);
+  assert(ulLength > ulHeader);
+  for(ulCut = 0; ulCut < ulLength; ulCut++) {
+    psFile = fopen(pcCutFile, "wb");
+    assert(psFile != NULL);
+    assert(fwrite(pcBytes, 1, ulCut, psFile) == ulCut);
+    assert(fclose(psFile) == 0);
+    if(ulCut == ulHeader) {
+      /* the header alone is the save of an empty tree */
+      oFTEmpty = FT_new();
+      assert(oFTEmpty != NULL);
+      assert(FT_loadIn(oFTEmpty, pcCutFile) == SUCCESS);
+      FT_free(oFTEmpty);
+    }
+    else
+      checkLoadFails(pcCutFile, IO_ERROR);
+  }
+  free(pcBytes);
+}
+
+/* Saves oFT with contents if bContents, loads the save into a new FT,
+   and checks that the two agree on every node and, if bContents, on
+   every file's contents */
+static void checkRoundTrip(FT_T oFT, boolean bContents) {
+  FT_T oFTLoaded;
+  FTIter_T oIter;
+  const char *pcPath;
+  char *pcSaved, *pcLoaded;
+  void *pvContents, *pvLoaded;
+  boolean bIsFile, bLoadedIsFile;
+  size_t l, lLoaded;
+
+  assert(FT_saveIn(oFT, pcSaveFile, bContents) == SUCCESS);
+  oFTLoaded = FT_new();
+  assert(oFTLoaded != NULL);
+  assert(FT_loadIn(oFTLoaded, pcSaveFile) == SUCCESS);
+
+  pcSaved = FT_toStringIn(oFT);
+  pcLoaded = FT_toStringIn(oFTLoaded);
+  assert(pcSaved != NULL && pcLoaded != NULL);
+  assert(!strcmp(pcLoaded, pcSaved));
+
+  /* a load is only into an empty FT */
+  if(pcSaved[0] != '\0')
+    assert(FT_loadIn(oFTLoaded, pcSaveFile) == ALREADY_IN_TREE);
+  free(pcSaved);
+  free(pcLoaded);
+
+  assert(FT_iterOpenIn(oFT, NULL, &oIter) == SUCCESS);
+  while(FT_iterNext(oIter, &pcPath, &bIsFile, &l) == SUCCESS) {
+    assert(FT_statIn(oFTLoaded, pcPath, &bLoadedIsFile, &lLoaded) ==
+           SUCCESS);
+    assert(bLoadedIsFile == bIsFile);
+    if(!bIsFile)
+      continue;
+    assert(lLoaded == l);
+    pvContents = FT_getFileContentsIn(oFT, pcPath);
+    pvLoaded = FT_getFileContentsIn(oFTLoaded, pcPath);
+    if(!bContents || pvContents == NULL)
+      assert(pvLoaded == NULL);
+    else
+      assert(pvLoaded != NULL && !memcmp(pvLoaded, pvContents, l));
+  }
+  FT_iterClose(oIter);
+  freeLoaded(oFTLoaded);
+}
+
+/* Tests FT_save and FT_load: a save must load back as the same tree,
+   and a damaged save file must be refused, leaving the FT empty.
+   Prints the status of the data structure along the way to stderr.
+   Returns 0. */
+int main(void) {
+  static const struct Node asFilesOutOfOrder[] = {
+    {'D', "1root", 2, 0}, {'F', "b", 0, 0}, {'F', "a", 0, 0}
+  };
+  static const struct Node asFilesRepeated[] = {
+    {'D', "1root", 2, 0}, {'F', "a", 0, 0}, {'F', "a", 0, 0}
+  };
+  static const struct Node asDirectoriesOutOfOrder[] = {
+    {'D', "1root", 0, 2}, {'D', "b", 0, 0}, {'D', "a", 0, 0}
+  };
+  static const struct Node asDirectoryNamedAsFile[] = {
+    {'D', "1root", 2, 1}, {'F', "a", 0, 0}, {'F', "b", 0, 0},
+    {'D', "b", 0, 0}
+  };
+  static const struct Node asDirectoryBeforeFile[] = {
+    {'D', "1root", 1, 1}, {'D', "a", 0, 0}, {'F', "b", 0, 0}
+  };
+  static const struct Node asNameWithSlash[] = {
+    {'D', "1root", 1, 0}, {'F', "a/b", 0, 0}
+  };
+  static const struct Node asTooFewChildren[] = {
+    {'D', "1root", 1, 1}, {'F', "a", 0, 0}
+  };
+  static const struct Node asNodesPastTree[] = {
+    {'D', "1root", 1, 0}, {'F', "a", 0, 0}, {'F', "b", 0, 0}
+  };
+  static const struct Node asRootFile[] = {
+    {'F', "1root", 0, 0}
+  };
+  static const struct Node asWellMade[] = {
+    {'D', "1root", 2, 2}, {'F', "a", 0, 0}, {'F', "c", 0, 0},
+    {'D', "b", 1, 0}, {'F', "x", 0, 0}, {'D', "d", 0, 0}
+  };
+  FT_T oFT;
+  char acPath[32];
+  char acContents[32];
+  size_t i, j;
+
+  oFT = FT_new();
+  assert(oFT != NULL);
+
+  /* An empty tree saves and loads back empty */
+  checkRoundTrip(oFT, TRUE);
+
+  /* A tree of directories and files, some with contents and some
+     without, loads back the same, with or without contents */
+  assert(FT_insertDirIn(oFT, "1root/2child/3gkid") == SUCCESS);
+  assert(FT_insertFileIn(oFT, "1root/2child/3gkid/4ggk",
+                         copyString("4ggk"), 5) == SUCCESS);
+  assert(FT_insertFileIn(oFT, "1root/2second", NULL, 0) == SUCCESS);
+  assert(FT_insertFileIn(oFT, "1root/2child/3file",
+                         copyString("3file"), 6) == SUCCESS);
+  assert(FT_insertDirIn(oFT, "1root/2empty") == SUCCESS);
+  for(i = 0; i < 10; i++) {
+    for(j = 0; j <= i; j++) {
+      sprintf(acPath, "1root/d%lu/f%lu", (unsigned long) i,
+              (unsigned long) j);
+      sprintf(acContents, "%lu.%lu", (unsigned long) i,
+              (unsigned long) j);
+      assert(FT_insertFileIn(oFT, acPath, copyString(acContents),
+                             strlen(acContents) + 1) == SUCCESS);
+    }
+  }
+  checkRoundTrip(oFT, TRUE);
+  checkRoundTrip(oFT, FALSE);
+  fprintf(stderr, "Saved and loaded the tree back\n");
+
+  /* Every cut of a save fails to load, with or without contents */
+  checkCuts(oFT, TRUE);
+  checkCuts(oFT, FALSE);
+  fprintf(stderr, "Refused every cut of the save\n");
+
+  /* A file that is not a save at all is refused */
+  checkLoadFails("ft_treefile_client.none", IO_ERROR);
+  {
+    FILE *psFile = fopen(pcSaveFile, "w");
+    assert(psFile != NULL);
+    fputs("1root\n1root/2child\n", psFile);
+    fclose(psFile);
+  }
+  checkLoadFails(pcSaveFile, IO_ERROR);
+
+  /* Hand-made saves: siblings must be in order and distinct, files
+     must precede directories, no directory may share a file's name,
+     every name must be one component, and the tree must be the whole
+     file, with a directory as its root */
+  checkMadeFile(asWellMade, sizeof(asWellMade) / sizeof(asWellMade[0]),
+                SUCCESS);
+  checkMadeFile(asFilesOutOfOrder, 3, IO_ERROR);
+  checkMadeFile(asFilesRepeated, 3, IO_ERROR);
+  checkMadeFile(asDirectoriesOutOfOrder, 3, IO_ERROR);
+  checkMadeFile(asDirectoryNamedAsFile, 4, IO_ERROR);
+  checkMadeFile(asDirectoryBeforeFile, 3, IO_ERROR);
+  checkMadeFile(asNameWithSlash, 2, IO_ERROR);
+  checkMadeFile(asTooFewChildren, 2, IO_ERROR);
+  checkMadeFile(asNodesPastTree, 3, IO_ERROR);
+  checkMadeFile(asRootFile, 1, CONFLICTING_PATH);
+  fprintf(stderr, "Refused every malformed save\n");
+
+  freeLoaded(oFT);
+  remove(pcSaveFile);
+  remove(pcCutFile);
+  FT_waitReclaim();
+  return 0;
+}
@@ -0,0 +1,382 @@
+/*--------------------------------------------------------------------*/
+/* hashtable.c                                                        */
+/* Author: Matthew Okechukwu, Pinrui Huang                            */
+/*--------------------------------------------------------------------*/
+
+#include "hashtable.h"
+#include "arena.h"
+#include "epoch.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*--------------------------------------------------------------------*/
+
+/* The initial number of slots in a HashTable object.  Must be a power
+   of two. */
+
+static const size_t INITIAL_PHYS_LENGTH = 16;
+
+/*--------------------------------------------------------------------*/
+
+/* One slot of a HashTable.  The slot is empty iff pvElement is NULL. */
+
+struct HashTableSlot
+{
+   /* The hash value under which pvElement was added. */
+   size_t uHash;
+
+   /* The element, or NULL. */
+   const void *pvElement;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* A HashTable consists of an array of slots, along with the number of
+   slots and the number of occupied slots.  Collisions are resolved by
+   linear probing; removal shifts later entries back rather than
+   leaving tombstones, so a probe always stops at the first empty
+   slot.
+
+   HashTable_find may run while the HashTable changes, so each slot's
+   element is stored in one piece after its hash, a grown array is
+   filled in before it is published, and discarded arrays go to
+   Epoch_release rather than free, or, in a HashTable allocated from
+   an arena, are simply left for the arena to release. */
+
+struct HashTable
+{
+   /* The number of elements in the HashTable. */
+   size_t uLength;
+
+   /* The number of slots, a power of two. */
+   size_t uPhysLength;
+
+   /* The array of slots. */
+   struct HashTableSlot *psSlots;
+
+   /* The arena that the HashTable and its slots come from, or NULL if
+      they come from malloc. */
+   Arena_T oArena;
+};
+
+/*--------------------------------------------------------------------*/
+
+#ifndef NDEBUG
+
+/* Check the invariants of oHashTable.  Return 1 (TRUE) iff oHashTable
+   is in a valid state. */
+
+static int HashTable_isValid(HashTable_T oHashTable)
+{
+   if (oHashTable->psSlots == NULL) return 0;
+   if (oHashTable->uPhysLength < INITIAL_PHYS_LENGTH) return 0;
+   if ((oHashTable->uPhysLength & (oHashTable->uPhysLength - 1)) != 0)
+      return 0;
+   if (oHashTable->uLength >= oHashTable->uPhysLength) return 0;
+   return 1;
+}
+
+#endif
+
+/*--------------------------------------------------------------------*/
+
+size_t HashTable_hash(size_t uHash, const char *pc, size_t uLength)
+{
+   size_t u;
+
+   assert(pc != NULL || uLength == 0);
+
+   for (u = 0; u < uLength; u++)
+      uHash = (uHash * 33) ^ (size_t)(unsigned char)pc[u];
+   return uHash;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the slot index at which a probe for uHash begins in a table
+   with uPhysLength slots.  The hash is mixed first so that nearby
+   hash values do not cluster. */
+
+static size_t HashTable_home(size_t uHash, size_t uPhysLength)
+{
+   uHash ^= uHash >> 16;
+   uHash *= 0x45d9f3bU;
+   uHash ^= uHash >> 16;
+   return uHash & (uPhysLength - 1);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Place pvElement under uHash into the first empty slot of its probe
+   sequence in psSlots, an array of uPhysLength slots. */
+
+static void HashTable_place(struct HashTableSlot *psSlots,
+                            size_t uPhysLength, size_t uHash,
+                            const void *pvElement)
+{
+   size_t u;
+
+   assert(psSlots != NULL);
+   assert(pvElement != NULL);
+
+   u = HashTable_home(uHash, uPhysLength);
+   while (psSlots[u].pvElement != NULL)
+      u = (u + 1) & (uPhysLength - 1);
+   __atomic_store_n(&psSlots[u].uHash, uHash, __ATOMIC_RELAXED);
+   __atomic_store_n(&psSlots[u].pvElement, pvElement, __ATOMIC_RELEASE);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new array of uPhysLength empty slots for oHashTable, from
+   its arena if it has one, or NULL if insufficient memory is
+   available. */
+
+static struct HashTableSlot *HashTable_newSlots(HashTable_T oHashTable,
+                                                size_t uPhysLength)
+{
+   struct HashTableSlot *psSlots;
+
+   assert(oHashTable != NULL);
+
+   if (oHashTable->oArena == NULL)
+      return (struct HashTableSlot*)
+         calloc(uPhysLength, sizeof(struct HashTableSlot));
+
+   psSlots = (struct HashTableSlot*)
+      Arena_alloc(oHashTable->oArena,
+                  uPhysLength * sizeof(struct HashTableSlot));
+   if (psSlots != NULL)
+      memset(psSlots, 0, uPhysLength * sizeof(struct HashTableSlot));
+   return psSlots;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Release pv, a block of oHashTable that may still be read, through
+   Epoch_release.  A block from an arena stays until the arena is
+   released. */
+
+static void HashTable_release(HashTable_T oHashTable, void *pv)
+{
+   assert(oHashTable != NULL);
+
+   if (oHashTable->oArena == NULL)
+      Epoch_release(pv);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Double the number of slots of oHashTable, rehashing every element.
+   Return 1 (TRUE) if successful and 0 (FALSE) if insufficient memory
+   is available. */
+
+static int HashTable_grow(HashTable_T oHashTable)
+{
+   const size_t GROWTH_FACTOR = 2;
+
+   size_t uNewLength;
+   struct HashTableSlot *psNewSlots;
+   struct HashTableSlot *psOldSlots;
+   size_t u;
+
+   assert(oHashTable != NULL);
+
+   uNewLength = GROWTH_FACTOR * oHashTable->uPhysLength;
+   psNewSlots = HashTable_newSlots(oHashTable, uNewLength);
+   if (psNewSlots == NULL)
+      return 0;
+
+   for (u = 0; u < oHashTable->uPhysLength; u++)
+      if (oHashTable->psSlots[u].pvElement != NULL)
+         HashTable_place(psNewSlots, uNewLength,
+                         oHashTable->psSlots[u].uHash,
+                         oHashTable->psSlots[u].pvElement);
+
+   /* HashTable_find reads the length first, so publish the larger
+      array before the larger length. */
+   psOldSlots = oHashTable->psSlots;
+   __atomic_store_n(&oHashTable->psSlots, psNewSlots, __ATOMIC_RELEASE);
+   __atomic_store_n(&oHashTable->uPhysLength, uNewLength,
+                    __ATOMIC_RELEASE);
+   HashTable_release(oHashTable, psOldSlots);
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+HashTable_T HashTable_new(void)
+{
+   return HashTable_newIn(NULL);
+}
+
+/*--------------------------------------------------------------------*/
+
+HashTable_T HashTable_newIn(Arena_T oArena)
+{
+   HashTable_T oHashTable;
+
+   if (oArena != NULL)
+      oHashTable = (struct HashTable*)
+         Arena_alloc(oArena, sizeof(struct HashTable));
+   else
+      oHashTable = (struct HashTable*)malloc(sizeof(struct HashTable));
+   if (oHashTable == NULL)
+      return NULL;
+
+   oHashTable->uLength = 0;
+   oHashTable->uPhysLength = INITIAL_PHYS_LENGTH;
+   oHashTable->oArena = oArena;
+   oHashTable->psSlots =
+      HashTable_newSlots(oHashTable, oHashTable->uPhysLength);
+   if (oHashTable->psSlots == NULL)
+   {
+      HashTable_release(oHashTable, oHashTable);
+      return NULL;
+   }
+
+   return oHashTable;
+}
+
+/*--------------------------------------------------------------------*/
+
+void HashTable_free(HashTable_T oHashTable)
+{
+   assert(oHashTable != NULL);
+   assert(HashTable_isValid(oHashTable));
+
+   HashTable_release(oHashTable, oHashTable->psSlots);
+   HashTable_release(oHashTable, oHashTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t HashTable_getLength(HashTable_T oHashTable)
+{
+   assert(oHashTable != NULL);
+   assert(HashTable_isValid(oHashTable));
+
+   return oHashTable->uLength;
+}
+
+/*--------------------------------------------------------------------*/
+
+int HashTable_add(HashTable_T oHashTable, size_t uHash,
+                  const void *pvElement)
+{
+   assert(oHashTable != NULL);
+   assert(pvElement != NULL);
+   assert(HashTable_isValid(oHashTable));
+
+   /* Keep the load factor at or below one half. */
+   if (2 * (oHashTable->uLength + 1) > oHashTable->uPhysLength)
+      if (! HashTable_grow(oHashTable))
+         return 0;
+
+   HashTable_place(oHashTable->psSlots, oHashTable->uPhysLength,
+                   uHash, pvElement);
+   oHashTable->uLength++;
+
+   assert(HashTable_isValid(oHashTable));
+
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+int HashTable_remove(HashTable_T oHashTable, size_t uHash,
+                     const void *pvElement)
+{
+   size_t uMask;
+   size_t uHole;
+   size_t u;
+   size_t uHome;
+
+   assert(oHashTable != NULL);
+   assert(pvElement != NULL);
+   assert(HashTable_isValid(oHashTable));
+
+   uMask = oHashTable->uPhysLength - 1;
+
+   /* Find the slot holding pvElement under uHash, since an element
+      may briefly be filed under two hash values at once. */
+   uHole = HashTable_home(uHash, oHashTable->uPhysLength);
+   for (;;)
+   {
+      if (oHashTable->psSlots[uHole].pvElement == NULL)
+         return 0;
+      if (oHashTable->psSlots[uHole].pvElement == pvElement &&
+          oHashTable->psSlots[uHole].uHash == uHash)
+         break;
+      uHole = (uHole + 1) & uMask;
+   }
+
+   /* Shift back each later entry of the cluster whose home slot does
+      not lie cyclically within (uHole, u]. */
+   u = uHole;
+   for (;;)
+   {
+      u = (u + 1) & uMask;
+      if (oHashTable->psSlots[u].pvElement == NULL)
+         break;
+      uHome = HashTable_home(oHashTable->psSlots[u].uHash,
+                             oHashTable->uPhysLength);
+      if (((u - uHome) & uMask) >= ((u - uHole) & uMask))
+      {
+         __atomic_store_n(&oHashTable->psSlots[uHole].uHash,
+                          oHashTable->psSlots[u].uHash,
+                          __ATOMIC_RELAXED);
+         __atomic_store_n(&oHashTable->psSlots[uHole].pvElement,
+                          oHashTable->psSlots[u].pvElement,
+                          __ATOMIC_RELEASE);
+         uHole = u;
+      }
+   }
+   __atomic_store_n(&oHashTable->psSlots[uHole].pvElement, NULL,
+                    __ATOMIC_RELEASE);
+   oHashTable->uLength--;
+
+   assert(HashTable_isValid(oHashTable));
+
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *HashTable_find(HashTable_T oHashTable, size_t uHash,
+                     const void *pvKey,
+                     int (*pfMatch)(const void *pvElement,
+                                    const void *pvKey))
+{
+   size_t uPhysLength;
+   struct HashTableSlot *psSlots;
+   const void *pvElement;
+   size_t uMask;
+   size_t u;
+   size_t uProbes;
+
+   assert(oHashTable != NULL);
+   assert(pfMatch != NULL);
+
+   /* The length is read before the array, and the probe never visits
+      more slots than that length, so a concurrent change can make
+      the answer wrong but never sends the probe out of bounds. */
+   uPhysLength = __atomic_load_n(&oHashTable->uPhysLength,
+                                 __ATOMIC_ACQUIRE);
+   psSlots = __atomic_load_n(&oHashTable->psSlots, __ATOMIC_ACQUIRE);
+   uMask = uPhysLength - 1;
+   u = HashTable_home(uHash, uPhysLength);
+   for (uProbes = 0; uProbes < uPhysLength; uProbes++)
+   {
+      pvElement = __atomic_load_n(&psSlots[u].pvElement,
+                                  __ATOMIC_ACQUIRE);
+      if (pvElement == NULL)
+         break;
+      if (__atomic_load_n(&psSlots[u].uHash, __ATOMIC_RELAXED) == uHash
+          && (*pfMatch)(pvElement, pvKey))
+         return (void*)pvElement;
+      u = (u + 1) & uMask;
+   }
+   return NULL;
+}
@@ -0,0 +1,98 @@
+/*--------------------------------------------------------------------*/
+/* hashtable.h                                                        */
+/* Author: Matthew Okechukwu, Pinrui Huang                            */
+/*--------------------------------------------------------------------*/
+
+#ifndef HASHTABLE_INCLUDED
+#define HASHTABLE_INCLUDED
+
+#include <stddef.h>
+#include "arena.h"
+
+/* A HashTable_T object is an open-addressing table of elements, each
+   filed under a hash value that the client computes.  The table does
+   not own its elements and never compares them itself: the client
+   supplies a match function at lookup time. */
+
+typedef struct HashTable *HashTable_T;
+
+/*--------------------------------------------------------------------*/
+
+/* The seed with which to begin hashing a new string. */
+
+enum { HASHTABLE_SEED = 5381 };
+
+/*--------------------------------------------------------------------*/
+
+/* Return the hash of the uLength characters at pc, continuing from
+   uHash, which is either HASHTABLE_SEED or the result of an earlier
+   call.  Hashing "ab" and then "cd" gives the same result as hashing
+   "abcd". */
+
+size_t HashTable_hash(size_t uHash, const char *pc, size_t uLength);
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new, empty HashTable_T object, or NULL if insufficient
+   memory is available. */
+
+HashTable_T HashTable_new(void);
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new, empty HashTable_T object whose memory, as it grows,
+   comes from oArena, or from malloc if oArena is NULL.  Return NULL
+   if insufficient memory is available.  Nothing that such an object
+   discards is released before oArena is. */
+
+HashTable_T HashTable_newIn(Arena_T oArena);
+
+/*--------------------------------------------------------------------*/
+
+/* Free oHashTable.  The elements themselves are not freed. */
+
+void HashTable_free(HashTable_T oHashTable);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of elements in oHashTable. */
+
+size_t HashTable_getLength(HashTable_T oHashTable);
+
+/*--------------------------------------------------------------------*/
+
+/* Add non-NULL pvElement to oHashTable under hash value uHash.
+   Return 1 (TRUE) if successful, or 0 (FALSE) if insufficient memory
+   is available. */
+
+int HashTable_add(HashTable_T oHashTable, size_t uHash,
+                  const void *pvElement);
+
+/*--------------------------------------------------------------------*/
+
+/* Remove pvElement, which was added under hash value uHash, from
+   oHashTable.  If pvElement was also added under another hash value,
+   that entry remains.  Return 1 (TRUE) if it was found, or 0 (FALSE)
+   if not. */
+
+int HashTable_remove(HashTable_T oHashTable, size_t uHash,
+                     const void *pvElement);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the first element filed under hash value uHash for which
+   (*pfMatch)(pvElement, pvKey) returns nonzero, or NULL if there is
+   no such element.
+
+   Unlike every other function here, HashTable_find may run while
+   another thread changes oHashTable, provided that the reading
+   thread is inside Epoch_enter and the changing thread is inside
+   Epoch_beginRetire.  It is then safe, but its answer is only
+   reliable if the caller can tell that no change overlapped it. */
+
+void *HashTable_find(HashTable_T oHashTable, size_t uHash,
+                     const void *pvKey,
+                     int (*pfMatch)(const void *pvElement,
+                                    const void *pvKey));
+
+#endif
@@ -0,0 +1,683 @@
+/*--------------------------------------------------------------------*/
+/* journal.c                                                          */
+/* Author: Matthew Okechukwu, Pinrui Huang                            */
+/*--------------------------------------------------------------------*/
+
+/* pthreads, open, fsync and ftruncate are POSIX extensions beyond
+   ISO C */
+#define _XOPEN_SOURCE 600
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "journal.h"
+
+/* The string that begins every journal */
+static const char acMagic[8] =
+   { '3', 'F', 'T', 'J', 'R', 'N', 'L', '\n' };
+
+/* The version of the format that this module writes and reads */
+enum { VERSION = 1 };
+
+/* The most bytes that a stored size_t can take */
+enum { MAX_NUMBER_LENGTH = (sizeof(size_t) * 8 + 6) / 7 };
+
+/* The number of bytes in each record's checksum */
+enum { CHECKSUM_LENGTH = 4 };
+
+/* The number of bytes by which the buffer of logged records first
+   grows */
+enum { MIN_BUFFER_LENGTH = 4096 };
+
+/* A journal open for logging */
+struct Journal {
+   /* the file, open for appending */
+   int iFd;
+   /* the generation of the checkpoint that the journal follows */
+   size_t ulGeneration;
+   /* guards every field below */
+   pthread_mutex_t sMutex;
+   /* signalled each time a write of logged records ends */
+   pthread_cond_t sWritten;
+   /* the records logged but not yet being written, and the room
+      there is for them */
+   unsigned char *pucPending;
+   size_t ulPendingLength;
+   size_t ulPendingRoom;
+   /* a second buffer, which the records being written occupy while
+      new ones go to pucPending, and its room */
+   unsigned char *pucSpare;
+   size_t ulSpareRoom;
+   /* the sequence number of the last record logged, and of the last
+      one durable */
+   size_t ulLogged;
+   size_t ulDurable;
+   /* TRUE while some caller is writing records out */
+   boolean bWriting;
+   /* SUCCESS, or the status with which the journal has failed */
+   int iStatus;
+};
+
+/*
+  Returns the checksum of the ulLength bytes at pucBytes: their 32-bit
+  FNV-1a hash.
+*/
+static unsigned long Journal_checksum(const unsigned char *pucBytes,
+                                      size_t ulLength) {
+   unsigned long ulHash = 2166136261UL;
+   size_t ul;
+
+   assert(pucBytes != NULL || ulLength == 0);
+
+   for(ul = 0; ul < ulLength; ul++) {
+      ulHash ^= pucBytes[ul];
+      ulHash = (ulHash * 16777619UL) & 0xffffffffUL;
+   }
+   return ulHash;
+}
+
+/*
+  Stores ulNumber at pucOut in 7-bit groups, least significant first.
+  Returns the number of bytes stored.
+*/
+static size_t Journal_putNumber(unsigned char *pucOut,
+                                size_t ulNumber) {
+   size_t ulLength = 0;
+
+   assert(pucOut != NULL);
+
+   while(ulNumber >= 0x80) {
+      pucOut[ulLength++] = (unsigned char) ((ulNumber & 0x7f) | 0x80);
+      ulNumber >>= 7;
+   }
+   pucOut[ulLength++] = (unsigned char) ulNumber;
+   return ulLength;
+}
+
+/*
+  Reads a number stored in 7-bit groups from the ulLength bytes at
+  pucIn into *pulNumber. Returns the number of bytes it took, or 0 if
+  it runs past ulLength or does not fit in a size_t.
+*/
+static size_t Journal_getNumber(const unsigned char *pucIn,
+                                size_t ulLength, size_t *pulNumber) {
+   size_t ulNumber = 0;
+   size_t ulShift = 0;
+   size_t ul;
+
+   assert(pucIn != NULL || ulLength == 0);
+   assert(pulNumber != NULL);
+
+   for(ul = 0; ul < ulLength && ulShift < sizeof(size_t) * 8; ul++) {
+      if(ulShift > 0 &&
+         ((size_t) (pucIn[ul] & 0x7f) << ulShift) >> ulShift !=
+         (size_t) (pucIn[ul] & 0x7f))
+         return 0;
+      ulNumber |= (size_t) (pucIn[ul] & 0x7f) << ulShift;
+      if((pucIn[ul] & 0x80) == 0) {
+         *pulNumber = ulNumber;
+         return ul + 1;
+      }
+      ulShift += 7;
+   }
+   return 0;
+}
+
+/*
+  Reads a number stored in 7-bit groups from psFile into *pulNumber.
+  Returns SUCCESS, or NO_SUCH_PATH if psFile ends before its first
+  byte, or IO_ERROR if psFile ends or fails within it or it does not
+  fit in a size_t.
+*/
+static int Journal_readNumber(FILE *psFile, size_t *pulNumber) {
+   unsigned char aucBytes[MAX_NUMBER_LENGTH];
+   size_t ulLength = 0;
+   int iChar;
+
+   assert(psFile != NULL);
+   assert(pulNumber != NULL);
+
+   do {
+      iChar = getc(psFile);
+      if(iChar == EOF)
+         return (ulLength == 0 && !ferror(psFile)) ? NO_SUCH_PATH
+                                                    : IO_ERROR;
+      aucBytes[ulLength++] = (unsigned char) iChar;
+   } while((iChar & 0x80) != 0 && ulLength < MAX_NUMBER_LENGTH);
+   if(Journal_getNumber(aucBytes, ulLength, pulNumber) != ulLength)
+      return IO_ERROR;
+   return SUCCESS;
+}
+
+/*
+  Writes the ulLength bytes at pvBytes to iFd, however many write
+  calls it takes. Returns SUCCESS, or IO_ERROR if a write failed.
+*/
+static int Journal_writeAll(int iFd, const void *pvBytes,
+                            size_t ulLength) {
+   const char *pcBytes = pvBytes;
+   ssize_t lWritten;
+
+   assert(pvBytes != NULL || ulLength == 0);
+
+   while(ulLength > 0) {
+      lWritten = write(iFd, pcBytes, ulLength);
+      if(lWritten < 0 && errno == EINTR)
+         continue;
+      if(lWritten <= 0)
+         return IO_ERROR;
+      pcBytes += lWritten;
+      ulLength -= (size_t) lWritten;
+   }
+   return SUCCESS;
+}
+
+/*
+  Writes a journal header for generation ulGeneration to iFd, which
+  must be empty, and makes it durable. Returns SUCCESS, or IO_ERROR
+  if a write or the fsync failed.
+*/
+static int Journal_writeHeader(int iFd, size_t ulGeneration) {
+   unsigned char aucHeader[sizeof(acMagic) + 2 * MAX_NUMBER_LENGTH];
+   size_t ulLength = sizeof(acMagic);
+
+   memcpy(aucHeader, acMagic, sizeof(acMagic));
+   ulLength += Journal_putNumber(aucHeader + ulLength, VERSION);
+   ulLength += Journal_putNumber(aucHeader + ulLength, ulGeneration);
+   if(Journal_writeAll(iFd, aucHeader, ulLength) != SUCCESS ||
+      fsync(iFd) != 0)
+      return IO_ERROR;
+   return SUCCESS;
+}
+
+/*
+  Parses the record body of ulLength bytes at pucBody into *psRecord,
+  copying its contents, if any, into a new block from malloc. The
+  body's paths are stored with their '\0's, and *psRecord's point
+  into it. Returns SUCCESS, or IO_ERROR if the body is malformed, or
+  MEMORY_ERROR if memory could not be allocated.
+*/
+static int Journal_parse(const unsigned char *pucBody, size_t ulLength,
+                         struct JournalRecord *psRecord) {
+   const unsigned char *pucEnd = pucBody + ulLength;
+   const char **ppcPath;
+   size_t ulPathLength;
+   size_t ulTaken;
+   int iPaths;
+   int iPath;
+
+   assert(pucBody != NULL);
+   assert(psRecord != NULL);
+
+   if(ulLength == 0 || *pucBody > JOURNAL_MOVE)
+      return IO_ERROR;
+   psRecord->iKind = *pucBody++;
+   psRecord->pcPath = NULL;
+   psRecord->pcOther = NULL;
+   psRecord->pvContents = NULL;
+   psRecord->ulLength = 0;
+
+   /* each path is its length, counting its '\0', then its bytes */
+   iPaths = (psRecord->iKind == JOURNAL_MOVE) ? 2 : 1;
+   for(iPath = 0; iPath < iPaths; iPath++) {
+      ppcPath = iPath == 0 ? &psRecord->pcPath : &psRecord->pcOther;
+      ulTaken = Journal_getNumber(pucBody, (size_t) (pucEnd - pucBody),
+                                  &ulPathLength);
+      if(ulTaken == 0)
+         return IO_ERROR;
+      pucBody += ulTaken;
+      if(ulPathLength == 0 ||
+         ulPathLength > (size_t) (pucEnd - pucBody) ||
+         pucBody[ulPathLength - 1] != '\0' ||
+         strlen((const char *) pucBody) != ulPathLength - 1)
+         return IO_ERROR;
+      *ppcPath = (const char *) pucBody;
+      pucBody += ulPathLength;
+   }
+
+   if(psRecord->iKind == JOURNAL_INSERT_FILE ||
+      psRecord->iKind == JOURNAL_REPLACE_CONTENTS) {
+      /* a flag for whether contents follow, then the length */
+      if(pucBody == pucEnd || *pucBody > 1)
+         return IO_ERROR;
+      ulTaken = Journal_getNumber(pucBody + 1,
+                                  (size_t) (pucEnd - pucBody - 1),
+                                  &psRecord->ulLength);
+      if(ulTaken == 0)
+         return IO_ERROR;
+      if(*pucBody == 1) {
+         pucBody += 1 + ulTaken;
+         if(psRecord->ulLength != (size_t) (pucEnd - pucBody))
+            return IO_ERROR;
+         /* an empty file still gets a block, to tell it from none */
+         psRecord->pvContents = malloc(psRecord->ulLength > 0
+                                       ? psRecord->ulLength : 1);
+         if(psRecord->pvContents == NULL)
+            return MEMORY_ERROR;
+         memcpy(psRecord->pvContents, pucBody, psRecord->ulLength);
+         return SUCCESS;
+      }
+      pucBody += 1 + ulTaken;
+   }
+   return pucBody == pucEnd ? SUCCESS : IO_ERROR;
+}
+
+int Journal_replay(const char *pcFile, size_t ulGeneration,
+                   void (*pfApply)(struct JournalRecord *psRecord,
+                                   void *pvExtra),
+                   void *pvExtra, size_t *pulLength) {
+   FILE *psFile;
+   char acRead[sizeof(acMagic)];
+   unsigned char aucChecksum[CHECKSUM_LENGTH];
+   unsigned char *pucBody = NULL;
+   unsigned char *pucGrown;
+   size_t ulBodyRoom = 0;
+   size_t ulVersion;
+   size_t ulFound;
+   size_t ulBodyLength;
+   size_t ulLength;
+   long lFileLength;
+   unsigned long ulChecksum;
+   struct JournalRecord sRecord;
+   int iStatus = SUCCESS;
+   int i;
+
+   assert(pcFile != NULL);
+   assert(pfApply != NULL);
+   assert(pulLength != NULL);
+
+   psFile = fopen(pcFile, "rb");
+   if(psFile == NULL)
+      return (errno == ENOENT) ? NO_SUCH_PATH : IO_ERROR;
+   if(fseek(psFile, 0L, SEEK_END) != 0 ||
+      (lFileLength = ftell(psFile)) < 0 ||
+      fseek(psFile, 0L, SEEK_SET) != 0) {
+      fclose(psFile);
+      return IO_ERROR;
+   }
+
+   /* a journal of another checkpoint holds nothing of this one's */
+   if(fread(acRead, 1, sizeof(acRead), psFile) != sizeof(acRead) ||
+      memcmp(acRead, acMagic, sizeof(acMagic)) != 0 ||
+      Journal_readNumber(psFile, &ulVersion) != SUCCESS ||
+      ulVersion != VERSION ||
+      Journal_readNumber(psFile, &ulFound) != SUCCESS ||
+      ulFound != ulGeneration) {
+      iStatus = ferror(psFile) ? IO_ERROR : NO_SUCH_PATH;
+      fclose(psFile);
+      return iStatus;
+   }
+   ulLength = (size_t) ftell(psFile);
+
+   /* stop quietly at the first record cut short or damaged */
+   for(;;) {
+      if(Journal_readNumber(psFile, &ulBodyLength) != SUCCESS ||
+         ulBodyLength > (size_t) lFileLength)
+         break;
+      if(ulBodyLength > ulBodyRoom) {
+         pucGrown = realloc(pucBody, ulBodyLength);
+         if(pucGrown == NULL) {
+            iStatus = MEMORY_ERROR;
+            break;
+         }
+         pucBody = pucGrown;
+         ulBodyRoom = ulBodyLength;
+      }
+      if(fread(pucBody, 1, ulBodyLength, psFile) != ulBodyLength ||
+         fread(aucChecksum, 1, CHECKSUM_LENGTH, psFile)
+         != CHECKSUM_LENGTH)
+         break;
+      ulChecksum = 0;
+      for(i = CHECKSUM_LENGTH - 1; i >= 0; i--)
+         ulChecksum = (ulChecksum << 8) | aucChecksum[i];
+      if(ulChecksum != Journal_checksum(pucBody, ulBodyLength))
+         break;
+      iStatus = Journal_parse(pucBody, ulBodyLength, &sRecord);
+      if(iStatus == IO_ERROR) {
+         iStatus = SUCCESS;
+         break;
+      }
+      if(iStatus != SUCCESS)
+         break;
+      (*pfApply)(&sRecord, pvExtra);
+      ulLength = (size_t) ftell(psFile);
+   }
+   if(iStatus == SUCCESS && ferror(psFile))
+      iStatus = IO_ERROR;
+
+   free(pucBody);
+   fclose(psFile);
+   *pulLength = ulLength;
+   return iStatus;
+}
+
+int Journal_open(const char *pcFile, size_t ulGeneration,
+                 size_t ulLength, Journal_T *poJournal) {
+   Journal_T oJournal;
+
+   assert(pcFile != NULL);
+   assert(poJournal != NULL);
+
+   *poJournal = NULL;
+   oJournal = malloc(sizeof(struct Journal));
+   if(oJournal == NULL)
+      return MEMORY_ERROR;
+   if(pthread_mutex_init(&oJournal->sMutex, NULL) != 0) {
+      free(oJournal);
+      return MEMORY_ERROR;
+   }
+   if(pthread_cond_init(&oJournal->sWritten, NULL) != 0) {
+      (void) pthread_mutex_destroy(&oJournal->sMutex);
+      free(oJournal);
+      return MEMORY_ERROR;
+   }
+
+   if(ulLength == 0) {
+      oJournal->iFd = open(pcFile, O_WRONLY | O_CREAT | O_TRUNC |
+                           O_APPEND, 0666);
+      if(oJournal->iFd >= 0 &&
+         Journal_writeHeader(oJournal->iFd, ulGeneration) != SUCCESS) {
+         (void) close(oJournal->iFd);
+         oJournal->iFd = -1;
+      }
+   }
+   else {
+      /* drop whatever Journal_replay did not apply */
+      oJournal->iFd = open(pcFile, O_WRONLY | O_APPEND);
+      if(oJournal->iFd >= 0 &&
+         (ftruncate(oJournal->iFd, (off_t) ulLength) != 0 ||
+          fsync(oJournal->iFd) != 0)) {
+         (void) close(oJournal->iFd);
+         oJournal->iFd = -1;
+      }
+   }
+   if(oJournal->iFd < 0) {
+      (void) pthread_cond_destroy(&oJournal->sWritten);
+      (void) pthread_mutex_destroy(&oJournal->sMutex);
+      free(oJournal);
+      return IO_ERROR;
+   }
+
+   oJournal->ulGeneration = ulGeneration;
+   oJournal->pucPending = NULL;
+   oJournal->ulPendingLength = 0;
+   oJournal->ulPendingRoom = 0;
+   oJournal->pucSpare = NULL;
+   oJournal->ulSpareRoom = 0;
+   oJournal->ulLogged = 0;
+   oJournal->ulDurable = 0;
+   oJournal->bWriting = FALSE;
+   oJournal->iStatus = SUCCESS;
+   *poJournal = oJournal;
+   return SUCCESS;
+}
+
+size_t Journal_getGeneration(Journal_T oJournal) {
+   assert(oJournal != NULL);
+
+   return oJournal->ulGeneration;
+}
+
+/*
+  Makes room in oJournal's pending buffer, whose mutex the caller
+  holds, for ulLength more bytes. Returns SUCCESS, or MEMORY_ERROR if
+  the buffer could not grow.
+*/
+static int Journal_reserve(Journal_T oJournal, size_t ulLength) {
+   unsigned char *pucGrown;
+   size_t ulRoom;
+
+   assert(oJournal != NULL);
+
+   if(oJournal->ulPendingLength + ulLength <= oJournal->ulPendingRoom)
+      return SUCCESS;
+   ulRoom = oJournal->ulPendingRoom * 2;
+   if(ulRoom < MIN_BUFFER_LENGTH)
+      ulRoom = MIN_BUFFER_LENGTH;
+   if(ulRoom < oJournal->ulPendingLength + ulLength)
+      ulRoom = oJournal->ulPendingLength + ulLength;
+   pucGrown = realloc(oJournal->pucPending, ulRoom);
+   if(pucGrown == NULL)
+      return MEMORY_ERROR;
+   oJournal->pucPending = pucGrown;
+   oJournal->ulPendingRoom = ulRoom;
+   return SUCCESS;
+}
+
+int Journal_log(Journal_T oJournal,
+                const struct JournalRecord *psRecord,
+                size_t *pulSequence) {
+   unsigned char *pucRecord;
+   unsigned char *pucBody;
+   size_t ulPathLength;
+   size_t ulOtherLength = 0;
+   size_t ulContentsLength = 0;
+   size_t ulBodyLength;
+   size_t ulLength;
+   unsigned long ulChecksum;
+   int iStatus;
+   int i;
+
+   assert(oJournal != NULL);
+   assert(psRecord != NULL);
+   assert(psRecord->pcPath != NULL);
+   assert(pulSequence != NULL);
+
+   ulPathLength = strlen(psRecord->pcPath) + 1;
+   if(psRecord->pcOther != NULL)
+      ulOtherLength = strlen(psRecord->pcOther) + 1;
+   if(psRecord->pvContents != NULL)
+      ulContentsLength = psRecord->ulLength;
+   ulBodyLength = 1 + MAX_NUMBER_LENGTH + ulPathLength +
+                  MAX_NUMBER_LENGTH + ulOtherLength + 1 +
+                  MAX_NUMBER_LENGTH + ulContentsLength;
+
+   (void) pthread_mutex_lock(&oJournal->sMutex);
+   *pulSequence = ++oJournal->ulLogged;
+   if(oJournal->iStatus == SUCCESS &&
+      Journal_reserve(oJournal, MAX_NUMBER_LENGTH + ulBodyLength +
+                                CHECKSUM_LENGTH) != SUCCESS)
+      oJournal->iStatus = MEMORY_ERROR;
+   iStatus = oJournal->iStatus;
+   if(iStatus != SUCCESS) {
+      (void) pthread_mutex_unlock(&oJournal->sMutex);
+      return iStatus;
+   }
+
+   /* build the body where it will go, then slide it after its
+      length once that is known */
+   pucRecord = oJournal->pucPending + oJournal->ulPendingLength;
+   pucBody = pucRecord + MAX_NUMBER_LENGTH;
+   ulLength = 0;
+   pucBody[ulLength++] = (unsigned char) psRecord->iKind;
+   ulLength += Journal_putNumber(pucBody + ulLength, ulPathLength);
+   memcpy(pucBody + ulLength, psRecord->pcPath, ulPathLength);
+   ulLength += ulPathLength;
+   if(psRecord->iKind == JOURNAL_MOVE) {
+      ulLength += Journal_putNumber(pucBody + ulLength, ulOtherLength);
+      memcpy(pucBody + ulLength, psRecord->pcOther, ulOtherLength);
+      ulLength += ulOtherLength;
+   }
+   if(psRecord->iKind == JOURNAL_INSERT_FILE ||
+      psRecord->iKind == JOURNAL_REPLACE_CONTENTS) {
+      pucBody[ulLength++] = (unsigned char)
+         (psRecord->pvContents != NULL ? 1 : 0);
+      ulLength += Journal_putNumber(pucBody + ulLength,
+                                    psRecord->ulLength);
+      if(psRecord->pvContents != NULL)
+         memcpy(pucBody + ulLength, psRecord->pvContents,
+                ulContentsLength);
+      ulLength += ulContentsLength;
+   }
+   ulBodyLength = ulLength;
+   ulChecksum = Journal_checksum(pucBody, ulBodyLength);
+
+   ulLength = Journal_putNumber(pucRecord, ulBodyLength);
+   memmove(pucRecord + ulLength, pucBody, ulBodyLength);
+   ulLength += ulBodyLength;
+   for(i = 0; i < CHECKSUM_LENGTH; i++) {
+      pucRecord[ulLength++] = (unsigned char) (ulChecksum & 0xff);
+      ulChecksum >>= 8;
+   }
+   oJournal->ulPendingLength += ulLength;
+   (void) pthread_mutex_unlock(&oJournal->sMutex);
+   return SUCCESS;
+}
+
+/*
+  Writes out every record logged in oJournal so far, as one write and
+  one fsync, releasing oJournal's mutex, which the caller holds,
+  meanwhile so that more records can be logged. The caller must have
+  found no write under way.
+*/
+static void Journal_write(Journal_T oJournal) {
+   unsigned char *pucWriting;
+   size_t ulWritingLength;
+   size_t ulWritingRoom;
+   size_t ulTarget;
+   int iStatus;
+
+   assert(oJournal != NULL);
+   assert(!oJournal->bWriting);
+
+   /* swap buffers, so that logging goes on into the spare */
+   pucWriting = oJournal->pucPending;
+   ulWritingLength = oJournal->ulPendingLength;
+   ulWritingRoom = oJournal->ulPendingRoom;
+   oJournal->pucPending = oJournal->pucSpare;
+   oJournal->ulPendingRoom = oJournal->ulSpareRoom;
+   oJournal->ulPendingLength = 0;
+   oJournal->pucSpare = pucWriting;
+   ulTarget = oJournal->ulLogged;
+   oJournal->bWriting = TRUE;
+   (void) pthread_mutex_unlock(&oJournal->sMutex);
+
+   iStatus = Journal_writeAll(oJournal->iFd, pucWriting,
+                              ulWritingLength);
+   if(iStatus == SUCCESS && fsync(oJournal->iFd) != 0)
+      iStatus = IO_ERROR;
+
+   (void) pthread_mutex_lock(&oJournal->sMutex);
+   oJournal->ulSpareRoom = ulWritingRoom;
+   oJournal->bWriting = FALSE;
+   if(iStatus != SUCCESS && oJournal->iStatus == SUCCESS)
+      oJournal->iStatus = iStatus;
+   if(oJournal->iStatus == SUCCESS)
+      oJournal->ulDurable = ulTarget;
+   (void) pthread_cond_broadcast(&oJournal->sWritten);
+}
+
+int Journal_commit(Journal_T oJournal, size_t ulSequence) {
+   int iStatus;
+
+   assert(oJournal != NULL);
+
+   (void) pthread_mutex_lock(&oJournal->sMutex);
+   while(oJournal->ulDurable < ulSequence &&
+         oJournal->iStatus == SUCCESS) {
+      if(oJournal->bWriting)
+         (void) pthread_cond_wait(&oJournal->sWritten,
+                                  &oJournal->sMutex);
+      else
+         Journal_write(oJournal);
+   }
+   iStatus = (oJournal->ulDurable >= ulSequence) ? SUCCESS
+                                                 : oJournal->iStatus;
+   (void) pthread_mutex_unlock(&oJournal->sMutex);
+   return iStatus;
+}
+
+int Journal_reset(Journal_T oJournal, size_t ulGeneration) {
+   int iStatus;
+
+   assert(oJournal != NULL);
+
+   (void) pthread_mutex_lock(&oJournal->sMutex);
+   while(oJournal->bWriting ||
+         (oJournal->ulDurable < oJournal->ulLogged &&
+          oJournal->iStatus == SUCCESS)) {
+      if(oJournal->bWriting)
+         (void) pthread_cond_wait(&oJournal->sWritten,
+                                  &oJournal->sMutex);
+      else
+         Journal_write(oJournal);
+   }
+
+   /* the checkpoint holds every change logged, durable or not */
+   oJournal->ulPendingLength = 0;
+   oJournal->ulDurable = oJournal->ulLogged;
+   iStatus = SUCCESS;
+   if(ftruncate(oJournal->iFd, 0) != 0 ||
+      Journal_writeHeader(oJournal->iFd, ulGeneration) != SUCCESS)
+      iStatus = IO_ERROR;
+   oJournal->ulGeneration = ulGeneration;
+   oJournal->iStatus = iStatus;
+   (void) pthread_cond_broadcast(&oJournal->sWritten);
+   (void) pthread_mutex_unlock(&oJournal->sMutex);
+   return iStatus;
+}
+
+int Journal_close(Journal_T oJournal) {
+   int iStatus;
+
+   assert(oJournal != NULL);
+
+   iStatus = Journal_commit(oJournal, oJournal->ulLogged);
+   if(close(oJournal->iFd) != 0 && iStatus == SUCCESS)
+      iStatus = IO_ERROR;
+   (void) pthread_cond_destroy(&oJournal->sWritten);
+   (void) pthread_mutex_destroy(&oJournal->sMutex);
+   free(oJournal->pucPending);
+   free(oJournal->pucSpare);
+   free(oJournal);
+   return iStatus;
+}
+
+int Journal_syncFile(const char *pcFile) {
+   int iFd;
+   int iStatus = SUCCESS;
+
+   assert(pcFile != NULL);
+
+   iFd = open(pcFile, O_RDONLY);
+   if(iFd < 0)
+      return IO_ERROR;
+   if(fsync(iFd) != 0)
+      iStatus = IO_ERROR;
+   if(close(iFd) != 0)
+      iStatus = IO_ERROR;
+   return iStatus;
+}
+
+int Journal_replaceFile(const char *pcFrom, const char *pcTo) {
+   char *pcDirectory;
+   const char *pcSlash;
+   size_t ulLength;
+   int iStatus;
+
+   assert(pcFrom != NULL);
+   assert(pcTo != NULL);
+
+   if(rename(pcFrom, pcTo) != 0)
+      return IO_ERROR;
+
+   /* the rename is durable once the directory holding it is */
+   pcSlash = strrchr(pcTo, '/');
+   if(pcSlash == NULL)
+      return Journal_syncFile(".");
+   ulLength = pcSlash == pcTo ? 1 : (size_t) (pcSlash - pcTo);
+   pcDirectory = malloc(ulLength + 1);
+   if(pcDirectory == NULL)
+      return MEMORY_ERROR;
+   memcpy(pcDirectory, pcTo, ulLength);
+   pcDirectory[ulLength] = '\0';
+   iStatus = Journal_syncFile(pcDirectory);
+   free(pcDirectory);
+   return iStatus;
+}
@@ -0,0 +1,134 @@
+/*--------------------------------------------------------------------*/
+/* journal.h                                                          */
+/* Author: Matthew Okechukwu, Pinrui Huang                            */
+/*--------------------------------------------------------------------*/
+
+#ifndef JOURNAL_INCLUDED
+#define JOURNAL_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+
+/*
+  A Journal_T is an append-only log of the changes made to a tree
+  since its last checkpoint, so that the tree can be rebuilt after a
+  crash from the checkpoint's save file (see treefile.h) and the log.
+  The log begins with a magic string, a version, and the generation
+  of the checkpoint that it follows; each record then holds its
+  length, its change, and a checksum, so that a record cut short by
+  a crash, and everything after it, is recognized and dropped.
+  Records are logged into memory and written out by whichever
+  caller first waits for them to be durable: it writes everything
+  logged so far with one write and one fsync, and every other caller
+  waiting meanwhile is satisfied by the same fsync or the next
+  (group commit).
+*/
+typedef struct Journal *Journal_T;
+
+/* The kinds of change that a journal records */
+enum JournalKind {
+   JOURNAL_INSERT_DIR, JOURNAL_INSERT_FILE, JOURNAL_RM_DIR,
+   JOURNAL_RM_FILE, JOURNAL_REPLACE_CONTENTS, JOURNAL_MOVE
+};
+
+/* One change, as logged or replayed */
+struct JournalRecord {
+   /* the kind of change, an enum JournalKind */
+   int iKind;
+   /* the absolute path changed, '\0'-terminated */
+   const char *pcPath;
+   /* for JOURNAL_MOVE, the path moved to, or else NULL */
+   const char *pcOther;
+   /* for JOURNAL_INSERT_FILE and JOURNAL_REPLACE_CONTENTS, the file's
+      new contents, ulLength bytes, or NULL if it has none */
+   void *pvContents;
+   /* the file's new length */
+   size_t ulLength;
+};
+
+/*
+  Reads the journal pcFile, which must follow the checkpoint of
+  generation ulGeneration, and calls (*pfApply)(psRecord, pvExtra)
+  for each of its records in order, up to the first one that is cut
+  short or damaged. The contents in each record passed are a new
+  block from malloc, which pfApply then owns. Sets *pulLength to the
+  number of bytes up to the end of the last record applied. Returns
+  SUCCESS, or otherwise, without calling pfApply, returns status:
+  * NO_SUCH_PATH if pcFile does not exist, or follows another
+                 checkpoint, or its header is cut short or damaged,
+                 in which case no record in it belongs to the tree
+  * IO_ERROR if pcFile could not be read
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int Journal_replay(const char *pcFile, size_t ulGeneration,
+                   void (*pfApply)(struct JournalRecord *psRecord,
+                                   void *pvExtra),
+                   void *pvExtra, size_t *pulLength);
+
+/*
+  Opens the journal pcFile for logging: if ulLength is 0, as a new,
+  empty journal following the checkpoint of generation ulGeneration,
+  replacing any file of that name, or otherwise as the existing
+  journal of that generation, cut back to its first ulLength bytes,
+  as Journal_replay found them. Returns SUCCESS and sets *poJournal
+  to it if successful. Otherwise, sets *poJournal to NULL and returns
+  status:
+  * IO_ERROR if pcFile could not be opened, created or synced
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int Journal_open(const char *pcFile, size_t ulGeneration,
+                 size_t ulLength, Journal_T *poJournal);
+
+/* Returns the generation of the checkpoint that oJournal follows. */
+size_t Journal_getGeneration(Journal_T oJournal);
+
+/*
+  Logs *psRecord in oJournal, in memory, and sets *pulSequence to its
+  number for Journal_commit. Callers must log their changes in the
+  order they make them. Returns SUCCESS, or the status with which
+  oJournal has failed: MEMORY_ERROR if memory could not be allocated
+  for this record, or IO_ERROR if an earlier write failed. Once
+  oJournal has failed, nothing more is written until Journal_reset.
+*/
+int Journal_log(Journal_T oJournal,
+                const struct JournalRecord *psRecord,
+                size_t *pulSequence);
+
+/*
+  Waits until the record that Journal_log numbered ulSequence is
+  durable, writing it and every record logged before it if no other
+  caller is already doing so. Returns SUCCESS, or the status with
+  which oJournal failed before the record was durable.
+*/
+int Journal_commit(Journal_T oJournal, size_t ulSequence);
+
+/*
+  Empties oJournal, once every record logged is durable or oJournal
+  has failed, and begins it again as following the checkpoint of
+  generation ulGeneration, clearing any failure. The caller must
+  have made that checkpoint durable first. Returns SUCCESS, or
+  IO_ERROR if oJournal could not be rewritten, in which case it has
+  failed.
+*/
+int Journal_reset(Journal_T oJournal, size_t ulGeneration);
+
+/*
+  Writes out every record logged in oJournal, closes it, and frees
+  it. No call may still be using oJournal. Returns SUCCESS, or the
+  status with which oJournal has failed.
+*/
+int Journal_close(Journal_T oJournal);
+
+/*
+  Makes the file pcFile, already written, durable. Returns SUCCESS,
+  or IO_ERROR if it could not be opened or synced.
+*/
+int Journal_syncFile(const char *pcFile);
+
+/*
+  Renames pcFrom to pcTo, replacing any file of that name, and makes
+  the rename durable. Returns SUCCESS, or IO_ERROR if it failed.
+*/
+int Journal_replaceFile(const char *pcFrom, const char *pcTo);
+
+#endif
@@ -0,0 +1,400 @@
+/*--------------------------------------------------------------------*/
+/* manifest.c                                                         */
+/* Author: Matthew Okechukwu, Pinrui Huang                            */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "manifest.h"
+
+/* The number of bytes first read from a manifest file */
+enum { INITIAL_TEXT_LENGTH = 65536 };
+
+/*
+  The number of ranks a character of a path can take in component
+  order: one for the end of the path, one for '/', and one for each
+  other value of an unsigned char
+*/
+enum { NUM_RANKS = 258 };
+
+/* Buckets no longer than this are insertion sorted, not radix sorted */
+enum { INSERTION_SORT_LENGTH = 16 };
+
+/* A manifest file, and its entries */
+struct Manifest {
+   /* The text of the file, with each line '\0'-terminated in place */
+   char *pcText;
+   /* The entries, in component order */
+   struct ManifestEntry *psEntries;
+   /* The number of entries */
+   size_t ulLength;
+};
+
+/* A bucket of entries still to be radix sorted */
+struct ManifestBucket {
+   /* The index of the bucket's first entry */
+   size_t ulStart;
+   /* The number of entries in the bucket */
+   size_t ulLength;
+   /* The offset of the character the bucket is next sorted by */
+   size_t ulOffset;
+};
+
+/*
+  Returns the rank in component order of the character at offset
+  ulOffset of psEntry's path: 0 past its end, 1 for '/', and two more
+  than its value as an unsigned char otherwise.
+*/
+static size_t Manifest_rank(const struct ManifestEntry *psEntry,
+                            size_t ulOffset) {
+   unsigned char c;
+
+   assert(psEntry != NULL);
+
+   if(ulOffset >= psEntry->ulLength)
+      return 0;
+   c = (unsigned char) psEntry->pcPath[ulOffset];
+   if(c == '/')
+      return 1;
+   return (size_t) c + 2;
+}
+
+/*
+  Compares the paths of psEntry1 and psEntry2 in component order,
+  starting from offset ulOffset, before which they must agree. Returns
+  <0, 0, or >0 if psEntry1's path is less than, equal to, or greater
+  than psEntry2's.
+*/
+static int Manifest_compare(const struct ManifestEntry *psEntry1,
+                            const struct ManifestEntry *psEntry2,
+                            size_t ulOffset) {
+   size_t ulRank1;
+   size_t ulRank2;
+
+   assert(psEntry1 != NULL);
+   assert(psEntry2 != NULL);
+
+   for(;;) {
+      ulRank1 = Manifest_rank(psEntry1, ulOffset);
+      ulRank2 = Manifest_rank(psEntry2, ulOffset);
+      if(ulRank1 != ulRank2)
+         return ulRank1 < ulRank2 ? -1 : 1;
+      if(ulRank1 == 0)
+         return 0;
+      ulOffset++;
+   }
+}
+
+/*
+  Sorts the ulLength entries at psEntries, which agree before offset
+  ulOffset, into component order by insertion sort.
+*/
+static void Manifest_insertionSort(struct ManifestEntry *psEntries,
+                                   size_t ulLength, size_t ulOffset) {
+   size_t ul;
+   size_t ulHole;
+   struct ManifestEntry sEntry;
+
+   assert(psEntries != NULL);
+
+   for(ul = 1; ul < ulLength; ul++) {
+      sEntry = psEntries[ul];
+      ulHole = ul;
+      while(ulHole > 0 &&
+            Manifest_compare(&sEntry, &psEntries[ulHole - 1],
+                             ulOffset) < 0) {
+         psEntries[ulHole] = psEntries[ulHole - 1];
+         ulHole--;
+      }
+      psEntries[ulHole] = sEntry;
+   }
+}
+
+/*
+  Sorts the entries of oManifest into component order by most
+  significant digit radix sort, one character per pass, keeping the
+  buckets still to be sorted on a stack rather than recursing.
+  Returns SUCCESS, or MEMORY_ERROR if memory could not be allocated,
+  in which case the entries are left in some order.
+*/
+static int Manifest_sort(Manifest_T oManifest) {
+   struct ManifestEntry *psEntries;
+   struct ManifestEntry *psScratch;
+   struct ManifestBucket *psStack;
+   struct ManifestBucket sBucket;
+   size_t aulStarts[NUM_RANKS];
+   size_t aulEnds[NUM_RANKS];
+   size_t ulDepth = 0;
+   size_t ulRank;
+   size_t ul;
+
+   assert(oManifest != NULL);
+
+   psEntries = oManifest->psEntries;
+   psScratch = malloc(oManifest->ulLength * sizeof(*psScratch));
+   if(psScratch == NULL)
+      return MEMORY_ERROR;
+   /* the buckets on the stack never overlap and each holds at least
+      two entries */
+   psStack = malloc((oManifest->ulLength / 2 + 1) * sizeof(*psStack));
+   if(psStack == NULL) {
+      free(psScratch);
+      return MEMORY_ERROR;
+   }
+
+   psStack[ulDepth].ulStart = 0;
+   psStack[ulDepth].ulLength = oManifest->ulLength;
+   psStack[ulDepth].ulOffset = 0;
+   ulDepth++;
+
+   while(ulDepth > 0) {
+      sBucket = psStack[--ulDepth];
+      if(sBucket.ulLength <= INSERTION_SORT_LENGTH) {
+         Manifest_insertionSort(&psEntries[sBucket.ulStart],
+                                sBucket.ulLength, sBucket.ulOffset);
+         continue;
+      }
+
+      /* count each rank, then turn the counts into bucket bounds */
+      memset(aulEnds, 0, sizeof(aulEnds));
+      for(ul = sBucket.ulStart;
+          ul < sBucket.ulStart + sBucket.ulLength; ul++)
+         aulEnds[Manifest_rank(&psEntries[ul], sBucket.ulOffset)]++;
+      aulStarts[0] = 0;
+      for(ulRank = 1; ulRank < NUM_RANKS; ulRank++)
+         aulStarts[ulRank] =
+            aulStarts[ulRank - 1] + aulEnds[ulRank - 1];
+      for(ulRank = 0; ulRank < NUM_RANKS; ulRank++)
+         aulEnds[ulRank] = aulStarts[ulRank];
+
+      for(ul = sBucket.ulStart;
+          ul < sBucket.ulStart + sBucket.ulLength; ul++) {
+         ulRank = Manifest_rank(&psEntries[ul], sBucket.ulOffset);
+         psScratch[aulEnds[ulRank]++] = psEntries[ul];
+      }
+      memcpy(&psEntries[sBucket.ulStart], psScratch,
+             sBucket.ulLength * sizeof(*psEntries));
+
+      /* paths that have ended are equal; sort the rest further */
+      for(ulRank = 1; ulRank < NUM_RANKS; ulRank++) {
+         if(aulEnds[ulRank] - aulStarts[ulRank] < 2)
+            continue;
+         psStack[ulDepth].ulStart =
+            sBucket.ulStart + aulStarts[ulRank];
+         psStack[ulDepth].ulLength =
+            aulEnds[ulRank] - aulStarts[ulRank];
+         psStack[ulDepth].ulOffset = sBucket.ulOffset + 1;
+         ulDepth++;
+      }
+   }
+
+   free(psStack);
+   free(psScratch);
+   return SUCCESS;
+}
+
+/*
+  Reads all of psFile into a new '\0'-terminated string, setting
+  *ppcText to it and *pulLength to its length. Returns SUCCESS, or
+  IO_ERROR or MEMORY_ERROR, in which case *ppcText is set to NULL.
+*/
+static int Manifest_readAll(FILE *psFile, char **ppcText,
+                            size_t *pulLength) {
+   char *pcText;
+   char *pcGrown;
+   size_t ulPhysLength = INITIAL_TEXT_LENGTH;
+   size_t ulLength = 0;
+
+   assert(psFile != NULL);
+   assert(ppcText != NULL);
+   assert(pulLength != NULL);
+
+   *ppcText = NULL;
+   pcText = malloc(ulPhysLength);
+   if(pcText == NULL)
+      return MEMORY_ERROR;
+
+   for(;;) {
+      ulLength += fread(pcText + ulLength, 1,
+                        ulPhysLength - ulLength - 1, psFile);
+      if(ulLength < ulPhysLength - 1)
+         break;
+      pcGrown = realloc(pcText, ulPhysLength * 2);
+      if(pcGrown == NULL) {
+         free(pcText);
+         return MEMORY_ERROR;
+      }
+      pcText = pcGrown;
+      ulPhysLength *= 2;
+   }
+   if(ferror(psFile)) {
+      free(pcText);
+      return IO_ERROR;
+   }
+
+   pcText[ulLength] = '\0';
+   *ppcText = pcText;
+   *pulLength = ulLength;
+   return SUCCESS;
+}
+
+/*
+  Parses the '\0'-terminated line pcLine, of length ulLength, into
+  *psEntry, ending its path in place. Returns SUCCESS, or BAD_PATH if
+  its size is malformed.
+*/
+static int Manifest_parseLine(char *pcLine, size_t ulLength,
+                              struct ManifestEntry *psEntry) {
+   char *pcTab;
+   char *pc;
+   size_t ulSize = 0;
+   size_t ulDigit;
+
+   assert(pcLine != NULL);
+   assert(psEntry != NULL);
+
+   psEntry->pcPath = pcLine;
+   psEntry->bIsDirectory = FALSE;
+   psEntry->ulSize = 0;
+
+   pcTab = strchr(pcLine, '\t');
+   if(pcTab != NULL) {
+      *pcTab = '\0';
+      ulLength = (size_t) (pcTab - pcLine);
+      pc = pcTab + 1;
+      if(*pc == '\0')
+         return BAD_PATH;
+      for(; *pc != '\0'; pc++) {
+         if(*pc < '0' || *pc > '9')
+            return BAD_PATH;
+         ulDigit = (size_t) (*pc - '0');
+         if(ulSize > ((size_t) -1 - ulDigit) / 10)
+            return BAD_PATH;
+         ulSize = ulSize * 10 + ulDigit;
+      }
+      psEntry->ulSize = ulSize;
+   }
+
+   if(ulLength > 0 && pcLine[ulLength - 1] == '/') {
+      if(pcTab != NULL)
+         return BAD_PATH;
+      pcLine[--ulLength] = '\0';
+      psEntry->bIsDirectory = TRUE;
+   }
+
+   psEntry->ulLength = ulLength;
+   return SUCCESS;
+}
+
+/*
+  Returns TRUE if the entries of oManifest are in component order.
+*/
+static boolean Manifest_isSorted(Manifest_T oManifest) {
+   size_t ul;
+
+   assert(oManifest != NULL);
+
+   for(ul = 1; ul < oManifest->ulLength; ul++)
+      if(Manifest_compare(&oManifest->psEntries[ul - 1],
+                          &oManifest->psEntries[ul], 0) > 0)
+         return FALSE;
+   return TRUE;
+}
+
+int Manifest_read(const char *pcFile, Manifest_T *poManifest) {
+   FILE *psFile;
+   Manifest_T oManifest;
+   char *pcText;
+   char *pcLine;
+   char *pcEnd;
+   size_t ulTextLength;
+   size_t ulMaxLength = 1;
+   size_t ul;
+   int iStatus;
+
+   assert(pcFile != NULL);
+   assert(poManifest != NULL);
+
+   *poManifest = NULL;
+
+   psFile = fopen(pcFile, "rb");
+   if(psFile == NULL)
+      return IO_ERROR;
+   iStatus = Manifest_readAll(psFile, &pcText, &ulTextLength);
+   fclose(psFile);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   for(ul = 0; ul < ulTextLength; ul++)
+      if(pcText[ul] == '\n')
+         ulMaxLength++;
+
+   oManifest = malloc(sizeof(struct Manifest));
+   if(oManifest == NULL) {
+      free(pcText);
+      return MEMORY_ERROR;
+   }
+   oManifest->pcText = pcText;
+   oManifest->ulLength = 0;
+   oManifest->psEntries = malloc(ulMaxLength *
+                                 sizeof(struct ManifestEntry));
+   if(oManifest->psEntries == NULL) {
+      Manifest_free(oManifest);
+      return MEMORY_ERROR;
+   }
+
+   /* split the text into lines in place, skipping empty ones */
+   for(pcLine = pcText; pcLine < pcText + ulTextLength;
+       pcLine = pcEnd + 1) {
+      pcEnd = memchr(pcLine, '\n',
+                     (size_t) (pcText + ulTextLength - pcLine));
+      if(pcEnd == NULL)
+         pcEnd = pcText + ulTextLength;
+      *pcEnd = '\0';
+      if(pcEnd == pcLine)
+         continue;
+      iStatus = Manifest_parseLine(pcLine, (size_t) (pcEnd - pcLine),
+                     &oManifest->psEntries[oManifest->ulLength]);
+      if(iStatus != SUCCESS) {
+         Manifest_free(oManifest);
+         return iStatus;
+      }
+      oManifest->ulLength++;
+   }
+
+   if(!Manifest_isSorted(oManifest)) {
+      iStatus = Manifest_sort(oManifest);
+      if(iStatus != SUCCESS) {
+         Manifest_free(oManifest);
+         return iStatus;
+      }
+   }
+
+   *poManifest = oManifest;
+   return SUCCESS;
+}
+
+size_t Manifest_getLength(Manifest_T oManifest) {
+   assert(oManifest != NULL);
+
+   return oManifest->ulLength;
+}
+
+const struct ManifestEntry *Manifest_getEntry(Manifest_T oManifest,
+                                              size_t ulIndex) {
+   assert(oManifest != NULL);
+   assert(ulIndex < oManifest->ulLength);
+
+   return &oManifest->psEntries[ulIndex];
+}
+
+void Manifest_free(Manifest_T oManifest) {
+   if(oManifest == NULL)
+      return;
+   free(oManifest->psEntries);
+   free(oManifest->pcText);
+   free(oManifest);
+}
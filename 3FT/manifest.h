@@ -0,0 +1,64 @@
+/*--------------------------------------------------------------------*/
+/* manifest.h                                                         */
+/* Author: Matthew Okechukwu, Pinrui Huang                            */
+/*--------------------------------------------------------------------*/
+
+#ifndef MANIFEST_INCLUDED
+#define MANIFEST_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+
+/*
+  A Manifest_T is the list of paths read from a manifest file, sorted
+  into component order: the order of their components, compared one
+  at a time by strcmp, so that every path directly follows the paths
+  that are its prefixes and the paths beneath any one directory are
+  adjacent. This is strcmp order on whole paths, except that '/'
+  sorts below every other character.
+*/
+typedef struct Manifest *Manifest_T;
+
+/* One line of a manifest file */
+struct ManifestEntry {
+   /* the path, '\0'-terminated, without any trailing '/' */
+   const char *pcPath;
+   /* the string length of pcPath */
+   size_t ulLength;
+   /* TRUE if the line named a directory, by ending in '/' */
+   boolean bIsDirectory;
+   /* the size given for a file, or 0 if none was given */
+   size_t ulSize;
+};
+
+/*
+  Reads the manifest file named pcFile. Each line of the file is
+  empty, and then ignored, or is a path, in one of three forms:
+    path            a file of size 0
+    path<TAB>size   a file of size bytes, given in decimal
+    path/           a directory
+  The paths themselves are not checked. If the lines are not already
+  in component order, they are radix sorted into it. Returns SUCCESS
+  and sets *poManifest to the manifest if successful. Otherwise, sets
+  *poManifest to NULL and returns status:
+  * IO_ERROR if pcFile could not be opened or read
+  * BAD_PATH if a size is not a decimal number that fits in a size_t,
+             or is given for a directory
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int Manifest_read(const char *pcFile, Manifest_T *poManifest);
+
+/* Returns the number of entries in oManifest. */
+size_t Manifest_getLength(Manifest_T oManifest);
+
+/*
+  Returns the ulIndex'th entry of oManifest in component order, which
+  remains valid until oManifest is freed.
+*/
+const struct ManifestEntry *Manifest_getEntry(Manifest_T oManifest,
+                                              size_t ulIndex);
+
+/* Frees oManifest and every entry it holds. */
+void Manifest_free(Manifest_T oManifest);
+
+#endif
@@ -0,0 +1,421 @@
+/*--------------------------------------------------------------------*/
+/* pool.c                                                             */
+/* Author: Matthew Okechukwu, Pinrui Huang                            */
+/*--------------------------------------------------------------------*/
+
+/* pthread and posix_memalign are POSIX extensions beyond ISO C */
+#define _XOPEN_SOURCE 600
+
+#include "pool.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+/*--------------------------------------------------------------------*/
+
+/* The types whose alignment a block must satisfy.  Block sizes are
+   multiples of its size. */
+
+union PoolAlign
+{
+   long l;
+   double d;
+   long double ld;
+   void *pv;
+   void (*pf)(void);
+};
+
+enum {
+   /* The step between one block size and the next. */
+   GRAIN = sizeof(union PoolAlign),
+
+   /* The number of block sizes, from GRAIN to POOL_MAX_SIZE. */
+   NUM_CLASSES = (POOL_MAX_SIZE + GRAIN - 1) / GRAIN,
+
+   /* The size of a slab, which is also its alignment, so that the
+      slab holding a block is found by rounding the block's address
+      down. */
+   SLAB_SIZE = 65536,
+
+   /* The most free blocks of one size that a thread keeps; beyond
+      that, half of them go back to the shared list. */
+   CACHE_LENGTH = 32
+};
+
+/*--------------------------------------------------------------------*/
+
+/* A free block, linked to the next through its own first bytes. */
+
+struct PoolBlock
+{
+   /* The next free block, or NULL. */
+   struct PoolBlock *psNext;
+};
+
+/* The start of a slab, with its blocks following it. */
+
+struct PoolSlab
+{
+   /* The index of the size class that the slab's blocks belong to. */
+   size_t uClass;
+
+   /* The slab allocated before this one for the same size, or NULL.
+      Keeping every slab listed leaves none of them unreachable. */
+   struct PoolSlab *psNext;
+
+   /* The number of the slab's blocks on the shared list, counted by
+      Pool_trim. */
+   size_t uFree;
+
+   /* Pads the header to a multiple of the alignment of a block. */
+   union PoolAlign uAlign;
+};
+
+/* The blocks of one size that no thread holds. */
+
+struct PoolClass
+{
+   /* Guards the other fields. */
+   pthread_mutex_t sLock;
+
+   /* The shared free blocks. */
+   struct PoolBlock *psFree;
+
+   /* Every slab of this size. */
+   struct PoolSlab *psSlabs;
+};
+
+/* The free blocks that one thread keeps for itself, by size. */
+
+struct PoolCache
+{
+   /* The free blocks of each size. */
+   struct PoolBlock *apsFree[NUM_CLASSES];
+
+   /* The number of blocks in each of apsFree. */
+   size_t auLength[NUM_CLASSES];
+};
+
+/*--------------------------------------------------------------------*/
+
+/* The shared blocks of each size. */
+static struct PoolClass asClasses[NUM_CLASSES];
+
+/* The key under which each thread finds its own cache. */
+static pthread_key_t sKey;
+
+/* 1 (TRUE) once sKey has been created. */
+static int bKeyCreated;
+
+/* Makes sure the classes and sKey are set up exactly once. */
+static pthread_once_t sOnce = PTHREAD_ONCE_INIT;
+
+/* The number of slabs of every size, for Pool_getSlabs. */
+static size_t uSlabs;
+
+/*--------------------------------------------------------------------*/
+
+/* Move the first uCount blocks of psCache's list for size class
+   uClass to the shared list. */
+
+static void Pool_drain(struct PoolCache *psCache, size_t uClass,
+                       size_t uCount)
+{
+   struct PoolClass *psClass = &asClasses[uClass];
+   struct PoolBlock *psFirst;
+   struct PoolBlock *psLast;
+   size_t u;
+
+   assert(psCache != NULL);
+   assert(uCount > 0 && uCount <= psCache->auLength[uClass]);
+
+   psFirst = psCache->apsFree[uClass];
+   psLast = psFirst;
+   for (u = 1; u < uCount; u++)
+      psLast = psLast->psNext;
+   psCache->apsFree[uClass] = psLast->psNext;
+   psCache->auLength[uClass] -= uCount;
+
+   (void)pthread_mutex_lock(&psClass->sLock);
+   psLast->psNext = psClass->psFree;
+   psClass->psFree = psFirst;
+   (void)pthread_mutex_unlock(&psClass->sLock);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Give every block in pvCache, the cache of a thread that is
+   exiting, back to the shared lists, and free the cache. */
+
+static void Pool_releaseCache(void *pvCache)
+{
+   struct PoolCache *psCache = (struct PoolCache*)pvCache;
+   size_t uClass;
+
+   assert(psCache != NULL);
+
+   for (uClass = 0; uClass < NUM_CLASSES; uClass++)
+      if (psCache->auLength[uClass] > 0)
+         Pool_drain(psCache, uClass, psCache->auLength[uClass]);
+   free(psCache);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Set up the classes and create sKey. */
+
+static void Pool_init(void)
+{
+   size_t uClass;
+
+   for (uClass = 0; uClass < NUM_CLASSES; uClass++)
+   {
+      (void)pthread_mutex_init(&asClasses[uClass].sLock, NULL);
+      asClasses[uClass].psFree = NULL;
+      asClasses[uClass].psSlabs = NULL;
+   }
+   if (pthread_key_create(&sKey, Pool_releaseCache) == 0)
+      __atomic_store_n(&bKeyCreated, 1, __ATOMIC_RELEASE);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the calling thread's cache, allocating one if it has none
+   yet, or NULL if none could be allocated, in which case the thread
+   uses the shared lists directly. */
+
+static struct PoolCache *Pool_getCache(void)
+{
+   struct PoolCache *psCache;
+
+   if (! __atomic_load_n(&bKeyCreated, __ATOMIC_ACQUIRE))
+      return NULL;
+
+   psCache = (struct PoolCache*)pthread_getspecific(sKey);
+   if (psCache != NULL)
+      return psCache;
+
+   psCache = (struct PoolCache*)calloc(1, sizeof(struct PoolCache));
+   if (psCache == NULL)
+      return NULL;
+   if (pthread_setspecific(sKey, psCache) != 0)
+   {
+      free(psCache);
+      return NULL;
+   }
+   return psCache;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Allocate a slab for size class uClass and add its blocks to the
+   shared list.  The class's lock must be held.  Return 1 (TRUE) if
+   successful and 0 (FALSE) if insufficient memory is available. */
+
+static int Pool_addSlab(size_t uClass)
+{
+   struct PoolClass *psClass = &asClasses[uClass];
+   struct PoolSlab *psSlab;
+   struct PoolBlock *psBlock;
+   void *pvSlab;
+   size_t uSize;
+   char *pc;
+
+   uSize = (uClass + 1) * GRAIN;
+   if (posix_memalign(&pvSlab, SLAB_SIZE, SLAB_SIZE) != 0)
+      return 0;
+   psSlab = (struct PoolSlab*)pvSlab;
+   psSlab->uClass = uClass;
+   psSlab->psNext = psClass->psSlabs;
+   psClass->psSlabs = psSlab;
+   (void)__atomic_add_fetch(&uSlabs, 1, __ATOMIC_RELAXED);
+
+   for (pc = (char*)(psSlab + 1);
+        pc + uSize <= (char*)pvSlab + SLAB_SIZE; pc += uSize)
+   {
+      psBlock = (struct PoolBlock*)(void*)pc;
+      psBlock->psNext = psClass->psFree;
+      psClass->psFree = psBlock;
+   }
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *Pool_alloc(size_t uSize)
+{
+   struct PoolCache *psCache;
+   struct PoolClass *psClass;
+   struct PoolBlock *psBlock;
+   size_t uClass;
+   size_t u;
+
+   assert(uSize <= POOL_MAX_SIZE);
+
+   uClass = (uSize == 0) ? 0 : (uSize - 1) / GRAIN;
+   (void)pthread_once(&sOnce, Pool_init);
+
+   psCache = Pool_getCache();
+   if (psCache != NULL && psCache->apsFree[uClass] != NULL)
+   {
+      psBlock = psCache->apsFree[uClass];
+      psCache->apsFree[uClass] = psBlock->psNext;
+      psCache->auLength[uClass]--;
+      return psBlock;
+   }
+
+   /* Take one block for the caller and, while the lock is held, up
+      to half a cache's worth more for later. */
+   psClass = &asClasses[uClass];
+   (void)pthread_mutex_lock(&psClass->sLock);
+   if (psClass->psFree == NULL && ! Pool_addSlab(uClass))
+   {
+      (void)pthread_mutex_unlock(&psClass->sLock);
+      return NULL;
+   }
+   psBlock = psClass->psFree;
+   psClass->psFree = psBlock->psNext;
+   if (psCache != NULL)
+      for (u = 0; u < CACHE_LENGTH / 2 && psClass->psFree != NULL; u++)
+      {
+         struct PoolBlock *psMoved = psClass->psFree;
+         psClass->psFree = psMoved->psNext;
+         psMoved->psNext = psCache->apsFree[uClass];
+         psCache->apsFree[uClass] = psMoved;
+         psCache->auLength[uClass]++;
+      }
+   (void)pthread_mutex_unlock(&psClass->sLock);
+   return psBlock;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the slab that holds pv, a block from Pool_alloc. */
+
+static struct PoolSlab *Pool_getSlab(void *pv)
+{
+   return (struct PoolSlab*)(void*)
+      ((char*)pv - ((size_t)pv & (SLAB_SIZE - 1)));
+}
+
+/*--------------------------------------------------------------------*/
+
+void Pool_free(void *pv)
+{
+   struct PoolSlab *psSlab;
+   struct PoolCache *psCache;
+   struct PoolClass *psClass;
+   struct PoolBlock *psBlock = (struct PoolBlock*)pv;
+   size_t uClass;
+
+   if (pv == NULL)
+      return;
+
+   psSlab = Pool_getSlab(pv);
+   uClass = psSlab->uClass;
+   assert(uClass < NUM_CLASSES);
+
+   psCache = Pool_getCache();
+   if (psCache == NULL)
+   {
+      psClass = &asClasses[uClass];
+      (void)pthread_mutex_lock(&psClass->sLock);
+      psBlock->psNext = psClass->psFree;
+      psClass->psFree = psBlock;
+      (void)pthread_mutex_unlock(&psClass->sLock);
+      return;
+   }
+
+   psBlock->psNext = psCache->apsFree[uClass];
+   psCache->apsFree[uClass] = psBlock;
+   psCache->auLength[uClass]++;
+   if (psCache->auLength[uClass] > CACHE_LENGTH)
+      Pool_drain(psCache, uClass, CACHE_LENGTH / 2);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free every slab of size class uClass all of whose blocks are on the
+   shared list, taking its blocks off the list.  The class's lock must
+   be held. */
+
+static void Pool_trimClass(size_t uClass)
+{
+   struct PoolClass *psClass = &asClasses[uClass];
+   struct PoolSlab *psSlab;
+   struct PoolSlab **ppsSlabLink;
+   struct PoolBlock *psBlock;
+   struct PoolBlock **ppsBlockLink;
+   size_t uCapacity;
+   int bAnyEmpty = 0;
+
+   uCapacity = (SLAB_SIZE - sizeof(struct PoolSlab)) /
+      ((uClass + 1) * GRAIN);
+
+   for (psSlab = psClass->psSlabs; psSlab != NULL;
+        psSlab = psSlab->psNext)
+      psSlab->uFree = 0;
+   for (psBlock = psClass->psFree; psBlock != NULL;
+        psBlock = psBlock->psNext)
+      if (++Pool_getSlab(psBlock)->uFree == uCapacity)
+         bAnyEmpty = 1;
+   if (! bAnyEmpty)
+      return;
+
+   /* Take the blocks of unused slabs off the list, then the slabs. */
+   ppsBlockLink = &psClass->psFree;
+   while ((psBlock = *ppsBlockLink) != NULL)
+   {
+      if (Pool_getSlab(psBlock)->uFree == uCapacity)
+         *ppsBlockLink = psBlock->psNext;
+      else
+         ppsBlockLink = &psBlock->psNext;
+   }
+   ppsSlabLink = &psClass->psSlabs;
+   while ((psSlab = *ppsSlabLink) != NULL)
+   {
+      if (psSlab->uFree == uCapacity)
+      {
+         *ppsSlabLink = psSlab->psNext;
+         free(psSlab);
+         (void)__atomic_sub_fetch(&uSlabs, 1, __ATOMIC_RELAXED);
+      }
+      else
+         ppsSlabLink = &psSlab->psNext;
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+void Pool_trim(void)
+{
+   struct PoolCache *psCache;
+   size_t uClass;
+
+   (void)pthread_once(&sOnce, Pool_init);
+
+   /* Blocks in the calling thread's own cache would keep their slabs,
+      so give them up first. */
+   if (__atomic_load_n(&bKeyCreated, __ATOMIC_ACQUIRE))
+   {
+      psCache = (struct PoolCache*)pthread_getspecific(sKey);
+      if (psCache != NULL)
+         for (uClass = 0; uClass < NUM_CLASSES; uClass++)
+            if (psCache->auLength[uClass] > 0)
+               Pool_drain(psCache, uClass, psCache->auLength[uClass]);
+   }
+
+   for (uClass = 0; uClass < NUM_CLASSES; uClass++)
+   {
+      (void)pthread_mutex_lock(&asClasses[uClass].sLock);
+      Pool_trimClass(uClass);
+      (void)pthread_mutex_unlock(&asClasses[uClass].sLock);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t Pool_getSlabs(void)
+{
+   return __atomic_load_n(&uSlabs, __ATOMIC_RELAXED);
+}
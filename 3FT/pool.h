@@ -0,0 +1,58 @@
+/*--------------------------------------------------------------------*/
+/* pool.h                                                             */
+/* Author: Matthew Okechukwu, Pinrui Huang                            */
+/*--------------------------------------------------------------------*/
+
+#ifndef POOL_INCLUDED
+#define POOL_INCLUDED
+
+#include <stddef.h>
+
+/* The pool hands out small blocks of memory from slabs, each slab
+   divided into blocks of one size, so that blocks freed by one
+   structure are reused by the next instead of going back to malloc.
+   Each thread keeps a short list of free blocks of each size of its
+   own, and takes the shared lists' lock only to refill or drain it,
+   so threads allocating and freeing at once rarely wait for each
+   other.  A slab stays allocated, even once all of its blocks are
+   free, until Pool_trim returns it to the system. */
+
+/*--------------------------------------------------------------------*/
+
+/* The largest block that Pool_alloc hands out. */
+
+enum { POOL_MAX_SIZE = 1024 };
+
+/*--------------------------------------------------------------------*/
+
+/* Return a block of uSize bytes, aligned for any type, or NULL if
+   insufficient memory is available.  uSize must be at most
+   POOL_MAX_SIZE. */
+
+void *Pool_alloc(size_t uSize);
+
+/*--------------------------------------------------------------------*/
+
+/* Give pv, a block from Pool_alloc, back to the pool for reuse.  pv
+   may be NULL. */
+
+void Pool_free(void *pv);
+
+/*--------------------------------------------------------------------*/
+
+/* Give the calling thread's free blocks back to the shared lists, and
+   free every slab all of whose blocks are then on them.  A slab with a
+   block in use, or in another thread's list, is kept.  Takes time in
+   proportion to the number of free blocks, so is meant for after a
+   large structure has been freed. */
+
+void Pool_trim(void);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of slabs that the pool holds, whether or not any
+   of their blocks are in use. */
+
+size_t Pool_getSlabs(void);
+
+#endif
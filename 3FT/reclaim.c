@@ -0,0 +1,200 @@
+/*--------------------------------------------------------------------*/
+/* reclaim.c                                                          */
+/* Author: Matthew Okechukwu, Pinrui Huang                            */
+/*--------------------------------------------------------------------*/
+
+/* pthread and sched_yield are POSIX extensions beyond ISO C */
+#define _XOPEN_SOURCE 600
+
+#include "reclaim.h"
+#include "epoch.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <sched.h>
+
+/*--------------------------------------------------------------------*/
+
+/* One item awaiting the worker. */
+
+struct ReclaimItem
+{
+   /* The function that frees the item, and the item itself. */
+   void (*pfFree)(void *pvItem);
+   void *pvItem;
+
+   /* The item's weight, as given to Reclaim_defer. */
+   size_t uWeight;
+
+   /* 1 (TRUE) if readers without locks might still see the item. */
+   int bRetire;
+
+   /* The next item in the queue. */
+   struct ReclaimItem *psNext;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Guards everything below except uPending. */
+static pthread_mutex_t sLock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Signalled when an item is queued. */
+static pthread_cond_t sQueued = PTHREAD_COND_INITIALIZER;
+
+/* Signalled when the worker has freed an item. */
+static pthread_cond_t sFreed = PTHREAD_COND_INITIALIZER;
+
+/* The queue of items, oldest first, and its last item. */
+static struct ReclaimItem *psFirst;
+static struct ReclaimItem *psLast;
+
+/* The number of items ever queued, and the number freed since; an
+   item is done once uDone passes its place in the queue. */
+static size_t uQueued;
+static size_t uDone;
+
+/* 1 (TRUE) once the worker thread is running. */
+static int bStarted;
+
+/* The total weight of the items not yet freed, which
+   Reclaim_getPending reads without sLock. */
+static size_t uPending;
+
+/*--------------------------------------------------------------------*/
+
+/* Free psItem and the item it holds, waiting out the readers, if
+   any, of anything the item releases to Epoch_release. */
+
+static void Reclaim_freeItem(struct ReclaimItem *psItem)
+{
+   assert(psItem != NULL);
+
+   if (! psItem->bRetire)
+      (*psItem->pfFree)(psItem->pvItem);
+   else
+   {
+      /* Freeing at once could pull memory out from under readers, so
+         wait for the bookkeeping to be available instead. */
+      while (! Epoch_beginRetire())
+         (void)sched_yield();
+      (*psItem->pfFree)(psItem->pvItem);
+      Epoch_endRetire();
+      /* This thread may not retire again for a long time, so free
+         the item now rather than at its next change. */
+      Epoch_flush();
+   }
+
+   (void)__atomic_sub_fetch(&uPending, psItem->uWeight,
+                            __ATOMIC_RELAXED);
+   free(psItem);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* The worker thread: free queued items, oldest first, forever.
+   pvUnused is unused. */
+
+static void *Reclaim_work(void *pvUnused)
+{
+   struct ReclaimItem *psItem;
+
+   (void)pvUnused;
+
+   (void)pthread_mutex_lock(&sLock);
+   for (;;)
+   {
+      while (psFirst == NULL)
+         (void)pthread_cond_wait(&sQueued, &sLock);
+      psItem = psFirst;
+      psFirst = psItem->psNext;
+      if (psFirst == NULL)
+         psLast = NULL;
+      (void)pthread_mutex_unlock(&sLock);
+
+      Reclaim_freeItem(psItem);
+
+      (void)pthread_mutex_lock(&sLock);
+      uDone++;
+      (void)pthread_cond_broadcast(&sFreed);
+   }
+
+   /* not reached */
+   return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Start the worker thread if it is not yet running.  sLock must be
+   held.  Return 1 (TRUE) if it is running, or 0 (FALSE) if it could
+   not be started. */
+
+static int Reclaim_start(void)
+{
+   pthread_t sThread;
+
+   if (bStarted)
+      return 1;
+   if (pthread_create(&sThread, NULL, Reclaim_work, NULL) != 0)
+      return 0;
+   (void)pthread_detach(sThread);
+   bStarted = 1;
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+int Reclaim_defer(void (*pfFree)(void *pvItem), void *pvItem,
+                  size_t uWeight, int bRetire)
+{
+   struct ReclaimItem *psItem;
+
+   assert(pfFree != NULL);
+
+   psItem = (struct ReclaimItem*)malloc(sizeof(struct ReclaimItem));
+   if (psItem == NULL)
+      return 0;
+   psItem->pfFree = pfFree;
+   psItem->pvItem = pvItem;
+   psItem->uWeight = uWeight;
+   psItem->bRetire = bRetire;
+   psItem->psNext = NULL;
+
+   (void)pthread_mutex_lock(&sLock);
+   if (! Reclaim_start())
+   {
+      (void)pthread_mutex_unlock(&sLock);
+      free(psItem);
+      return 0;
+   }
+   (void)__atomic_add_fetch(&uPending, uWeight, __ATOMIC_RELAXED);
+   if (psLast == NULL)
+      psFirst = psItem;
+   else
+      psLast->psNext = psItem;
+   psLast = psItem;
+   uQueued++;
+   (void)pthread_cond_signal(&sQueued);
+   (void)pthread_mutex_unlock(&sLock);
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t Reclaim_getPending(void)
+{
+   return __atomic_load_n(&uPending, __ATOMIC_RELAXED);
+}
+
+/*--------------------------------------------------------------------*/
+
+void Reclaim_wait(void)
+{
+   size_t uTarget;
+
+   (void)pthread_mutex_lock(&sLock);
+   uTarget = uQueued;
+   while (uDone < uTarget)
+      (void)pthread_cond_wait(&sFreed, &sLock);
+   (void)pthread_mutex_unlock(&sLock);
+}
@@ -0,0 +1,45 @@
+/*--------------------------------------------------------------------*/
+/* reclaim.h                                                          */
+/* Author: Matthew Okechukwu, Pinrui Huang                            */
+/*--------------------------------------------------------------------*/
+
+#ifndef RECLAIM_INCLUDED
+#define RECLAIM_INCLUDED
+
+#include <stddef.h>
+
+/* Background reclamation frees large structures off the caller's
+   thread.  A caller that has detached a structure from everything
+   that can reach it hands it to Reclaim_defer instead of freeing it,
+   and a single worker thread, started on first use, frees it later.
+   An item that readers without locks might still see is freed
+   between Epoch_beginRetire and Epoch_endRetire, so that memory it
+   gives to Epoch_release still waits for them; any other item is
+   freed at once. */
+
+/*--------------------------------------------------------------------*/
+
+/* Arrange for (*pfFree)(pvItem) to be called on the worker thread,
+   counting uWeight towards Reclaim_getPending until it returns.
+   bRetire is 1 (TRUE) if readers without locks might still see
+   pvItem, and 0 (FALSE) otherwise.  Return 1 (TRUE) if successful, or
+   0 (FALSE) if insufficient memory is available or the worker thread
+   could not be started, in which case the caller must free pvItem
+   itself. */
+
+int Reclaim_defer(void (*pfFree)(void *pvItem), void *pvItem,
+                  size_t uWeight, int bRetire);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the total weight of the items deferred but not yet freed. */
+
+size_t Reclaim_getPending(void);
+
+/*--------------------------------------------------------------------*/
+
+/* Wait until every item deferred before the call has been freed. */
+
+void Reclaim_wait(void);
+
+#endif
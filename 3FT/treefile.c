@@ -0,0 +1,421 @@
+/*--------------------------------------------------------------------*/
+/* treefile.c                                                         */
+/* Author: Matthew Okechukwu, Pinrui Huang                            */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "treefile.h"
+
+/* The string that begins every save file */
+static const char acMagic[8] =
+   { '3', 'F', 'T', 'S', 'A', 'V', 'E', '\n' };
+
+/* The version of the format that this module writes and reads */
+enum { VERSION = 1 };
+
+/* The header flags for a file whose files' contents are stored, and
+   for one whose header goes on to give a tag */
+enum { FLAG_CONTENTS = 1, FLAG_TAG = 2 };
+
+/* The kinds of node, as stored in each node's first byte */
+enum { KIND_DIRECTORY, KIND_FILE, KIND_FILE_CONTENTS };
+
+/* The number of bytes moved to or from the disk at a time */
+enum { BUFFER_LENGTH = 1 << 20 };
+
+/* The most bytes that a stored size_t can take */
+enum { MAX_NUMBER_LENGTH = (sizeof(size_t) * 8 + 6) / 7 };
+
+/* A save file, open for writing or for reading */
+struct TreeFile {
+   /* the file itself, unbuffered, since this module buffers */
+   FILE *psFile;
+   /* TRUE if the file was created for writing */
+   boolean bWriting;
+   /* TRUE if files' contents are stored */
+   boolean bContents;
+   /* the tag given at creation, or 0 if none */
+   size_t ulTag;
+   /* when writing, the number of bytes written so far */
+   size_t ulLength;
+   /* BUFFER_LENGTH bytes: when writing, those not yet written, and
+      when reading, those read but not yet consumed */
+   unsigned char *pucBuffer;
+   /* the offsets in pucBuffer of the first byte held and past the
+      last */
+   size_t ulStart;
+   size_t ulEnd;
+   /* SUCCESS, or IO_ERROR once a write has failed */
+   int iStatus;
+   /* when reading, the last node's name, and the room for it */
+   char *pcName;
+   size_t ulNameRoom;
+};
+
+/*
+  Allocates a TreeFile for psFile, to write if bWriting, setting
+  *poTreeFile to it. Returns SUCCESS, or MEMORY_ERROR, in which case
+  psFile is closed and *poTreeFile set to NULL.
+*/
+static int TreeFile_wrap(FILE *psFile, boolean bWriting,
+                         TreeFile_T *poTreeFile) {
+   TreeFile_T oTreeFile;
+
+   assert(psFile != NULL);
+   assert(poTreeFile != NULL);
+
+   *poTreeFile = NULL;
+   oTreeFile = malloc(sizeof(struct TreeFile));
+   if(oTreeFile == NULL) {
+      fclose(psFile);
+      return MEMORY_ERROR;
+   }
+   oTreeFile->pucBuffer = malloc(BUFFER_LENGTH);
+   if(oTreeFile->pucBuffer == NULL) {
+      free(oTreeFile);
+      fclose(psFile);
+      return MEMORY_ERROR;
+   }
+   (void) setvbuf(psFile, NULL, _IONBF, 0);
+   oTreeFile->psFile = psFile;
+   oTreeFile->bWriting = bWriting;
+   oTreeFile->bContents = FALSE;
+   oTreeFile->ulTag = 0;
+   oTreeFile->ulLength = 0;
+   oTreeFile->ulStart = 0;
+   oTreeFile->ulEnd = 0;
+   oTreeFile->iStatus = SUCCESS;
+   oTreeFile->pcName = NULL;
+   oTreeFile->ulNameRoom = 0;
+   *poTreeFile = oTreeFile;
+   return SUCCESS;
+}
+
+/*
+  Writes out the bytes held in oTreeFile's buffer, recording any
+  failure in oTreeFile->iStatus.
+*/
+static void TreeFile_flush(TreeFile_T oTreeFile) {
+   assert(oTreeFile != NULL);
+
+   if(oTreeFile->ulEnd > 0 &&
+      fwrite(oTreeFile->pucBuffer, 1, oTreeFile->ulEnd,
+             oTreeFile->psFile) != oTreeFile->ulEnd)
+      oTreeFile->iStatus = IO_ERROR;
+   oTreeFile->ulEnd = 0;
+}
+
+/*
+  Appends the ulLength bytes at pvBytes to oTreeFile. Runs of a
+  buffer's length or more go straight to the file.
+*/
+static void TreeFile_putBytes(TreeFile_T oTreeFile, const void *pvBytes,
+                              size_t ulLength) {
+   assert(oTreeFile != NULL);
+   assert(pvBytes != NULL || ulLength == 0);
+
+   oTreeFile->ulLength += ulLength;
+   if(oTreeFile->ulEnd + ulLength > BUFFER_LENGTH)
+      TreeFile_flush(oTreeFile);
+   if(ulLength >= BUFFER_LENGTH) {
+      if(fwrite(pvBytes, 1, ulLength, oTreeFile->psFile) != ulLength)
+         oTreeFile->iStatus = IO_ERROR;
+      return;
+   }
+   memcpy(oTreeFile->pucBuffer + oTreeFile->ulEnd, pvBytes, ulLength);
+   oTreeFile->ulEnd += ulLength;
+}
+
+/* Appends ulNumber to oTreeFile in 7-bit groups */
+static void TreeFile_putNumber(TreeFile_T oTreeFile, size_t ulNumber) {
+   unsigned char aucBytes[MAX_NUMBER_LENGTH];
+   size_t ulLength = 0;
+
+   assert(oTreeFile != NULL);
+
+   while(ulNumber >= 0x80) {
+      aucBytes[ulLength++] = (unsigned char) ((ulNumber & 0x7f) | 0x80);
+      ulNumber >>= 7;
+   }
+   aucBytes[ulLength++] = (unsigned char) ulNumber;
+   TreeFile_putBytes(oTreeFile, aucBytes, ulLength);
+}
+
+/*
+  Reads more of oTreeFile into its buffer, after the bytes it still
+  holds, which move to the front. Returns the number of bytes held.
+*/
+static size_t TreeFile_fill(TreeFile_T oTreeFile) {
+   size_t ulHeld;
+
+   assert(oTreeFile != NULL);
+
+   ulHeld = oTreeFile->ulEnd - oTreeFile->ulStart;
+   memmove(oTreeFile->pucBuffer,
+           oTreeFile->pucBuffer + oTreeFile->ulStart, ulHeld);
+   oTreeFile->ulStart = 0;
+   ulHeld += fread(oTreeFile->pucBuffer + ulHeld, 1,
+                   BUFFER_LENGTH - ulHeld, oTreeFile->psFile);
+   oTreeFile->ulEnd = ulHeld;
+   return ulHeld;
+}
+
+/*
+  Reads the next ulLength bytes of oTreeFile into pvBytes. Runs
+  longer than what the buffer holds are read straight from the file.
+  Returns SUCCESS, or IO_ERROR if the file ends first or cannot be
+  read.
+*/
+static int TreeFile_getBytes(TreeFile_T oTreeFile, void *pvBytes,
+                             size_t ulLength) {
+   size_t ulHeld;
+
+   assert(oTreeFile != NULL);
+   assert(pvBytes != NULL || ulLength == 0);
+
+   ulHeld = oTreeFile->ulEnd - oTreeFile->ulStart;
+   if(ulLength > ulHeld && ulLength < BUFFER_LENGTH / 2)
+      ulHeld = TreeFile_fill(oTreeFile);
+   if(ulLength <= ulHeld) {
+      memcpy(pvBytes, oTreeFile->pucBuffer + oTreeFile->ulStart,
+             ulLength);
+      oTreeFile->ulStart += ulLength;
+      return SUCCESS;
+   }
+
+   memcpy(pvBytes, oTreeFile->pucBuffer + oTreeFile->ulStart, ulHeld);
+   oTreeFile->ulStart = oTreeFile->ulEnd = 0;
+   if(fread((char *) pvBytes + ulHeld, 1, ulLength - ulHeld,
+            oTreeFile->psFile) != ulLength - ulHeld)
+      return IO_ERROR;
+   return SUCCESS;
+}
+
+/*
+  Reads a number stored in 7-bit groups from oTreeFile into
+  *pulNumber. Returns SUCCESS, or IO_ERROR if the file ends first or
+  the number does not fit in a size_t.
+*/
+static int TreeFile_getNumber(TreeFile_T oTreeFile, size_t *pulNumber) {
+   unsigned char ucByte;
+   size_t ulNumber = 0;
+   size_t ulShift;
+
+   assert(oTreeFile != NULL);
+   assert(pulNumber != NULL);
+
+   for(ulShift = 0; ulShift < sizeof(size_t) * 8; ulShift += 7) {
+      if(TreeFile_getBytes(oTreeFile, &ucByte, 1) != SUCCESS)
+         return IO_ERROR;
+      if(ulShift > 0 &&
+         ((size_t) (ucByte & 0x7f) << ulShift) >> ulShift !=
+         (size_t) (ucByte & 0x7f))
+         return IO_ERROR;
+      ulNumber |= (size_t) (ucByte & 0x7f) << ulShift;
+      if((ucByte & 0x80) == 0) {
+         *pulNumber = ulNumber;
+         return SUCCESS;
+      }
+   }
+   return IO_ERROR;
+}
+
+int TreeFile_create(const char *pcFile, boolean bContents,
+                    size_t ulTag, TreeFile_T *poTreeFile) {
+   FILE *psFile;
+   int iStatus;
+
+   assert(pcFile != NULL);
+   assert(poTreeFile != NULL);
+
+   *poTreeFile = NULL;
+   psFile = fopen(pcFile, "wb");
+   if(psFile == NULL)
+      return IO_ERROR;
+   iStatus = TreeFile_wrap(psFile, TRUE, poTreeFile);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   (*poTreeFile)->bContents = bContents;
+   (*poTreeFile)->ulTag = ulTag;
+   TreeFile_putBytes(*poTreeFile, acMagic, sizeof(acMagic));
+   TreeFile_putNumber(*poTreeFile, VERSION);
+   TreeFile_putNumber(*poTreeFile, (bContents ? FLAG_CONTENTS : 0) |
+                                   (ulTag != 0 ? FLAG_TAG : 0));
+   if(ulTag != 0)
+      TreeFile_putNumber(*poTreeFile, ulTag);
+   return SUCCESS;
+}
+
+int TreeFile_write(TreeFile_T oTreeFile,
+                   const struct TreeFileNode *psNode) {
+   unsigned char ucKind;
+
+   assert(oTreeFile != NULL);
+   assert(oTreeFile->bWriting);
+   assert(psNode != NULL);
+   assert(psNode->pcName != NULL);
+
+   if(!psNode->bIsFile)
+      ucKind = KIND_DIRECTORY;
+   else if(oTreeFile->bContents && psNode->pvContents != NULL)
+      ucKind = KIND_FILE_CONTENTS;
+   else
+      ucKind = KIND_FILE;
+
+   TreeFile_putBytes(oTreeFile, &ucKind, 1);
+   TreeFile_putNumber(oTreeFile, psNode->ulNameLength);
+   TreeFile_putBytes(oTreeFile, psNode->pcName, psNode->ulNameLength);
+   if(ucKind == KIND_DIRECTORY) {
+      TreeFile_putNumber(oTreeFile, psNode->ulNumFiles);
+      TreeFile_putNumber(oTreeFile, psNode->ulNumDirectories);
+   }
+   else {
+      TreeFile_putNumber(oTreeFile, psNode->ulSize);
+      if(ucKind == KIND_FILE_CONTENTS)
+         TreeFile_putBytes(oTreeFile, psNode->pvContents,
+                           psNode->ulSize);
+   }
+   return oTreeFile->iStatus;
+}
+
+size_t TreeFile_getLength(TreeFile_T oTreeFile) {
+   assert(oTreeFile != NULL);
+   assert(oTreeFile->bWriting);
+
+   return oTreeFile->ulLength;
+}
+
+int TreeFile_open(const char *pcFile, TreeFile_T *poTreeFile) {
+   FILE *psFile;
+   char acRead[sizeof(acMagic)];
+   size_t ulVersion;
+   size_t ulFlags;
+   int iStatus;
+
+   assert(pcFile != NULL);
+   assert(poTreeFile != NULL);
+
+   *poTreeFile = NULL;
+   psFile = fopen(pcFile, "rb");
+   if(psFile == NULL)
+      return IO_ERROR;
+   iStatus = TreeFile_wrap(psFile, FALSE, poTreeFile);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   if(TreeFile_getBytes(*poTreeFile, acRead, sizeof(acRead))
+      != SUCCESS ||
+      memcmp(acRead, acMagic, sizeof(acMagic)) != 0 ||
+      TreeFile_getNumber(*poTreeFile, &ulVersion) != SUCCESS ||
+      ulVersion != VERSION ||
+      TreeFile_getNumber(*poTreeFile, &ulFlags) != SUCCESS ||
+      (ulFlags & ~(size_t) (FLAG_CONTENTS | FLAG_TAG)) != 0 ||
+      ((ulFlags & FLAG_TAG) != 0 &&
+       TreeFile_getNumber(*poTreeFile, &(*poTreeFile)->ulTag)
+       != SUCCESS)) {
+      (void) TreeFile_close(*poTreeFile);
+      *poTreeFile = NULL;
+      return IO_ERROR;
+   }
+   (*poTreeFile)->bContents =
+      (boolean) ((ulFlags & FLAG_CONTENTS) != 0);
+   return SUCCESS;
+}
+
+size_t TreeFile_getTag(TreeFile_T oTreeFile) {
+   assert(oTreeFile != NULL);
+
+   return oTreeFile->ulTag;
+}
+
+int TreeFile_read(TreeFile_T oTreeFile, struct TreeFileNode *psNode) {
+   unsigned char ucKind;
+   char *pcGrown;
+   size_t ulLength;
+
+   assert(oTreeFile != NULL);
+   assert(!oTreeFile->bWriting);
+   assert(psNode != NULL);
+
+   /* a clean end comes only where a node would begin */
+   if(oTreeFile->ulStart == oTreeFile->ulEnd &&
+      TreeFile_fill(oTreeFile) == 0)
+      return ferror(oTreeFile->psFile) ? IO_ERROR : NO_SUCH_PATH;
+   if(TreeFile_getBytes(oTreeFile, &ucKind, 1) != SUCCESS ||
+      ucKind > KIND_FILE_CONTENTS ||
+      (ucKind == KIND_FILE_CONTENTS && !oTreeFile->bContents))
+      return IO_ERROR;
+
+   /* a name is one whole, nonempty path component */
+   if(TreeFile_getNumber(oTreeFile, &ulLength) != SUCCESS ||
+      ulLength == 0)
+      return IO_ERROR;
+   if(ulLength >= oTreeFile->ulNameRoom) {
+      pcGrown = realloc(oTreeFile->pcName, ulLength * 2 + 1);
+      if(pcGrown == NULL)
+         return MEMORY_ERROR;
+      oTreeFile->pcName = pcGrown;
+      oTreeFile->ulNameRoom = ulLength * 2 + 1;
+   }
+   if(TreeFile_getBytes(oTreeFile, oTreeFile->pcName, ulLength)
+      != SUCCESS)
+      return IO_ERROR;
+   oTreeFile->pcName[ulLength] = '\0';
+   if(strlen(oTreeFile->pcName) != ulLength ||
+      memchr(oTreeFile->pcName, '/', ulLength) != NULL)
+      return IO_ERROR;
+
+   psNode->pcName = oTreeFile->pcName;
+   psNode->ulNameLength = ulLength;
+   psNode->bIsFile = (boolean) (ucKind != KIND_DIRECTORY);
+   psNode->ulSize = 0;
+   psNode->pvContents = NULL;
+   psNode->ulNumFiles = 0;
+   psNode->ulNumDirectories = 0;
+
+   if(ucKind == KIND_DIRECTORY) {
+      if(TreeFile_getNumber(oTreeFile, &psNode->ulNumFiles)
+         != SUCCESS ||
+         TreeFile_getNumber(oTreeFile, &psNode->ulNumDirectories)
+         != SUCCESS)
+         return IO_ERROR;
+      return SUCCESS;
+   }
+   if(TreeFile_getNumber(oTreeFile, &psNode->ulSize) != SUCCESS)
+      return IO_ERROR;
+   if(ucKind == KIND_FILE_CONTENTS) {
+      /* an empty file still gets a block, to tell it from none */
+      psNode->pvContents = malloc(psNode->ulSize > 0 ? psNode->ulSize
+                                                     : 1);
+      if(psNode->pvContents == NULL)
+         return MEMORY_ERROR;
+      if(TreeFile_getBytes(oTreeFile, psNode->pvContents,
+                           psNode->ulSize) != SUCCESS) {
+         free(psNode->pvContents);
+         psNode->pvContents = NULL;
+         return IO_ERROR;
+      }
+   }
+   return SUCCESS;
+}
+
+int TreeFile_close(TreeFile_T oTreeFile) {
+   int iStatus;
+
+   assert(oTreeFile != NULL);
+
+   if(oTreeFile->bWriting)
+      TreeFile_flush(oTreeFile);
+   iStatus = oTreeFile->iStatus;
+   if(fclose(oTreeFile->psFile) != 0 && oTreeFile->bWriting)
+      iStatus = IO_ERROR;
+   free(oTreeFile->pcName);
+   free(oTreeFile->pucBuffer);
+   free(oTreeFile);
+   return iStatus;
+}
@@ -0,0 +1,112 @@
+/*--------------------------------------------------------------------*/
+/* treefile.h                                                         */
+/* Author: Matthew Okechukwu, Pinrui Huang                            */
+/*--------------------------------------------------------------------*/
+
+#ifndef TREEFILE_INCLUDED
+#define TREEFILE_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+
+/*
+  A TreeFile_T is a save file of a whole tree, open either for
+  writing or for reading, one node at a time. The file begins with a
+  magic string and a version, and then lists the nodes in preorder:
+  each directory, then its files, then each of its directories'
+  subtrees, each group in the order given. A node is stored as its
+  kind, its name (the final component of its path, not the whole
+  path), and then, for a file, its size and, if the file was created
+  to hold them, its contents, or, for a directory, its number of file
+  and directory children. Numbers are stored in 7-bit groups, least
+  significant first, so that small ones take a byte and the format
+  does not depend on the machine. The header may also hold a tag, a
+  number that the creator chooses to tell one save of a tree from
+  another.
+*/
+typedef struct TreeFile *TreeFile_T;
+
+/* One node of a save file */
+struct TreeFileNode {
+   /* the node's name, which need not be '\0'-terminated when written
+      but is when read */
+   const char *pcName;
+   /* the number of characters in pcName */
+   size_t ulNameLength;
+   /* TRUE if the node is a file, FALSE if a directory */
+   boolean bIsFile;
+   /* a file's size in bytes */
+   size_t ulSize;
+   /* a file's contents, ulSize bytes, or NULL if there are none to
+      store or none were stored */
+   void *pvContents;
+   /* a directory's number of file children */
+   size_t ulNumFiles;
+   /* a directory's number of directory children */
+   size_t ulNumDirectories;
+};
+
+/*
+  Creates the save file pcFile, replacing any file of that name, to
+  hold contents as well as sizes if bContents, tagged with ulTag
+  unless it is 0. Returns SUCCESS and sets *poTreeFile to it if
+  successful. Otherwise, sets *poTreeFile to NULL and returns status:
+  * IO_ERROR if pcFile could not be created
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int TreeFile_create(const char *pcFile, boolean bContents,
+                    size_t ulTag, TreeFile_T *poTreeFile);
+
+/*
+  Appends *psNode, the next node in preorder, to oTreeFile, which
+  TreeFile_create opened. Writes go through a large buffer, so an
+  error may only be found by a later call or by TreeFile_close.
+  Returns SUCCESS, or IO_ERROR if writing failed.
+*/
+int TreeFile_write(TreeFile_T oTreeFile,
+                   const struct TreeFileNode *psNode);
+
+/*
+  Returns the number of bytes written to oTreeFile, which
+  TreeFile_create opened, so far, counting those still buffered.
+*/
+size_t TreeFile_getLength(TreeFile_T oTreeFile);
+
+/*
+  Opens the save file pcFile for reading. Returns SUCCESS and sets
+  *poTreeFile to it if successful. Otherwise, sets *poTreeFile to NULL
+  and returns status:
+  * IO_ERROR if pcFile could not be opened or read, or is not a save
+             file of a version this module reads
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int TreeFile_open(const char *pcFile, TreeFile_T *poTreeFile);
+
+/*
+  Returns the tag of oTreeFile, which TreeFile_open opened, or 0 if it
+  has none.
+*/
+size_t TreeFile_getTag(TreeFile_T oTreeFile);
+
+/*
+  Reads the next node of oTreeFile, which TreeFile_open opened, into
+  *psNode. Its name is '\0'-terminated and stays valid until the next
+  call on oTreeFile; its contents, if stored, are in a new block from
+  malloc, which the caller then owns. Returns SUCCESS, or:
+  * NO_SUCH_PATH if every node has been read
+  * IO_ERROR if reading failed or the file is malformed or cut short
+  * MEMORY_ERROR if memory could not be allocated to complete request
+  Whether every node has been read is a matter of the tree's shape,
+  which only the caller tracks, so NO_SUCH_PATH means only that the
+  file ends cleanly between nodes.
+*/
+int TreeFile_read(TreeFile_T oTreeFile, struct TreeFileNode *psNode);
+
+/*
+  Closes oTreeFile, flushing what was written to it, and frees it.
+  Returns SUCCESS, or IO_ERROR if a write since TreeFile_create failed
+  or the flush did.
+*/
+int TreeFile_close(TreeFile_T oTreeFile);
+
+#endif
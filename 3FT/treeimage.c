@@ -0,0 +1,654 @@
+/*--------------------------------------------------------------------*/
+/* treeimage.c                                                        */
+/* Author: Matthew Okechukwu, Pinrui Huang                            */
+/*--------------------------------------------------------------------*/
+
+/* open, fstat and mmap are POSIX extensions beyond ISO C */
+#define _XOPEN_SOURCE 600
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "treeimage.h"
+
+/* The string that begins every image */
+static const char acMagic[8] =
+   { '3', 'F', 'T', 'I', 'M', 'A', 'G', 'E' };
+
+/* The version of the format that this module writes and reads */
+enum { VERSION = 1 };
+
+/* The size of a stored word, to which every record is aligned */
+enum { WORD = sizeof(size_t) };
+
+/* The number of bytes that stdio gathers before writing an image */
+enum { BUFFER_LENGTH = 1 << 20 };
+
+/* The start of an image */
+struct TreeImageHeader {
+   /* acMagic */
+   char acMagic[8];
+   /* VERSION */
+   size_t ulVersion;
+   /* WORD on the machine that wrote the image */
+   size_t ulWordSize;
+   /* the number of bytes in the whole image */
+   size_t ulLength;
+   /* the offset of the root's record, or 0 if there are no nodes */
+   size_t ulRoot;
+};
+
+/* A node, as stored; each offset is from the start of the image */
+struct TreeImageRecord {
+   /* 1 for a file, 0 for a directory */
+   size_t ulIsFile;
+   /* the offset of the name, which is followed by '\0', and its
+      number of characters */
+   size_t ulName;
+   size_t ulNameLength;
+   /* a file's size, and the offset of its contents, or 0 if none */
+   size_t ulSize;
+   size_t ulContents;
+   /* the offsets of a directory's arrays of child offsets, and their
+      numbers of entries */
+   size_t ulFiles;
+   size_t ulNumFiles;
+   size_t ulDirectories;
+   size_t ulNumDirectories;
+};
+
+/* An image, being written or mapped for reading */
+struct TreeImage {
+   /* while writing, the file, or NULL once mapped */
+   FILE *psFile;
+   /* while writing, the number of bytes written so far, or once
+      mapped, the number of bytes in the image */
+   size_t ulLength;
+   /* while writing, SUCCESS, or IO_ERROR once a write has failed */
+   int iStatus;
+   /* once mapped, the first byte of the image */
+   const unsigned char *pucBase;
+};
+
+/*
+  Appends the ulLength bytes at pvBytes to oImage, recording any
+  failure in oImage->iStatus.
+*/
+static void TreeImage_putBytes(TreeImage_T oImage, const void *pvBytes,
+                               size_t ulLength) {
+   assert(oImage != NULL);
+   assert(pvBytes != NULL || ulLength == 0);
+
+   if(ulLength > 0 &&
+      fwrite(pvBytes, 1, ulLength, oImage->psFile) != ulLength)
+      oImage->iStatus = IO_ERROR;
+   oImage->ulLength += ulLength;
+}
+
+/* Pads oImage with '\0's to the next multiple of WORD */
+static void TreeImage_align(TreeImage_T oImage) {
+   static const char acZeros[WORD] = { 0 };
+
+   assert(oImage != NULL);
+
+   if(oImage->ulLength % WORD != 0)
+      TreeImage_putBytes(oImage, acZeros,
+                         WORD - oImage->ulLength % WORD);
+}
+
+int TreeImage_create(const char *pcFile, TreeImage_T *poImage) {
+   TreeImage_T oImage;
+   struct TreeImageHeader sHeader;
+
+   assert(pcFile != NULL);
+   assert(poImage != NULL);
+
+   *poImage = NULL;
+   oImage = malloc(sizeof(struct TreeImage));
+   if(oImage == NULL)
+      return MEMORY_ERROR;
+   oImage->psFile = fopen(pcFile, "wb");
+   if(oImage->psFile == NULL) {
+      free(oImage);
+      return IO_ERROR;
+   }
+   (void) setvbuf(oImage->psFile, NULL, _IOFBF, BUFFER_LENGTH);
+   oImage->ulLength = 0;
+   oImage->iStatus = SUCCESS;
+   oImage->pucBase = NULL;
+
+   /* TreeImage_finish fills in the header once the root is known */
+   memset(&sHeader, 0, sizeof(sHeader));
+   TreeImage_putBytes(oImage, &sHeader, sizeof(sHeader));
+
+   *poImage = oImage;
+   return SUCCESS;
+}
+
+int TreeImage_add(TreeImage_T oImage,
+                  const struct TreeImageNode *psNode, size_t *pulNode) {
+   struct TreeImageRecord sRecord;
+
+   assert(oImage != NULL);
+   assert(oImage->psFile != NULL);
+   assert(psNode != NULL);
+   assert(psNode->pcName != NULL);
+   assert(pulNode != NULL);
+
+   memset(&sRecord, 0, sizeof(sRecord));
+   sRecord.ulIsFile = psNode->bIsFile ? 1 : 0;
+   sRecord.ulName = oImage->ulLength;
+   sRecord.ulNameLength = psNode->ulNameLength;
+   TreeImage_putBytes(oImage, psNode->pcName, psNode->ulNameLength);
+   TreeImage_putBytes(oImage, "", 1);
+   TreeImage_align(oImage);
+
+   if(psNode->bIsFile) {
+      sRecord.ulSize = psNode->ulSize;
+      if(psNode->pvContents != NULL) {
+         sRecord.ulContents = oImage->ulLength;
+         TreeImage_putBytes(oImage, psNode->pvContents, psNode->ulSize);
+         TreeImage_align(oImage);
+      }
+   }
+   else {
+      sRecord.ulFiles = oImage->ulLength;
+      sRecord.ulNumFiles = psNode->ulNumFiles;
+      TreeImage_putBytes(oImage, psNode->aulFiles,
+                         psNode->ulNumFiles * WORD);
+      sRecord.ulDirectories = oImage->ulLength;
+      sRecord.ulNumDirectories = psNode->ulNumDirectories;
+      TreeImage_putBytes(oImage, psNode->aulDirectories,
+                         psNode->ulNumDirectories * WORD);
+   }
+
+   *pulNode = oImage->ulLength;
+   TreeImage_putBytes(oImage, &sRecord, sizeof(sRecord));
+   if(oImage->iStatus != SUCCESS)
+      *pulNode = 0;
+   return oImage->iStatus;
+}
+
+int TreeImage_finish(TreeImage_T oImage, size_t ulRoot) {
+   struct TreeImageHeader sHeader;
+   int iStatus;
+
+   assert(oImage != NULL);
+   assert(oImage->psFile != NULL);
+
+   memset(&sHeader, 0, sizeof(sHeader));
+   memcpy(sHeader.acMagic, acMagic, sizeof(acMagic));
+   sHeader.ulVersion = VERSION;
+   sHeader.ulWordSize = WORD;
+   sHeader.ulLength = oImage->ulLength;
+   sHeader.ulRoot = ulRoot;
+
+   iStatus = oImage->iStatus;
+   if(fflush(oImage->psFile) != 0 ||
+      fseek(oImage->psFile, 0L, SEEK_SET) != 0 ||
+      fwrite(&sHeader, sizeof(sHeader), 1, oImage->psFile) != 1)
+      iStatus = IO_ERROR;
+   if(fclose(oImage->psFile) != 0)
+      iStatus = IO_ERROR;
+   free(oImage);
+   return iStatus;
+}
+
+/*
+  Returns TRUE if the ulLength bytes at offset ulOffset lie wholly
+  inside oImage.
+*/
+static boolean TreeImage_holds(TreeImage_T oImage, size_t ulOffset,
+                               size_t ulLength) {
+   assert(oImage != NULL);
+
+   return (boolean) (ulOffset <= oImage->ulLength &&
+                     ulLength <= oImage->ulLength - ulOffset);
+}
+
+/*
+  Returns TRUE if the array of ulNum offsets at offset ulArray lies
+  wholly inside oImage and is aligned.
+*/
+static boolean TreeImage_holdsArray(TreeImage_T oImage, size_t ulArray,
+                                    size_t ulNum) {
+   assert(oImage != NULL);
+
+   return (boolean) (ulArray % WORD == 0 &&
+                     ulNum <= oImage->ulLength / WORD &&
+                     TreeImage_holds(oImage, ulArray, ulNum * WORD));
+}
+
+int TreeImage_open(const char *pcFile, TreeImage_T *poImage) {
+   TreeImage_T oImage;
+   struct TreeImageHeader sHeader;
+   struct TreeImageNode sRoot;
+   struct stat sStat;
+   void *pvBase;
+   int iFd;
+
+   assert(pcFile != NULL);
+   assert(poImage != NULL);
+
+   *poImage = NULL;
+   oImage = malloc(sizeof(struct TreeImage));
+   if(oImage == NULL)
+      return MEMORY_ERROR;
+
+   iFd = open(pcFile, O_RDONLY);
+   if(iFd < 0) {
+      free(oImage);
+      return IO_ERROR;
+   }
+   if(fstat(iFd, &sStat) != 0 ||
+      sStat.st_size < (off_t) sizeof(struct TreeImageHeader) ||
+      (off_t) (size_t) sStat.st_size != sStat.st_size) {
+      (void) close(iFd);
+      free(oImage);
+      return IO_ERROR;
+   }
+   pvBase = mmap(NULL, (size_t) sStat.st_size, PROT_READ, MAP_SHARED,
+                 iFd, 0);
+   (void) close(iFd);
+   if(pvBase == MAP_FAILED) {
+      free(oImage);
+      return IO_ERROR;
+   }
+   oImage->psFile = NULL;
+   oImage->ulLength = (size_t) sStat.st_size;
+   oImage->iStatus = SUCCESS;
+   oImage->pucBase = pvBase;
+
+   /* the root alone is checked now; other nodes are as they are read */
+   memcpy(&sHeader, pvBase, sizeof(sHeader));
+   if(memcmp(sHeader.acMagic, acMagic, sizeof(acMagic)) != 0 ||
+      sHeader.ulVersion != VERSION || sHeader.ulWordSize != WORD ||
+      sHeader.ulLength != oImage->ulLength ||
+      (sHeader.ulRoot != 0 &&
+       (TreeImage_getNode(oImage, sHeader.ulRoot, &sRoot) != SUCCESS ||
+        sRoot.bIsFile))) {
+      TreeImage_close(oImage);
+      return IO_ERROR;
+   }
+
+   *poImage = oImage;
+   return SUCCESS;
+}
+
+size_t TreeImage_getRoot(TreeImage_T oImage) {
+   const struct TreeImageHeader *psHeader;
+
+   assert(oImage != NULL);
+   assert(oImage->pucBase != NULL);
+
+   psHeader = (const struct TreeImageHeader *) (const void *)
+      oImage->pucBase;
+   return psHeader->ulRoot;
+}
+
+int TreeImage_getNode(TreeImage_T oImage, size_t ulNode,
+                      struct TreeImageNode *psNode) {
+   const struct TreeImageRecord *psRecord;
+   const char *pcName;
+
+   assert(oImage != NULL);
+   assert(oImage->pucBase != NULL);
+   assert(psNode != NULL);
+
+   if(ulNode % WORD != 0 || ulNode < sizeof(struct TreeImageHeader) ||
+      !TreeImage_holds(oImage, ulNode, sizeof(struct TreeImageRecord)))
+      return IO_ERROR;
+   psRecord = (const struct TreeImageRecord *) (const void *)
+      (oImage->pucBase + ulNode);
+   if(psRecord->ulIsFile > 1 || psRecord->ulNameLength == 0 ||
+      !TreeImage_holds(oImage, psRecord->ulName,
+                       psRecord->ulNameLength) ||
+      !TreeImage_holds(oImage,
+                       psRecord->ulName + psRecord->ulNameLength, 1))
+      return IO_ERROR;
+   pcName = (const char *) oImage->pucBase + psRecord->ulName;
+   if(pcName[psRecord->ulNameLength] != '\0' ||
+      memchr(pcName, '\0', psRecord->ulNameLength) != NULL)
+      return IO_ERROR;
+
+   psNode->pcName = pcName;
+   psNode->ulNameLength = psRecord->ulNameLength;
+   psNode->bIsFile = (boolean) psRecord->ulIsFile;
+   psNode->ulSize = 0;
+   psNode->pvContents = NULL;
+   psNode->aulFiles = NULL;
+   psNode->ulNumFiles = 0;
+   psNode->aulDirectories = NULL;
+   psNode->ulNumDirectories = 0;
+
+   if(psNode->bIsFile) {
+      psNode->ulSize = psRecord->ulSize;
+      if(psRecord->ulContents != 0) {
+         if(!TreeImage_holds(oImage, psRecord->ulContents,
+                             psRecord->ulSize))
+            return IO_ERROR;
+         psNode->pvContents = oImage->pucBase + psRecord->ulContents;
+      }
+      return SUCCESS;
+   }
+
+   if(!TreeImage_holdsArray(oImage, psRecord->ulFiles,
+                            psRecord->ulNumFiles) ||
+      !TreeImage_holdsArray(oImage, psRecord->ulDirectories,
+                            psRecord->ulNumDirectories))
+      return IO_ERROR;
+   psNode->aulFiles = (const size_t *) (const void *)
+      (oImage->pucBase + psRecord->ulFiles);
+   psNode->ulNumFiles = psRecord->ulNumFiles;
+   psNode->aulDirectories = (const size_t *) (const void *)
+      (oImage->pucBase + psRecord->ulDirectories);
+   psNode->ulNumDirectories = psRecord->ulNumDirectories;
+   return SUCCESS;
+}
+
+/*
+  Searches the ulNum children of oImage at aulChildren, sorted by
+  name, for the one named by the ulLength characters at pcName, which
+  need not be '\0'-terminated. Sets *pulIndex to its index if found,
+  or else to the index of the first child whose name follows pcName.
+  Returns SUCCESS if found, NO_SUCH_PATH if not, or IO_ERROR if a
+  child is damaged.
+*/
+static int TreeImage_search(TreeImage_T oImage,
+                            const size_t *aulChildren, size_t ulNum,
+                            const char *pcName, size_t ulLength,
+                            size_t *pulIndex) {
+   struct TreeImageNode sChild;
+   size_t ulLow = 0;
+   size_t ulHigh = ulNum;
+   size_t ulMid;
+   int iCompare;
+   int iStatus;
+
+   assert(oImage != NULL);
+   assert(aulChildren != NULL || ulNum == 0);
+   assert(pcName != NULL);
+   assert(pulIndex != NULL);
+
+   while(ulLow < ulHigh) {
+      ulMid = ulLow + (ulHigh - ulLow) / 2;
+      iStatus = TreeImage_getNode(oImage, aulChildren[ulMid], &sChild);
+      if(iStatus != SUCCESS)
+         return iStatus;
+      iCompare = strncmp(sChild.pcName, pcName, ulLength);
+      if(iCompare == 0 && sChild.ulNameLength > ulLength)
+         iCompare = 1;
+      if(iCompare == 0) {
+         *pulIndex = ulMid;
+         return SUCCESS;
+      }
+      if(iCompare < 0)
+         ulLow = ulMid + 1;
+      else
+         ulHigh = ulMid;
+   }
+   *pulIndex = ulLow;
+   return NO_SUCH_PATH;
+}
+
+int TreeImage_find(TreeImage_T oImage, const char *pcPath,
+                   struct TreeImageNode *psNode) {
+   const char *pcStart;
+   const char *pcEnd;
+   size_t ulRoot;
+   size_t ulIndex;
+   int iStatus;
+
+   assert(oImage != NULL);
+   assert(oImage->pucBase != NULL);
+   assert(pcPath != NULL);
+   assert(psNode != NULL);
+
+   ulRoot = TreeImage_getRoot(oImage);
+   if(ulRoot == 0)
+      return NO_SUCH_PATH;
+
+   /* the first component must name the root */
+   iStatus = TreeImage_getNode(oImage, ulRoot, psNode);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   pcEnd = strchr(pcPath, '/');
+   if(pcEnd == NULL)
+      pcEnd = pcPath + strlen(pcPath);
+   if(psNode->ulNameLength != (size_t) (pcEnd - pcPath) ||
+      strncmp(psNode->pcName, pcPath, psNode->ulNameLength) != 0)
+      return CONFLICTING_PATH;
+
+   /* each later component must name a directory child of the
+      previous one, except that the last may name a file */
+   while(*pcEnd != '\0') {
+      if(psNode->bIsFile)
+         return NO_SUCH_PATH;
+      pcStart = pcEnd + 1;
+      pcEnd = pcStart;
+      while(*pcEnd != '/' && *pcEnd != '\0')
+         pcEnd++;
+      iStatus = TreeImage_search(oImage, psNode->aulDirectories,
+                                 psNode->ulNumDirectories, pcStart,
+                                 (size_t) (pcEnd - pcStart), &ulIndex);
+      if(iStatus == SUCCESS)
+         iStatus = TreeImage_getNode(oImage,
+                                     psNode->aulDirectories[ulIndex],
+                                     psNode);
+      else if(iStatus == NO_SUCH_PATH && *pcEnd == '\0') {
+         iStatus = TreeImage_search(oImage, psNode->aulFiles,
+                                    psNode->ulNumFiles, pcStart,
+                                    (size_t) (pcEnd - pcStart),
+                                    &ulIndex);
+         if(iStatus == SUCCESS)
+            iStatus = TreeImage_getNode(oImage,
+                                        psNode->aulFiles[ulIndex],
+                                        psNode);
+      }
+      if(iStatus != SUCCESS)
+         return iStatus;
+   }
+   return SUCCESS;
+}
+
+/*
+  Sets *pulNext to the node of oImage that follows, in walk order,
+  the file (if bIsFile) or directory named by the ulLength characters
+  at pcName, which need not exist, in the directory on top of the
+  *pulDepth offsets at aulStack. Pops each directory that has nothing
+  left to follow, and sets *pulNext to 0 if the stack empties.
+  Returns SUCCESS, or IO_ERROR if a node is damaged.
+*/
+static int TreeImage_after(TreeImage_T oImage, const size_t *aulStack,
+                           size_t *pulDepth, const char *pcName,
+                           size_t ulLength, boolean bIsFile,
+                           size_t *pulNext) {
+   struct TreeImageNode sDir;
+   size_t ulChild;
+   int iStatus;
+
+   assert(oImage != NULL);
+   assert(pulDepth != NULL);
+   assert(aulStack != NULL || *pulDepth == 0);
+   assert(pcName != NULL);
+   assert(pulNext != NULL);
+
+   *pulNext = 0;
+   while(*pulDepth > 0) {
+      iStatus = TreeImage_getNode(oImage, aulStack[*pulDepth - 1],
+                                  &sDir);
+      if(iStatus != SUCCESS)
+         return iStatus;
+      if(bIsFile) {
+         iStatus = TreeImage_search(oImage, sDir.aulFiles,
+                                    sDir.ulNumFiles, pcName, ulLength,
+                                    &ulChild);
+         if(iStatus == IO_ERROR)
+            return iStatus;
+         if(iStatus == SUCCESS)
+            ulChild++;
+         if(ulChild < sDir.ulNumFiles) {
+            *pulNext = sDir.aulFiles[ulChild];
+            return SUCCESS;
+         }
+         /* files come first, so every directory follows */
+         ulChild = 0;
+      }
+      else {
+         iStatus = TreeImage_search(oImage, sDir.aulDirectories,
+                                    sDir.ulNumDirectories, pcName,
+                                    ulLength, &ulChild);
+         if(iStatus == IO_ERROR)
+            return iStatus;
+         if(iStatus == SUCCESS)
+            ulChild++;
+      }
+      if(ulChild < sDir.ulNumDirectories) {
+         *pulNext = sDir.aulDirectories[ulChild];
+         return SUCCESS;
+      }
+
+      /* the directory is done, so go on from it within its parent */
+      pcName = sDir.pcName;
+      ulLength = sDir.ulNameLength;
+      bIsFile = FALSE;
+      (*pulDepth)--;
+   }
+   return SUCCESS;
+}
+
+int TreeImage_next(TreeImage_T oImage, const char *pcToken,
+                   size_t *aulStack, size_t *pulDepth,
+                   size_t *pulNext) {
+   struct TreeImageNode sNode;
+   size_t ulDepth = 0;
+   size_t ulNext;
+   size_t ulIndex;
+   const char *pcStart;
+   const char *pcEnd;
+   boolean bTokenFile;
+   boolean bFile = FALSE;
+   int iStatus = SUCCESS;
+
+   assert(oImage != NULL);
+   assert(oImage->pucBase != NULL);
+   assert(pcToken != NULL);
+   assert(pulDepth != NULL);
+   assert(pulNext != NULL);
+
+   *pulDepth = 0;
+   *pulNext = 0;
+   ulNext = TreeImage_getRoot(oImage);
+   if(ulNext == 0)
+      return NO_SUCH_PATH;
+
+   if(pcToken[0] != '\0') {
+      assert(aulStack != NULL);
+      bTokenFile = (boolean) (pcToken[0] == 'F');
+      pcStart = pcToken + 1;
+      pcEnd = strchr(pcStart, '/');
+      if(pcEnd == NULL)
+         pcEnd = pcStart + strlen(pcStart);
+      iStatus = TreeImage_getNode(oImage, ulNext, &sNode);
+      if(iStatus != SUCCESS)
+         return iStatus;
+      /* a token from another tree ends the walk */
+      if(sNode.ulNameLength != (size_t) (pcEnd - pcStart) ||
+         strncmp(sNode.pcName, pcStart, sNode.ulNameLength) != 0)
+         return NO_SUCH_PATH;
+      aulStack[ulDepth++] = ulNext;
+
+      /* push the directories along the token's path that exist */
+      iStatus = SUCCESS;
+      while(*pcEnd != '\0') {
+         pcStart = pcEnd + 1;
+         pcEnd = pcStart;
+         while(*pcEnd != '/' && *pcEnd != '\0')
+            pcEnd++;
+         bFile = (boolean) (*pcEnd == '\0' && bTokenFile);
+         iStatus = TreeImage_search(oImage,
+                     bFile ? sNode.aulFiles : sNode.aulDirectories,
+                     bFile ? sNode.ulNumFiles : sNode.ulNumDirectories,
+                     pcStart, (size_t) (pcEnd - pcStart), &ulIndex);
+         if(iStatus != SUCCESS || bFile)
+            break;
+         ulNext = sNode.aulDirectories[ulIndex];
+         iStatus = TreeImage_getNode(oImage, ulNext, &sNode);
+         if(iStatus != SUCCESS)
+            return iStatus;
+         aulStack[ulDepth++] = ulNext;
+      }
+      if(iStatus == IO_ERROR)
+         return iStatus;
+
+      if(*pcEnd == '\0' && iStatus == SUCCESS && !bTokenFile &&
+         (sNode.ulNumFiles > 0 || sNode.ulNumDirectories > 0))
+         /* the token's directory is on top: enter it */
+         ulNext = sNode.ulNumFiles > 0 ? sNode.aulFiles[0]
+                                       : sNode.aulDirectories[0];
+      else {
+         if(*pcEnd == '\0' && iStatus == SUCCESS && !bFile) {
+            /* the token's directory is on top, and empty, or is the
+               root named as a file */
+            ulDepth--;
+            bFile = bTokenFile;
+         }
+         iStatus = TreeImage_after(oImage, aulStack, &ulDepth, pcStart,
+                                   (size_t) (pcEnd - pcStart), bFile,
+                                   &ulNext);
+         if(iStatus != SUCCESS)
+            return iStatus;
+         if(ulNext == 0)
+            return NO_SUCH_PATH;
+      }
+   }
+
+   *pulDepth = ulDepth;
+   *pulNext = ulNext;
+   return SUCCESS;
+}
+
+size_t TreeImage_getPath(TreeImage_T oImage, const size_t *aulStack,
+                         size_t ulDepth, size_t ulNode, char *pcBuf) {
+   struct TreeImageNode sNode;
+   size_t ulLength = 0;
+   size_t ul;
+   int iStatus;
+
+   assert(oImage != NULL);
+   assert(aulStack != NULL || ulDepth == 0);
+
+   for(ul = 0; ul <= ulDepth; ul++) {
+      if(ul > 0) {
+         if(pcBuf != NULL)
+            pcBuf[ulLength] = '/';
+         ulLength++;
+      }
+      iStatus = TreeImage_getNode(oImage,
+                                  ul < ulDepth ? aulStack[ul] : ulNode,
+                                  &sNode);
+      assert(iStatus == SUCCESS);
+      (void) iStatus;
+      if(pcBuf != NULL)
+         memcpy(pcBuf + ulLength, sNode.pcName, sNode.ulNameLength);
+      ulLength += sNode.ulNameLength;
+   }
+   if(pcBuf != NULL)
+      pcBuf[ulLength] = '\0';
+   return ulLength;
+}
+
+void TreeImage_close(TreeImage_T oImage) {
+   if(oImage == NULL)
+      return;
+   assert(oImage->pucBase != NULL);
+
+   (void) munmap((void *) oImage->pucBase, oImage->ulLength);
+   free(oImage);
+}
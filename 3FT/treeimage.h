@@ -0,0 +1,147 @@
+/*--------------------------------------------------------------------*/
+/* treeimage.h                                                        */
+/* Author: Matthew Okechukwu, Pinrui Huang                            */
+/*--------------------------------------------------------------------*/
+
+#ifndef TREEIMAGE_INCLUDED
+#define TREEIMAGE_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+
+/*
+  A TreeImage_T is an image of a whole tree, being written or else
+  mapped into memory for reading. Unlike a save file (see
+  treefile.h), an image is read where it lies, with no parsing: each
+  node is a record of machine words at some offset in the file, and
+  refers to its name, its contents and its children by their offsets
+  rather than by pointers, so every process that maps the image
+  shares the one copy of it in the page cache. A directory's children
+  are two arrays of offsets, files and directories, each sorted by
+  name, so that a child is found by binary search. Children are
+  written before their parents, and a header at the start gives the
+  root's offset. Since words are stored as the machine holds them,
+  an image is read only on machines like the one that wrote it.
+  A node is named by its offset, which is never 0.
+*/
+typedef struct TreeImage *TreeImage_T;
+
+/* One node of an image */
+struct TreeImageNode {
+   /* the node's name, '\0'-terminated when read */
+   const char *pcName;
+   /* the number of characters in pcName */
+   size_t ulNameLength;
+   /* TRUE if the node is a file, FALSE if a directory */
+   boolean bIsFile;
+   /* a file's size in bytes */
+   size_t ulSize;
+   /* a file's contents, ulSize bytes, or NULL if there are none */
+   const void *pvContents;
+   /* a directory's file children, sorted by name, and their number */
+   const size_t *aulFiles;
+   size_t ulNumFiles;
+   /* a directory's directory children, sorted by name, and their
+      number */
+   const size_t *aulDirectories;
+   size_t ulNumDirectories;
+};
+
+/*
+  Creates the image pcFile, replacing any file of that name. Returns
+  SUCCESS and sets *poImage to it if successful. Otherwise, sets
+  *poImage to NULL and returns status:
+  * IO_ERROR if pcFile could not be created
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int TreeImage_create(const char *pcFile, TreeImage_T *poImage);
+
+/*
+  Appends *psNode to oImage, which TreeImage_create made, and sets
+  *pulNode to its offset. A directory's children must already be in
+  the image. Returns SUCCESS, or IO_ERROR if writing failed, in which
+  case *pulNode is 0.
+*/
+int TreeImage_add(TreeImage_T oImage,
+                  const struct TreeImageNode *psNode, size_t *pulNode);
+
+/*
+  Finishes oImage, which TreeImage_create made, with ulRoot as its
+  root, or with no nodes if ulRoot is 0, and frees it. Returns
+  SUCCESS, or IO_ERROR if a write since TreeImage_create failed or
+  the last ones did.
+*/
+int TreeImage_finish(TreeImage_T oImage, size_t ulRoot);
+
+/*
+  Maps the image pcFile into memory, read-only, for reading. Costs
+  O(1) in the size of the image, which is read only as its nodes are
+  used. Returns SUCCESS and sets *poImage to it if successful.
+  Otherwise, sets *poImage to NULL and returns status:
+  * IO_ERROR if pcFile could not be opened or mapped, or is not an
+             image that this machine reads
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int TreeImage_open(const char *pcFile, TreeImage_T *poImage);
+
+/* Returns the offset of oImage's root, or 0 if it has no nodes. */
+size_t TreeImage_getRoot(TreeImage_T oImage);
+
+/*
+  Reads the node at offset ulNode of oImage, which TreeImage_open
+  mapped, into *psNode, whose pointers point into the mapping and
+  stay valid until TreeImage_close. Returns SUCCESS, or IO_ERROR if
+  ulNode is not the offset of a node that lies wholly inside the
+  image, which only a damaged image gives.
+*/
+int TreeImage_getNode(TreeImage_T oImage, size_t ulNode,
+                      struct TreeImageNode *psNode);
+
+/*
+  Finds the node of oImage, which TreeImage_open mapped, with the
+  well-formed absolute path pcPath, and reads it into *psNode as
+  TreeImage_getNode does. Looks each component up by binary search
+  where the image lies, taking no lock and allocating nothing.
+  Returns SUCCESS, or else:
+  * CONFLICTING_PATH if the root's name is not pcPath's first
+                     component
+  * NO_SUCH_PATH if no node has path pcPath, or one before the last
+                 component is a file
+  * IO_ERROR if a node along the way is damaged
+*/
+int TreeImage_find(TreeImage_T oImage, const char *pcPath,
+                   struct TreeImageNode *psNode);
+
+/*
+  Finds the node of oImage, which TreeImage_open mapped, that follows
+  in walk order, which is that of FT_toString: each directory before
+  its children, and its files, by name, before its directories, by
+  name. pcToken names where the walk stands: "" before the root, or
+  'F' or 'D' for the kind of a node followed by its absolute path,
+  which need not exist in oImage. Sets *pulNext to the offset of the
+  node that follows and the *pulDepth offsets at aulStack to its
+  directories, root first; aulStack must hold as many offsets as
+  pcToken's path has components. Returns SUCCESS, or NO_SUCH_PATH if
+  no node follows, in which case *pulNext is 0, or IO_ERROR if a node
+  is damaged.
+*/
+int TreeImage_next(TreeImage_T oImage, const char *pcToken,
+                   size_t *aulStack, size_t *pulDepth,
+                   size_t *pulNext);
+
+/*
+  Returns the length of the absolute path of the node of oImage at
+  ulNode, whose directories are the ulDepth offsets at aulStack as
+  TreeImage_next set them, and if pcBuf is not NULL writes the path
+  there, '\0'-terminated.
+*/
+size_t TreeImage_getPath(TreeImage_T oImage, const size_t *aulStack,
+                         size_t ulDepth, size_t ulNode, char *pcBuf);
+
+/*
+  Unmaps oImage, which TreeImage_open mapped, and frees it. oImage
+  may be NULL.
+*/
+void TreeImage_close(TreeImage_T oImage);
+
+#endif